@@ -49,8 +49,9 @@
 
 #include "hexchat-plugin.h"
 
-#define BUFSIZE 32768
+#define BUFSIZE 262144
 #define DEFAULT_LIMIT 256									/* default size is 256 MiB */
+#define PROGRESS_INTERVAL 1000								/* ms between looks at the worker */
 
 static hexchat_plugin *ph;									/* plugin handle */
 static char name[] = "Checksum";
@@ -89,10 +90,32 @@ sha256 (char *string, char outputBuffer[65])
 }
 #endif
 
+/* a file waiting for, or being hashed by, the worker thread */
+typedef struct
+{
+	char *path;
+	char *file;				/* name to show */
+	char *nick;
+	hexchat_context *context;	/* where the offer was made */
+	int remote;				/* an offer, tell the other side */
+	gint64 size;
+	volatile gint percent;	/* written by the worker */
+	int next_report;			/* percent at which to say how far along we are */
+	int result;
+	char sum[65];
+} hash_job;
+
+static GThreadPool *hash_pool;
+static GAsyncQueue *hash_done;
+static GSList *hash_jobs;									/* main thread only */
+static hexchat_hook *hash_timer;
+static volatile gint shutting_down;
+
 static int
-sha256_file (const char *path, char outputBuffer[65])
+sha256_file (const char *path, char outputBuffer[65], hash_job *job)
 {
-	int bytesRead;
+	size_t bytesRead;
+	gint64 total = 0;
 	unsigned char *buffer;
 	unsigned char hash[SHA256_DIGEST_LENGTH];
 	SHA256_CTX sha256;
@@ -115,7 +138,19 @@ sha256_file (const char *path, char outputBuffer[65])
 
 	while ((bytesRead = fread (buffer, 1, BUFSIZE, file)))
 	{
+		if (g_atomic_int_get (&shutting_down))
+		{
+			fclose (file);
+			free (buffer);
+			return ECANCELED;
+		}
+
 		SHA256_Update (&sha256, buffer, bytesRead);
+		total += bytesRead;
+		if (job && job->size > 0)
+		{
+			g_atomic_int_set (&job->percent, (gint) (total * 100 / job->size));
+		}
 	}
 
 	SHA256_Final (hash, &sha256);
@@ -126,6 +161,155 @@ sha256_file (const char *path, char outputBuffer[65])
 	return 0;
 }
 
+static void
+hash_worker (gpointer data, gpointer user_data)
+{
+	hash_job *job = data;
+
+	job->result = sha256_file (job->path, job->sum, job);
+	g_async_queue_push (hash_done, job);
+}
+
+static void
+hash_job_free (hash_job *job)
+{
+	g_free (job->path);
+	g_free (job->file);
+	g_free (job->nick);
+	g_free (job);
+}
+
+static void
+hash_job_report (hash_job *job)
+{
+	if (job->remote)
+	{
+		if (!hexchat_set_context (ph, job->context))
+		{
+			return;											/* the server tab is gone, so is the offer */
+		}
+		if (job->result == 0)
+		{
+			hexchat_commandf (ph, "quote PRIVMSG %s :SHA-256 checksum for %s (remote): %s", job->nick, job->file, job->sum);
+		}
+		else
+		{
+			hexchat_printf (ph, "File access error!\n");
+		}
+		return;
+	}
+
+	/* try to print the checksum in the privmsg tab of the sender */
+	hexchat_set_context (ph, hexchat_find_context (ph, NULL, job->nick));
+	if (job->result == 0)
+	{
+		hexchat_printf (ph, "SHA-256 checksum for %s (local):  %s\n", job->file, job->sum);
+	}
+	else
+	{
+		hexchat_printf (ph, "File access error!\n");
+	}
+}
+
+static int
+hash_timer_cb (void *userdata)
+{
+	hash_job *job;
+	GSList *list;
+
+	while ((job = g_async_queue_try_pop (hash_done)))
+	{
+		hash_jobs = g_slist_remove (hash_jobs, job);
+		hash_job_report (job);
+		hash_job_free (job);
+	}
+
+	/* big files take a while, say how far along they are */
+	for (list = hash_jobs; list; list = list->next)
+	{
+		int percent;
+
+		job = list->data;
+		percent = g_atomic_int_get (&job->percent);
+		if (percent >= job->next_report && percent < 100)
+		{
+			if (job->remote || !hexchat_set_context (ph, hexchat_find_context (ph, NULL, job->nick)))
+			{
+				hexchat_set_context (ph, job->context);
+			}
+			hexchat_printf (ph, "SHA-256 checksum for %s: %d%% hashed\n", job->file, percent);
+			job->next_report = (percent / 25 + 1) * 25;
+		}
+	}
+
+	if (!hash_jobs)
+	{
+		hash_timer = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+/* hashes path on the worker thread and reports back on the main one */
+static void
+hash_in_background (const char *path, gint64 size, const char *file, const char *nick, int remote)
+{
+	hash_job *job = g_new0 (hash_job, 1);
+
+	job->path = g_strdup (path);
+	job->file = g_strdup (file);
+	job->nick = g_strdup (nick);
+	job->context = hexchat_get_context (ph);
+	job->remote = remote;
+	job->size = size;
+	job->next_report = 25;
+
+	hash_jobs = g_slist_prepend (hash_jobs, job);
+	g_thread_pool_push (hash_pool, job, NULL);
+
+	if (!hash_timer)
+	{
+		hash_timer = hexchat_hook_timer (ph, PROGRESS_INTERVAL, hash_timer_cb, NULL);
+	}
+}
+
+/* the core hashes receives as they are written, look for that first. Older
+ * transfers of the same file can still be in the list, the one that just
+ * completed is the finished receive from nick with the highest id. */
+static char *
+dcc_sha256 (const char *destfile, const char *nick)
+{
+	hexchat_list *list;
+	char *sum = NULL;
+	int best_id = 0;
+
+	list = hexchat_list_get (ph, "dcc");
+	if (!list)
+	{
+		return NULL;
+	}
+
+	while (hexchat_list_next (ph, list))
+	{
+		const char *dest = hexchat_list_str (ph, list, "destfile");
+		const char *from = hexchat_list_str (ph, list, "nick");
+		int id = hexchat_list_int (ph, list, "id");
+
+		if (hexchat_list_int (ph, list, "type") == 1 && hexchat_list_int (ph, list, "status") == 3
+			&& id > best_id && dest && !strcmp (dest, destfile) && from && !hexchat_nickcmp (ph, from, nick))
+		{
+			const char *found = hexchat_list_str (ph, list, "sha256");
+
+			best_id = id;
+			g_free (sum);
+			sum = (found && found[0]) ? g_strdup (found) : NULL;
+		}
+	}
+
+	hexchat_list_free (ph, list);
+	return sum;
+}
+
 static void
 set_limit (const char* size)
 {
@@ -174,10 +358,20 @@ dccrecv_cb(const char *const word[], void *userdata)
 {
 	int result;
 	struct stat buffer;									/* buffer for storing file info */
-	char sum[65];											/* buffer for checksum */
+	char *sum;
 	const char *file;
 	char *cfile;
 
+	sum = dcc_sha256 (word[2], word[3]);
+	if (sum)
+	{
+		/* try to print the checksum in the privmsg tab of the sender */
+		hexchat_set_context (ph, hexchat_find_context (ph, NULL, word[3]));
+		hexchat_printf (ph, "SHA-256 checksum for %s (local):  %s\n", word[1], sum);
+		g_free (sum);
+		return HEXCHAT_EAT_NONE;
+	}
+
 	if (hexchat_get_prefs (ph, "dcc_completed_dir", &file, NULL) == 1 && file[0] != 0)
 	{
 		cfile = g_strconcat (file, G_DIR_SEPARATOR_S, word[1], NULL);
@@ -192,10 +386,7 @@ dccrecv_cb(const char *const word[], void *userdata)
 	{
 		if (buffer.st_size <= (unsigned long long) get_limit () * 1048576)
 		{
-			sha256_file (cfile, sum);						/* file is the full filename even if completed dir set */
-			/* try to print the checksum in the privmsg tab of the sender */
-			hexchat_set_context (ph, hexchat_find_context (ph, NULL, word[3]));
-			hexchat_printf (ph, "SHA-256 checksum for %s (local):  %s\n", word[1], sum);
+			hash_in_background (cfile, buffer.st_size, word[1], word[3], FALSE);	/* file is the full filename even if completed dir set */
 		}
 		else
 		{
@@ -217,15 +408,13 @@ dccoffer_cb(const char *const word[], void *userdata)
 {
 	int result;
 	struct stat buffer;									/* buffer for storing file info */
-	char sum[65];											/* buffer for checksum */
 
 	result = stat (word[3], &buffer);
 	if (result == 0)										/* stat returns 0 on success */
 	{
 		if (buffer.st_size <= (unsigned long long) get_limit () * 1048576)
 		{
-			sha256_file (word[3], sum);						/* word[3] is the full filename */
-			hexchat_commandf (ph, "quote PRIVMSG %s :SHA-256 checksum for %s (remote): %s", word[2], word[1], sum);
+			hash_in_background (word[3], buffer.st_size, word[1], word[2], TRUE);	/* word[3] is the full filename */
 		}
 		else
 		{
@@ -277,6 +466,9 @@ hexchat_plugin_init (hexchat_plugin *plugin_handle, char **plugin_name, char **p
 		hexchat_pluginpref_set_int (ph, "limit", DEFAULT_LIMIT);
 	}
 
+	hash_done = g_async_queue_new ();
+	hash_pool = g_thread_pool_new (hash_worker, NULL, 1, FALSE, NULL);
+
 	hexchat_hook_command (ph, "CHECKSUM", HEXCHAT_PRI_NORM, checksum, "Usage: /CHECKSUM GET|SET", 0);
 	hexchat_hook_print (ph, "DCC RECV Complete", HEXCHAT_PRI_NORM, dccrecv_cb, NULL);
 	hexchat_hook_print (ph, "DCC Offer", HEXCHAT_PRI_NORM, dccoffer_cb, NULL);
@@ -288,6 +480,20 @@ hexchat_plugin_init (hexchat_plugin *plugin_handle, char **plugin_name, char **p
 int
 hexchat_plugin_deinit (void)
 {
+	hash_job *job;
+
+	/* stop the file being hashed now, drop the ones waiting */
+	g_atomic_int_set (&shutting_down, 1);
+	g_thread_pool_free (hash_pool, TRUE, TRUE);
+	while ((job = g_async_queue_try_pop (hash_done)))
+	{
+		hash_jobs = g_slist_remove (hash_jobs, job);
+		hash_job_free (job);
+	}
+	g_slist_free_full (hash_jobs, (GDestroyNotify) hash_job_free);
+	hash_jobs = NULL;
+	g_async_queue_unref (hash_done);
+
 	hexchat_printf (ph, "%s plugin unloaded\n", name);
 	return 1;
 }
@@ -61,8 +61,7 @@ static const signed char fish_unbase64[256] = {
 } while (0);
 
 
-char *fish_encrypt(const char *key, size_t keylen, const char *message) {
-    BF_KEY bfkey;
+static char *fish_encrypt_bf(const BF_KEY *bfkey, const char *message) {
     size_t messagelen;
     size_t i;
     int j;
@@ -71,7 +70,6 @@ char *fish_encrypt(const char *key, size_t keylen, const char *message) {
     unsigned char bit;
     unsigned char word;
     unsigned char d;
-    BF_set_key(&bfkey, keylen, (const unsigned char*)key);
     
     messagelen = strlen(message);
     if (messagelen == 0) return NULL;
@@ -91,7 +89,7 @@ char *fish_encrypt(const char *key, size_t keylen, const char *message) {
         message += 8;
         
         // Encrypt block
-        BF_encrypt(binary, &bfkey);
+        BF_encrypt(binary, bfkey);
         
         // Emit FiSH-BASE64
         bit = 0;
@@ -114,15 +112,13 @@ char *fish_encrypt(const char *key, size_t keylen, const char *message) {
 }
 
 
-char *fish_decrypt(const char *key, size_t keylen, const char *data) {
-    BF_KEY bfkey;
+static char *fish_decrypt_bf(const BF_KEY *bfkey, const char *data) {
     size_t i;
     char *decrypted;
     char *end;
     unsigned char bit;
     unsigned char word;
     unsigned char d;
-    BF_set_key(&bfkey, keylen, (const unsigned char*)key);
     
     decrypted = malloc(strlen(data)+1);
     end = decrypted;
@@ -145,7 +141,7 @@ char *fish_decrypt(const char *key, size_t keylen, const char *data) {
         }
         
         // Decrypt block
-        BF_decrypt(binary, &bfkey);
+        BF_decrypt(binary, bfkey);
         
         // Copy to buffer
         GET_BYTES(end, binary[0]);
@@ -157,41 +153,46 @@ char *fish_decrypt(const char *key, size_t keylen, const char *data) {
     return decrypted;
 }
 
+char *fish_encrypt(const char *key, size_t keylen, const char *message) {
+    BF_KEY bfkey;
+    BF_set_key(&bfkey, keylen, (const unsigned char*)key);
+    return fish_encrypt_bf(&bfkey, message);
+}
+
+char *fish_decrypt(const char *key, size_t keylen, const char *data) {
+    BF_KEY bfkey;
+    BF_set_key(&bfkey, keylen, (const unsigned char*)key);
+    return fish_decrypt_bf(&bfkey, data);
+}
+
 /**
  * Encrypts a message (see fish_decrypt). The key is searched for in the
- * key store.
+ * key store, which keeps it expanded between messages.
  */
 char *fish_encrypt_for_nick(const char *nick, const char *data) {
-    char *key;
-    char *encrypted;
+    const BF_KEY *bfkey;
 
     // Look for key
-    key = keystore_get_key(nick);
-    if (!key) return NULL;
+    bfkey = keystore_get_bfkey(nick);
+    if (!bfkey) return NULL;
     
     // Encrypt
-    encrypted = fish_encrypt(key, strlen(key), data);
-    
-    free(key);
-    return encrypted;
+    return fish_encrypt_bf(bfkey, data);
 }
 
 /**
  * Decrypts a message (see fish_decrypt). The key is searched for in the
- * key store.
+ * key store, which keeps it expanded between messages.
  */
 char *fish_decrypt_from_nick(const char *nick, const char *data) {
-    char *key;
-    char *decrypted;
+    const BF_KEY *bfkey;
+
     // Look for key
-    key = keystore_get_key(nick);
-    if (!key) return NULL;
+    bfkey = keystore_get_bfkey(nick);
+    if (!bfkey) return NULL;
     
     // Decrypt
-    decrypted = fish_decrypt(key, strlen(key), data);
-    
-    free(key);
-    return decrypted;
+    return fish_decrypt_bf(bfkey, data);
 }
 
 
@@ -23,8 +23,10 @@
 */
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <openssl/blowfish.h>
 #include "irc.h"
 #include "fish.h"
 #include "misc.h"
@@ -34,20 +36,98 @@
 
 static char *keystore_password = NULL;
 
+// How often to look at the key store file for changes made behind our back
+#define KEYFILE_CHECK_INTERVAL (2 * G_USEC_PER_SEC)
+// Forget all expanded keys once there are this many
+#define KEY_CACHE_MAX 256
+
+/* The parsed key store file, and how it looked on disk when it was read */
+static GKeyFile *keyfile_cache = NULL;
+static time_t keyfile_mtime = 0;
+static gint64 keyfile_size = -1;
+static gint64 keyfile_checked = 0;
+
+/* A key ready for use, decrypted and with its Blowfish schedule expanded */
+typedef struct {
+    char *key;
+    BF_KEY bfkey;
+} cached_key;
+
+/* nick/channel as asked for -> cached_key, or NULL if it has no key */
+static GHashTable *key_cache = NULL;
+
+
+static void free_cached_key(gpointer data) {
+    cached_key *entry = data;
+    if (!entry) return;
+    secure_erase(entry->key, strlen(entry->key));
+    free(entry->key);
+    secure_erase(&entry->bfkey, sizeof(entry->bfkey));
+    g_free(entry);
+}
+
+/**
+ * Drops every expanded key, they are worked out again when next needed.
+ */
+static void forget_keys() {
+    if (key_cache) g_hash_table_remove_all(key_cache);
+}
+
+/**
+ * Throws the parsed key store away, it is read again when next needed.
+ */
+static void discard_keyfile() {
+    if (keyfile_cache) g_key_file_free(keyfile_cache);
+    keyfile_cache = NULL;
+    forget_keys();
+}
+
+/**
+ * Remembers the size and modification time of the key store file.
+ */
+static void remember_file_state(const char *filename) {
+    GStatBuf st;
+    if (g_stat(filename, &st) == 0) {
+        keyfile_mtime = st.st_mtime;
+        keyfile_size = st.st_size;
+    } else {
+        keyfile_mtime = 0;
+        keyfile_size = -1;
+    }
+}
 
 /**
  * Opens the key store file: ~/.config/hexchat/addon_fishlim.conf
+ *
+ * The file is parsed once and kept; it is only read again when its size or
+ * modification time changes. The returned key file must not be freed.
  */
 static GKeyFile *getConfigFile() {
-    gchar *filename = get_config_filename();
+    gchar *filename;
+    time_t old_mtime = keyfile_mtime;
+    gint64 old_size = keyfile_size;
+    gint64 now = g_get_monotonic_time();
+    
+    if (keyfile_cache && now - keyfile_checked < KEYFILE_CHECK_INTERVAL)
+        return keyfile_cache;
+    keyfile_checked = now;
+    
+    filename = get_config_filename();
+    remember_file_state(filename);
+    if (keyfile_cache && keyfile_mtime == old_mtime && keyfile_size == old_size) {
+        g_free(filename);
+        return keyfile_cache;
+    }
     
-    GKeyFile *keyfile = g_key_file_new();
-    g_key_file_load_from_file(keyfile, filename,
+    if (keyfile_cache) g_key_file_free(keyfile_cache);
+    keyfile_cache = g_key_file_new();
+    g_key_file_load_from_file(keyfile_cache, filename,
                               G_KEY_FILE_KEEP_COMMENTS |
                               G_KEY_FILE_KEEP_TRANSLATIONS, NULL);
+    forget_keys();
     
     g_free(filename);
-    return keyfile;
+    return keyfile_cache;
 }
 
 
@@ -86,11 +166,9 @@ static gchar *get_nick_value(GKeyFile *keyfile, const char *nick, const char *it
 /**
  * Extracts a key from the key store file.
  */
-char *keystore_get_key(const char *nick) {
+static char *read_key(GKeyFile *keyfile, const char *nick) {
     // Get the key
-    GKeyFile *keyfile = getConfigFile();
     gchar *value = get_nick_value(keyfile, nick, "key");
-    g_key_file_free(keyfile);
     if (!value) return NULL;
     
     if (strncmp(value, "+OK ", 4) != 0) {
@@ -106,6 +184,52 @@ char *keystore_get_key(const char *nick) {
     }
 }
 
+/**
+ * Finds the key for a nick/channel, reading and expanding it only the
+ * first time it's asked for.
+ */
+static cached_key *lookup_key(const char *nick) {
+    GKeyFile *keyfile = getConfigFile();
+    cached_key *entry = NULL;
+    gpointer found;
+    char *key;
+    
+    if (!key_cache)
+        key_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_cached_key);
+    if (g_hash_table_lookup_extended(key_cache, nick, NULL, &found))
+        return found;
+    
+    key = read_key(keyfile, nick);
+    if (key) {
+        entry = g_new0(cached_key, 1);
+        entry->key = key;
+        BF_set_key(&entry->bfkey, strlen(key), (const unsigned char*)key);
+    }
+    
+    // Lots of different nicks asking, start over rather than grow forever
+    if (g_hash_table_size(key_cache) >= KEY_CACHE_MAX) forget_keys();
+    g_hash_table_insert(key_cache, g_strdup(nick), entry);
+    return entry;
+}
+
+/**
+ * Gets the key for a nick/channel. The result must be freed.
+ */
+char *keystore_get_key(const char *nick) {
+    cached_key *entry = lookup_key(nick);
+    if (!entry) return NULL;
+    return import_glib_string(g_strdup(entry->key));
+}
+
+/**
+ * Gets the expanded Blowfish key for a nick/channel. It belongs to the
+ * key store and is only good until the next call into it.
+ */
+const BF_KEY *keystore_get_bfkey(const char *nick) {
+    cached_key *entry = lookup_key(nick);
+    return entry ? &entry->bfkey : NULL;
+}
+
 /**
  * Deletes a nick and the associated key in the key store file.
  */
@@ -158,6 +282,8 @@ static bool save_keystore(GKeyFile *keyfile) {
 #else
     ok = g_key_file_save_to_file (keyfile, filename, NULL);
 #endif
+    // Our own write isn't a change to pick up
+    remember_file_state(filename);
     g_free (filename);
 
     return ok;
@@ -199,7 +325,9 @@ bool keystore_store_key(const char *nick, const char *key) {
     ok = save_keystore(keyfile);
     
   end:
-    g_key_file_free(keyfile);
+    // The old key is already gone from memory, go back to what's on disk
+    if (!ok) discard_keyfile();
+    forget_keys();
     return ok;
 }
 
@@ -213,9 +341,9 @@ bool keystore_delete_nick(const char *nick) {
     bool ok = delete_nick(keyfile, nick);
     
     // Save
-    if (ok) save_keystore(keyfile);
+    if (ok && !save_keystore(keyfile)) discard_keyfile();
     
-    g_key_file_free(keyfile);
+    forget_keys();
     return ok;
 }
 
@@ -225,4 +353,18 @@ void keystore_secure_free(void *ptr, size_t size) {
     free(ptr);
 }
 
+/**
+ * Forgets the key store and every key taken from it.
+ */
+void keystore_cleanup(void) {
+    if (key_cache) {
+        g_hash_table_destroy(key_cache);
+        key_cache = NULL;
+    }
+    discard_keyfile();
+    keyfile_mtime = 0;
+    keyfile_size = -1;
+    keyfile_checked = 0;
+}
+
 
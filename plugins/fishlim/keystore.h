@@ -27,12 +27,15 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <openssl/blowfish.h>
 
 char *keystore_get_key(const char *nick);
+const BF_KEY *keystore_get_bfkey(const char *nick);
 bool keystore_store_key(const char *nick, const char *key);
 bool keystore_delete_nick(const char *nick);
 
 void keystore_secure_free(void *ptr, size_t size);
+void keystore_cleanup(void);
 
 #endif
 
@@ -297,6 +297,7 @@ int hexchat_plugin_init(hexchat_plugin *plugin_handle,
 }
 
 int hexchat_plugin_deinit(void) {
+    keystore_cleanup();
     hexchat_printf(ph, "%s plugin unloaded\n", plugin_name);
     return 1;
 }
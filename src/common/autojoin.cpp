@@ -0,0 +1,213 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include "hexchat.hpp"
+#include "autojoin.hpp"
+#include "fe.hpp"
+#include "hexchatc.hpp"
+#include "server.hpp"
+#include "session.hpp"
+#include "text.hpp"
+#include "util.hpp"
+
+#define AUTOJOIN_QUERY_INTERVAL 1000	/* ms between batches of MODE/WHO */
+#define AUTOJOIN_QUERIES_PER_TICK 2		/* channels per batch */
+#define AUTOJOIN_REPORT_AFTER 60		/* seconds to wait for the last JOIN */
+
+namespace autojoin
+{
+	namespace
+	{
+		struct query
+		{
+			std::string channel;
+			bool who;
+		};
+
+		struct pending
+		{
+			std::int64_t started = 0;
+			std::size_t expected = 0;
+			std::unordered_set<std::string> waiting;	/* not joined yet */
+			std::deque<query> queries;
+			int tag = 0;
+		};
+
+		std::unordered_map<server*, pending> servers;
+
+		void report(server &serv, const pending &p)
+		{
+			const auto joined = static_cast<int>(p.expected - p.waiting.size());
+			const double took = (g_get_monotonic_time () - p.started) / 1e6;
+			if (p.waiting.empty ())
+				PrintTextf (serv.server_session, _("Joined %d channels in %.1f seconds.\n"), joined, took);
+			else
+				PrintTextf (serv.server_session, _("Joined %d of %d channels in %.1f seconds.\n"),
+					joined, static_cast<int>(p.expected), took);
+		}
+
+		void send_queries(server &serv, const std::string &channel, bool who)
+		{
+			serv.p_join_info (channel);
+			if (!who)
+				return;
+			serv.p_user_list (channel);
+			/* only now, a /who typed while ours waited its turn is shown */
+			auto sess = serv.find_channel (boost::string_ref (channel));
+			if (sess)
+				sess->doing_who = true;
+		}
+
+		int tick(server *serv)
+		{
+			auto found = servers.find (serv);
+			if (found == servers.end ())
+				return 0;
+			auto & p = found->second;
+
+			/* with the throttle on, don't pile up behind what's queued already */
+			for (int sent = 0; sent < AUTOJOIN_QUERIES_PER_TICK && !p.queries.empty ()
+				&& serv->outbound_queue.empty (); ++sent)
+			{
+				auto q = std::move (p.queries.front ());
+				p.queries.pop_front ();
+				/* parted meanwhile? */
+				if (serv->find_channel (boost::string_ref (q.channel)))
+					send_queries (*serv, q.channel, q.who);
+			}
+
+			/* some of them won't come, banned or full or whatever */
+			if (!p.waiting.empty ()
+				&& g_get_monotonic_time () - p.started > AUTOJOIN_REPORT_AFTER * G_USEC_PER_SEC)
+			{
+				report (*serv, p);
+				p.waiting.clear ();
+			}
+
+			if (p.queries.empty () && p.waiting.empty ())
+			{
+				servers.erase (found);
+				return 0;
+			}
+			return 1;
+		}
+	}
+
+	std::vector<std::string> pack(std::vector<favchannel> channels, int max_targets)
+	{
+		std::stable_partition (channels.begin (), channels.end (), [](const favchannel & c){
+			return static_cast<bool>(c.key);
+		});
+
+		std::vector<std::string> lines;
+		std::string names;
+		std::string keys;
+		int targets = 0;
+		for (const auto & c : channels)
+		{
+			/* "JOIN names keys\r\n" with this one added */
+			std::size_t len = 5 + names.size () + (names.empty () ? 0 : 1) + c.name.size ()
+				+ (keys.empty () ? 0 : 1 + keys.size ()) + 2;
+			if (c.key)
+				len += 1 + c.key->size ();
+
+			if (targets && ((max_targets > 0 && targets >= max_targets) || len > MAX_LINE))
+			{
+				lines.emplace_back ("JOIN " + names + (keys.empty () ? "" : " " + keys));
+				names.clear ();
+				keys.clear ();
+				targets = 0;
+			}
+
+			if (targets)
+				names.push_back (',');
+			names += c.name;
+			if (c.key)
+			{
+				if (!keys.empty ())
+					keys.push_back (',');
+				keys += *c.key;
+			}
+			targets++;
+		}
+		if (targets)
+			lines.emplace_back ("JOIN " + names + (keys.empty () ? "" : " " + keys));
+		return lines;
+	}
+
+	void start(server &serv, const std::vector<favchannel> &channels)
+	{
+		auto & p = servers[&serv];
+		p.started = g_get_monotonic_time ();
+		p.waiting.clear ();
+		for (const auto & c : channels)
+			p.waiting.insert (serv.casefold (c.name));
+		p.expected = p.waiting.size ();
+		if (!p.tag)
+			p.tag = fe_timeout_add (AUTOJOIN_QUERY_INTERVAL, (GSourceFunc)tick, &serv);
+
+		serv.p_join_list (channels);
+	}
+
+	void joined(server &serv, session &sess)
+	{
+		const bool who = want_who (serv);
+		auto found = servers.find (&serv);
+		if (found == servers.end () || !found->second.waiting.erase (serv.casefold (sess.channel)))
+		{
+			send_queries (serv, sess.channel, who);
+		}
+		else
+		{
+			auto & p = found->second;
+			p.queries.push_back (query{ sess.channel, who });
+			if (p.waiting.empty ())
+				report (serv, p);
+
+			/* so the away check doesn't WHO it as well meanwhile */
+			if (who)
+				sess.done_away_check = true;
+		}
+	}
+
+	bool want_who(const server &serv)
+	{
+		return prefs.hex_irc_who_join && !(serv.have_awaynotify && serv.have_extjoin);
+	}
+
+	void forget(server &serv)
+	{
+		auto found = servers.find (&serv);
+		if (found == servers.end ())
+			return;
+		if (found->second.tag)
+			fe_timeout_remove (found->second.tag);
+		servers.erase (found);
+	}
+}
@@ -0,0 +1,60 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_AUTOJOIN_HPP
+#define HEXCHAT_AUTOJOIN_HPP
+
+#include <string>
+#include <vector>
+#include <glib.h>
+#include "sessfwd.hpp"
+
+struct server;
+
+#include "servlist.hpp"
+
+/* Joining channels after login. They go out in as few JOIN lines as the
+ * 512 byte limit and the server's TARGMAX allow, and the MODE and WHO
+ * queries a join normally sends straight away are queued instead and sent
+ * a couple at a time while the send queue is empty, so hundreds of them
+ * don't get us penalized. The server tab says how long joining took. */
+namespace autojoin
+{
+	enum { MAX_LINE = 512 };	/* including the CR LF */
+
+	/* JOIN lines without the CR LF. Channels with keys go first, so the
+	 * ones without don't need filler keys. max_targets 0 means no limit. */
+	std::vector<std::string> pack(std::vector<favchannel> channels, int max_targets);
+
+	/* joins them all and starts the clock */
+	void start(server &serv, const std::vector<favchannel> &channels);
+
+	/* we've joined sess->channel: asks for its modes and users, right away
+	 * unless it was one of the autojoins */
+	void joined(server &serv, session &sess);
+
+	/* whether a join should WHO the channel; not needed when away-notify
+	 * and extended-join keep us up to date */
+	bool want_who(const server &serv);
+
+	/* disconnected, drop whatever is still queued */
+	void forget(server &serv);
+}
+
+#endif
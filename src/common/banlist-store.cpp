@@ -0,0 +1,272 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include "banlist-store.hpp"
+
+namespace banlist
+{
+	namespace
+	{
+		/* match() for a mask and text both folded already, so bytes are
+		 * compared as they are */
+		bool folded_match(const char *m, const char *s)
+		{
+			const char *star_m = nullptr, *star_s = nullptr;
+			while (*s)
+			{
+				if (*m == '*')
+				{
+					star_m = ++m;
+					star_s = s;
+					continue;
+				}
+				char want = *m;
+				bool any = want == '?';
+				if (want == '\\' && (m[1] == '*' || m[1] == '?'))
+				{
+					want = *++m;
+					any = false;
+				}
+				if (want && (any || want == *s))
+				{
+					++m;
+					++s;
+				}
+				else if (star_m)
+				{
+					m = star_m;
+					s = ++star_s;
+				}
+				else
+					return false;
+			}
+			while (*m == '*')
+				++m;
+			return !*m;
+		}
+
+		bool literal(const boost::string_ref & part)
+		{
+			return part.find_first_of("*?\\") == boost::string_ref::npos;
+		}
+	}
+
+	list_type from_reply(int rplcode)
+	{
+		switch (rplcode)
+		{
+		case 367: return BANS;
+		case 348: return EXEMPTS;
+		case 346: return INVITES;
+		case 728: return QUIETS;
+		}
+		return LIST_COUNT;
+	}
+
+	list_type from_end(int rplcode)
+	{
+		switch (rplcode)
+		{
+		case 368: return BANS;
+		case 349: return EXEMPTS;
+		case 347: return INVITES;
+		case 729: return QUIETS;
+		}
+		return LIST_COUNT;
+	}
+
+	list_type from_mode(char mode)
+	{
+		switch (mode)
+		{
+		case 'b': return BANS;
+		case 'e': return EXEMPTS;
+		case 'I': return INVITES;
+		case 'q': return QUIETS;
+		}
+		return LIST_COUNT;
+	}
+
+	void store::insert(list &l, const boost::string_ref & mask, const boost::string_ref & setter,
+		std::time_t set_at, const casemap & fold)
+	{
+		for (const auto & e : l.entries)
+			if (fold.equal(e.mask, mask))
+				return;
+		l.entries.push_back(entry{ mask.to_string(), setter.to_string(), set_at });
+	}
+
+	void store::reply(list_type type, const boost::string_ref & mask, const boost::string_ref & setter, std::time_t set_at)
+	{
+		auto & l = lists_[type];
+		if (!l.loading)
+		{
+			l.entries.clear();
+			l.loading = true;
+			l.complete = false;
+		}
+		/* a list we're fetching has no duplicates, don't look for them */
+		l.entries.push_back(entry{ mask.to_string(), setter.to_string(), set_at });
+	}
+
+	void store::end(list_type type)
+	{
+		auto & l = lists_[type];
+		l.loading = false;
+		l.complete = true;
+	}
+
+	void store::add(list_type type, const boost::string_ref & mask, const boost::string_ref & setter,
+		std::time_t set_at, const casemap & fold)
+	{
+		insert(lists_[type], mask, setter, set_at, fold);
+	}
+
+	bool store::remove(list_type type, const boost::string_ref & mask, const casemap & fold)
+	{
+		auto & entries = lists_[type].entries;
+		auto found = std::find_if(entries.begin(), entries.end(), [&mask, &fold](const entry & e){
+			return fold.equal(e.mask, mask);
+		});
+		if (found == entries.end())
+			return false;
+		entries.erase(found);
+		return true;
+	}
+
+	void store::clear()
+	{
+		for (auto & l : lists_)
+			l = list();
+	}
+
+	const std::vector<entry> & store::entries(list_type type) const
+	{
+		return lists_[type].entries;
+	}
+
+	bool store::complete(list_type type) const
+	{
+		return lists_[type].complete;
+	}
+
+	matcher::matcher(const std::vector<entry> & entries, const casemap & fold)
+		:entries_(entries), fold_(fold)
+	{
+		folded_.reserve(entries.size());
+		for (std::size_t i = 0; i < entries.size(); ++i)
+		{
+			/* everything below is filed and looked up folded */
+			folded_.push_back(fold_mask(entries[i].mask));
+			const boost::string_ref mask = folded_.back();
+			const auto bang = mask.find('!');
+			if (bang == boost::string_ref::npos)
+				continue;	/* an extended ban */
+			auto at = mask.substr(bang).find('@');
+			if (at == boost::string_ref::npos)
+				continue;
+			at += bang;
+
+			const auto nick = mask.substr(0, bang);
+			const auto user = mask.substr(bang + 1, at - bang - 1);
+			const auto host = mask.substr(at + 1);
+
+			if (literal(host))
+				by_host_[host.to_string()].push_back(i);
+			else if (literal(nick))
+				by_nick_[nick.to_string()].push_back(i);
+			else if (literal(user))
+				by_user_[user.to_string()].push_back(i);
+			else if (host.size() > 2 && host[0] == '*' && host[1] == '.' && literal(host.substr(1)))
+				by_suffix_[host.substr(1).to_string()].push_back(i);
+			else if (host.size() > 2 && host.back() == '*' && (host[host.size() - 2] == '.' || host[host.size() - 2] == ':')
+				&& literal(host.substr(0, host.size() - 1)))
+				by_prefix_[host.substr(0, host.size() - 1).to_string()].push_back(i);
+			else
+				other_.push_back(i);
+		}
+	}
+
+	std::string matcher::fold(const boost::string_ref & text) const
+	{
+		return fold_.key(text);
+	}
+
+	/* rfc1459 folds a backslash to |, but an escaped * or ? stays escaped */
+	std::string matcher::fold_mask(const std::string & mask) const
+	{
+		auto folded = fold_.key(mask);
+		for (std::size_t i = 0; i + 1 < mask.size(); ++i)
+		{
+			if (mask[i] == '\\' && (mask[i + 1] == '*' || mask[i + 1] == '?'))
+				folded[i++] = '\\';
+		}
+		return folded;
+	}
+
+	void matcher::match(const boost::string_ref & nick, const boost::string_ref & user,
+		const boost::string_ref & host, std::vector<std::size_t> & out) const
+	{
+		out.clear();
+		std::vector<std::size_t> candidates(other_);
+		auto look = [&candidates](const index & idx, const std::string & key){
+			auto found = idx.find(key);
+			if (found != idx.end())
+				candidates.insert(candidates.end(), found->second.begin(), found->second.end());
+		};
+
+		const auto folded_host = fold(host);
+		look(by_host_, folded_host);
+		look(by_nick_, fold(nick));
+		look(by_user_, fold(user));
+		if (!by_suffix_.empty() || !by_prefix_.empty())
+		{
+			for (std::size_t pos = 0; pos < folded_host.size(); ++pos)
+			{
+				if (folded_host[pos] != '.' && folded_host[pos] != ':')
+					continue;
+				if (folded_host[pos] == '.')
+					look(by_suffix_, folded_host.substr(pos));
+				look(by_prefix_, folded_host.substr(0, pos + 1));
+			}
+		}
+		if (candidates.empty())
+			return;
+
+		std::string full;
+		full.reserve(nick.size() + user.size() + host.size() + 2);
+		full.append(nick.begin(), nick.end());
+		full.push_back('!');
+		full.append(user.begin(), user.end());
+		full.push_back('@');
+		full.append(host.begin(), host.end());
+		full = fold(full);
+
+		for (auto i : candidates)
+			if (folded_match(folded_[i].c_str(), full.c_str()))
+				out.push_back(i);
+		std::sort(out.begin(), out.end());
+	}
+}
@@ -0,0 +1,127 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_BANLIST_STORE_HPP
+#define HEXCHAT_BANLIST_STORE_HPP
+
+#include <array>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/utility/string_ref_fwd.hpp>
+
+#include "casemap.hpp"
+
+/* A channel's ban, exempt, invite and quiet lists as the server last sent
+ * them, kept up to date from MODE changes, so the ban list window doesn't
+ * have to keep them itself, and a matcher that checks a whole userlist
+ * against a list without trying every mask on every user. */
+namespace banlist
+{
+	/* same order as the ban list window's checkboxes */
+	enum list_type { BANS, EXEMPTS, INVITES, QUIETS, LIST_COUNT };
+
+	/* which list a numeric reply, its end, or a list mode letter is
+	 * about; LIST_COUNT if none */
+	list_type from_reply(int rplcode);
+	list_type from_end(int rplcode);
+	list_type from_mode(char mode);
+
+	struct entry
+	{
+		std::string mask;
+		std::string setter;
+		std::time_t set_at;	/* 0 if the server didn't say */
+	};
+
+	class store
+	{
+	public:
+		/* one line of a list reply; the first one after the list was
+		 * complete starts it over */
+		void reply(list_type type, const boost::string_ref & mask, const boost::string_ref & setter, std::time_t set_at);
+		/* the server's done sending it */
+		void end(list_type type);
+
+		/* +b/-b and friends seen in a MODE; masks that only differ in
+		 * case as the server's CASEMAPPING sees it are the same mask */
+		void add(list_type type, const boost::string_ref & mask, const boost::string_ref & setter,
+			std::time_t set_at, const casemap & fold);
+		bool remove(list_type type, const boost::string_ref & mask, const casemap & fold);
+
+		/* we left the channel */
+		void clear();
+
+		const std::vector<entry> & entries(list_type type) const;
+		/* we have the whole list, not just what changed since we joined */
+		bool complete(list_type type) const;
+
+	private:
+		struct list
+		{
+			std::vector<entry> entries;
+			bool loading = false;
+			bool complete = false;
+		};
+
+		void insert(list &l, const boost::string_ref & mask, const boost::string_ref & setter,
+			std::time_t set_at, const casemap & fold);
+
+		std::array<list, LIST_COUNT> lists_;
+	};
+
+	/* Masks are filed by the part that has no wildcards: the host, else
+	 * the nick, else the ident, else a domain suffix (*.example.com) or
+	 * address prefix (192.168.*). A user then only gets tested against the
+	 * masks filed under their own host, nick, ident, suffixes and
+	 * prefixes, plus the few left with wildcards everywhere, which makes
+	 * checking a whole channel O(users + bans) for real-world lists.
+	 * Extended bans ($a:account, ~q:...) aren't hostmasks and never match.
+	 * Case is folded the way the server's CASEMAPPING says. */
+	class matcher
+	{
+	public:
+		/* entries has to stay as it is while the matcher's in use */
+		matcher(const std::vector<entry> & entries, const casemap & fold);
+
+		/* indices into entries of the masks nick!user@host matches, in
+		 * ascending order */
+		void match(const boost::string_ref & nick, const boost::string_ref & user,
+			const boost::string_ref & host, std::vector<std::size_t> & out) const;
+
+	private:
+		typedef std::unordered_map<std::string, std::vector<std::size_t>> index;
+
+		std::string fold(const boost::string_ref & text) const;
+		std::string fold_mask(const std::string & mask) const;
+
+		const std::vector<entry> & entries_;
+		casemap fold_;
+		std::vector<std::string> folded_;	/* each mask, folded */
+		index by_host_;
+		index by_nick_;
+		index by_user_;
+		index by_suffix_;	/* ".example.com" */
+		index by_prefix_;	/* "192.168." */
+		std::vector<std::size_t> other_;
+	};
+}
+
+#endif
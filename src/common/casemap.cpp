@@ -0,0 +1,178 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "casemap.hpp"
+
+namespace
+{
+	/* indexed by casemap::mapping */
+	const unsigned char last_folded[] = { 'Z', '^', ']' };
+
+	struct fold_tables
+	{
+		unsigned char table[3][256];
+
+		fold_tables()
+		{
+			for (int kind = 0; kind < 3; ++kind)
+			{
+				for (int c = 0; c < 256; ++c)
+				{
+					table[kind][c] = static_cast<unsigned char>(
+						c >= 'A' && c <= last_folded[kind] ? c + ('a' - 'A') : c);
+				}
+			}
+		}
+	};
+
+	const fold_tables & tables()
+	{
+		static const fold_tables instance;
+		return instance;
+	}
+
+	const std::uint64_t ones = 0x0101010101010101ULL;
+	const std::uint64_t high_bits = ones * 0x80;
+
+	/* adds 0x20 to every byte of x in 'A'..last, without a branch: with the
+	   top bit of each byte masked off, adding a constant can't carry into
+	   the next byte and leaves the top bit telling whether it's in range */
+	std::uint64_t fold8(std::uint64_t x, unsigned char last)
+	{
+		const auto low = x & ~high_bits;
+		const auto at_least_a = low + ones * (0x80 - 'A');
+		const auto above_last = low + ones * (0x7f - last);
+		const auto in_range = at_least_a & ~above_last & ~x & high_bits;
+		return x | (in_range >> 2);
+	}
+
+	std::uint64_t load8(const char *p)
+	{
+		std::uint64_t x;
+		std::memcpy(&x, p, sizeof(x));
+		return x;
+	}
+
+	template<casemap::mapping Kind>
+	int folded_casecmp(const char *s1, const char *s2)
+	{
+		const auto table = tables().table[Kind];
+		auto str1 = reinterpret_cast<const unsigned char *>(s1);
+		auto str2 = reinterpret_cast<const unsigned char *>(s2);
+		int res;
+		while ((res = table[*str1] - table[*str2]) == 0)
+		{
+			if (*str1 == '\0')
+				return 0;
+			str1++;
+			str2++;
+		}
+		return res;
+	}
+}
+
+casemap::casemap(mapping kind)
+	:kind_(kind),
+	table_(tables().table[kind]),
+	last_(last_folded[kind])
+{}
+
+casemap::mapping casemap::parse(const boost::string_ref & name)
+{
+	if (name == "ascii")
+		return ASCII;
+	if (name == "strict-rfc1459")
+		return STRICT_RFC1459;
+	return RFC1459;
+}
+
+casemap::mapping casemap::kind() const
+{
+	return kind_;
+}
+
+void casemap::fold(char *begin, char *end) const
+{
+	for (; end - begin >= 8; begin += 8)
+	{
+		const auto folded = fold8(load8(begin), last_);
+		std::memcpy(begin, &folded, sizeof(folded));
+	}
+	for (; begin != end; ++begin)
+		*begin = static_cast<char>(table_[static_cast<unsigned char>(*begin)]);
+}
+
+std::string casemap::key(const boost::string_ref & name) const
+{
+	std::string folded(name.begin(), name.end());
+	if (!folded.empty())
+		fold(&folded[0], &folded[0] + folded.size());
+	return folded;
+}
+
+bool casemap::equal(const boost::string_ref & a, const boost::string_ref & b) const
+{
+	if (a.size() != b.size())
+		return false;
+
+	std::size_t i = 0;
+	for (; a.size() - i >= 8; i += 8)
+	{
+		if (fold8(load8(a.data() + i), last_) != fold8(load8(b.data() + i), last_))
+			return false;
+	}
+	for (; i < a.size(); ++i)
+	{
+		if (table_[static_cast<unsigned char>(a[i])] != table_[static_cast<unsigned char>(b[i])])
+			return false;
+	}
+	return true;
+}
+
+int casemap::compare(const boost::string_ref & a, const boost::string_ref & b) const
+{
+	const auto len = std::min(a.size(), b.size());
+	for (std::size_t i = 0; i < len; ++i)
+	{
+		const int res = table_[static_cast<unsigned char>(a[i])] - table_[static_cast<unsigned char>(b[i])];
+		if (res)
+			return res;
+	}
+	if (a.size() == b.size())
+		return 0;
+	return a.size() < b.size() ? -1 : 1;
+}
+
+casemap::c_compare casemap::c_function() const
+{
+	switch (kind_)
+	{
+	case ASCII:
+		return folded_casecmp<ASCII>;
+	case STRICT_RFC1459:
+		return folded_casecmp<STRICT_RFC1459>;
+	default:
+		return folded_casecmp<RFC1459>;
+	}
+}
@@ -0,0 +1,69 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#ifndef HEXCHAT_CASEMAP_HPP
+#define HEXCHAT_CASEMAP_HPP
+
+#include <string>
+#include <boost/utility/string_ref.hpp>
+
+/* How a server folds case in nicks and channel names, as CASEMAPPING= in
+ * 005 says. All three mappings lower 'A'..'Z' and differ only in how many
+ * of the bytes after 'Z' they fold too: rfc1459 takes [\]^ to {|}~,
+ * strict-rfc1459 leaves ^ alone, ascii stops at Z. Folding is one table
+ * lookup a byte, and long strings are done eight bytes at a time.
+ *
+ * key() is what to index and compare by: two names are the same exactly
+ * when their keys are equal byte for byte, and keys sort the same way
+ * compare() does. */
+class casemap
+{
+public:
+	enum mapping { ASCII, RFC1459, STRICT_RFC1459 };
+
+	explicit casemap(mapping kind = RFC1459);
+
+	/* the value of CASEMAPPING=, rfc1459 for anything we don't know */
+	static mapping parse(const boost::string_ref & name);
+
+	mapping kind() const;
+
+	unsigned char fold(unsigned char c) const
+	{
+		return table_[c];
+	}
+	void fold(char *begin, char *end) const;
+	std::string key(const boost::string_ref & name) const;
+
+	bool equal(const boost::string_ref & a, const boost::string_ref & b) const;
+	/* <0, 0 or >0 like strcmp, on the folded bytes */
+	int compare(const boost::string_ref & a, const boost::string_ref & b) const;
+
+	/* the same as compare() for C strings, for server::p_cmp */
+	typedef int (*c_compare)(const char *, const char *);
+	c_compare c_function() const;
+
+private:
+	mapping kind_;
+	const unsigned char *table_;
+	unsigned char last_;	/* the highest byte that gets folded */
+};
+
+#endif
@@ -20,6 +20,7 @@
 #define NOMINMAX
 #endif
 #include <algorithm>
+#include <cerrno>
 #include <iterator>
 #include <fcntl.h>
 #include <memory>
@@ -178,15 +179,6 @@ cfg_get_str (char *cfg, const char *var, char *dest, int dest_len)
 	}
 }
 
-static bool cfg_put_str (int fh, const char *var, const char *value)
-{
-	char buf[512];
-
-	snprintf (buf, sizeof buf, "%s = %s\n", var, value);
-	auto len = strlen (buf);
-	return (write (fh, buf, len) == len);
-}
-
 bool cfg_put_color (int fh, int r, int g, int b, const char var[])
 {
 	char buf[400];
@@ -301,6 +293,154 @@ namespace config
 		static const std::string config_dir(get_xdir());
 		return config_dir;
 	}
+
+	namespace
+	{
+		bool is_blank(char c)
+		{
+			return c == ' ' || c == '\t';
+		}
+
+		boost::string_ref skip_leading_blanks(boost::string_ref text)
+		{
+			while (!text.empty() && is_blank(text.front()))
+				text.remove_prefix(1);
+			return text;
+		}
+
+		boost::string_ref drop_trailing_blanks(boost::string_ref text)
+		{
+			while (!text.empty() && is_blank(text.back()))
+				text.remove_suffix(1);
+			return text;
+		}
+
+		std::string lowercase(boost::string_ref text)
+		{
+			std::string low(text.data(), text.size());
+			for (auto & c : low)
+				c = g_ascii_tolower(c);
+			return low;
+		}
+	}
+
+	std::vector<line> parse_lines(boost::string_ref text, char separator)
+	{
+		std::vector<line> lines;
+		lines.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+		while (!text.empty())
+		{
+			const auto end = std::min(text.find('\n'), text.size());
+			auto row = text.substr(0, end);
+			text.remove_prefix(std::min(end + 1, text.size()));
+
+			if (!row.empty() && row.back() == '\r')
+				row.remove_suffix(1);
+			if (row.empty() || row.front() == '#')
+				continue;
+
+			line ln;
+			ln.text = row;
+			const auto sep = row.find(separator);
+			if (sep == boost::string_ref::npos)
+			{
+				ln.key = drop_trailing_blanks(row);
+			}
+			else
+			{
+				/* trailing blanks in the value are kept, they may be meant */
+				ln.key = drop_trailing_blanks(row.substr(0, sep));
+				ln.value = skip_leading_blanks(row.substr(sep + 1));
+			}
+			lines.push_back(ln);
+		}
+		return lines;
+	}
+
+	settings::settings(boost::string_ref text)
+	{
+		const auto lines = parse_lines(text);
+		values_.reserve(lines.size());
+		for (const auto & ln : lines)
+			values_.emplace(lowercase(ln.key), ln.value.to_string());
+	}
+
+	const std::string *settings::find(const char *name) const
+	{
+		auto found = values_.find(lowercase(name));
+		return found == values_.end() ? nullptr : &found->second;
+	}
+
+	bool settings::get_str(const char *name, char *dest, int dest_len) const
+	{
+		auto value = find(name);
+		if (!value)
+			return false;
+		safe_strcpy(dest, value->c_str(), dest_len);
+		return true;
+	}
+
+	bool settings::get_int(const char *name, int &value) const
+	{
+		auto str = find(name);
+		if (!str)
+			return false;
+		value = std::atoi(str->c_str());
+		return true;
+	}
+
+	void writer::put_str(const char *var, boost::string_ref value)
+	{
+		buf_ += var;
+		buf_ += " = ";
+		buf_.append(value.data(), value.size());
+		buf_.push_back('\n');
+	}
+
+	void writer::put_int(const char *var, int value)
+	{
+		/* like cfg_put_int */
+		if (value == -1)
+			value = 1;
+		put_str(var, std::to_string(value));
+	}
+
+	void writer::put_raw(boost::string_ref text)
+	{
+		buf_.append(text.data(), text.size());
+	}
+
+	bool writer::commit(const std::string &path) const
+	{
+		const auto tmp_path = path + ".new";
+		int fh = g_open(tmp_path.c_str(), OFLAGS | O_TRUNC | O_WRONLY | O_CREAT, 0600);
+		if (fh == -1)
+			return false;
+
+		const char *pos = buf_.data();
+		auto left = buf_.size();
+		while (left > 0)
+		{
+			const auto len = write(fh, pos, static_cast<unsigned int>(left));
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len <= 0)
+				break;
+			pos += len;
+			left -= len;
+		}
+
+		if (close(fh) == -1 || left > 0)
+		{
+			g_unlink(tmp_path.c_str());
+			return false;
+		}
+
+#ifdef WIN32
+		g_unlink(path.c_str());	/* win32 can't rename to an existing file */
+#endif
+		return g_rename(tmp_path.c_str(), path.c_str()) != -1;
+	}
 }
 
 int
@@ -373,6 +513,7 @@ struct prefs vars[] =
 	{"gui_chanlist_maxusers", P_OFFINT (hex_gui_chanlist_maxusers), TYPE_INT},
 	{"gui_chanlist_minusers", P_OFFINT (hex_gui_chanlist_minusers), TYPE_INT},
 	{"gui_compact", P_OFFINT (hex_gui_compact), TYPE_BOOL},
+	{"gui_defer_plugins", P_OFFINT (hex_gui_defer_plugins), TYPE_BOOL},
 	{"gui_dialog_height", P_OFFINT (hex_gui_dialog_height), TYPE_INT},
 	{"gui_dialog_left", P_OFFINT (hex_gui_dialog_left), TYPE_INT},
 	{"gui_dialog_top", P_OFFINT (hex_gui_dialog_top), TYPE_INT},
@@ -899,27 +1040,27 @@ int load_config (void)
 {
 	g_assert(check_config_dir () == 0);
 	gchar* cfg_ptr;
-	if (!g_file_get_contents (default_file (), &cfg_ptr, NULL, NULL))
+	gsize cfg_len;
+	if (!g_file_get_contents (default_file (), &cfg_ptr, &cfg_len, NULL))
 		return -1;
-	glib_string cfg(cfg_ptr);
+	glib_string cfg_data(cfg_ptr);
+	/* parsed once, rather than rescanning the file for every variable */
+	const config::settings cfg(boost::string_ref(cfg_ptr, cfg_len));
 	/* If the config is incomplete we have the default values loaded */
 	load_default_config();
 
 	int i = 0;
 	do
 	{
-		bool res;
 		int val;
 		switch (vars[i].type)
 		{
 		case TYPE_STR:
-			cfg_get_str (cfg.get(), vars[i].name, (char *) &prefs + vars[i].offset,
-				     vars[i].len);
+			cfg.get_str (vars[i].name, (char *) &prefs + vars[i].offset, vars[i].len);
 			break;
 		case TYPE_BOOL:
 		case TYPE_INT:
-			val = cfg_get_int_with_result(cfg.get(), vars[i].name, res);
-			if (res)
+			if (cfg.get_int (vars[i].name, val))
 				*((int *) &prefs + vars[i].offset) = val;
 			break;
 		}
@@ -944,59 +1085,26 @@ bool save_config (void)
 	if (check_config_dir () != 0)
 		make_config_dirs ();
 
-	auto config = default_file ();
-	glib_string new_config(g_strconcat (config, ".new", NULL));
+	config::writer out;
+	out.put_str ("version", PACKAGE_VERSION);
 
-	int fh = g_open (new_config.get(), OFLAGS | O_TRUNC | O_WRONLY | O_CREAT, 0600);
-	if (fh == -1)
-	{
-		return false;
-	}
-
-	if (!cfg_put_str (fh, "version", PACKAGE_VERSION))
-	{
-		close (fh);
-		return false;
-	}
-		
 	int i = 0;
 	do
 	{
 		switch (vars[i].type)
 		{
 		case TYPE_STR:
-			if (!cfg_put_str (fh, vars[i].name, (char *) &prefs + vars[i].offset))
-			{
-				close (fh);
-				return false;
-			}
+			out.put_str (vars[i].name, (char *) &prefs + vars[i].offset);
 			break;
 		case TYPE_INT:
 		case TYPE_BOOL:
-			if (!cfg_put_int (fh, *((int *) &prefs + vars[i].offset), vars[i].name))
-			{
-				close (fh);
-				return false;
-			}
+			out.put_int (vars[i].name, *((int *) &prefs + vars[i].offset));
 		}
 		i++;
 	}
 	while (vars[i].name);
 
-	if (close (fh) == -1)
-	{
-		return false;
-	}
-
-#ifdef WIN32
-	g_unlink (config);	/* win32 can't rename to an existing file */
-#endif
-	if (g_rename (new_config.get(), config) == -1)
-	{
-		return false;
-	}
-
-	return true;
+	return out.commit (default_file ());
 }
 
 static void
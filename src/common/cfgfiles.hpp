@@ -24,7 +24,9 @@
 
 #include <cstdio>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include <boost/utility/string_ref.hpp>
 
 #include "sessfwd.hpp"
 #include "hexchat.hpp"
@@ -36,6 +38,49 @@ extern const char * const languages[LANGUAGES_LENGTH];
 namespace config
 {
 	const ::std::string& config_dir();
+
+	/* one line of a config file, split at the first separator */
+	struct line
+	{
+		boost::string_ref key;	/* trailing blanks dropped */
+		boost::string_ref value;	/* leading blanks dropped */
+		boost::string_ref text;	/* the whole line */
+	};
+
+	/* splits a config file into lines in a single pass, skipping blank
+	 * lines and '#' comments. A line without the separator is all key. */
+	std::vector<line> parse_lines(boost::string_ref text, char separator = '=');
+
+	/* "name = value" settings parsed once and looked up by name, ignoring
+	 * case. The first of two settings with the same name wins, as it did
+	 * with cfg_get_str. */
+	class settings
+	{
+	public:
+		explicit settings(boost::string_ref text);
+		const std::string *find(const char *name) const;
+		bool get_str(const char *name, char *dest, int dest_len) const;
+		bool get_int(const char *name, int &value) const;
+		std::size_t size() const { return values_.size(); }
+
+	private:
+		std::unordered_map<std::string, std::string> values_;	/* by lowercased name */
+	};
+
+	/* builds a whole config file in memory, then puts it in place with one
+	 * write to a temp file and a rename */
+	class writer
+	{
+	public:
+		void put_str(const char *var, boost::string_ref value);
+		void put_int(const char *var, int value);
+		void put_raw(boost::string_ref text);
+		const std::string &data() const { return buf_; }
+		bool commit(const std::string &path) const;
+
+	private:
+		std::string buf_;
+	};
 }
 char *cfg_get_str (char *cfg, const char *var, char *dest, int dest_len);
 int cfg_get_bool (const char *var);
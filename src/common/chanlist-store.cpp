@@ -0,0 +1,372 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#endif
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include "hexchat.hpp"
+#include "chanlist-store.hpp"
+#include "util.hpp"
+
+namespace chanlist
+{
+	snapshot::snapshot()
+		:size_()
+	{}
+
+	const char *snapshot::channel(row_id row) const
+	{
+		const auto & seg = *segments_[row / SEGMENT_ROWS];
+		return seg.names.c_str() + seg.name_start[row % SEGMENT_ROWS];
+	}
+
+	const char *snapshot::topic(row_id row) const
+	{
+		const auto & seg = *segments_[row / SEGMENT_ROWS];
+		return seg.topics.c_str() + seg.topic_start[row % SEGMENT_ROWS];
+	}
+
+	std::uint32_t snapshot::users(row_id row) const
+	{
+		return segments_[row / SEGMENT_ROWS]->users[row % SEGMENT_ROWS];
+	}
+
+	store::store()
+		:size_(), users_()
+	{}
+
+	row_id store::append(const boost::string_ref & channel, std::uint32_t users, const boost::string_ref & topic)
+	{
+		if (!open_ || open_->size() == SEGMENT_ROWS)
+		{
+			/* a full segment never changes again, share it from now on */
+			if (open_)
+				sealed_.emplace_back(std::move(open_));
+			open_ = std::make_shared<segment>();
+			open_->users.reserve(SEGMENT_ROWS);
+			open_->name_start.reserve(SEGMENT_ROWS);
+			open_->topic_start.reserve(SEGMENT_ROWS);
+			open_copy_.reset();
+		}
+
+		auto & seg = *open_;
+		seg.users.push_back(users);
+		seg.name_start.push_back(static_cast<std::uint32_t>(seg.names.size()));
+		seg.names.append(channel.data(), channel.size());
+		seg.names.push_back('\0');
+		seg.topic_start.push_back(static_cast<std::uint32_t>(seg.topics.size()));
+		seg.topics.append(topic.data(), topic.size());
+		seg.topics.push_back('\0');
+
+		users_ += users;
+		return size_++;
+	}
+
+	void store::clear()
+	{
+		sealed_.clear();
+		open_.reset();
+		open_copy_.reset();
+		size_ = 0;
+		users_ = 0;
+	}
+
+	snapshot store::snap()
+	{
+		snapshot snap;
+		snap.segments_ = sealed_;
+		if (open_)
+		{
+			/* the open segment is still being written to, hand out a copy */
+			if (!open_copy_ || open_copy_->size() != open_->size())
+				open_copy_ = std::make_shared<const segment>(*open_);
+			snap.segments_.push_back(open_copy_);
+		}
+		snap.size_ = size_;
+		return snap;
+	}
+
+	filter::filter()
+		:min_users(),
+		max_users(),
+		type(SIMPLE),
+		match_channel(true),
+		match_topic(true),
+		sort(BY_CHANNEL),
+		descending(false)
+	{}
+
+	namespace
+	{
+		bool match_text(const filter & flt, const char *text)
+		{
+			switch (flt.type)
+			{
+			case filter::WILDCARD:
+				return match(flt.pattern.c_str(), text);
+			case filter::REGEX:
+				if (!flt.regex)
+					return false;
+				return g_regex_match(flt.regex.get(), text, static_cast<GRegexMatchFlags>(0), nullptr) ? true : false;
+			default:	/* SIMPLE */
+				return nocasestrstr(text, flt.pattern.c_str()) != nullptr;
+			}
+		}
+
+		/* check for cancellation this often while looping over rows */
+		enum { CANCEL_CHECK_ROWS = 1024 };
+
+		struct sort_cancelled {};
+
+		/* std::stable_sort can't be stopped from outside, so the comparison
+		 * looks at cancel every so often and throws its way out; false if
+		 * it did, leaving the range in some order */
+		template <typename It, typename Less>
+		bool cancellable_sort(It first, It last, Less less, const std::function<bool()> & cancel)
+		{
+			typedef typename std::iterator_traits<It>::value_type value_type;
+			std::size_t compared = 0;
+			try
+			{
+				std::stable_sort(first, last, [&](const value_type & a, const value_type & b){
+					if (++compared % CANCEL_CHECK_ROWS == 0 && cancel && cancel())
+						throw sort_cancelled();
+					return less(a, b);
+				});
+			}
+			catch (const sort_cancelled &)
+			{
+				return false;
+			}
+			return true;
+		}
+
+		bool sort_rows(const snapshot & snap, const filter & flt, std::vector<row_id> & rows,
+			const std::function<bool()> & cancel)
+		{
+			const bool desc = flt.descending;
+			switch (flt.sort)
+			{
+			case filter::BY_USERS:
+				return cancellable_sort(rows.begin(), rows.end(), [&snap, desc](row_id a, row_id b){
+					return desc ? snap.users(b) < snap.users(a) : snap.users(a) < snap.users(b);
+				}, cancel);
+			case filter::BY_TOPIC:
+				return cancellable_sort(rows.begin(), rows.end(), [&snap, desc](row_id a, row_id b){
+					return desc ? std::strcmp(snap.topic(b), snap.topic(a)) < 0
+						: std::strcmp(snap.topic(a), snap.topic(b)) < 0;
+				}, cancel);
+			default:	/* BY_CHANNEL */
+				break;
+			}
+
+			/* collation keys are only worked out for rows that are shown */
+			std::vector<std::string> keys(rows.size());
+			for (std::size_t i = 0; i < rows.size(); ++i)
+			{
+				if (i % CANCEL_CHECK_ROWS == 0 && cancel && cancel())
+					return false;
+				const char *name = snap.channel(rows[i]);
+				glib_string key(g_utf8_collate_key(name, -1));
+				keys[i] = key ? key.get() : name;
+			}
+
+			std::vector<std::size_t> order(rows.size());
+			std::iota(order.begin(), order.end(), 0);
+			if (!cancellable_sort(order.begin(), order.end(), [&keys, desc](std::size_t a, std::size_t b){
+				return desc ? keys[b] < keys[a] : keys[a] < keys[b];
+			}, cancel))
+				return false;
+
+			std::vector<row_id> sorted;
+			sorted.reserve(rows.size());
+			for (auto i : order)
+				sorted.push_back(rows[i]);
+			rows.swap(sorted);
+			return true;
+		}
+	}
+
+	bool filter::matches(const snapshot & snap, row_id row) const
+	{
+		const auto users = snap.users(row);
+		if (users < min_users)
+			return false;
+		if (max_users > 0 && users > max_users)
+			return false;
+		if (pattern.empty())
+			return true;
+
+		/* if both or _neither_ box is ticked, look in both */
+		const bool both = match_channel == match_topic;
+		if ((both || match_channel) && match_text(*this, snap.channel(row)))
+			return true;
+		return (both || match_topic) && match_text(*this, snap.topic(row));
+	}
+
+	result::result()
+		:generation(),
+		first(),
+		end(),
+		sorted(),
+		users_shown()
+	{}
+
+	bool run_filter(const snapshot & snap, const filter & flt, row_id first, bool sort,
+		result & out, const std::function<bool()> & cancel)
+	{
+		out.snap = snap;
+		out.first = first;
+		out.end = snap.size();
+		out.sorted = sort;
+		out.rows.clear();
+		out.users_shown = 0;
+
+		for (row_id row = first; row < out.end; ++row)
+		{
+			if ((row - first) % CANCEL_CHECK_ROWS == 0 && cancel && cancel())
+				return false;
+			if (flt.matches(snap, row))
+			{
+				out.rows.push_back(row);
+				out.users_shown += snap.users(row);
+			}
+		}
+
+		if (sort)
+			return sort_rows(snap, flt, out.rows, cancel);
+		return true;
+	}
+
+	struct filter_worker::delivery_state
+	{
+		callback done;
+		bool alive;	/* only touched on the main thread */
+	};
+
+	namespace
+	{
+		struct delivery
+		{
+			std::shared_ptr<void> state;
+			result res;
+		};
+	}
+
+	filter_worker::filter_worker(callback done)
+		:delivery_(std::make_shared<delivery_state>()),
+		stop_(false),
+		latest_(0),
+		generation_(0)
+	{
+		delivery_->done = std::move(done);
+		delivery_->alive = true;
+		thread_ = std::thread(&filter_worker::run, this);
+	}
+
+	filter_worker::~filter_worker()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+			pending_ = boost::none;
+		}
+		++latest_;
+		cond_.notify_all();
+		thread_.join();
+
+		/* anything still queued on the main loop is dropped */
+		delivery_->alive = false;
+	}
+
+	unsigned int filter_worker::submit(snapshot snap, filter flt, row_id first, bool sort)
+	{
+		const auto generation = ++generation_;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job next;
+			next.snap = std::move(snap);
+			next.flt = std::move(flt);
+			next.first = first;
+			next.sort = sort;
+			next.generation = generation;
+			pending_ = std::move(next);
+		}
+		latest_ = generation;
+		cond_.notify_one();
+		return generation;
+	}
+
+	void filter_worker::cancel()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			pending_ = boost::none;
+		}
+		latest_ = ++generation_;
+	}
+
+	void filter_worker::run()
+	{
+		for (;;)
+		{
+			job current;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				cond_.wait(lock, [this]{ return stop_ || pending_; });
+				if (stop_)
+					return;
+				current = std::move(*pending_);
+				pending_ = boost::none;
+			}
+
+			const auto generation = current.generation;
+			auto superseded = [this, generation]{ return latest_.load() != generation; };
+
+			auto out = new delivery;
+			out->res.generation = generation;
+			if (!run_filter(current.snap, current.flt, current.first, current.sort, out->res, superseded)
+				|| superseded())
+			{
+				delete out;
+				continue;
+			}
+
+			out->state = delivery_;
+			g_idle_add([](gpointer data) -> gboolean
+			{
+				std::unique_ptr<delivery> out(static_cast<delivery*>(data));
+				auto state = std::static_pointer_cast<delivery_state>(out->state);
+				if (state->alive)
+					state->done(std::move(out->res));
+				return FALSE;
+			}, out);
+		}
+	}
+}
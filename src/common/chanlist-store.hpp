@@ -0,0 +1,161 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_CHANLIST_STORE_HPP
+#define HEXCHAT_CHANLIST_STORE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref_fwd.hpp>
+#include <glib.h>
+
+/* In-memory /LIST reply store and the filter engine behind the channel
+ * list window. Rows are kept column-wise in fixed size segments which
+ * never change once sealed, so a snapshot of the store can be filtered on
+ * a worker thread while the GUI keeps appending to it. */
+namespace chanlist
+{
+	typedef std::uint32_t row_id;
+
+	enum { SEGMENT_ROWS = 4096 };
+
+	struct segment
+	{
+		std::vector<std::uint32_t> users;
+		std::vector<std::uint32_t> name_start;	/* offsets into names */
+		std::vector<std::uint32_t> topic_start;	/* offsets into topics */
+		std::string names;	/* NUL separated channel names */
+		std::string topics;	/* NUL separated topics, colours stripped */
+
+		row_id size() const { return static_cast<row_id>(users.size()); }
+	};
+
+	/* a read-only view of the first size() rows of a store */
+	class snapshot
+	{
+		std::vector<std::shared_ptr<const segment>> segments_;
+		row_id size_;
+		friend class store;
+	public:
+		snapshot();
+		row_id size() const { return size_; }
+		const char *channel(row_id row) const;
+		const char *topic(row_id row) const;
+		std::uint32_t users(row_id row) const;
+	};
+
+	class store
+	{
+		std::vector<std::shared_ptr<const segment>> sealed_;
+		std::shared_ptr<segment> open_;
+		std::shared_ptr<const segment> open_copy_;	/* last published copy of open_ */
+		row_id size_;
+		std::uint64_t users_;
+	public:
+		store();
+		row_id append(const boost::string_ref & channel, std::uint32_t users, const boost::string_ref & topic);
+		void clear();
+		row_id size() const { return size_; }
+		std::uint64_t total_users() const { return users_; }
+		snapshot snap();
+	};
+
+	struct filter
+	{
+		enum search_type { SIMPLE = 0, WILDCARD = 1, REGEX = 2 };
+		enum sort_column { BY_CHANNEL = 0, BY_USERS = 1, BY_TOPIC = 2 };
+
+		filter();
+		bool matches(const snapshot & snap, row_id row) const;
+
+		std::uint32_t min_users;
+		std::uint32_t max_users;	/* 0 for no limit */
+		search_type type;
+		std::string pattern;
+		std::shared_ptr<GRegex> regex;	/* compiled pattern for REGEX */
+		bool match_channel;
+		bool match_topic;
+		sort_column sort;
+		bool descending;
+	};
+
+	struct result
+	{
+		result();
+		unsigned int generation;
+		snapshot snap;
+		row_id first;	/* rows [first, end) of snap were looked at */
+		row_id end;
+		bool sorted;	/* rows replace what's shown rather than add to it */
+		std::vector<row_id> rows;	/* the matching rows, in display order */
+		std::uint64_t users_shown;
+	};
+
+	/* filters rows [first, snap.size()) of snap, sorted if asked to; gives
+	 * up early and returns false once cancel() says so */
+	bool run_filter(const snapshot & snap, const filter & flt, row_id first, bool sort,
+		result & out, const std::function<bool()> & cancel);
+
+	/* runs one filter at a time on its own thread and hands the result
+	 * back on the main loop. A new job supersedes one still waiting. */
+	class filter_worker
+	{
+	public:
+		typedef std::function<void(result &&)> callback;
+
+		explicit filter_worker(callback done);
+		~filter_worker();
+
+		unsigned int submit(snapshot snap, filter flt, row_id first, bool sort);
+		void cancel();
+		unsigned int generation() const { return generation_; }
+
+	private:
+		struct job
+		{
+			snapshot snap;
+			filter flt;
+			row_id first;
+			bool sort;
+			unsigned int generation;
+		};
+		struct delivery_state;
+
+		void run();
+
+		std::shared_ptr<delivery_state> delivery_;
+		std::mutex mutex_;
+		std::condition_variable cond_;
+		boost::optional<job> pending_;
+		bool stop_;
+		std::atomic<unsigned int> latest_;
+		unsigned int generation_;
+		std::thread thread_;
+	};
+}
+
+#endif
@@ -31,6 +31,7 @@
 #include <cstring>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -40,6 +41,8 @@
 #include <boost/utility/string_ref.hpp>
 
 #include "hexchat.hpp"
+#include "cfgfiles.hpp"
+#include "fe.hpp"
 #include "session.hpp"
 #include "chanopt.hpp"
 
@@ -97,6 +100,7 @@ int chanopt_command (session *sess, char *, char *word[], char *[])
 {
 	int offset = 2;
 	bool quiet = false;
+	bool changed = false;
 
 	if (!strcmp (word[2], "-quiet"))
 	{
@@ -130,7 +134,7 @@ int chanopt_command (session *sess, char *, char *word[], char *[])
 			if (newval != -1)	/* set new value */
 			{
 				*(std::uint8_t*)G_STRUCT_MEMBER_P(sess, op.offset) = newval;
-				chanopt_changed = true;
+				changed = true;
 			}
 
 			if (!quiet)	/* print value */
@@ -152,6 +156,9 @@ int chanopt_command (session *sess, char *, char *word[], char *[])
 		}
 	}
 
+	if (changed)
+		chanopt_save (sess);
+
 	return TRUE;
 }
 
@@ -292,20 +299,39 @@ std::ostream &operator<<(std::ostream &o, const chanopt_in_memory &chanop)
 	return o;
 }
 
+/* kept in file order, so rewriting chanopt.conf doesn't shuffle it */
 static std::vector<chanopt_in_memory> chanopts;
+/* casefolded "network\nchannel" -> index into chanopts */
+static std::unordered_map<std::string, std::size_t> chanopt_index;
+static int chanopt_save_tag;
+
+/* changes are written out this long after the last one, so autojoining
+ * or closing a lot of channels only rewrites the file once */
+enum { CHANOPT_SAVE_DELAY = 2000 };
+
+static std::string
+chanopt_key (const boost::string_ref & network, const boost::string_ref & channel)
+{
+	std::string key;
+	key.reserve (network.size () + channel.size () + 1);
+	for (auto c : network)
+		key.push_back (g_ascii_tolower (c));
+	key.push_back ('\n');	/* can't be part of either name */
+	for (auto c : channel)
+		key.push_back (g_ascii_tolower (c));
+	return key;
+}
 
-static std::vector<chanopt_in_memory>::iterator 
+static chanopt_in_memory *
 chanopt_find (const boost::string_ref & network, const std::string& channel)
 {
-	return std::find_if(
-		chanopts.begin(), chanopts.end(),
-		[&network, &channel](const chanopt_in_memory& c){
-		return !g_ascii_strcasecmp(c.channel.c_str(), channel.c_str()) &&
-			!g_ascii_strcasecmp(c.network.c_str(), network.data());
-		});
+	auto found = chanopt_index.find (chanopt_key (network, channel));
+	if (found == chanopt_index.end ())
+		return nullptr;
+	return &chanopts[found->second];
 }
 
-/* load chanopt.conf from disk into our chanopt_list GSList */
+/* load chanopt.conf from disk into chanopts */
 
 static void
 chanopt_load_all (void)
@@ -314,10 +340,39 @@ chanopt_load_all (void)
 	bfs::ifstream stream(io::fs::make_config_path("chanopt.conf"), std::ios::in | std::ios::binary);
 	for (chanopt_in_memory current; stream >> current;)
 	{
-		chanopts.push_back(current);
-		chanopt_changed = true;
+		/* like the lookups always did, the first one wins */
+		if (chanopt_index.emplace (chanopt_key (current.network, current.channel), chanopts.size ()).second)
+			chanopts.push_back(current);
 	}
 }
+
+static gboolean
+chanopt_save_cb (gpointer)
+{
+	chanopt_save_tag = 0;
+	chanopt_save_all ();
+	return FALSE;
+}
+
+static void
+chanopt_mark_changed (void)
+{
+	chanopt_changed = true;
+	if (chanopt_save_tag)
+		fe_timeout_remove (chanopt_save_tag);
+	chanopt_save_tag = fe_timeout_add (CHANOPT_SAVE_DELAY, (GSourceFunc)chanopt_save_cb, nullptr);
+}
+}
+
+/* reads chanopt.conf, unless that's been done already */
+void
+chanopt_init (void)
+{
+	if (!chanopt_open)
+	{
+		chanopt_open = true;
+		chanopt_load_all ();
+	}
 }
 
 void
@@ -330,20 +385,16 @@ chanopt_load (session *sess)
 	if (network.empty())
 		return;
 
-	if (!chanopt_open)
-	{
-		chanopt_open = true;
-		chanopt_load_all ();
-	}
+	chanopt_init ();
 
-	auto itr = chanopt_find (network, sess->name);
-	if (itr == chanopts.end())
+	auto co = chanopt_find (network, sess->name);
+	if (!co)
 		return;
 
 	/* fill in all the sess->xxxxx fields */
 	for (const auto & op : chanopt)
 	{
-		auto val = G_STRUCT_MEMBER(std::uint8_t, &(*itr), op.offset);
+		auto val = G_STRUCT_MEMBER(std::uint8_t, co, op.offset);
 		*(std::uint8_t *)G_STRUCT_MEMBER_P(sess, op.offset) = val;
 	}
 }
@@ -358,49 +409,61 @@ chanopt_save (session *sess)
 	if (network.empty())
 		return;
 
+	chanopt_init ();
+
 	/* 2. reconcile sess with what we loaded from disk */
-	auto itr = chanopt_find (network, sess->name);
-	auto co = itr != chanopts.end() ? *itr : chanopt_in_memory(network.to_string(), sess->name);
+	auto co = chanopt_find (network, sess->name);
+	if (!co)
+	{
+		/* nothing to remember for a channel that was never changed */
+		bool all_default = true;
+		for (const auto& op : chanopt)
+			all_default = all_default && G_STRUCT_MEMBER(std::uint8_t, sess, op.offset) == SET_DEFAULT;
+		if (all_default)
+			return;
+
+		chanopt_index.emplace (chanopt_key (network, sess->name), chanopts.size ());
+		chanopts.emplace_back (network.to_string (), sess->name);
+		co = &chanopts.back ();
+	}
 
+	bool changed = false;
 	for (const auto& op : chanopt)
 	{
 		auto vals = G_STRUCT_MEMBER(std::uint8_t, sess, op.offset);
-		auto valm = G_STRUCT_MEMBER(std::uint8_t, &co, op.offset);
+		auto valm = G_STRUCT_MEMBER(std::uint8_t, co, op.offset);
 
 		if (vals != valm)
 		{
-			*(std::uint8_t *)G_STRUCT_MEMBER_P(&co, op.offset) = vals;
-			chanopt_changed = true;
+			*(std::uint8_t *)G_STRUCT_MEMBER_P(co, op.offset) = vals;
+			changed = true;
 		}
 	}
-	if (itr == chanopts.end())
-	{
-		chanopts.push_back(co);
-		chanopt_changed = true;
-	}
-	else
-	{
-		*itr = co;
-	}
+	if (changed)
+		chanopt_mark_changed ();
 }
 
 void
 chanopt_save_all (void)
 {
-	namespace bfs = boost::filesystem;
+	if (chanopt_save_tag)
+	{
+		fe_timeout_remove (chanopt_save_tag);
+		chanopt_save_tag = 0;
+	}
 	if (chanopts.empty() || !chanopt_changed)
 	{
 		return;
 	}
 
-	auto file_path = io::fs::make_config_path("chanopt.conf");
-	io::fs::create_file_with_mode(file_path, 0600);
-	bfs::ofstream stream(file_path, std::ios::trunc | std::ios::out | std::ios::binary);
+	std::ostringstream buffer;
 	for (const auto& co : chanopts)
 	{
-		stream << co;
+		buffer << co;
 	}
-	stream.flush();
-	chanopt_open = false;
-	chanopt_changed = false;
+
+	config::writer out;
+	out.put_raw (buffer.str ());
+	if (out.commit (io::fs::make_config_path ("chanopt.conf").string ()))
+		chanopt_changed = false;
 }
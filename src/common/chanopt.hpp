@@ -34,6 +34,7 @@ int chanopt_command (session *sess, char *tbuf, char *word[], char *word_eol[]);
 bool chanopt_is_set (unsigned int global, std::uint8_t per_chan_setting);
 void chanopt_save_all (void);
 void chanopt_save (session *sess);
+void chanopt_init (void);
 void chanopt_load (session *sess);
 
 #endif
@@ -0,0 +1,339 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#endif
+/* file offsets past 2GB, same as dcc.cpp */
+#define _FILE_OFFSET_BITS 64
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <utility>
+#include <fcntl.h>
+#include <glib.h>
+
+#include "../../config.h"
+
+#define WANTSOCKET
+#include "inet.hpp"
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#define USE_SENDFILE
+#endif
+#endif
+
+#include "dcc-xfer.hpp"
+
+namespace hexchat{
+namespace dcc{
+namespace xfer{
+
+sha256::sha256()
+	:sum_(g_checksum_new(G_CHECKSUM_SHA256), g_checksum_free)
+{}
+
+void
+sha256::update(const void *data, std::size_t len)
+{
+	g_checksum_update(sum_.get(), static_cast<const guchar*>(data), len);
+}
+
+std::string
+sha256::hex()
+{
+	return g_checksum_get_string(sum_.get());
+}
+
+std::size_t
+send_window(int sok, std::size_t floor, std::size_t ceiling)
+{
+	int sndbuf = 0;
+	socklen_t optlen = sizeof(sndbuf);
+	if (getsockopt(sok, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char*>(&sndbuf), &optlen) != 0 || sndbuf <= 0)
+		return floor;
+
+	std::size_t room = static_cast<std::size_t>(sndbuf);
+#ifdef SIOCOUTQ
+	/* take off what is still queued from the last chunk */
+	int queued = 0;
+	if (ioctl(sok, SIOCOUTQ, &queued) == 0 && queued > 0)
+		room = queued < sndbuf ? static_cast<std::size_t>(sndbuf - queued) : 0;
+#endif
+	return std::min(std::max(room, floor), ceiling);
+}
+
+file_sender::file_sender()
+#ifdef USE_SENDFILE
+	:zero_copy(true)
+#else
+	:zero_copy(false)
+#endif
+{}
+
+long long
+file_sender::send(int sok, int fd, std::uint64_t offset, std::size_t len)
+{
+	len = std::min<std::size_t>(len, INT_MAX);
+
+#ifdef USE_SENDFILE
+	if (zero_copy)
+	{
+		off_t off = static_cast<off_t>(offset);
+		const auto sent = ::sendfile(sok, fd, &off, len);
+		if (sent >= 0)
+			return sent;
+		/* not a file/socket pair the kernel can splice, copy it ourselves */
+		if (errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP)
+			return -1;
+		zero_copy = false;
+	}
+#endif
+
+	if (buf_.size() < len)
+		buf_.resize(len);
+
+#ifdef WIN32
+	_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET);
+	const int got = _read(fd, buf_.data(), static_cast<unsigned int>(len));
+#else
+	const auto got = pread(fd, buf_.data(), len, static_cast<off_t>(offset));
+#endif
+	if (got < 1)
+		return 0;
+	const auto sent = ::send(sok, buf_.data(), static_cast<int>(got), 0);
+	if (sent > 0 && hash)
+		hash->update(buf_.data(), sent);
+	return sent;
+}
+
+void
+preallocate(int fd, std::uint64_t offset, std::uint64_t len)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+	/* only a hint, the writes will find out if the disk is really full */
+	if (len > 0)
+		fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(len));
+#else
+	/* posix_fallocate() would grow the file and break resuming */
+	(void)fd;
+	(void)offset;
+	(void)len;
+#endif
+}
+
+struct file_receiver::delivery_state
+{
+	bool alive;	/* only touched on the main thread */
+};
+
+namespace
+{
+	struct delivery
+	{
+		std::shared_ptr<void> state;
+		file_receiver::callback done;
+	};
+}
+
+file_receiver::file_receiver(int fd, bool hash)
+	:fd_(fd),
+	fill_(0),
+	delivery_(std::make_shared<delivery_state>()),
+	writing_(false),
+	stop_(false),
+	error_(0)
+{
+	delivery_->alive = true;
+	if (hash)
+		hash_.reset(new sha256);
+	for (int i = 0; i < RECV_BUFFERS; ++i)
+		free_.emplace_back(new std::vector<char>(RECV_BUFFER_SIZE));
+	thread_ = std::thread(&file_receiver::run, this);
+}
+
+file_receiver::~file_receiver()
+{
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+		ready_ = nullptr;
+	}
+	cond_.notify_all();
+	thread_.join();
+
+	/* a callback still queued on the main loop is dropped */
+	delivery_->alive = false;
+}
+
+bool
+file_receiver::full()
+{
+	if (cur_)
+		return false;
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (free_.empty())
+		return true;
+	cur_ = std::move(free_.back());
+	free_.pop_back();
+	fill_ = 0;
+	return false;
+}
+
+long long
+file_receiver::recv(int sok)
+{
+	auto & buf = *cur_;
+	const auto n = ::recv(sok, buf.data() + fill_, static_cast<int>(buf.size() - fill_), 0);
+	if (n > 0)
+	{
+		fill_ += n;
+		if (fill_ == buf.size())
+			flush();
+	}
+	return n;
+}
+
+void
+file_receiver::flush()
+{
+	if (!cur_ || !fill_)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.emplace_back(std::move(cur_), fill_);
+	}
+	fill_ = 0;
+	cond_.notify_one();
+}
+
+void
+file_receiver::flush_if_idle()
+{
+	bool idle;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		idle = !writing_ && queue_.empty();
+	}
+	if (idle)
+		flush();
+}
+
+bool
+file_receiver::drained()
+{
+	if (cur_ && fill_)
+		return false;
+	std::lock_guard<std::mutex> lock(mutex_);
+	return !writing_ && queue_.empty();
+}
+
+void
+file_receiver::when_ready(callback done)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	ready_ = std::move(done);
+	/* nothing is going to finish, so answer straight away */
+	if (!writing_ && queue_.empty())
+		notify_locked();
+}
+
+std::string
+file_receiver::digest()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!hash_)
+		return std::string();
+	return hash_->hex();
+}
+
+void
+file_receiver::notify_locked()
+{
+	if (!ready_)
+		return;
+	auto out = new delivery;
+	out->state = delivery_;
+	out->done = std::move(ready_);
+	ready_ = nullptr;
+	g_idle_add([](gpointer data) -> gboolean
+	{
+		std::unique_ptr<delivery> out(static_cast<delivery*>(data));
+		auto state = std::static_pointer_cast<delivery_state>(out->state);
+		if (state->alive)
+			out->done();
+		return FALSE;
+	}, out);
+}
+
+void
+file_receiver::run()
+{
+	for (;;)
+	{
+		std::pair<buffer, std::size_t> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cond_.wait(lock, [this]{ return stop_ || !queue_.empty(); });
+			if (queue_.empty())
+				return;	/* stopping, and everything is written */
+			job = std::move(queue_.front());
+			queue_.pop_front();
+			writing_ = true;
+		}
+
+		/* after a failed write the rest is thrown away, the transfer is
+		   going to be closed anyway */
+		const char *data = job.first->data();
+		for (std::size_t left = job.second; left > 0 && !error_;)
+		{
+			const auto n = write(fd_, data, static_cast<unsigned int>(std::min<std::size_t>(left, INT_MAX)));
+			if (n < 0)
+			{
+				if (errno != EINTR)
+					error_ = errno;
+				continue;
+			}
+			data += n;
+			left -= n;
+		}
+		if (hash_ && !error_)
+			hash_->update(job.first->data(), job.second);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		free_.push_back(std::move(job.first));
+		writing_ = false;
+		notify_locked();
+	}
+}
+
+}
+}
+}
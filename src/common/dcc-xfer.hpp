@@ -0,0 +1,146 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_DCC_XFER_HPP
+#define HEXCHAT_DCC_XFER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glib.h>
+
+/* The file <-> socket data paths of DCC transfers, kept apart from the
+ * protocol handling in dcc.cpp so they can be exercised on their own. */
+namespace hexchat{
+namespace dcc{
+namespace xfer{
+
+	/* SHA-256 of a transfer, fed as the bytes go by */
+	class sha256
+	{
+		std::unique_ptr<GChecksum, void(*)(GChecksum*)> sum_;
+	public:
+		sha256();
+		void update(const void *data, std::size_t len);
+		/* lower case hex; finishes the hash, no update()s after this */
+		std::string hex();
+	};
+
+	/* upper bound for one fast-send chunk, whatever the socket can take */
+	enum { MAX_SEND_CHUNK = 1024 * 1024 };
+
+	/* how much can be handed to the socket right now without it blocking:
+	 * the free space in its send buffer, kept within [floor, ceiling] */
+	std::size_t send_window(int sok, std::size_t floor, std::size_t ceiling);
+
+	struct file_sender
+	{
+		file_sender();
+
+		/* sends up to len bytes of fd, starting at offset, to sok.
+		 * Returns the number of bytes sent, 0 if nothing could be read
+		 * from the file or -1 if the socket failed (see sock_error()) */
+		long long send(int sok, int fd, std::uint64_t offset, std::size_t len);
+
+		bool zero_copy;	/* sendfile() works for this pair, until it doesn't */
+		/* fed with what goes out, if set. sendfile() never shows us the
+		   bytes, so this only sees them on the copying path */
+		std::unique_ptr<sha256> hash;
+	private:
+		std::vector<char> buf_;	/* reused between blocks otherwise */
+	};
+
+	/* the receive ring: RECV_BUFFERS buffers of RECV_BUFFER_SIZE each */
+	enum { RECV_BUFFER_SIZE = 1024 * 1024, RECV_BUFFERS = 4 };
+
+	/* reserves disk space for len more bytes after offset without changing
+	 * the file size, so a resume still starts where the data ends */
+	void preallocate(int fd, std::uint64_t offset, std::uint64_t len);
+
+	/* Receives into a ring of large buffers on the main thread and writes
+	 * them out to fd on an I/O thread of its own, so a slow disk never
+	 * holds up the GUI. When every buffer is waiting for the disk the
+	 * caller stops reading and lets TCP push back on the sender. */
+	class file_receiver
+	{
+	public:
+		typedef std::function<void()> callback;
+
+		/* with hash set, everything written is hashed on the I/O thread */
+		file_receiver(int fd, bool hash);
+		/* writes out everything received so far before returning */
+		~file_receiver();
+
+		/* true if there is no buffer left to receive into */
+		bool full();
+		/* one recv() into the current buffer, only when !full(). Returns
+		 * like recv(): bytes read, 0 on hang up, -1 with sock_error() set */
+		long long recv(int sok);
+		/* hands the current buffer to the I/O thread if it has nothing
+		 * else to do, otherwise keeps filling it */
+		void flush_if_idle();
+		/* hands the current buffer to the I/O thread now */
+		void flush();
+		/* errno of a failed write, 0 while all is well */
+		int error() const { return error_; }
+		/* everything received has been written out */
+		bool drained();
+		/* runs done on the main loop, once, after the I/O thread next
+		 * finishes a buffer, hits an error or runs out of work. Replaces
+		 * any callback still waiting. */
+		void when_ready(callback done);
+		/* the hash of all that was written, once drained(); empty if the
+		   receiver wasn't asked to hash */
+		std::string digest();
+
+	private:
+		typedef std::unique_ptr<std::vector<char>> buffer;
+		struct delivery_state;
+
+		void run();
+		void notify_locked();
+
+		int fd_;
+		buffer cur_;	/* being filled on the main thread */
+		std::size_t fill_;
+		std::shared_ptr<delivery_state> delivery_;
+		std::mutex mutex_;
+		std::condition_variable cond_;
+		std::vector<buffer> free_;
+		std::deque<std::pair<buffer, std::size_t>> queue_;
+		bool writing_;
+		bool stop_;
+		callback ready_;
+		std::unique_ptr<sha256> hash_;	/* only used on the I/O thread until drained */
+		std::atomic<int> error_;
+		std::thread thread_;
+	};
+}
+}
+}
+
+#endif
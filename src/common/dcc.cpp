@@ -29,7 +29,7 @@
 #endif
 /* we only use 32 bits, but without this define, you get only 31! */
 #define _FILE_OFFSET_BITS 64
-#include <vector>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -68,6 +68,7 @@ using SOCKET = int;
 #include "hexchatc.hpp"
 #include "filesystem.hpp"
 #include "session.hpp"
+#include "timers.hpp"
 
 #ifdef USE_DCC64
 #define BIG_STR_TO_INT(x) strtoull(x,nullptr,10)
@@ -99,6 +100,7 @@ struct dccstat_info dccstat[] = {
 namespace {
 static int dcc_global_throttle;	/* 0x1 = sends, 0x2 = gets */
 static ::dcc::DCC *new_dcc (void);
+static void dcc_stop_check_timer (void);
 static void dcc_close (::dcc::DCC *dcc, int dccstat, int destroy);
 static gboolean dcc_send_data (GIOChannel *, GIOCondition, ::dcc::DCC *);
 static gboolean dcc_read (GIOChannel *, GIOCondition, ::dcc::DCC *);
@@ -321,6 +323,9 @@ dcc_close (::dcc::DCC *dcc, int dccstat, int destroy)
 
 	dcc_remove_from_sum (dcc);
 
+	/* let the I/O thread write out what it has before the file goes */
+	dcc->receiver.reset ();
+
 	if (dcc->fp != -1)
 	{
 		close (dcc->fp);
@@ -357,6 +362,7 @@ dcc_close (::dcc::DCC *dcc, int dccstat, int destroy)
 	if (destroy)
 	{
 		dcc_list = g_slist_remove (dcc_list, dcc);
+		dcc_stop_check_timer ();
 		::fe::fe_dcc_remove (dcc);
 		delete dcc->proxy;
 		delete[] dcc->file;
@@ -538,6 +544,35 @@ dcc_send_ack(::dcc::DCC *dcc)
 	send(dcc->sok, (char *)&pos, 4, 0);
 }
 
+/* everything has arrived, finish up once it's all on the disk */
+static void
+dcc_recv_done(::dcc::DCC *dcc)
+{
+	char buf[16];
+	auto & rx = *dcc->receiver;
+
+	if (rx.error())
+	{
+		EMIT_SIGNAL(XP_TE_DCCRECVERR, dcc->serv->front_session, dcc->file,
+			dcc->destfile, dcc->nick, errorstring(rx.error()), 0);
+		dcc_close(dcc, STAT_FAILED, false);
+		return;
+	}
+	if (!rx.drained())
+	{
+		rx.when_ready([dcc]{ dcc_recv_done(dcc); });
+		return;
+	}
+
+	dcc->sha256 = rx.digest();
+	dcc_close(dcc, STAT_DONE, false);
+	dcc_calc_average_cps(dcc);	/* this must be done _after_ dcc_close, or dcc_remove_from_sum will see the wrong value in dcc->cps */
+	/* cppcheck-suppress deallocuse */
+	sprintf(buf, "%d", dcc->cps);
+	EMIT_SIGNAL(XP_TE_DCCRECVCOMP, dcc->serv->front_session,
+		dcc->file, dcc->destfile, dcc->nick, buf, 0);
+}
+
 static gboolean
 dcc_read(GIOChannel *source, GIOCondition condition, ::dcc::DCC *dcc)
 {
@@ -589,28 +624,58 @@ dcc_read(GIOChannel *source, GIOCondition condition, ::dcc::DCC *dcc)
 		dcc_close(dcc, STAT_FAILED, false);
 		return true;
 	}
+	if (!dcc->receiver)
+	{
+		if (dcc->size > dcc->pos)
+			::dcc::xfer::preallocate(dcc->fp, dcc->pos, dcc->size - dcc->pos);
+		/* a resumed file has a start we never see, so no hash for it */
+		dcc->receiver.reset(new ::dcc::xfer::file_receiver(dcc->fp, dcc->pos == 0));
+	}
+	else if (dcc->size && dcc->pos >= dcc->size)
+		return true;	/* all in, dcc_recv_done() is waiting for the disk */
+
+	auto & rx = *dcc->receiver;
 	for (;;)
 	{
-		if (dcc->throttled)
+		if (rx.error())
 		{
+			EMIT_SIGNAL(XP_TE_DCCRECVERR, dcc->serv->front_session, dcc->file,
+				dcc->destfile, dcc->nick, errorstring(rx.error()), 0);
 			if (need_ack)
 				dcc_send_ack(dcc);
+			dcc_close(dcc, STAT_FAILED, false);
+			return true;
+		}
 
-			fe_input_remove(dcc->iotag);
-			dcc->iotag = 0;
+		if (dcc->throttled || rx.full())
+		{
+			if (need_ack)
+				dcc_send_ack(dcc);
+
+			if (dcc->throttled)
+				rx.flush_if_idle();
+			else	/* the disk is behind, let TCP hold the sender back until a buffer comes free */
+				rx.when_ready([dcc]{ dcc_read(nullptr, static_cast<GIOCondition>(0), dcc); });
+
+			if (dcc->iotag)
+			{
+				fe_input_remove(dcc->iotag);
+				dcc->iotag = 0;
+			}
 			return false;
 		}
 
 		if (!dcc->iotag)
 			dcc->iotag = fe_input_add(dcc->sok, FIA_READ | FIA_EX, (GIOFunc)dcc_read, dcc);
 
-		n = recv(dcc->sok, buf, sizeof(buf), 0);
+		n = static_cast<int>(rx.recv(dcc->sok));
 		if (n < 1)
 		{
 			if (n < 0)
 			{
 				if (would_block())
 				{
+					rx.flush_if_idle();
 					if (need_ack)
 						dcc_send_ack(dcc);
 					return true;
@@ -626,29 +691,21 @@ dcc_read(GIOChannel *source, GIOCondition condition, ::dcc::DCC *dcc)
 			return true;
 		}
 
-		if (write(dcc->fp, buf, n) == -1) /* could be out of hdd space */
+		/* one ack, and one look at the clock, per wakeup */
+		if (!need_ack)
 		{
-			EMIT_SIGNAL(XP_TE_DCCRECVERR, dcc->serv->front_session, dcc->file,
-				dcc->destfile, dcc->nick, errorstring(errno), 0);
-			if (need_ack)
-				dcc_send_ack(dcc);
-			dcc_close(dcc, STAT_FAILED, false);
-			return true;
+			dcc->lasttime = time(0);
+			need_ack = true;
 		}
-
-		dcc->lasttime = time(0);
 		dcc->pos += n;
-		need_ack = true;	/* send ack when we're done recv()ing */
 
 		if (dcc->pos >= dcc->size)
 		{
 			dcc_send_ack(dcc);
-			dcc_close(dcc, STAT_DONE, false);
-			dcc_calc_average_cps(dcc);	/* this must be done _after_ dcc_close, or dcc_remove_from_sum will see the wrong value in dcc->cps */
-			/* cppcheck-suppress deallocuse */
-			sprintf(buf, "%d", dcc->cps);
-			EMIT_SIGNAL(XP_TE_DCCRECVCOMP, dcc->serv->front_session,
-				dcc->file, dcc->destfile, dcc->nick, buf, 0);
+			fe_input_remove(dcc->iotag);
+			dcc->iotag = 0;
+			rx.flush();
+			dcc_recv_done(dcc);
 			return true;
 		}
 	}
@@ -1300,7 +1357,7 @@ dcc_connect(::dcc::DCC *dcc)
 static gboolean
 dcc_send_data(GIOChannel *source, GIOCondition condition, ::dcc::DCC *dcc)
 {
-	int len, sent, sok = dcc->sok;
+	int sok = dcc->sok;
 
 	if (prefs.hex_dcc_blocksize < 1) /* this is too little! */
 		prefs.hex_dcc_blocksize = 1024;
@@ -1323,16 +1380,22 @@ dcc_send_data(GIOChannel *source, GIOCondition condition, ::dcc::DCC *dcc)
 	else if (!dcc->wiotag)
 		dcc->wiotag = fe_input_add(sok, FIA_WRITE, (GIOFunc)dcc_send_data, dcc);
 
-	std::vector<char> buf(prefs.hex_dcc_blocksize);
-	lseek(dcc->fp, dcc->pos, SEEK_SET);
-	len = read(dcc->fp, &buf[0], prefs.hex_dcc_blocksize);
-	if (len < 1)
-		goto abortit;
-	sent = send(sok, &buf[0], len, 0);
+	/* only a send from the very start, on the copying path, can be hashed */
+	if (dcc->pos == 0 && !dcc->sender.zero_copy && !dcc->sender.hash)
+		dcc->sender.hash.reset(new ::dcc::xfer::sha256);
 
-	if (sent < 0 && !(would_block()))
+	/* without fastsend every block waits for its ack, so keep to the
+	   configured size; otherwise fill whatever room the socket has, unless
+	   a cps limit wants it metered out in small steps */
+	std::size_t chunk = prefs.hex_dcc_blocksize;
+	if (dcc->fastsend && !dcc->maxcps && !prefs.hex_dcc_global_max_send_cps)
+		chunk = ::dcc::xfer::send_window(sok, chunk, ::dcc::xfer::MAX_SEND_CHUNK);
+	if (dcc->size > dcc->pos)
+		chunk = std::min<std::size_t>(chunk, dcc->size - dcc->pos);
+
+	const auto sent = dcc->sender.send(sok, dcc->fp, dcc->pos, chunk);
+	if (sent == 0 || (sent < 0 && !would_block()))
 	{
-	abortit:
 		EMIT_SIGNAL(XP_TE_DCCSENDFAIL, dcc->serv->front_session,
 			file_part(dcc->file), dcc->nick,
 			errorstring(sock_error()), nullptr, 0);
@@ -1382,6 +1445,8 @@ dcc_handle_new_ack(::dcc::DCC *dcc)
 	if (dcc->pos >= dcc->size && dcc->ack >= (dcc->size & 0xffffffff))
 	{
 		dcc->ack = dcc->size;	/* force 100% ack for >4 GB */
+		if (dcc->sender.hash)
+			dcc->sha256 = dcc->sender.hash->hex();
 		dcc_close(dcc, STAT_DONE, false);
 		dcc_calc_average_cps(dcc);	/* this must be done _after_ dcc_close, or dcc_remove_from_sum will see the wrong value in dcc->cps */
 		/* cppcheck-suppress deallocuse */
@@ -1593,13 +1658,39 @@ dcc_send_wild(char *file)
 	::dcc::dcc_send(dccsess, dccto, file, dccmaxcps, 0);
 }
 
+/* the once a second timeout check, only running while there are DCCs */
+static timers::handle check_timer;
+
+static void
+dcc_start_check_timer(void)
+{
+	if (check_timer)
+		return;
+	check_timer = timers::add(1000, []{
+		hexchat::dcc::dcc_check_timeouts();
+		return true;
+	});
+}
+
+static void
+dcc_stop_check_timer(void)
+{
+	if (dcc_list)
+		return;
+	timers::remove(check_timer);
+	check_timer = 0;
+}
+
 static ::dcc::DCC *
 new_dcc(void)
 {
+	static int last_id = 0;
 	::dcc::DCC *dcc = new ::dcc::DCC();
+	dcc->id = ++last_id;
 	dcc->sok = -1;
 	dcc->fp = -1;
 	dcc_list = g_slist_prepend(dcc_list, dcc);
+	dcc_start_check_timer();
 	return (dcc);
 }
 
@@ -1904,7 +1995,7 @@ is_dcc_completed(::dcc::DCC *dcc)
 	return false;
 }
 
-/* this is called from hexchat.c:hexchat_misc_checks() every 1 second. */
+/* this is called every second while dcc_list isn't empty. */
 
 void
 dcc_check_timeouts(void)
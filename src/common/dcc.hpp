@@ -23,8 +23,11 @@
 #define HEXCHAT_DCC_HPP
 
 #include <ctime>						/* for time_t */
+#include <memory>
+#include <string>
 #include "proto-irc.hpp"
 #include "serverfwd.hpp"
+#include "dcc-xfer.hpp"
 
 namespace hexchat{
 #define STAT_QUEUED 0
@@ -70,6 +73,7 @@ struct DCC
 	int wiotag;						/* writing/sending io tag */
 	int port;
 	int pasvid;						/* mIRC's passive DCC id */
+	int id;							/* never reused, "id" in the plugin "dcc" list */
 	int cps;
 	int resume_error;
 	int resume_errno;
@@ -99,6 +103,9 @@ struct DCC
 										/* the resume point? */
 	unsigned char throttled;	/* 0x1 = per send/get throttle
 											0x2 = global throttle */
+	xfer::file_sender sender;	/* file -> socket path for sends */
+	std::unique_ptr<xfer::file_receiver> receiver;	/* socket -> file path for gets */
+	std::string sha256;	/* of the whole file, if it all went past us */
 };
 
 enum{ MAX_PROXY_BUFFER = 1024 };
@@ -21,12 +21,14 @@
 #define HEXCHAT_FE_HPP
 
 #include <cstdint>
+#include <ctime>
 #include <string>
 #include <boost/optional.hpp>
 #include <boost/utility/string_ref_fwd.hpp>
 #include <glib.h>
 #include "sessfwd.hpp"
 struct User;
+struct userlist_moves;
 
 /* for storage of /menu entries */
 struct menu_entry
@@ -98,7 +100,7 @@ int fe_is_chanwindow (struct server *serv);
 void fe_add_chan_list (struct server *serv, char *chan, char *users,
 							  char *topic);
 void fe_chan_list_end (struct server *serv);
-gboolean fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, int rplcode);
+gboolean fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, time_t stamp, int rplcode);
 gboolean fe_ban_list_end (struct session *sess, int rplcode);
 void fe_notify_update(const std::string* name);
 void fe_text_clear (struct session *sess, int lines);
@@ -108,10 +110,11 @@ void fe_progressbar_end (struct server *serv);
 void fe_print_text (session &sess, char *text, time_t stamp,
 					gboolean no_activity);
 void fe_userlist_insert (struct session *sess, struct User *newuser, int row, bool sel);
-bool fe_userlist_remove (struct session *sess, struct User const *user);
+void fe_userlist_remove (struct session *sess, struct User const *user, int row);
 void fe_userlist_rehash (struct session *sess, struct User const *user);
 void fe_userlist_update (struct session *sess, struct User *user);
-void fe_userlist_move (struct session *sess, struct User *user, int new_row);
+void fe_userlist_move (struct session *sess, struct User *user, int old_row, int new_row);
+void fe_userlist_reorder (struct session *sess, const struct userlist_moves & moves);
 void fe_userlist_numbers (session &sess);
 void fe_userlist_clear (session &sess);
 void fe_userlist_set_selected (struct session *sess);
@@ -164,7 +167,8 @@ enum fe_gui_action{
 	FE_GUI_ICONIFY,
 	FE_GUI_MENU,
 	FE_GUI_ATTACH,
-	FE_GUI_APPLY
+	FE_GUI_APPLY,
+	FE_GUI_FRAMES
 };
 void fe_ctrl_gui (session *sess, fe_gui_action action, int arg);
 int fe_gui_info (session *sess, int info_type);
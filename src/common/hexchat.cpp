@@ -29,6 +29,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <string>
 #include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -57,6 +58,7 @@
 #include "notify.hpp"
 #include "server.hpp"
 #include "session.hpp"
+#include "session_registry.hpp"
 #include "session_logging.hpp"
 #include "servlist.hpp"
 #include "outbound.hpp"
@@ -66,6 +68,8 @@
 #include "dcc.hpp"
 #include "userlist.hpp"
 #include "glist_iterators.hpp"
+#include "startup.hpp"
+#include "timers.hpp"
 
 #if ! GLIB_CHECK_VERSION (2, 36, 0)
 #include <glib-object.h>			/* for g_type_init() */
@@ -105,7 +109,6 @@ GSList *dcc_list = nullptr;
  * session with the most important/recent activity.
  */
 GList *sess_list_by_lastact[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
-using sess_itr = glib_helper::glist_iterator < session >;
 
 static std::atomic_bool in_hexchat_exit = { false };
 std::atomic_bool hexchat_is_quitting = { false };
@@ -117,6 +120,7 @@ char *arg_url = nullptr;
 char **arg_urls = nullptr;
 char *arg_command = nullptr;
 gint arg_existing = FALSE;
+gint arg_trace_startup = FALSE;
 
 #ifdef USE_DBUS
 #include "dbus/dbus-client.h"
@@ -213,71 +217,91 @@ lastact_getfirst(int (*filter) (session *sess))
 bool
 is_session (session * sess)
 {
-	return g_slist_find(sess_list, sess) != nullptr;
+	return session_registry::contains(sess);
 }
 
 session * find_dialog(const server &serv, const boost::string_ref &nick)
 {
-	sess_itr end;
-	auto result = std::find_if(
-		sess_itr(sess_list),
-		end,
-		[&nick, &serv](const session& sess)
-		{
-			return (sess.server == &serv && sess.type == session::SESS_DIALOG) && !serv.compare(nick, sess.channel);
-		});
-	return result != end ? &(*result) : nullptr;
+	return session_registry::find(serv, session::SESS_DIALOG, nick);
 }
 
 session *find_channel(const server &serv, const boost::string_ref &chan)
 {
-	sess_itr end;
-	auto result = std::find_if(
-		sess_itr(sess_list),
-		end,
-		[&chan, &serv](const session& sess)
-	{
-		return (sess.server == &serv && sess.type == session::SESS_CHANNEL) && !serv.compare(chan, sess.channel);
+	return session_registry::find(serv, session::SESS_CHANNEL, chan);
+}
+
+#define LAG_CHECK_INTERVAL 30000	/* ms between lag pings */
+#define LAG_METER_INTERVAL 500		/* ms between lag meter redraws */
+
+/* keeps the lag meter moving until the ping comes back */
+static void
+lag_meter_start (server &serv)
+{
+	if (serv.lag_meter_timer)
+		return;
+	serv.lag_meter_timer = timers::add (LAG_METER_INTERVAL, [&serv]{
+		if (!serv.lag_sent)
+		{
+			serv.lag_meter_timer = 0;
+			return false;
+		}
+		if (prefs.hex_gui_lagometer)
+			fe_set_lag (serv, -1);
+		return true;
 	});
-	return result != end ? &(*result) : nullptr;
 }
 
 void
-lag_check (void)
+lag_check (server &serv)
 {
 	using namespace boost;
 	char tbuf[128];
-	auto now = chrono::steady_clock::now();
 
-	auto tim = make_ping_time ();
+	if (!serv.connected || !serv.end_of_motd)
+		return;
 
-	for (auto & serv : glib_helper::glist_iterable<server>(serv_list))
+	auto seconds = chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - serv.ping_recv).count();
+	if (prefs.hex_net_ping_timeout && seconds > prefs.hex_net_ping_timeout && seconds > 0)
+	{
+		snprintf(tbuf, sizeof(tbuf), "%" PRId64, seconds);
+		EMIT_SIGNAL (XP_TE_PINGTIMEOUT, serv.server_session, tbuf, nullptr,
+						 nullptr, nullptr, 0);
+		if (prefs.hex_net_auto_reconnect)
+			serv.auto_reconnect (false, -1);
+	} else
 	{
-		if (serv.connected && serv.end_of_motd)
+		auto tim = make_ping_time ();
+		snprintf (tbuf, sizeof (tbuf), "LAG%lu", tim);
+		serv.p_ping({}, tbuf);
+
+		if (!serv.lag_sent)
 		{
-			auto seconds = chrono::duration_cast<chrono::seconds>(now - serv.ping_recv).count();
-			if (prefs.hex_net_ping_timeout && seconds > prefs.hex_net_ping_timeout && seconds > 0)
-			{
-				snprintf(tbuf, sizeof(tbuf), "%" PRId64, seconds);
-				EMIT_SIGNAL (XP_TE_PINGTIMEOUT, serv.server_session, tbuf, nullptr,
-								 nullptr, nullptr, 0);
-				if (prefs.hex_net_auto_reconnect)
-					serv.auto_reconnect (false, -1);
-			} else
-			{
-				snprintf (tbuf, sizeof (tbuf), "LAG%lu", tim);
-				serv.p_ping({}, tbuf);
-				
-				if (!serv.lag_sent)
-				{
-					serv.lag_sent = tim;
-					fe_set_lag (serv, -1);
-				}
-			}
+			serv.lag_sent = tim;
+			fe_set_lag (serv, -1);
+			lag_meter_start (serv);
 		}
 	}
 }
 
+void
+lag_check (void)
+{
+	for (auto & serv : glib_helper::glist_iterable<server>(serv_list))
+		lag_check (serv);
+}
+
+/* logged in, ping it every LAG_CHECK_INTERVAL from now on */
+void
+lag_check_start (server &serv)
+{
+	timers::remove (serv.lag_timer);
+	serv.lag_timer = timers::add (LAG_CHECK_INTERVAL, [&serv]{
+		if (prefs.hex_gui_lagometer)
+			lag_check (serv);
+		return true;
+	});
+}
+
 nbexec::nbexec(session *sess)
 	:myfd(),
 	childpid(),
@@ -359,6 +383,7 @@ session_free (session *killsess)
 		killserv->server_session = killserv->front_session;
 
 	sess_list = g_slist_remove (sess_list, killsess);
+	session_registry::remove (*killsess);
 
 	oldidx = killsess->lastact_idx;
 	if (oldidx != LACT_NONE)
@@ -552,11 +577,7 @@ xchat_init (void)
 	if (g_get_charset (&cs))
 		prefs.utf8_locale = TRUE;
 
-	load_text_events ();
-	sound_load ();
-	notify_load ();
-	ignore_load ();
-
+	/* the menu defaults all go through buf, so they're built up front */
 	snprintf (buf, sizeof (buf),
 		"NAME %s~%s~\n"				"CMD query %%s\n\n"\
 		"NAME %s~%s~\n"				"CMD send %%s\n\n"\
@@ -611,7 +632,7 @@ xchat_init (void)
 		_("KickBan"),
 		_("KickBan"));
 
-	list_loadconf ("popup.conf", popup_list, buf);
+	const std::string popup_defaults (buf);
 
 	snprintf (buf, sizeof (buf),
 		"NAME %s\n"				"CMD part\n\n"
@@ -625,7 +646,7 @@ xchat_init (void)
 				_("Server Links"),
 				_("Ping Server"),
 				_("Hide Version"));
-	list_loadconf ("usermenu.conf", usermenu_list, buf);
+	const std::string usermenu_defaults (buf);
 
 	snprintf (buf, sizeof (buf),
 		"NAME %s\n"		"CMD op %%a\n\n"
@@ -642,7 +663,7 @@ xchat_init (void)
 				_("Enter reason to kick %s:"),
 				_("Sendfile"),
 				_("Dialog"));
-	list_loadconf ("buttons.conf", button_list, buf);
+	const std::string button_defaults (buf);
 
 	snprintf (buf, sizeof (buf),
 		"NAME %s\n"				"CMD whois %%s %%s\n\n"
@@ -655,16 +676,45 @@ xchat_init (void)
 				_("Chat"),
 				_("Clear"),
 				_("Ping"));
-	list_loadconf ("dlgbuttons.conf", dlgbutton_list, buf);
-
-	list_loadconf ("tabmenu.conf", tabmenu_list, nullptr);
-	list_loadconf ("ctcpreply.conf", ctcp_list, defaultconf_ctcp);
-	list_loadconf ("commands.conf", command_list, defaultconf_commands);
-	list_loadconf ("replace.conf", replace_list, defaultconf_replace);
-	list_loadconf ("urlhandlers.conf", urlhandler_list,
-						defaultconf_urlhandlers);
+	const std::string dlgbutton_defaults (buf);
+
+	/* these only read their own config files, so they can do it side by side */
+	startup::run_parallel ({
+		{"read_text_events", read_text_events},
+		{"sound_load", sound_load},
+		{"ignore_load", ignore_load},
+		{"chanopt_init", chanopt_init},
+		{"servlist_init", servlist_init},	/* load server list */
+		{"list_loadconf", [&]
+		{
+			list_loadconf ("popup.conf", popup_list, popup_defaults.c_str ());
+			list_loadconf ("usermenu.conf", usermenu_list, usermenu_defaults.c_str ());
+			list_loadconf ("buttons.conf", button_list, button_defaults.c_str ());
+			list_loadconf ("dlgbuttons.conf", dlgbutton_list, dlgbutton_defaults.c_str ());
+			list_loadconf ("tabmenu.conf", tabmenu_list, nullptr);
+			list_loadconf ("ctcpreply.conf", ctcp_list, defaultconf_ctcp);
+			list_loadconf ("commands.conf", command_list, defaultconf_commands);
+			list_loadconf ("replace.conf", replace_list, defaultconf_replace);
+			list_loadconf ("urlhandlers.conf", urlhandler_list,
+								defaultconf_urlhandlers);
+		}},
+	});
 
-	servlist_init ();							/* load server list */
+	{
+		/* sound_load only parsed sound.conf, caching the sounds is main thread work */
+		startup::span trace ("sound_preload");
+		sound_preload ();
+	}
+	{
+		/* may complain about a broken event through the GUI */
+		startup::span trace ("pevent_make_pntevts");
+		pevent_make_pntevts ();
+	}
+	{
+		/* adding a friend updates the GUI, so not on a worker either */
+		startup::span trace ("notify_load");
+		notify_load ();
+	}
 
 	/* if we got a URL, don't open the server list GUI */
 	if (!prefs.hex_gui_slist_skip && !arg_url && !arg_urls)
@@ -744,11 +794,29 @@ set_locale (void)
 #endif
 }
 
+static gboolean
+trace_startup_finish (gpointer)
+{
+	startup::trace_finish ();
+	return FALSE;
+}
+
 int
 hexmain (int argc, char *argv[])
 {
 	std::srand (static_cast<unsigned>(std::time (nullptr)));	/* CL: do this only once! */
 
+	/* fe_args() sees this one too, but by then loading the config is over */
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp (argv[i], "--trace-startup") == 0)
+		{
+			arg_trace_startup = TRUE;
+			startup::trace_enable ();
+			break;
+		}
+	}
+
 	/* We must check for the config dir parameter, otherwise load_config() will behave incorrectly.
 	 * load_config() must come before fe_args() because fe_args() calls gtk_init() which needs to
 	 * know the language which is set in the config. The code below is copy-pasted from fe_args()
@@ -783,16 +851,19 @@ hexmain (int argc, char *argv[])
 	g_type_init ();
 #endif
 
-	if (check_config_dir () == 0)
 	{
-		if (load_config () != 0)
+		startup::span trace ("load_config");
+		if (check_config_dir () == 0)
+		{
+			if (load_config () != 0)
+				load_default_config ();
+		} else
+		{
+			/* this is probably the first run */
 			load_default_config ();
-	} else
-	{
-		/* this is probably the first run */
-		load_default_config ();
-		make_config_dirs ();
-		make_dcc_dirs ();
+			make_config_dirs ();
+			make_dcc_dirs ();
+		}
 	}
 
 	/* we MUST do this after load_config () AND before fe_init (thus gtk_init) otherwise it will fail */
@@ -802,7 +873,11 @@ hexmain (int argc, char *argv[])
 	SOCKSinit (argv[0]);
 #endif
 
-	auto ret = fe_args (argc, argv);
+	int ret;
+	{
+		startup::span trace ("fe_args");
+		ret = fe_args (argc, argv);
+	}
 	if (ret != -1)
 		return ret;
 	
@@ -814,7 +889,10 @@ hexmain (int argc, char *argv[])
 	libproxy_factory = px_proxy_factory_new();
 #endif
 
-	fe_init ();
+	{
+		startup::span trace ("fe_init");
+		fe_init ();
+	}
 
 	/* This is done here because cfgfiles.c is too early in
 	* the startup process to use gtk functions. */
@@ -846,7 +924,13 @@ hexmain (int argc, char *argv[])
 	}
 #endif
 
-	xchat_init ();
+	{
+		startup::span trace ("xchat_init");
+		xchat_init ();
+	}
+	/* idle callbacks only run once the main window has been drawn */
+	if (startup::tracing ())
+		fe_idle_add (trace_startup_finish, nullptr);
 
 	fe_main ();
 
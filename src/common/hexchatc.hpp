@@ -34,6 +34,7 @@ extern char *arg_url;
 extern char **arg_urls;
 extern char *arg_command;
 extern gint arg_existing;
+extern gint arg_trace_startup;
 
 extern session *current_sess;
 extern session *current_tab;
@@ -58,6 +59,8 @@ session * lastact_getfirst (int (*filter) (session *sess));
 bool is_session (session * sess);
 void session_free (session *killsess);
 void lag_check (void);
+void lag_check (server &serv);
+void lag_check_start (server &serv);
 void hexchat_exit (void);
 void hexchat_exec (const char *cmd);
 
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/format.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/string_ref.hpp>
@@ -37,6 +38,7 @@
 #include "ignore.hpp"
 #include "cfgfiles.hpp"
 #include "fe.hpp"
+#include "filesystem.hpp"
 #include "text.hpp"
 #include "util.hpp"
 #include "hexchatc.hpp"
@@ -225,78 +227,47 @@ bool ignore_check(const boost::string_ref& mask, ignore::ignore_type type)
 	return false;
 }
 
-static char *
-ignore_read_next_entry (char *my_cfg, ignore &ig)
-{
-	char tbuf[1024];
-
-	/* Casting to char * done below just to satisfy compiler */
-
-	if (my_cfg)
-	{
-		my_cfg = cfg_get_str (my_cfg, "mask", tbuf, sizeof (tbuf));
-		if (!my_cfg)
-			return NULL;
-		ig.mask = tbuf;
-	}
-	if (my_cfg)
-	{
-		my_cfg = cfg_get_str (my_cfg, "type", tbuf, sizeof (tbuf));
-		ig.type = atoi (tbuf);
-	}
-	return my_cfg;
-}
-
 void
 ignore_load ()
 {
-	struct stat st;
-	char *my_cfg;
-	int fh, i;
-
-	fh = hexchat_open_file ("ignore.conf", O_RDONLY, 0, 0);
-	if (fh != -1)
+	gchar *cfg_ptr;
+	gsize cfg_len;
+	if (!g_file_get_contents (io::fs::make_config_path ("ignore.conf").string ().c_str (), &cfg_ptr, &cfg_len, nullptr))
+		return;
+	glib_string cfg(cfg_ptr);
+
+	/* each entry is a "mask" line followed by a "type" line */
+	boost::optional<ignore> ig;
+	for (const auto & ln : config::parse_lines (boost::string_ref (cfg_ptr, cfg_len)))
 	{
-		fstat (fh, &st);
-		if (st.st_size)
+		if (boost::iequals (ln.key, "mask"))
 		{
-			std::string cfg(st.st_size + 1, '\0');
-			cfg[0] = '\0';
-			i = read (fh, &cfg[0], st.st_size);
-			if (i >= 0)
-				cfg[i] = '\0';
-			my_cfg = &cfg[0];
-			while (my_cfg)
-			{
-				ignore ig;
-				if ((my_cfg = ignore_read_next_entry(my_cfg, ig)))
-					ignores.emplace_back(std::move(ig));
-			}
+			ig = ignore ();
+			ig->mask = ln.value.to_string ();
+		}
+		else if (ig && boost::iequals (ln.key, "type"))
+		{
+			ig->type = std::atoi (ln.value.to_string ().c_str ());
+			ignores.emplace_back (std::move (*ig));
+			ig = boost::none;
 		}
-		close (fh);
 	}
 }
 
 void
 ignore_save ()
 {
-	char buf[1024];
-	int fh;
-
-	fh = hexchat_open_file ("ignore.conf", O_TRUNC | O_WRONLY | O_CREAT, 0600, XOF_DOMODE);
-	if (fh != -1)
+	config::writer out;
+	for(const auto & ig : ignores)
 	{
-		for(const auto & ig : ignores)
+		if (!(ig.type & ignore::IG_NOSAVE))
 		{
-			if (!(ig.type & ignore::IG_NOSAVE))
-			{
-				snprintf (buf, sizeof (buf), "mask = %s\ntype = %u\n\n",
-							 ig.mask.c_str(), ig.type);
-				write (fh, buf, strlen (buf));
-			}
+			out.put_str ("mask", ig.mask);
+			out.put_str ("type", std::to_string (ig.type));
+			out.put_raw ("\n");
 		}
-		close (fh);
 	}
+	out.commit (io::fs::make_config_path ("ignore.conf").string ());
 }
 
 static gboolean
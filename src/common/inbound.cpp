@@ -59,12 +59,14 @@
 #include "servlist.hpp"
 #include "text.hpp"
 #include "hexchatc.hpp"
+#include "autojoin.hpp"
 #include "chanopt.hpp"
 #include "dcc.hpp"
 #include "sasl.hpp"
 #include "userlist.hpp"
 #include "session.hpp"
 #include "session_logging.hpp"
+#include "session_registry.hpp"
 
 namespace dcc = hexchat::dcc;
 
@@ -74,8 +76,11 @@ clear_channel (session &sess)
 	if (sess.channel[0])
 		strcpy (sess.waitchannel, sess.channel);
 	sess.channel[0] = 0;
+	session_registry::renamed (sess);
 	sess.doing_who = false;
 	sess.done_away_check = false;
+	sess.who_replies.clear();
+	sess.bans.clear();
 
 	//log_close (sess);
 
@@ -217,7 +222,7 @@ inbound_privmsg (server &serv, char *from, char *ip, char *text, bool id,
 	if (user)
 	{
 		user->lasttalk = time (0);
-		if (user->account)
+		if (user->info->account)
 			id = true;
 	}
 	
@@ -399,7 +404,7 @@ inbound_action (session *sess, const std::string& chan, char *from, char *ip, ch
 	{
 		nickchar[0] = user->prefix[0];
 		user->lasttalk = std::time (nullptr);
-		if (user->account)
+		if (user->info->account)
 			id = true;
 		if (user->me)
 			fromme = true;
@@ -462,7 +467,7 @@ inbound_chanmsg (server &serv, session *sess, char *chan, char *from,
 	char nickchar[2] = "\000";
 	if (user)
 	{
-		if (user->account)
+		if (user->info->account)
 			id = true;
 		nickchar[0] = user->prefix[0];
 		user->lasttalk = std::time (nullptr);
@@ -504,12 +509,23 @@ inbound_newnick (server &serv, char *nick, char *newnick, int quiet,
 		safe_strcpy (serv.nick, newnick, NICKLEN);
 	}
 
+	/* rename and re-sort every channel before any plugin gets to see the
+	   change, the user_info they share is renamed by the first one */
+	std::vector<session*> changed;
+	for (auto list = sess_list; list; list = g_slist_next(list))
+	{
+		auto sess = static_cast<session*>(list->data);
+		if (sess->server == &serv && userlist_change(sess, nick, newnick))
+			changed.push_back(sess);
+	}
+
 	for (auto list = sess_list; list; list = g_slist_next(list))
 	{
 		auto sess = static_cast<session*>(list->data);
 		if (sess->server == &serv)
 		{
-			if (userlist_change(sess, nick, newnick) || (me && sess->type == session::SESS_SERVER))
+			if (std::find(changed.cbegin(), changed.cend(), sess) != changed.cend()
+				|| (me && sess->type == session::SESS_SERVER))
 			{
 				if (!quiet)
 				{
@@ -525,6 +541,7 @@ inbound_newnick (server &serv, char *nick, char *newnick, int quiet,
 			if (sess->type == session::SESS_DIALOG && !serv.p_cmp(sess->channel, nick))
 			{
 				safe_strcpy (sess->channel, newnick, CHANLEN);
+				session_registry::renamed (*sess);
 				fe_set_channel (sess);
 			}
 			fe_set_title (*sess);
@@ -594,6 +611,7 @@ inbound_ujoin (server &serv, char *chan, char *nick, char *ip,
 	}
 
 	safe_strcpy (sess->channel, chan, CHANLEN);
+	session_registry::renamed (*sess);
 	if (found_unused)
 	{
 		chanopt_load (sess);
@@ -615,18 +633,11 @@ inbound_ujoin (server &serv, char *chan, char *nick, char *ip,
 	sess->ignore_names = true;
 	sess->end_of_names = false;
 
-	/* sends a MODE */
-	serv.p_join_info (chan);
-
 	EMIT_SIGNAL_TIMESTAMP (XP_TE_UJOIN, sess, nick, chan, ip, nullptr, 0,
 								  tags_data->timestamp);
 
-	if (prefs.hex_irc_who_join)
-	{
-		/* sends WHO #channel */
-		serv.p_user_list (chan);
-		sess->doing_who = true;
-	}
+	/* sends a MODE and WHO #channel, or queues them while autojoining */
+	autojoin::joined (serv, *sess);
 }
 
 void
@@ -838,12 +849,7 @@ void
 inbound_account (const server &serv, const char *nick, const char *account,
 					  const message_tags_data *tags_data)
 {
-	for (auto list = sess_list; list; list = g_slist_next(list))
-	{
-		auto sess = static_cast<session*>(list->data);
-		if (sess->server == &serv)
-			userlist_set_account (sess, nick, account);
-	}
+	userlist_set_account (serv, nick, account);
 }
 
 void
@@ -1031,34 +1037,23 @@ inbound_away (server &serv, char *nick, char *msg,
 		EMIT_SIGNAL_TIMESTAMP (XP_TE_WHOIS5, sess, nick, msg, nullptr, nullptr, 0,
 									  tags_data->timestamp);
 
-	for (auto list = sess_list; list; list = g_slist_next(list))
-	{
-		auto sess = static_cast<session*>(list->data);
-		if (sess->server == &serv)
-			userlist_set_away (sess, nick, true);
-	}
+	userlist_set_away (serv, nick, true);
 }
 
 void
 inbound_away_notify (const server &serv, char *nick, char *reason,
 							const message_tags_data *tags_data)
 {
-	for (auto list = sess_list; list; list = g_slist_next(list))
+	userlist_set_away (serv, nick, reason ? true : false);
+	auto sess = serv.front_session;
+	if (sess && notify_is_in_list (serv, nick))
 	{
-		auto sess = static_cast<session*>(list->data);
-		if (sess->server == &serv)
-		{
-			userlist_set_away (sess, nick, reason ? true : false);
-			if (sess == serv.front_session && notify_is_in_list (serv, nick))
-			{
-				if (reason)
-					EMIT_SIGNAL_TIMESTAMP (XP_TE_NOTIFYAWAY, sess, nick, reason, nullptr,
-												  nullptr, 0, tags_data->timestamp);
-				else
-					EMIT_SIGNAL_TIMESTAMP (XP_TE_NOTIFYBACK, sess, nick, nullptr, nullptr, 
-												  nullptr, 0, tags_data->timestamp);
-			}
-		}
+		if (reason)
+			EMIT_SIGNAL_TIMESTAMP (XP_TE_NOTIFYAWAY, sess, nick, reason, nullptr,
+										  nullptr, 0, tags_data->timestamp);
+		else
+			EMIT_SIGNAL_TIMESTAMP (XP_TE_NOTIFYBACK, sess, nick, nullptr, nullptr, 
+										  nullptr, 0, tags_data->timestamp);
 	}
 }
 
@@ -1140,14 +1135,17 @@ check_autojoin_channels (server &serv)
 
 	if (!sess_channels.empty())
 	{
-		serv.p_join_list (sess_channels);
+		autojoin::start (serv, sess_channels);
 	}
 	else
 	{
 		/* If there's no session, just autojoin to favorites. */
 		if (serv.favlist)
 		{
-			serv.p_join_list (serv.favlist);
+			std::vector<favchannel> favorites;
+			for (auto list = serv.favlist; list; list = g_slist_next (list))
+				favorites.push_back (*static_cast<favchannel*>(list->data));
+			autojoin::start (serv, favorites);
 			i++;
 
 			/* FIXME this is not going to work and is not needed either. server_free() does the job already. */
@@ -1332,12 +1330,7 @@ inbound_login_start (session *sess, char *nick, char *servname,
 static void
 inbound_set_all_away_status (const server &serv, const char *nick, bool away)
 {
-	for (auto list = sess_list; list; list = g_slist_next(list))
-	{
-		auto sess = static_cast<session*>(list->data);
-		if (sess->server == &serv)
-			userlist_set_away (sess, nick, away);
-	}
+	userlist_set_away (serv, nick, away);
 }
 
 void
@@ -1404,7 +1397,14 @@ inbound_user_info (session *sess, char *chan, char *user, char *host,
 	if (chan)
 	{
 		auto who_sess = find_channel (*serv, chan);
-		if (who_sess)
+		if (who_sess && who_sess->doing_who && nick)
+		{
+			/* our own WHO, applied in one go when it ends */
+			auto or_empty = [](const char *s){ return std::string (s ? s : ""); };
+			who_sess->who_replies.push_back (who_reply{ nick, or_empty (uhost.get()), or_empty (realname),
+				or_empty (servname), or_empty (account), away });
+		}
+		else if (who_sess)
 			userlist_add_hostname (who_sess, nick, uhost.get(), realname, servname, account, away);
 		else
 		{
@@ -1450,7 +1450,8 @@ bool inbound_banlist (session *sess, time_t stamp, char *chan, char *mask,
 		goto nowindow;
 	}
 
-	if (!fe_add_ban_list (sess, mask, banner, time_str, rplcode))
+	sess->bans.reply (banlist::from_reply (rplcode), mask, banner, stamp > 0 ? stamp : 0);
+	if (!fe_add_ban_list (sess, mask, banner, time_str, stamp > 0 ? stamp : 0, rplcode))
 	{
 nowindow:
 
@@ -1462,6 +1463,15 @@ nowindow:
 	return true;
 }
 
+bool inbound_banlist_end (server &serv, char *chan, int rplcode)
+{
+	session *sess = find_channel (serv, chan);
+	if (!sess)
+		return false;
+	sess->bans.end (banlist::from_end (rplcode));
+	return fe_ban_list_end (sess, rplcode);
+}
+
 /* execute 1 end-of-motd command */
 
 static bool
@@ -1543,6 +1553,8 @@ inbound_login_end (session *sess, char *text, const message_tags_data *tags_data
 		}
 
 		serv.end_of_motd = true;
+		serv.reconnect_done ();
+		lag_check_start (serv);
 	}
 
 	if (prefs.hex_irc_skip_motd && !serv.motd_skipped)
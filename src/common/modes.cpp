@@ -21,11 +21,12 @@
 #define NOMINMAX
 #endif
 #include <algorithm>
-#include <locale>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <ctime>
 #include <stdexcept>
 #include <boost/utility/string_ref.hpp>
 
@@ -52,6 +53,7 @@ struct mode_run
 	std::string deop;
 	std::string voice;
 	std::string devoice;
+	userlist_moves moves;	/* whose access changed on this line, and where they went */
 };
 
 static int is_prefix_char (const server * serv, char c);
@@ -401,8 +403,8 @@ handle_single_mode (mode_run &mr, char sign, char mode, char *nick,
 	/* is this a nick mode? */
 	if (serv.nick_modes.find_first_of(mode) != std::string::npos)
 	{
-		/* update the user in the userlist */
-		userlist_update_mode (sess, /*nickname */ arg, mode, sign);
+		/* update the user in the userlist, the GUI catches up at the end */
+		userlist_apply_mode (sess, /*nickname */ arg, mode, sign, mr.moves);
 	} else
 	{
 		if (!is_324 && !sess->ignore_mode && mode_chanmode_type(serv, mode) >= 1)
@@ -418,6 +420,20 @@ handle_single_mode (mode_run &mr, char sign, char mode, char *nick,
 			supportsq = true;
 	}
 
+	/* keep the cached lists current, if it's a list mode here (+q can be
+	   owner and +e/+I may not exist) */
+	{
+		const auto list = banlist::from_mode (mode);
+		if (list != banlist::LIST_COUNT && *arg
+			&& (mode == 'b' || mode_chanmode_type (serv, mode) == 0))
+		{
+			if (sign == '+')
+				sess->bans.add (list, arg, nick, std::time (nullptr), serv.casemapping ());
+			else
+				sess->bans.remove (list, arg, serv.casemapping ());
+		}
+	}
+
 	switch (sign)
 	{
 	case '+':
@@ -754,6 +770,9 @@ handle_mode (server & serv, char *word[], char *word_eol[],
 		modes++;
 	}
 
+	/* whatever moved in sess's userlist has to move in the GUI too */
+	userlist_modes_applied (sess, mr.moves);
+
 	/* update the title at the end, now that the mode update is internal now */
 	if (!using_front_tab)
 		fe_set_title (*sess);
@@ -762,19 +781,6 @@ handle_mode (server & serv, char *word[], char *word_eol[],
 	mode_print_grouped (sess, nick, mr, tags_data);
 }
 
-namespace
-{
-	struct ascii_strcasecmp : public std::collate < char >
-	{
-	protected:
-		int do_compare(const char * low1, const char * high1,
-			const char * low2, const char* high2) const
-		{
-			return g_ascii_strcasecmp(low1, low2);
-		}
-	};
-}
-
 /* handle the 005 numeric */
 
 void
@@ -814,9 +820,32 @@ inbound_005 (server & serv, char *word[], const message_tags_data *tags_data)
 		} else if (strncmp (word[w], "WATCH=", 6) == 0)
 		{
 			serv.supports_watch = TRUE;
+			serv.watch_limit = atoi (word[w] + 6);
 		} else if (strncmp (word[w], "MONITOR=", 8) == 0)
 		{
 			serv.supports_monitor = TRUE;
+			serv.watch_limit = atoi (word[w] + 8);
+		} else if (strncmp (word[w], "TARGMAX=", 8) == 0)
+		{
+			/* TARGMAX=PRIVMSG:4,JOIN:,... an empty limit means none */
+			serv.join_targets = 0;
+			serv.join_targets_targmax = true;
+			const char *cmd = word[w] + 8;
+			while (cmd)
+			{
+				if (g_ascii_strncasecmp (cmd, "JOIN:", 5) == 0)
+				{
+					serv.join_targets = atoi (cmd + 5);
+					break;
+				}
+				cmd = strchr (cmd, ',');
+				if (cmd)
+					cmd++;
+			}
+		} else if (strncmp (word[w], "MAXTARGETS=", 11) == 0)
+		{
+			if (!serv.join_targets_targmax)
+				serv.join_targets = atoi (word[w] + 11);
 		} else if (strncmp (word[w], "NETWORK=", 8) == 0)
 		{
 /*			if (serv.networkname)
@@ -831,11 +860,8 @@ inbound_005 (server & serv, char *word[], const message_tags_data *tags_data)
 
 		} else if (strncmp (word[w], "CASEMAPPING=", 12) == 0)
 		{
-			if (strcmp(word[w] + 12, "ascii") == 0)	/* bahamut */
-			{
-				serv.p_cmp = (int(*)(const char*, const char*))g_ascii_strcasecmp;
-				serv.imbue(std::locale(std::locale(), new ascii_strcasecmp));
-			}
+			/* ascii is bahamut's */
+			serv.set_casemapping (casemap::parse (word[w] + 12));
 		} else if (strncmp (word[w], "CHARSET=", 8) == 0)
 		{
 			if (g_ascii_strncasecmp (word[w] + 8, "UTF-8", 5) == 0)
@@ -26,10 +26,14 @@
 #include <cstring>
 #include <cstdlib>
 #include <ctime>
+#include <deque>
 #include <functional>
 #include <locale>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -48,6 +52,7 @@
 #include "notify.hpp"
 #include "cfgfiles.hpp"
 #include "fe.hpp"
+#include "filesystem.hpp"
 #include "server.hpp"
 #include "text.hpp"
 #include "util.hpp"
@@ -56,7 +61,28 @@
 
 
 GSList *notify_list = 0;
-int notify_tag = 0;
+timers::handle notify_tag = 0;
+
+namespace
+{
+	/* one server's view of the notify list */
+	struct server_notify
+	{
+		std::vector<notify_per_server *> entries;	/* in notify_list order */
+		std::unordered_map<std::string, notify_per_server *> by_nick;	/* casefolded nick */
+		std::vector<std::string> unwatch;	/* dropped from the list but still on the server's */
+		std::deque<std::vector<std::string>> ison_sent;	/* casefolded nicks of each ISON not answered yet */
+	};
+
+	std::unordered_map<server *, server_notify> server_notifies;
+	int notify_sync_tag;
+
+	/* IRC lines are 512 bytes including the CRLF, stay well short of that */
+	enum { NOTIFY_LINE_MAX = 500 };
+	/* list changes are sent to the servers this long after the last one,
+	   so loading or editing the list sends a few lines, not one per nick */
+	enum { NOTIFY_SYNC_DELAY = 100 };
+}
 
 /* monitor this nick on this particular network? */
 
@@ -76,7 +102,7 @@ static bool notify_do_network (struct notify *notify, const server &serv)
 		notify->networks.cend(),
 		[&serv_str](const std::string & net){
 			return rfc_casecmp(net.c_str(), serv_str.c_str()) == 0;
-		}) == notify->networks.cend();
+		}) != notify->networks.cend();
 }
 
 struct notify_per_server *
@@ -103,78 +129,83 @@ notify_find_server_entry (struct notify *notify, struct server &serv)
 	return servnot.release();
 }
 
-void notify_save (void)
+/* prepend for a notify that was just put at the front of notify_list */
+static void notify_index_add (server &serv, server_notify &index, struct notify *notify, bool prepend)
 {
-	int fh = hexchat_open_file ("notify.conf", O_TRUNC | O_WRONLY | O_CREAT, 0600, XOF_DOMODE);
-	if (fh == -1)
-	{
+	auto servnot = notify_find_server_entry (notify, serv);
+	if (!servnot)
 		return;
+	/* like the linear search used to, the first one on the list wins */
+	if (prepend)
+	{
+		index.entries.insert (index.entries.begin (), servnot);
+		index.by_nick[serv.casefold (notify->name)] = servnot;
 	}
+	else
+	{
+		index.entries.push_back (servnot);
+		index.by_nick.emplace (serv.casefold (notify->name), servnot);
+	}
+}
+
+/* the server's watched nicks, built the first time they're needed */
+static server_notify & notify_index (server &serv)
+{
+	auto found = server_notifies.find (&serv);
+	if (found != server_notifies.end ())
+		return found->second;
+
+	auto & index = server_notifies[&serv];
+	for (GSList *list = notify_list; list; list = list->next)
+		notify_index_add (serv, index, static_cast<struct notify *>(list->data), false);
+	return index;
+}
+
+void notify_save (void)
+{
+	config::writer out;
 	GSList *list = notify_list;
 	while (list)
 	{
 		auto notify = static_cast<struct notify *>(list->data);
-		write(fh, notify->name.c_str(), notify->name.size());
+		out.put_raw(notify->name);
 		if (!notify->networks.empty())
 		{
-			write(fh, " ", 1);
-			auto result = boost::join(notify->networks, ",");
-			write(fh, result.c_str(), result.size());
+			out.put_raw(" ");
+			out.put_raw(boost::join(notify->networks, ","));
 		}
-		write(fh, "\n", 1);
+		out.put_raw("\n");
 		list = list->next;
 	}
-	close(fh);
+	out.commit(io::fs::make_config_path("notify.conf").string());
 }
 
 void notify_load (void)
 {
-	int fh = hexchat_open_file ("notify.conf", O_RDONLY, 0, 0);
-	if (fh == -1)
+	gchar *cfg_ptr;
+	gsize cfg_len;
+	if (!g_file_get_contents(io::fs::make_config_path("notify.conf").string().c_str(), &cfg_ptr, &cfg_len, nullptr))
 	{
 		return;
 	}
+	glib_string cfg(cfg_ptr);
 
-	char buf[256];
-	char *sep;
-	while (waitline(fh, buf, sizeof buf, FALSE) != -1)
+	/* "nick networks", the networks are optional */
+	for (const auto & ln : config::parse_lines(boost::string_ref(cfg_ptr, cfg_len), ' '))
 	{
-		if (buf[0] != '#' && buf[0] != 0)
-		{
-			sep = strchr(buf, ' ');
-			if (sep)
-			{
-				sep[0] = 0;
-				notify_adduser(buf, sep + 1);
-			}
-			else
-				notify_adduser(buf, NULL);
-		}
+		const auto name = ln.key.to_string();
+		if (ln.text.size() > ln.key.size())
+			notify_adduser(name.c_str(), ln.value.to_string().c_str());
+		else
+			notify_adduser(name.c_str(), nullptr);
 	}
-	close(fh);
 }
 
 static struct notify_per_server * notify_find (server &serv, const std::string& nick)
 {
-	GSList *list = notify_list;
-	while (list)
-	{
-		auto notify = static_cast<struct notify *>(list->data);
-
-		auto servnot = notify_find_server_entry (notify, serv);
-		if (!servnot)
-		{
-			list = list->next;
-			continue;
-		}
-
-		if (!serv.compare(notify->name, nick))
-			return servnot;
-
-		list = list->next;
-	}
-
-	return 0;
+	auto & index = notify_index (serv);
+	auto found = index.by_nick.find (serv.casefold (nick));
+	return found != index.by_nick.end () ? found->second : nullptr;
 }
 
 static void notify_announce_offline (server & serv, struct notify_per_server *servnot,
@@ -255,28 +286,29 @@ notify_set_online (server & serv, const std::string& nick,
 	notify_announce_online (serv, *servnot, nick, tags_data);
 }
 
-/* monitor can send lists for numeric 730/731 */
+/* monitor can send lists for numeric 730/731: nick!user@host for
+   the ones online, just the nick for the ones that aren't */
 
-void
-notify_set_offline_list (server & serv, const std::string & users, bool quiet,
-						  const message_tags_data *tags_data)
+static std::vector<std::string> notify_split_targets (const std::string & users)
 {
-	struct notify_per_server *servnot;
-	//char nick[NICKLEN] = { 0 };
-
+	std::vector<std::string> nicks;
 	std::istringstream stream(users);
 	for (std::string token; std::getline(stream, token, ',');)
 	{
-		auto pos = token.find_first_of('!');
-		if (pos == std::string::npos)
-			continue;
-
-		if (pos + 1 >= NICKLEN)
-			continue;
-		auto nick = token.substr(0, pos);
-		//std::copy_n(token.cbegin(), pos, std::begin(nick));
+		auto nick = token.substr(0, token.find_first_of('!'));
+		if (!nick.empty() && nick.size() < NICKLEN)
+			nicks.push_back(std::move(nick));
+	}
+	return nicks;
+}
 
-		servnot = notify_find (serv, nick);
+void
+notify_set_offline_list (server & serv, const std::string & users, bool quiet,
+						  const message_tags_data *tags_data)
+{
+	for (const auto & nick : notify_split_targets (users))
+	{
+		auto servnot = notify_find (serv, nick);
 		if (servnot)
 			notify_announce_offline (serv, servnot, nick, quiet, tags_data);
 	}
@@ -285,188 +317,169 @@ notify_set_offline_list (server & serv, const std::string & users, bool quiet,
 void notify_set_online_list (server & serv, const std::string& users,
 						 const message_tags_data *tags_data)
 {
-	std::istringstream stream(users);
-	for (std::string token; std::getline(stream, token, ',');)
+	for (const auto & nick : notify_split_targets (users))
 	{
-		auto pos = token.find_first_of('!');
-		if (pos == std::string::npos || pos + 1 >= NICKLEN)
-			continue;
-
-		auto nick = token.substr(0, pos);
 		auto servnot = notify_find (serv, nick);
 		if (servnot)
 			notify_announce_online (serv, *servnot, nick, tags_data);
 	}
 }
 
-static void notify_watch (server * serv, const std::string& nick, bool add)
-{
-	if (!serv->supports_monitor && !serv->supports_watch)
-		return;
-
-	char addchar = add ? '+' : '-';
+/* "MONITOR + a,b,c" or "WATCH +a +b +c", in as few lines as fit */
 
-	std::ostringstream buf;
-	if (serv->supports_monitor)
-		buf << boost::format("MONITOR %c %s") % addchar % nick;
-	else if (serv->supports_watch)
-		buf << boost::format("WATCH %c%s") % addchar % nick;
-
-	serv->p_raw (buf.str());
-}
-
-static void
-notify_watch_all (struct notify *notify, bool add)
+static void notify_send_watch_lines (server & serv, const std::vector<std::string> & nicks, char sign)
 {
-	GSList *list = serv_list;
-	while (list)
+	std::string line;
+	for (const auto & nick : nicks)
 	{
-		auto serv = static_cast<server*>(list->data);
-		if (serv->connected && serv->end_of_motd && notify_do_network (notify, *serv))
-			notify_watch (serv, notify->name, add);
-		list = list->next;
-	}
-}
+		if (!line.empty() && line.size() + nick.size() + 2 > NOTIFY_LINE_MAX)
+		{
+			serv.p_raw (line);
+			line.clear();
+		}
 
-static void
-notify_flush_watches(server & serv, std::vector<struct notify*>::const_iterator from, std::vector<struct notify*>::const_iterator end)
-{
-	std::ostringstream buffer;
-	buffer << (serv.supports_monitor ? "MONITOR + " : "WATCH");
-	auto it = from;
-	buffer << (*it)->name;
-	++it;
-	for (;it != end; ++it)
-	{
-		struct notify *notify = *it;
 		if (serv.supports_monitor)
-			buffer << ",";
+		{
+			if (line.empty())
+				line = std::string("MONITOR ") + sign + ' ';
+			else
+				line += ',';
+		}
 		else
-			buffer << " +";
-		buffer << notify->name;
+		{
+			if (line.empty())
+				line = "WATCH";
+			line += ' ';
+			line += sign;
+		}
+		line += nick;
 	}
-	serv.p_raw (buffer.str());
+
+	if (!line.empty())
+		serv.p_raw (line);
 }
 
-/* called when logging in. e.g. when End of motd. */
+/* brings the server's MONITOR/WATCH list in line with ours, sending only
+   the difference and never more nicks than the server said it takes */
 
-void
-notify_send_watches (server & serv)
+static void notify_sync_watches (server & serv)
 {
-	const int format_len = serv.supports_monitor ? 1 : 2; /* just , for monitor or + and space for watch */
-	std::vector<notify*> send_list;
-	int len = 0;
+	if (!serv.supports_monitor && !serv.supports_watch)
+		return;
 
-	/* Only get the list for this network */
-	auto list = notify_list;
-	while (list)
-	{
-		auto notify = static_cast<struct notify*>(list->data);
+	auto & index = notify_index (serv);
+	std::vector<std::string> add;
+	std::vector<std::string> del;
+	del.swap (index.unwatch);
 
-		if (notify_do_network (notify, serv))
+	std::size_t watching = 0;
+	for (auto servnot : index.entries)
+	{
+		const bool want = serv.watch_limit <= 0 || watching < static_cast<std::size_t>(serv.watch_limit);
+		if (want)
+			watching++;
+		if (want != servnot->watched)
 		{
-			send_list.push_back(notify);
+			(want ? add : del).push_back (servnot->notify->name);
+			servnot->watched = want;
 		}
-
-		list = list->next;
 	}
 
-	/* Now send that list in batches */
-	auto point = send_list.cbegin();
-	for (auto it = send_list.cbegin(); it != send_list.cend(); ++it)
-	{
-		auto notify = *it;
+	/* removals first, they make room for the additions */
+	notify_send_watch_lines (serv, del, '-');
+	notify_send_watch_lines (serv, add, '+');
+}
 
-		len += notify->name.size() + format_len;
-		if (len > 500)
-		{
-			/* Too long send existing list */
-			notify_flush_watches (serv, send_list.begin(), it);
-			len = notify->name.size() + format_len;
-			point = it; /* We left off here */
-		}
-	}
+/* called when logging in. e.g. when End of motd. */
 
-	if (len) /* We had leftovers under 500, send them all */
+void
+notify_send_watches (server & serv)
+{
+	/* the network name and casemapping are known by now, and a new
+	   connection starts with an empty list on the server's side */
+	server_notifies.erase (&serv);
+	for (GSList *list = notify_list; list; list = list->next)
 	{
-		notify_flush_watches (serv, point, send_list.cend());
+		auto servnot = notify_find_server_entry (static_cast<struct notify *>(list->data), serv);
+		if (servnot)
+			servnot->watched = false;
 	}
+
+	notify_sync_watches (serv);
 }
 
-/* called when receiving a ISON 303 - should this func go? */
+/* called when receiving a ISON 303. Each reply answers one of the ISON
+   lines we sent, in order, so only the nicks that line asked about can
+   be marked offline. */
 
-void notify_markonline(server &serv, const char * const word[], const message_tags_data *tags_data)
+void notify_markonline(server &serv, const char *nicks, const message_tags_data *tags_data)
 {
-	GSList *list = notify_list;
-	int i;
+	auto & index = notify_index (serv);
+	std::vector<std::string> asked;
+	if (!index.ison_sent.empty())
+	{
+		asked = std::move (index.ison_sent.front());
+		index.ison_sent.pop_front();
+	}
 
-	while (list)
+	std::unordered_set<std::string> seen;
+	std::istringstream stream(nicks);
+	for (std::string nick; stream >> nick;)
 	{
-		auto notify = static_cast<struct notify *>(list->data);
-		auto servnot = notify_find_server_entry (notify, serv);
-		if (!servnot)
-		{
-			list = list->next;
+		auto folded = serv.casefold (nick);
+		auto found = index.by_nick.find (folded);
+		if (found != index.by_nick.end())
+			notify_announce_online (serv, *found->second, found->second->notify->name, tags_data);
+		seen.insert (std::move (folded));
+	}
+
+	for (const auto & folded : asked)
+	{
+		if (seen.count (folded))
 			continue;
-		}
-		i = 4;
-		bool seen = false;
-		while (*word[i])
-		{
-			if (!serv.p_cmp (notify->name.c_str(), word[i]))
-			{
-				seen = true;
-				notify_announce_online (serv, *servnot, notify->name, tags_data);
-				break;
-			}
-			i++;
-			/* FIXME: word[] is only a 32 element array, limits notify list to
-			   about 27 people */
-			if (i > PDIWORDS - 5)
-			{
-				/*fprintf (stderr, _("*** HEXCHAT WARNING: notify list too large.\n"));*/
-				break;
-			}
-		}
-		if (!seen && servnot->ison)
-		{
-			notify_announce_offline (serv, servnot, notify->name, FALSE, tags_data);
-		}
-		list = list->next;
+		auto found = index.by_nick.find (folded);
+		if (found != index.by_nick.end() && found->second->ison)
+			notify_announce_offline (serv, found->second, found->second->notify->name, false, tags_data);
 	}
 	fe_notify_update (nullptr);
 }
 
-/* yuck! Old routine for ISON notify */
+/* asks about everyone the server isn't watching for us, in as many ISON
+   lines as that takes */
 
 static void notify_checklist_for_server (server &serv)
 {
-	GSList *list = notify_list;
-	int i = 0;
-	std::ostringstream outbuf;
-	outbuf << "ISON ";
-	while (list)
+	auto & index = notify_index (serv);
+	/* anything still unanswered belongs to the last round */
+	index.ison_sent.clear();
+
+	std::string line;
+	std::vector<std::string> asked;
+	auto send_line = [&serv, &index, &line, &asked]
 	{
-		auto notify = static_cast<struct notify*>(list->data);
-		if (notify_do_network (notify, serv))
-		{
-			i++;
-			outbuf << notify->name;
-			outbuf << ' ';
-			if (outbuf.tellp() > 460)
-			{
-				/* LAME: we can't send more than 512 bytes to the server, but     *
-				 * if we split it in two packets, our offline detection wouldn't  *
-				 work                                                           */
-				/*fprintf (stderr, _("*** HEXCHAT WARNING: notify list too large.\n"));*/
-				break;
-			}
-		}
-		list = list->next;
+		serv.p_raw (line);
+		index.ison_sent.push_back (std::move (asked));
+		asked.clear();
+		line.clear();
+	};
+
+	for (auto servnot : index.entries)
+	{
+		if (servnot->watched)
+			continue;
+
+		const auto & name = servnot->notify->name;
+		if (!line.empty() && line.size() + name.size() + 1 > NOTIFY_LINE_MAX)
+			send_line();
+		if (line.empty())
+			line = "ISON";
+		line += ' ';
+		line += name;
+		asked.push_back (serv.casefold (name));
 	}
 
-	if (i)
-		serv.p_raw (outbuf.str());
+	if (!line.empty())
+		send_line();
 }
 
 int notify_checklist (void)	/* check ISON list */
@@ -476,7 +489,7 @@ int notify_checklist (void)	/* check ISON list */
 	while (list)
 	{
 		auto serv = static_cast<server*>(list->data);
-		if (serv->connected && serv->end_of_motd && !serv->supports_watch && !serv->supports_monitor)
+		if (serv->connected && serv->end_of_motd)
 		{
 			notify_checklist_for_server (*serv);
 		}
@@ -485,6 +498,26 @@ int notify_checklist (void)	/* check ISON list */
 	return 1;
 }
 
+static gboolean notify_sync_cb (gpointer)
+{
+	notify_sync_tag = 0;
+
+	for (GSList *list = serv_list; list; list = list->next)
+	{
+		auto serv = static_cast<server*>(list->data);
+		if (serv->connected && serv->end_of_motd)
+			notify_sync_watches (*serv);
+	}
+	notify_checklist ();
+	return FALSE;
+}
+
+static void notify_schedule_sync (void)
+{
+	if (!notify_sync_tag)
+		notify_sync_tag = fe_timeout_add (NOTIFY_SYNC_DELAY, (GSourceFunc)notify_sync_cb, nullptr);
+}
+
 void notify_showlist (struct session *sess, const message_tags_data *tags_data)
 {
 	char outbuf[256];
@@ -533,9 +566,31 @@ bool notify_deluser(const std::string& name)
 					static_cast<notify_per_server*>(note->server_list->data));
 				note->server_list =
 					g_slist_remove (note->server_list, servnot.get());
+
+				auto found = server_notifies.find (servnot->server);
+				if (found == server_notifies.end())
+					continue;
+				auto & index = found->second;
+				index.entries.erase (std::remove (index.entries.begin(), index.entries.end(), servnot.get()), index.entries.end());
+				auto by_nick = index.by_nick.find (servnot->server->casefold (note->name));
+				if (by_nick != index.by_nick.end() && by_nick->second == servnot.get())
+				{
+					/* another entry for the same nick takes its place */
+					index.by_nick.erase (by_nick);
+					for (auto other : index.entries)
+					{
+						if (!servnot->server->p_cmp (other->notify->name.c_str(), note->name.c_str()))
+						{
+							index.by_nick.emplace (servnot->server->casefold (note->name), other);
+							break;
+						}
+					}
+				}
+				if (servnot->watched)
+					index.unwatch.push_back (note->name);
 			}
 			notify_list = g_slist_remove (notify_list, note.get());
-			notify_watch_all (note.get(), false);
+			notify_schedule_sync ();
 			fe_notify_update (nullptr);
 			return true;
 		}
@@ -562,10 +617,16 @@ void notify_adduser (const char *name, const char *networks)
 	notify->server_list = 0;
 	notify_list = g_slist_prepend(notify_list, notify.get());
 	struct notify* note = notify.release();
-	notify_checklist();
-	fe_notify_update(&notify->name);
+
+	for (auto & index : server_notifies)
+	{
+		/* only connected servers have an index, see notify_cleanup() */
+		notify_index_add (*index.first, index.second, note, true);
+	}
+
+	notify_schedule_sync();
+	fe_notify_update(&note->name);
 	fe_notify_update(nullptr);
-	notify_watch_all(note, true);
 }
 
 bool
@@ -587,21 +648,8 @@ notify_is_in_list (const server &serv, const std::string & name)
 bool
 notify_isnotify (struct session *sess, const char *name)
 {
-	GSList *list = notify_list;
-
-	while (list)
-	{
-		auto notify = static_cast<struct notify *>(list->data);
-		if (!sess->server->p_cmp (notify->name.c_str(), name))
-		{
-			auto servnot = notify_find_server_entry (notify, *sess->server);
-			if (servnot && servnot->ison)
-				return true;
-		}
-		list = list->next;
-	}
-
-	return false;
+	auto servnot = notify_find (*sess->server, name);
+	return servnot && servnot->ison;
 }
 
 void
@@ -645,5 +693,15 @@ notify_cleanup ()
 		}
 		list = list->next;
 	}
+
+	/* the indexes of those servers point at what was just freed */
+	for (auto it = server_notifies.begin(); it != server_notifies.end();)
+	{
+		auto found = g_slist_find (serv_list, it->first);
+		if (found && it->first->connected)
+			++it;
+		else
+			it = server_notifies.erase (it);
+	}
 	fe_notify_update (nullptr);
 }
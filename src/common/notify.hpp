@@ -25,6 +25,7 @@
 #include "proto-irc.hpp"
 #include "serverfwd.hpp"
 #include "sessfwd.hpp"
+#include "timers.hpp"
 
 struct notify
 {
@@ -41,10 +42,11 @@ struct notify_per_server
 	time_t lastseen;
 	time_t lastoff;
 	bool ison;
+	bool watched;	/* on the server's MONITOR or WATCH list */
 };
 
 extern GSList *notify_list;
-extern int notify_tag;
+extern timers::handle notify_tag;
 
 /* the WATCH stuff */
 void notify_set_online(server & serv, const std::string &nick,
@@ -69,8 +71,8 @@ bool notify_is_in_list (const server &serv, const std::string & name);
 bool notify_isnotify (session *sess, const char *name);
 struct notify_per_server *notify_find_server_entry (struct notify *notify, server &serv);
 
-/* the old ISON stuff - remove me? */
-void notify_markonline (server &serv, const char * const word[], 
+/* the ISON stuff, for whoever MONITOR/WATCH doesn't cover */
+void notify_markonline (server &serv, const char *nicks,
 								const message_tags_data *tags_data);
 int notify_checklist (void);
 
@@ -400,11 +400,11 @@ create_mask(session * sess, std::string mask, const boost::string_ref &mode, con
 	std::ostringstream buf;
 
 	auto user = userlist_find (sess, mask);
-	if (user && user->hostname)  /* it's a nickname, let's find a proper ban mask */
+	if (user && user->info->hostname)  /* it's a nickname, let's find a proper ban mask */
 	{
-		const std::string & p2 = deop ? user->nick : std::string{};
+		const std::string & p2 = deop ? user->info->nick : std::string{};
 
-		mask = user->hostname.get();
+		mask = *user->info->hostname;
 
 		auto at = mask.find_first_of('@'); /* FIXME: utf8 */	
 		if (at == std::string::npos)
@@ -552,7 +552,6 @@ cmd_chanopt (struct session *sess, char *tbuf, char *word[], char *word_eol[])
 	
 	/* chanopt.c */
 	ret = chanopt_command (sess, tbuf, word, word_eol);
-	chanopt_save_all ();
 	
 	return ret;
 }
@@ -942,7 +941,7 @@ cmd_mdehop (struct session *sess, char *, char *[], char *[])
 	{
 		if (user->hop && !user->me)
 		{
-			nicks.emplace_back(user->nick);
+			nicks.emplace_back(user->info->nick);
 		}
 	}
 	send_channel_modes (sess, nicks, 0, nicks.size(), '-', 'h', 0);
@@ -958,7 +957,7 @@ cmd_mdeop (struct session *sess, char *, char *[], char *[])
 	{
 		if (user->op && !user->me)
 		{
-				nicks.emplace_back(user->nick);
+				nicks.emplace_back(user->info->nick);
 		}
 	}
 	send_channel_modes (sess, nicks, 0, nicks.size(), '-', 'o', 0);
@@ -1225,14 +1224,14 @@ cmd_mkick (struct session *sess, char *, char *[], char *word_eol[])
 	{
 		if (user->op && !user->me)
 		{
-			sess->server->p_kick(sess->channel, user->nick, reason);
+			sess->server->p_kick(sess->channel, user->info->nick, reason);
 		}
 	}
 	for (auto & user : sess->usertree)
 	{
 		if (!user->op && !user->me)
 		{
-			sess->server->p_kick(sess->channel, user->nick, reason);
+			sess->server->p_kick(sess->channel, user->info->nick, reason);
 		}
 	}
 	return true;
@@ -1271,9 +1270,9 @@ cmd_dns (struct session *sess, char *, char *word[], char *[])
 		auto user = userlist_find (sess, nick);
 		if (user)
 		{
-			if (user->hostname)
+			if (user->info->hostname)
 			{
-				do_dns (sess, user->nick.c_str(), user->hostname->c_str(), &no_tags);
+				do_dns (sess, user->info->nick.c_str(), user->info->hostname->c_str(), &no_tags);
 			} else
 			{
 				sess->server->p_get_ip (nick);
@@ -1924,6 +1923,7 @@ cmd_gui (struct session *sess, char *, char *word[], char *[])
 	case 0xb06a1793: fe_ctrl_gui(sess, FE_GUI_ATTACH, 1); break; /* DETACH */
 	case 0x05cfeff0: fe_ctrl_gui(sess, FE_GUI_FLASH, 0); break; /* FLASH */
 	case 0x05d154d8: fe_ctrl_gui(sess, FE_GUI_FOCUS, 0); break; /* FOCUS */
+	case 0xb48284a6: fe_ctrl_gui(sess, FE_GUI_FRAMES, 0); break; /* FRAMES */
 	case 0x0030dd42: fe_ctrl_gui(sess, FE_GUI_HIDE, 0); break; /* HIDE */
 	case 0x61addbe3: fe_ctrl_gui(sess, FE_GUI_ICONIFY, 0); break; /* ICONIFY */
 	case 0xc0851aaa: fe_message (word[3], FE_MSG_INFO|FE_MSG_MARKUP); break; /* MSGBOX */
@@ -2398,8 +2398,8 @@ split_up_text(struct session *sess, char *text, int cmd_length, char *split_text
 	max -= cmd_length;
 	max -= std::strlen (sess->server->nick);
 	max -= std::strlen (sess->channel);
-	if (sess->me && sess->me->hostname)
-		max -= sess->me->hostname->size();
+	if (sess->me && sess->me->info->hostname)
+		max -= sess->me->info->hostname->size();
 	else
 	{
 		max -= 9;	/* username */
@@ -2523,7 +2523,7 @@ cmd_mop (struct session *sess, char *, char *[], char *[])
 	{
 		if (!user->op)
 		{
-			nicks.emplace_back(user->nick);
+			nicks.emplace_back(user->info->nick);
 		}
 	}
 
@@ -3514,7 +3514,7 @@ cmd_userlist (struct session *sess, char *, char *[],
 			lt = time(0) - user->lasttalk;
 		PrintTextf(sess,
 			boost::format("\00306%s\t\00314[\00310%-38s\00314] \017ov\0033=\017%d%d away=%u lt\0033=\017%ld\n") %
-			user->nick % (user->hostname ? user->hostname->c_str() : "") % user->op % user->voice % user->away % (long)lt);
+			user->info->nick % (user->info->hostname ? user->info->hostname->c_str() : "") % int (user->op) % int (user->voice) % user->info->away % (long)lt);
 	}
 	return true;
 }
@@ -3535,7 +3535,7 @@ cmd_wallchop (struct session *sess, char *, char *[],
 		{
 			if (i)
 				outbuf << ',';
-			outbuf << user->nick;
+			outbuf << user->info->nick;
 			i++;
 		}
 		if (i == 5)
@@ -3692,7 +3692,7 @@ const struct commands xc_cmds[] = {
 	{"GETINT", cmd_getint, 0, 0, 1, "GETINT <default> <command> <prompt>"},
 	{"GETSTR", cmd_getstr, 0, 0, 1, "GETSTR <default> <command> <prompt>"},
 	{"GHOST", cmd_ghost, 1, 0, 1, N_("GHOST <nick> [password], Kills a ghosted nickname")},
-	{"GUI", cmd_gui, 0, 0, 1, "GUI [APPLY|ATTACH|DETACH|SHOW|HIDE|FOCUS|FLASH|ICONIFY|COLOR <n>]\n"
+	{"GUI", cmd_gui, 0, 0, 1, "GUI [APPLY|ATTACH|DETACH|SHOW|HIDE|FOCUS|FLASH|ICONIFY|FRAMES|COLOR <n>]\n"
 									  "       GUI [MSGBOX <text>|MENU TOGGLE]"},
 	{"HELP", cmd_help, 0, 0, 1, 0},
 	{"HOP", cmd_hop, 1, 1, 1,
@@ -4164,12 +4164,12 @@ perform_nick_completion (struct session *sess, char *cmd, char *tbuf)
 				{
 					int lenu;
 
-					if (!rfc_ncasecmp(user->nick.c_str(), nick, len))
+					if (!rfc_ncasecmp(user->info->nick.c_str(), nick, len))
 					{
-						lenu = user->nick.size();
+						lenu = user->info->nick.size();
 						if (lenu == len)
 						{
-							snprintf(tbuf, TBUFSIZE, "%s%s", user->nick.c_str(), space - 1);
+							snprintf(tbuf, TBUFSIZE, "%s%s", user->info->nick.c_str(), space - 1);
 							len = -1;
 							break;
 						}
@@ -4186,7 +4186,7 @@ perform_nick_completion (struct session *sess, char *cmd, char *tbuf)
 
 				if (best)
 				{
-					snprintf (tbuf, TBUFSIZE, "%s%s", best->nick.c_str(), space - 1);
+					snprintf (tbuf, TBUFSIZE, "%s%s", best->info->nick.c_str(), space - 1);
 					return;
 				}
 			}
@@ -0,0 +1,261 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#endif
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include "hexchat.hpp"
+#include "cfgfiles.hpp"
+#include "fe.hpp"
+#include "filesystem.hpp"
+#include "plugin-prefs.hpp"
+#include "util.hpp"
+
+namespace pluginpref
+{
+	namespace
+	{
+		std::string lowercase(const std::string & text)
+		{
+			std::string low(text);
+			for (auto & c : low)
+				c = g_ascii_tolower(c);
+			return low;
+		}
+	}
+
+	void file::parse(const boost::string_ref & text)
+	{
+		lines_.clear();
+		index_.clear();
+		auto pos = text.begin();
+		while (pos != text.end())
+		{
+			auto end = std::find(pos, text.end(), '\n');
+			add_line(std::string(pos, end));
+			pos = end == text.end() ? end : end + 1;
+		}
+	}
+
+	std::string file::serialize() const
+	{
+		std::string out;
+		for (const auto & ln : lines_)
+		{
+			out += ln.text;
+			out.push_back('\n');
+		}
+		return out;
+	}
+
+	void file::add_line(std::string text)
+	{
+		line ln;
+		ln.value_start = 0;
+		const auto eq = text.find('=');
+		if (eq != std::string::npos)
+		{
+			auto name_end = eq;
+			while (name_end > 0 && (text[name_end - 1] == ' ' || text[name_end - 1] == '\t'))
+				name_end--;
+			ln.name = text.substr(0, name_end);
+			ln.value_start = text.find_first_not_of(' ', eq + 1);
+			if (ln.value_start == std::string::npos)
+				ln.value_start = text.size();
+		}
+		ln.text = std::move(text);
+
+		if (!ln.name.empty())
+			index_[lowercase(ln.name)].push_back(lines_.size());
+		lines_.emplace_back(std::move(ln));
+	}
+
+	void file::reindex()
+	{
+		index_.clear();
+		for (std::size_t i = 0; i < lines_.size(); ++i)
+		{
+			if (!lines_[i].name.empty())
+				index_[lowercase(lines_[i].name)].push_back(i);
+		}
+	}
+
+	bool file::get(const std::string & var, std::string & value) const
+	{
+		auto found = index_.find(lowercase(var));
+		if (found == index_.end())
+			return false;
+
+		const auto & ln = lines_[found->second.front()];
+		glib_string unescaped(g_strcompress(ln.text.c_str() + ln.value_start));
+		value = unescaped.get();
+		return true;
+	}
+
+	void file::set(const std::string & var, const std::string & value)
+	{
+		glib_string escaped(g_strescape(value.c_str(), nullptr));
+		auto text = var + " = " + escaped.get();
+
+		bool replaced = false;
+		auto found = index_.find(lowercase(var));
+		if (found != index_.end())
+		{
+			for (auto i : found->second)
+			{
+				auto & ln = lines_[i];
+				if (ln.name != var)
+					continue;
+				/* like reading it back would, leading spaces aren't part of the value */
+				ln.text = text;
+				ln.value_start = std::min(text.find_first_not_of(' ', var.size() + 3), text.size());
+				replaced = true;
+			}
+		}
+
+		if (!replaced)
+			add_line(std::move(text));
+	}
+
+	bool file::remove(const std::string & var)
+	{
+		const auto old_size = lines_.size();
+		lines_.erase(std::remove_if(lines_.begin(), lines_.end(), [&var](const line & ln){
+			return ln.name == var;
+		}), lines_.end());
+		if (lines_.size() == old_size)
+			return false;
+
+		reindex();
+		return true;
+	}
+
+	std::vector<std::string> file::names() const
+	{
+		std::vector<std::string> out;
+		for (const auto & ln : lines_)
+		{
+			if (!ln.name.empty())
+				out.push_back(ln.name);
+		}
+		return out;
+	}
+
+	namespace
+	{
+		/* changes are written out this long after the first one, so a
+		 * plugin saving a burst of settings only rewrites its file once */
+		enum { FLUSH_DELAY = 1000 };
+
+		struct pref_file
+		{
+			pref_file()
+				:exists(false), dirty(false)
+			{}
+
+			file prefs;
+			bool exists;	/* on disk, or will be once written */
+			bool dirty;
+		};
+
+		std::unordered_map<std::string, pref_file> files;	/* by file name */
+		int flush_tag;
+
+		std::string conf_name(const std::string & plugin)
+		{
+			std::string canon(plugin);
+			if (!canon.empty())
+				canonalize_key(&canon[0]);
+			return "addon_" + canon + ".conf";
+		}
+
+		bool save(const std::string & name, const file & prefs)
+		{
+			config::writer out;
+			out.put_raw(prefs.serialize());
+			return out.commit(io::fs::make_config_path(name).string());
+		}
+
+		gboolean flush_cb(gpointer)
+		{
+			flush_tag = 0;
+			flush();
+			return FALSE;
+		}
+	}
+
+	file *lookup(const std::string & plugin, bool create)
+	{
+		const auto name = conf_name(plugin);
+		auto found = files.find(name);
+		if (found == files.end())
+		{
+			found = files.emplace(name, pref_file()).first;
+
+			char *cfg;
+			gsize len;
+			if (g_file_get_contents(io::fs::make_config_path(name).string().c_str(), &cfg, &len, nullptr))
+			{
+				glib_string cfg_ptr(cfg);
+				found->second.prefs.parse(boost::string_ref(cfg, len));
+				found->second.exists = true;
+			}
+		}
+
+		auto & entry = found->second;
+		if (create)
+			entry.exists = true;
+		return entry.exists ? &entry.prefs : nullptr;
+	}
+
+	void changed(const std::string & plugin)
+	{
+		auto found = files.find(conf_name(plugin));
+		if (found == files.end())
+			return;
+
+		found->second.dirty = true;
+		if (!flush_tag)
+			flush_tag = fe_timeout_add(FLUSH_DELAY, (GSourceFunc)flush_cb, nullptr);
+	}
+
+	void flush()
+	{
+		if (flush_tag)
+		{
+			fe_timeout_remove(flush_tag);
+			flush_tag = 0;
+		}
+
+		for (auto & entry : files)
+		{
+			/* a file that couldn't be written stays dirty for next time */
+			if (entry.second.dirty && save(entry.first, entry.second.prefs))
+				entry.second.dirty = false;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_PLUGIN_PREFS_HPP
+#define HEXCHAT_PLUGIN_PREFS_HPP
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/utility/string_ref_fwd.hpp>
+
+/* Plugin preferences, as read and written by hexchat_pluginpref_*. Each
+ * addon_<name>.conf is parsed the first time it's used and kept in memory;
+ * changes are written back a moment later, all at once, and before the
+ * plugin is unloaded. */
+namespace pluginpref
+{
+	/* one addon_<name>.conf: "name = value" lines with the value
+	 * g_strescape'd. Lines are kept in file order and anything else in the
+	 * file is written back as it was. */
+	class file
+	{
+	public:
+		void parse(const boost::string_ref & text);
+		std::string serialize() const;
+
+		/* the first setting called var, ignoring case */
+		bool get(const std::string & var, std::string & value) const;
+		/* replaces every setting called exactly var, or adds one */
+		void set(const std::string & var, const std::string & value);
+		/* drops every setting called exactly var, false if there were none */
+		bool remove(const std::string & var);
+		/* every setting's name, in file order */
+		std::vector<std::string> names() const;
+
+	private:
+		struct line
+		{
+			std::string text;
+			std::string name;	/* empty if this isn't a setting */
+			std::size_t value_start;
+		};
+
+		void add_line(std::string text);
+		void reindex();
+
+		std::vector<line> lines_;
+		std::unordered_map<std::string, std::vector<std::size_t>> index_;	/* lowercased name -> lines */
+	};
+
+	/* the prefs of the plugin called 'plugin'. Returns nullptr if it has
+	 * none and create is false. */
+	file *lookup(const std::string & plugin, bool create);
+	/* the plugin's prefs were changed, write them out soon */
+	void changed(const std::string & plugin);
+	/* write out everything that has changed, now */
+	void flush();
+}
+
+#endif
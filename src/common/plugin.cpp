@@ -36,7 +36,6 @@
 #include <sys/stat.h>
 
 #include <boost/filesystem.hpp>
-#include <boost/filesystem/fstream.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/utility/string_ref.hpp>
@@ -65,6 +64,8 @@
 
 #define PLUGIN_C
 #include "plugin.hpp"
+#include "plugin-prefs.hpp"
+#include "startup.hpp"
 #include "typedef.h"
 
 #include "hexchatc.hpp"
@@ -183,6 +184,9 @@ plugin_free(hexchat_plugin_internal *pl, bool do_deinit, bool allow_refuse)
 
 xit:
 
+	/* anything it saved on the way out is on disk before it's gone */
+	pluginpref::flush();
+
 	plugin_list = g_slist_remove (plugin_list, pl);
 
 	delete pl;
@@ -439,6 +443,7 @@ plugin_auto_load_cb (const char *filename)
 {
 	const char *pMsg;
 
+	startup::span trace (std::string ("plugin_load ") + filename);
 	pMsg = plugin_load (ps, filename, nullptr);
 	if (pMsg)
 	{
@@ -1348,8 +1353,8 @@ hexchat_list_fields (hexchat_plugin *, const char *name)
 {
 	static const char * const dcc_fields[] =
 	{
-		"iaddress32","icps",		"sdestfile","sfile",		"snick",	"iport",
-		"ipos", "iposhigh", "iresume", "iresumehigh", "isize", "isizehigh", "istatus", "itype", nullptr
+		"iaddress32","icps",		"sdestfile","sfile",		"iid",	"snick",	"iport",
+		"ipos", "iposhigh", "iresume", "iresumehigh", "ssha256", "isize", "isizehigh", "istatus", "itype", nullptr
 	};
 	static const char * const channels_fields[] =
 	{
@@ -1474,6 +1479,11 @@ hexchat_list_str (hexchat_plugin *ph, hexchat_list *xlist, const char *name)
 			return ((dcc::DCC *)data)->file;
 		case 0x339763: /* nick */
 			return ((dcc::DCC *)data)->nick;
+		case 0xca23b627: /* sha256 */
+		{
+			const auto & sum = ((dcc::DCC *)data)->sha256;
+			return sum.empty() ? nullptr : sum.c_str();
+		}
 		}
 		break;
 
@@ -1499,15 +1509,15 @@ hexchat_list_str (hexchat_plugin *ph, hexchat_list *xlist, const char *name)
 		switch (hash)
 		{
 		case 0xb9d38a2d: /* account */
-			return ((struct User *)data)->account ? ((struct User *)data)->account->c_str() : nullptr;
+			return ((struct User *)data)->info->account ? ((struct User *)data)->info->account->c_str() : nullptr;
 		case 0x339763: /* nick */
-			return ((struct User *)data)->nick.c_str();
+			return ((struct User *)data)->info->nick.c_str();
 		case 0x30f5a8: /* host */
-			return ((struct User *)data)->hostname ? ((struct User *)data)->hostname->c_str() : nullptr;
+			return ((struct User *)data)->info->hostname ? ((struct User *)data)->info->hostname->c_str() : nullptr;
 		case 0xc594b292: /* prefix */
 			return ((struct User *)data)->prefix;
 		case 0xccc6d529: /* realname */
-			return ((struct User *)data)->realname ? ((struct User *)data)->realname->c_str() : nullptr;
+			return ((struct User *)data)->info->realname ? ((struct User *)data)->info->realname->c_str() : nullptr;
 		}
 		break;
 	}
@@ -1539,6 +1549,8 @@ hexchat_list_int (hexchat_plugin *ph, hexchat_list *xlist, const char *name)
 			return ((dcc::DCC *)data)->addr;
 		case 0x181a6: /* cps */
 			return ((dcc::DCC *)data)->cps;
+		case 0xd1b: /* id */
+			return ((dcc::DCC *)data)->id;
 		case 0x349881: /* port */
 			return ((dcc::DCC *)data)->port;
 		case 0x1b254: /* pos */
@@ -1634,7 +1646,7 @@ hexchat_list_int (hexchat_plugin *ph, hexchat_list *xlist, const char *name)
 		switch (hash)
 		{
 		case 0x2de2ee:	/* away */
-			return ((struct User *)data)->away;
+			return ((struct User *)data)->info->away;
 		case 0x4705f29b: /* selected */
 			return ((struct User *)data)->selected;
 		}
@@ -1757,99 +1769,21 @@ namespace {
 	};
 }
 static int
-hexchat_pluginpref_set_str_real(hexchat_plugin *pl, const char *var, const char *value, set_mode mode) /* mode: 0 = delete, 1 = save */
+hexchat_pluginpref_set_str_real(hexchat_plugin *pl, const char *var, const char *value, set_mode mode)
 {
-	namespace bfs = boost::filesystem;
-	glib_string canon(g_strdup(static_cast<hexchat_plugin_internal*>(pl)->name.c_str()));
-	canonalize_key (canon.get());
-	glib_string confname(g_strdup_printf ("addon_%s.conf", canon.get()));
-	glib_string confname_tmp(g_strdup_printf ("%s.new", confname.get()));
-	auto fhOut = hexchat_open_file (confname_tmp.get(), O_TRUNC | O_WRONLY | O_CREAT, 0600, XOF_DOMODE);
-	
-	if (fhOut == -1)		/* unable to save, abort */
-	{
-		return false;
-	}
-	auto fpIn = hexchat_fopen_file(confname.get(), "r", 0);
-	auto config_dir = bfs::path(config::config_dir());
-	auto confpath = config_dir / confname.get();
-	auto confoldpath = config_dir / confname_tmp.get();
-	if (fpIn == nullptr)	/* no previous config file, no parsing */
-	{
-		if (mode == set_mode::save)
-		{
-			glib_string escaped_value(g_strescape (value, nullptr));
-			glib_string buffer(g_strdup_printf ("%s = %s\n", var, escaped_value.get()));
-			write (fhOut, buffer.get(), strlen (buffer.get()));
-			close (fhOut);
-
-#ifdef WIN32
-			g_unlink (confpath.string().c_str());
-#endif
-			boost::system::error_code ec;
-			bfs::rename(confoldpath, confpath, ec);
-			return !ec ? true : false;
-		}
-		else
-		{
-			/* mode = 0, we want to delete but the config file and thus the given setting does not exist, we're ready */
-			close (fhOut);
-			return true;
-		}
-	}
-	else	/* existing config file, preserve settings and find & replace current var value if any */
-	{
-		bool prevSetting = false;
-		char line_buffer[512] = { 0 };		/* the same as in cfg_put_str */
-		char *line_bufp = line_buffer;
-		auto var_len = std::strlen(var);
-
-		while (fscanf (fpIn, " %[^\n]", line_bufp) != EOF)	/* read whole lines including whitespaces */
-		{
-			glib_string buffer_tmp(g_strdup_printf ("%s ", var));	/* add one space, this way it works against var - var2 checks too */
-			glib_string buffer;
-			if (strncmp (buffer_tmp.get(), line_buffer, var_len + 1) == 0)	/* given setting already exists */
-			{
-				if (mode == set_mode::save)									/* overwrite the existing matching setting if we are in save mode */
-				{
-					glib_string escaped_value(g_strescape (value, nullptr));
-					buffer.reset(g_strdup_printf ("%s = %s\n", var, escaped_value.get()));
-				}
-				else										/* erase the setting in delete mode */
-				{
-					buffer.reset(g_strdup (""));
-				}
-
-				prevSetting = true;
-			}
-			else
-			{
-				buffer.reset(g_strdup_printf ("%s\n", line_buffer));	/* preserve the existing different settings */
-			}
-
-			write (fhOut, buffer.get(), strlen (buffer.get()));
-		}
-
-		fclose (fpIn);
+	const auto & name = static_cast<hexchat_plugin_internal*>(pl)->name;
+	auto prefs = pluginpref::lookup(name, mode == set_mode::save);
+	if (!prefs)	/* deleting from a config file that doesn't exist, we're ready */
+		return true;
 
-		if (!prevSetting && mode == set_mode::save)	/* var doesn't exist currently, append if we're in save mode */
-		{
-			glib_string escaped_value(g_strescape (value, nullptr));
-			glib_string buffer(g_strdup_printf ("%s = %s\n", var, escaped_value.get()));
-			write (fhOut, buffer.get(), strlen (buffer.get()));
-		}
+	if (mode == set_mode::save)
+		prefs->set(var, value);
+	else if (!prefs->remove(var))
+		return true;
 
-		close (fhOut);
-
-#ifdef WIN32
-		g_unlink (confpath.string().c_str());
-#endif
-
-		boost::system::error_code ec;
-		bfs::rename(confoldpath, confpath, ec);
-
-		return !ec ? true : false;
-	}
+	/* written out a moment later, together with whatever comes next */
+	pluginpref::changed(name);
+	return true;
 }
 
 int
@@ -1861,26 +1795,12 @@ hexchat_pluginpref_set_str (hexchat_plugin *pl, const char *var, const char *val
 static int
 hexchat_pluginpref_get_str_real (hexchat_plugin_internal *pl, const char *var, char *dest, int dest_len)
 {
-	glib_string canon(g_strdup (pl->name.c_str()));
-	canonalize_key (canon.get());
-	glib_string confname( g_strdup_printf ("%s%caddon_%s.conf", get_xdir(), G_DIR_SEPARATOR, canon.get()));
-
-	char *cfg;
-	if (!g_file_get_contents (confname.get(), &cfg, nullptr, nullptr))
-	{
+	auto prefs = pluginpref::lookup(pl->name, false);
+	std::string value;
+	if (!prefs || !prefs->get(var, value))
 		return false;
-	}
-	glib_string cfg_ptr(cfg);
-
-	char buf[512];
-	if (!cfg_get_str (cfg, var, buf, sizeof(buf)))
-	{
-		return false;
-	}
-
-	glib_string unescaped_value(g_strcompress (buf));
-	g_strlcpy (dest, unescaped_value.get(), dest_len);
 
+	g_strlcpy (dest, value.c_str(), dest_len);
 	return true;
 }
 
@@ -1924,34 +1844,13 @@ hexchat_pluginpref_delete (hexchat_plugin *pl, const char *var)
 int
 hexchat_pluginpref_list (hexchat_plugin *pl, char* dest)
 {
-	namespace bfs = boost::filesystem;
-	char confname[64];
-
-	{
-		glib_string token(g_strdup(static_cast<hexchat_plugin_internal*>(pl)->name.c_str()));
-		canonalize_key(token.get());
-		snprintf(confname, sizeof(confname), "addon_%s.conf", token.get());
-	}
-	auto config_path = io::fs::make_config_path(confname);
-	boost::system::error_code ec;
-	if (!bfs::exists(config_path, ec)) /* no existing config file, no parsing */
+	auto prefs = pluginpref::lookup(static_cast<hexchat_plugin_internal*>(pl)->name, false);
+	if (!prefs) /* no existing config file, no parsing */
 		return false;
 
 	/* clean up garbage */
 	strcpy(dest, "");
-	bfs::ifstream stream(config_path, std::ios::in | std::ios::binary);
-	std::locale locale;
-	std::vector<std::string> prefs;
-	for (std::string line; std::getline(stream, line, '\n');)
-	{
-		auto eq = line.find_first_of('=');
-		if (eq == std::string::npos)
-			continue;
-		auto part1 = line.substr(0, eq);
-		boost::algorithm::trim_right(part1, locale);
-		prefs.emplace_back(part1);
-	}
-	auto prefs_joined = boost::join(prefs, ",");
+	auto prefs_joined = boost::join(prefs->names(), ",");
 	// we have no idea how long dest is...
 	g_strlcat(dest, prefs_joined.c_str(), 4096);
 
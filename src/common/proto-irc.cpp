@@ -30,6 +30,7 @@
 #include <cctype>
 #include <cstdarg>
 #include <stdexcept>
+#include <vector>
 
 #include <boost/config.hpp>
 #include <boost/utility/string_ref.hpp>
@@ -42,6 +43,7 @@
 
 #include "hexchat.hpp"
 #include "proto-irc.hpp"
+#include "autojoin.hpp"
 #include "ctcp.hpp"
 #include "fe.hpp"
 #include "ignore.hpp"
@@ -57,6 +59,7 @@
 #include "url.hpp"
 #include "servlist.hpp"
 #include "session.hpp"
+#include "userlist.hpp"
 
 
 void
@@ -142,147 +145,24 @@ server::p_join(const std::string& channel, const std::string& key)
 		tcp_sendf (*this, "JOIN %s\r\n", channel.c_str());
 }
 
-static void
-irc_join_list_flush (server *serv, const std::string & channels, const std::string & keys, bool send_keys)
-{
-	if (send_keys)
-	{
-		tcp_sendf (*serv, "JOIN %s %s\r\n", channels.c_str(), keys.c_str());	/* send the actual command */
-	}
-	else
-	{
-		tcp_sendf(*serv, "JOIN %s\r\n", channels.c_str());	/* send the actual command */
-	}
-}
-
 /* Join a whole list of channels & keys, split to multiple lines
- * to get around the 512 limit.
+ * to get around the 512 limit and the server's TARGMAX.
  */
 
 void
 server::p_join_list (GSList *favorites)
 {
-	bool first_item = true;										/* determine whether we add commas or not */
-	bool send_keys = false;										/* if none of our channels have keys, we can omit the 'x' fillers altogether */
-	int len = 9;											/* JOIN<space>channels<space>keys\r\n\0 */
-	favchannel *fav;
-	std::string chanlist;
-	std::string keylist;
-	GSList *favlist;
-
-	favlist = favorites;
-
-	while (favlist)
-	{
-		fav = static_cast<favchannel*>(favlist->data);
-
-		len += fav->name.size();
-		if (fav->key)
-		{
-			len += fav->key->size();
-		}
-
-		if (len >= 512)										/* command length exceeds the IRC hard limit, flush it and start from scratch */
-		{
-			irc_join_list_flush (this, chanlist, keylist, send_keys);
-
-			chanlist.clear();
-			keylist.clear();
-			len = 9;
-			first_item = true;									/* list dumped, omit commas once again */
-			send_keys = false;									/* also omit keys until we actually find one */
-		}
-
-		if (!first_item)
-		{
-			/* This should be done before the length check, but channel names
-			 * are already at least 2 characters long so it would trigger the
-			 * flush anyway.
-			 */
-			len += 2;
-
-			/* add separators but only if it's not the 1st element */
-			chanlist.push_back(',');
-			keylist.push_back(',');
-		}
-
-		chanlist += fav->name;
-
-		if (fav->key)
-		{
-			keylist += *(fav->key);
-			send_keys = true;
-		}
-		else
-		{
-			keylist.push_back('x');				/* 'x' filler for keyless channels so that our JOIN command is always well-formatted */
-		}
-
-		first_item = false;
-		favlist = favlist->next;
-	}
-
-	irc_join_list_flush (this, chanlist, keylist, send_keys);
-	g_slist_free (favlist);
+	std::vector<favchannel> channels;
+	for (GSList *favlist = favorites; favlist; favlist = favlist->next)
+		channels.push_back (*static_cast<favchannel*>(favlist->data));
+	p_join_list (channels);
 }
 
 void
 server::p_join_list(const std::vector<favchannel> &favorites)
 {
-	bool first_item = true;										/* determine whether we add commas or not */
-	bool send_keys = false;										/* if none of our channels have keys, we can omit the 'x' fillers altogether */
-	int len = 9;											/* JOIN<space>channels<space>keys\r\n\0 */
-	std::string chanlist;
-	std::string keylist;
-
-	for (const auto & fav : favorites)
-	{
-		len += fav.name.size();
-		if (fav.key)
-		{
-			len += fav.key->size();
-		}
-
-		if (len >= 512)										/* command length exceeds the IRC hard limit, flush it and start from scratch */
-		{
-			irc_join_list_flush(this, chanlist, keylist, send_keys);
-
-			chanlist.clear();
-			keylist.clear();
-			len = 9;
-			first_item = true;									/* list dumped, omit commas once again */
-			send_keys = false;									/* also omit keys until we actually find one */
-		}
-
-		if (!first_item)
-		{
-			/* This should be done before the length check, but channel names
-			* are already at least 2 characters long so it would trigger the
-			* flush anyway.
-			*/
-			len += 2;
-
-			/* add separators but only if it's not the 1st element */
-			chanlist.push_back(',');
-			keylist.push_back(',');
-		}
-
-		chanlist += fav.name;
-
-		if (fav.key)
-		{
-			keylist += *(fav.key);
-			send_keys = true;
-		}
-		else
-		{
-			keylist.push_back('x');				/* 'x' filler for keyless channels so that our JOIN command is always well-formatted */
-		}
-
-		first_item = false;
-	}
-
-	irc_join_list_flush(this, chanlist, keylist, send_keys);
+	for (const auto & line : autojoin::pack (favorites, this->join_targets))
+		tcp_sendf (*this, "%s\r\n", line.c_str ());
 }
 
 void
@@ -382,15 +262,15 @@ server::p_get_ip_uh(const std::string & nick)
 	tcp_sendf (*this, "USERHOST %s\r\n", nick.c_str());
 }
 
-// TODO: get rid of?
-//void
-//server::p_away_status(const std::string & channel)
-//{
-//	if (this->have_whox)
-//		tcp_sendf (this, "WHO %s %%chtsunfra,152\r\n", channel.c_str());
-//	else
-//        tcp_sendf(this, "WHO %s\r\n", channel.c_str());
-//}
+/* only the away flags: with WHOX that's channel, nick and flags per user */
+void
+server::p_away_status(const std::string & channel)
+{
+	if (this->have_whox)
+		tcp_sendf (*this, "WHO %s %%tcnf,153\r\n", channel.c_str());
+	else
+		tcp_sendf (*this, "WHO %s\r\n", channel.c_str());
+}
 
 /*static void
 irc_get_ip (server *serv, char *nick)
@@ -604,8 +484,7 @@ process_numeric (session * sess, int n,
 		else goto def;
 
 	case 303:
-		word[4]++;
-		notify_markonline (serv, word, tags_data);
+		notify_markonline (serv, word_eol[4][0] == ':' ? word_eol[4] + 1 : word_eol[4], tags_data);
 		break;
 
 	case 305:
@@ -813,7 +692,7 @@ process_numeric (session * sess, int n,
 			unsigned int away = 0;
 			session *who_sess;
 
-			/* irc_away_status and irc_user_list sends out a "152" */
+			/* server::p_user_list sends out a "152" */
 			if (!strcmp (word[4], "152"))
 			{
 				who_sess = find_channel (serv, word[5]);
@@ -831,6 +710,13 @@ process_numeric (session * sess, int n,
 					EMIT_SIGNAL_TIMESTAMP (XP_TE_SERVTEXT, serv.server_session, text,
 												  word[1], word[2], NULL, 0,
 												  tags_data->timestamp);
+			}
+			/* server::p_away_status asks for "153" and just the away flag */
+			else if (!strcmp (word[4], "153"))
+			{
+				/* :server 354 yournick 153 #channel nick H */
+				inbound_user_info (sess, word[5], NULL, NULL, NULL, word[6], NULL, NULL,
+										 *word[7] == 'G' ? 1 : 0, tags_data);
 			} else
 				goto def;
 		}
@@ -846,6 +732,10 @@ process_numeric (session * sess, int n,
 					EMIT_SIGNAL_TIMESTAMP (XP_TE_SERVTEXT, serv.server_session, text,
 												  word[1], word[2], NULL, 0,
 												  tags_data->timestamp);
+				userlist_apply_who (who_sess);
+				/* away-notify keeps it up to date from here on */
+				if (serv.have_awaynotify)
+					who_sess->done_away_check = true;
 				who_sess->doing_who = FALSE;
 			} else
 			{
@@ -864,7 +754,7 @@ process_numeric (session * sess, int n,
 		break;
 
 	case 347:	/* end of invite list */
-		if (!fe_ban_list_end (sess, 347))
+		if (!inbound_banlist_end (serv, word[4], 347))
 			goto def;
 		break;
 
@@ -875,10 +765,7 @@ process_numeric (session * sess, int n,
 		break;
 
 	case 349:	/* end of exemption list */
-		sess = find_channel (serv, word[4]);
-		if (!sess)
-			goto def;
-		if (!fe_ban_list_end (sess, 349))
+		if (!inbound_banlist_end (serv, word[4], 349))
 			goto def;
 		break;
 
@@ -900,10 +787,7 @@ process_numeric (session * sess, int n,
 		break;
 
 	case 368:
-		sess = find_channel (serv, word[4]);
-		if (!sess)
-			goto def;
-		if (!fe_ban_list_end (sess, 368))
+		if (!inbound_banlist_end (serv, word[4], 368))
 			goto def;
 		break;
 
@@ -990,7 +874,7 @@ process_numeric (session * sess, int n,
 		break;
 
 	case 729:	/* end of quiet list */
-		if (!fe_ban_list_end (sess, 729))
+		if (!inbound_banlist_end (serv, word[4], 729))
 			goto def;
 		break;
 
@@ -1611,8 +1495,7 @@ server::p_inline (const boost::string_ref& text)
 	}
 
 	/* see if the second word is a numeric */
-	std::locale locale;
-	if (std::isdigit (word[2][0], locale))
+	if (g_ascii_isdigit (word[2][0]))
 	{
 		char* t = word_eol[4];
 		if (*t == ':')
@@ -0,0 +1,163 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include "reconnect.hpp"
+
+namespace reconnect
+{
+	int planner::schedule(const void *key, int base_ms, double jitter, double roll, std::int64_t now)
+	{
+		auto & e = entries_[key];
+		if (e.attempts == 0)
+			e.dropped = now;
+
+		std::int64_t delay = std::max<int>(base_ms, MIN_DELAY_MS);
+		for (int i = 0; i < e.attempts && delay < MAX_BACKOFF_MS; ++i)
+			delay *= 2;
+		delay = std::min<std::int64_t>(delay, MAX_BACKOFF_MS);
+		delay += static_cast<std::int64_t>(delay * jitter * (2.0 * roll - 1.0));
+		delay = std::max<std::int64_t>(delay, MIN_DELAY_MS);
+
+		e.attempts++;
+		e.st = state::backoff;
+		return static_cast<int>(delay);
+	}
+
+	void planner::due(const void *key, priority prio, std::int64_t now)
+	{
+		auto & e = entries_[key];
+		e.prio = prio;
+		if (e.st != state::waiting)
+		{
+			e.st = state::waiting;
+			e.due = now;
+		}
+	}
+
+	bool planner::try_start(const void *key, std::int64_t now)
+	{
+		auto found = entries_.find(key);
+		if (found == entries_.end() || found->second.st != state::waiting)
+			return false;
+		auto & me = found->second;
+
+		int handshaking = 0;
+		int bursting = 0;
+		for (const auto & other : entries_)
+		{
+			const auto & e = other.second;
+			if (e.st == state::waiting && other.first != key
+				&& (e.prio < me.prio || (e.prio == me.prio && e.due < me.due)))
+				return false;	/* someone else goes first */
+			if (!active(e, now))
+				continue;
+			if (e.st == state::handshake)
+				handshaking++;
+			else
+				bursting++;
+		}
+		if (handshaking >= MAX_HANDSHAKES || bursting >= MAX_BURSTS)
+			return false;
+
+		me.st = state::handshake;
+		me.started = now;
+		return true;
+	}
+
+	bool planner::logged_in(const void *key, std::int64_t now, timing &out)
+	{
+		auto found = entries_.find(key);
+		if (found == entries_.end() || found->second.st != state::handshake)
+			return false;
+		auto & e = found->second;
+
+		out.attempt = e.attempts;
+		out.backoff = e.due - e.dropped;
+		out.queued = e.started - e.due;
+		out.login = now - e.started;
+
+		e.st = state::burst;
+		e.burst_end = now + BURST_US;
+		e.attempts = 0;
+		e.dropped = 0;
+		return true;
+	}
+
+	void planner::release(const void *key)
+	{
+		auto found = entries_.find(key);
+		if (found != entries_.end())
+			found->second.st = state::idle;
+	}
+
+	void planner::forget(const void *key)
+	{
+		entries_.erase(key);
+	}
+
+	void planner::reset_attempts(const void *key)
+	{
+		auto found = entries_.find(key);
+		if (found != entries_.end())
+		{
+			found->second.attempts = 0;
+			found->second.dropped = 0;
+		}
+	}
+
+	int planner::attempts(const void *key) const
+	{
+		auto found = entries_.find(key);
+		return found == entries_.end() ? 0 : found->second.attempts;
+	}
+
+	int planner::handshakes(std::int64_t now) const
+	{
+		return static_cast<int>(std::count_if(entries_.cbegin(), entries_.cend(),
+			[this, now](const std::pair<const void * const, entry> & e){
+				return e.second.st == state::handshake && active(e.second, now);
+			}));
+	}
+
+	int planner::bursts(std::int64_t now) const
+	{
+		return static_cast<int>(std::count_if(entries_.cbegin(), entries_.cend(),
+			[this, now](const std::pair<const void * const, entry> & e){
+				return e.second.st == state::burst && active(e.second, now);
+			}));
+	}
+
+	/* a handshake that never finishes or a burst that is over doesn't hold
+	 * its slot any longer */
+	bool planner::active(const entry &e, std::int64_t now) const
+	{
+		switch (e.st)
+		{
+		case state::handshake:
+			return now - e.started < HANDSHAKE_TIMEOUT_US;
+		case state::burst:
+			return now < e.burst_end;
+		default:
+			return false;
+		}
+	}
+}
@@ -0,0 +1,120 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_RECONNECT_HPP
+#define HEXCHAT_RECONNECT_HPP
+
+#include <cstdint>
+#include <unordered_map>
+
+/* Decides when dropped servers get to reconnect. Each server backs off
+ * exponentially (with jitter, so they don't all come back in the same
+ * tick) and once its delay is over it waits for a free slot: only a few
+ * connections may be in their handshake, and only a few may be in the
+ * JOIN/NAMES/WHO burst that follows the login, at any one time. Waiting
+ * servers are let in by priority, then by how long they've been due.
+ * Times are in microseconds, as from g_get_monotonic_time(). */
+namespace reconnect
+{
+	enum
+	{
+		MAX_HANDSHAKES = 3,			/* connecting, not logged in yet */
+		MAX_BURSTS = 2,				/* logged in, still joining channels */
+		MAX_BACKOFF_MS = 10 * 60 * 1000,
+		MIN_DELAY_MS = 500			/* so it doesn't block the gui */
+	};
+
+	const std::int64_t BURST_US = 5 * 1000 * 1000;
+	const std::int64_t HANDSHAKE_TIMEOUT_US = 60 * 1000 * 1000;
+
+	/* lower goes first */
+	enum priority
+	{
+		PRIORITY_FAVORITE,
+		PRIORITY_AUTO_CONNECT,
+		PRIORITY_OTHER
+	};
+
+	/* where the time went for one reconnect */
+	struct timing
+	{
+		int attempt;				/* 1 for the first try after a drop */
+		std::int64_t backoff;		/* waiting out the delay */
+		std::int64_t queued;		/* waiting for a free slot */
+		std::int64_t login;			/* connect until end of MOTD */
+	};
+
+	class planner
+	{
+	public:
+		/* the delay before the next attempt: base_ms doubled for every
+		 * attempt that hasn't logged in yet, at most MAX_BACKOFF_MS, then
+		 * moved by up to +-jitter (0..1) of itself. roll is in [0, 1). */
+		int schedule(const void *key, int base_ms, double jitter, double roll, std::int64_t now);
+
+		/* the delay is over, wait for a slot */
+		void due(const void *key, priority prio, std::int64_t now);
+
+		/* true if key may connect now; it then holds a handshake slot */
+		bool try_start(const void *key, std::int64_t now);
+
+		/* end of MOTD: moves key to a burst slot, forgets its failed
+		 * attempts and returns how long the reconnect took. false if key
+		 * wasn't reconnecting through the planner. */
+		bool logged_in(const void *key, std::int64_t now, timing &out);
+
+		/* gives up the slot and any place in the queue, keeps the attempt
+		 * count for the backoff */
+		void release(const void *key);
+
+		/* the server is gone */
+		void forget(const void *key);
+
+		void reset_attempts(const void *key);
+		int attempts(const void *key) const;
+		int handshakes(std::int64_t now) const;
+		int bursts(std::int64_t now) const;
+
+	private:
+		enum class state
+		{
+			idle,
+			backoff,
+			waiting,
+			handshake,
+			burst
+		};
+
+		struct entry
+		{
+			state st = state::idle;
+			priority prio = PRIORITY_OTHER;
+			int attempts = 0;
+			std::int64_t dropped = 0;	/* when the backoff began */
+			std::int64_t due = 0;
+			std::int64_t started = 0;
+			std::int64_t burst_end = 0;
+		};
+
+		bool active(const entry &e, std::int64_t now) const;
+		std::unordered_map<const void*, entry> entries_;
+	};
+}
+
+#endif
@@ -62,10 +62,14 @@
 #include "util.hpp"
 #include "url.hpp"
 #include "proto-irc.hpp"
+#include "autojoin.hpp"
+#include "reconnect.hpp"
 #include "servlist.hpp"
 #include "server.hpp"
 #include "dcc.hpp"
 #include "session.hpp"
+#include "session_registry.hpp"
+#include "userlist.hpp"
 
 
 namespace dcc = ::hexchat::dcc;
@@ -177,13 +181,11 @@ server_send_real (server &serv, const boost::string_ref & buf)
    ircu2.10 server; under test, a 200-line paste didn't flood
    off the client */
 
-static int
+/* sends what the throttle lets out now, true if some has to wait */
+
+static bool
 tcp_send_queue (server *serv)
 {
-	/* did the server close since the timeout was added? */
-	if (!is_server (serv))
-		return 0;
-
 	const char *p;
 	int  i;
 	time_t now = time(0);
@@ -199,7 +201,7 @@ tcp_send_queue (server *serv)
 		{
 			/* check for clock skew */
 			if (now >= serv->prev_now)
-				return 1;		  /* don't remove the timeout handler */
+				return true;
 			/* it is skewed, reset to something sane */
 			serv->next_send = now;
 		}
@@ -215,14 +217,31 @@ tcp_send_queue (server *serv)
 
 		serv->outbound_queue.pop(); // = g_slist_remove (serv->outbound_queue, buf);
 	}
-	return 0;						  /* remove the timeout handler */
+	return false;
+}
+
+/* wakes up when the throttle lets the next line out; the queue sends
+   while next_send is less than 10 seconds ahead. Never sleeps longer
+   than that, so a clock that jumped back gets noticed as before. */
+
+static void
+tcp_send_queue_schedule (server &serv)
+{
+	if (serv.send_timer || serv.outbound_queue.empty ())
+		return;
+
+	auto wait = (serv.next_send - 9) * 1000 - g_get_real_time () / 1000;
+	wait = std::min<gint64> (std::max<gint64> (wait, 50), 10 * 1000);
+	serv.send_timer = timers::once (static_cast<int>(wait), [&serv]{
+		serv.send_timer = 0;
+		if (tcp_send_queue (&serv))
+			tcp_send_queue_schedule (serv);
+	});
 }
 
 int
 tcp_send_len (server &serv, const boost::string_ref & buf)
 {
-	bool noqueue = serv.outbound_queue.empty();
-
 	if (!prefs.hex_net_throttle)
 		return server_send_real (serv, buf);
 
@@ -248,8 +267,8 @@ tcp_send_len (server &serv, const boost::string_ref & buf)
 	serv.outbound_queue.emplace(std::make_pair(priority, buf.to_string()));
 	serv.sendq_len += buf.size(); /* tcp_send_queue uses strlen */
 
-	if (tcp_send_queue (&serv) && noqueue)
-		fe_timeout_add(500, (GSourceFunc)tcp_send_queue, &serv);
+	if (tcp_send_queue (&serv))
+		tcp_send_queue_schedule (serv);
 
 	return 1;
 }
@@ -273,18 +292,11 @@ tcp_sendf (server &serv, const char *fmt, ...)
 	tcp_send_len(serv, boost::string_ref(send_buf, len));
 }
 
-static int
-close_socket_cb (gpointer sok)
-{
-	closesocket (GPOINTER_TO_INT (sok));
-	return 0;
-}
-
 static void
 close_socket (int sok)
 {
 	/* close the socket in 5 seconds so the QUIT message is not lost */
-	fe_timeout_add (5000, close_socket_cb, GINT_TO_POINTER (sok));
+	timers::once (5000, [sok]{ closesocket (sok); });
 }
 
 /* handle 1 line of text received from the server */
@@ -912,6 +924,25 @@ ssl_do_connect (server * serv)
 }
 #endif
 
+/* shared by every server, so that a flapping uplink doesn't bring them all
+ * back in the same tick */
+static reconnect::planner reconnect_planner;
+
+#define RECONNECT_JITTER 0.2			/* +-20% of the backoff */
+#define RECONNECT_RETRY_MS 250		/* how often a due server asks for a slot */
+
+static reconnect::priority
+reconnect_priority (const server &serv)
+{
+	if (!serv.network)
+		return reconnect::PRIORITY_OTHER;
+	if (serv.network->flags & FLAG_FAVORITE)
+		return reconnect::PRIORITY_FAVORITE;
+	if (serv.network->flags & FLAG_AUTO_CONNECT)
+		return reconnect::PRIORITY_AUTO_CONNECT;
+	return reconnect::PRIORITY_OTHER;
+}
+
 static int
 timeout_auto_reconnect (server *serv)
 {
@@ -920,12 +951,39 @@ timeout_auto_reconnect (server *serv)
 		serv->recondelay_tag = 0;
 		if (!serv->connected && !serv->connecting && serv->server_session)
 		{
+			const auto now = g_get_monotonic_time ();
+			reconnect_planner.due (serv, reconnect_priority (*serv), now);
+			if (!reconnect_planner.try_start (serv, now))
+			{
+				/* still counts as a reconnect delay, so /disconnect cancels it */
+				serv->recondelay_tag = fe_timeout_add(RECONNECT_RETRY_MS, (GSourceFunc)timeout_auto_reconnect, serv);
+				return 0;
+			}
 			serv->connect (serv->hostname, serv->port, false);
 		}
+		else
+		{
+			/* connected by hand meanwhile, or the tab is gone: stop holding
+			   up the queue for the servers behind us */
+			reconnect_planner.release (serv);
+		}
 	}
 	return 0;			  /* returning 0 should remove the timeout handler */
 }
 
+void
+server::reconnect_done ()
+{
+	reconnect::timing took;
+	if (!reconnect_planner.logged_in (this, g_get_monotonic_time (), took))
+		return;
+
+	PrintTextf (this->server_session,
+		_("Reconnected after %.1f seconds (attempt %d): %.1fs backing off, %.1fs waiting for a free slot, %.1fs logging in.\n"),
+		(took.backoff + took.queued + took.login) / 1e6, took.attempt,
+		took.backoff / 1e6, took.queued / 1e6, took.login / 1e6);
+}
+
 void
 server::auto_reconnect (bool send_quit, int err)
 {
@@ -951,9 +1009,11 @@ server::auto_reconnect (bool send_quit, int err)
 	if (this->connected)
 		this->disconnect (this->server_session, send_quit, err);
 
-	del = prefs.hex_net_reconnect_delay * 1000;
-	if (del < 1000)
-		del = 500;				  /* so it doesn't block the gui */
+	/* /reconnect starts over, anything else backs off further every time */
+	if (send_quit)
+		reconnect_planner.reset_attempts (this);
+	del = reconnect_planner.schedule (this, prefs.hex_net_reconnect_delay * 1000,
+		RECONNECT_JITTER, g_random_double (), g_get_monotonic_time ());
 
 #ifndef WIN32
 	if (err == -1 || err == 0 || err == ECONNRESET || err == ETIMEDOUT)
@@ -971,6 +1031,8 @@ server::auto_reconnect (bool send_quit, int err)
 
 	this->recondelay_tag = fe_timeout_add(del, (GSourceFunc)timeout_auto_reconnect, this);
 	fe_server_event(this, fe_serverevents::RECONDELAY, del);
+	PrintTextf (this->server_session, _("Reconnecting in %.1f seconds (attempt %d)...\n"),
+		del / 1000.0, reconnect_planner.attempts (this));
 }
 
 void
@@ -980,23 +1042,22 @@ server::flush_queue ()
 	std::swap(this->outbound_queue, empty);
 	this->sendq_len = 0;
 	fe_set_throttle (this);
+
+	/* a WHO that was still queued won't get an answer now */
+	for (auto list = sess_list; list; list = g_slist_next(list))
+	{
+		auto sess = static_cast<session*>(list->data);
+		if (sess->server == this)
+			sess->doing_who = false;
+	}
 }
 
 boost::optional<session&> 
 server::find_channel(const boost::string_ref &chan)
 {
-	session *sess;
-	GSList *list = sess_list;
-	while (list)
-	{
-		sess = static_cast<session*>(list->data);
-		if ((this == sess->server) && sess->type == session::SESS_CHANNEL)
-		{
-			if (!this->p_cmp(chan.data(), sess->channel))
-				return *sess;
-		}
-		list = list->next;
-	}
+	auto sess = session_registry::find(*this, session::SESS_CHANNEL, chan);
+	if (sess)
+		return *sess;
 	return boost::none;
 }
 
@@ -1170,6 +1231,10 @@ server::cleanup ()
 {
 	fe_set_lag (*this, 0);
 
+	/* give up our connection slot, or our place in the queue for one */
+	reconnect_planner.release (this);
+	autojoin::forget (*this);
+
 	if (this->death_timer)
 	{
 		fe_timeout_remove(this->death_timer);
@@ -1189,6 +1254,11 @@ server::cleanup ()
 		this->joindelay_tag = 0;
 	}
 
+	timers::remove (this->lag_timer);
+	timers::remove (this->lag_meter_timer);
+	timers::remove (this->send_timer);
+	this->lag_timer = this->lag_meter_timer = this->send_timer = 0;
+
 //#ifdef USE_OPENSSL
 //	if (this->ssl)
 //	{
@@ -1818,24 +1888,37 @@ server::connect (char *hostname, int port, bool no_login)
 void
 server_fill_her_up (server &serv)
 {
-	serv.p_cmp = rfc_casecmp;	/* can be changed by 005 in modes.c */
-	serv.imbue(rfc_locale(std::locale()));
+	serv.set_casemapping (casemap::RFC1459);	/* can be changed by 005 in modes.c */
 }
 
-void server::imbue(const std::locale& other)
+void server::set_casemapping(casemap::mapping kind)
 {
-	this->locale_ = other;
+	casemapping_ = casemap(kind);
+	p_cmp = casemapping_.c_function();
+	/* everything keyed by folded names has to be folded again */
+	session_registry::rehash(*this);
+	users.rehash([this](const std::string & nick){ return casefold(nick); });
+	for (auto list = sess_list; list; list = g_slist_next(list))
+	{
+		auto sess = static_cast<session*>(list->data);
+		if (sess->server == this)
+			userlist_refold(*sess);
+	}
 }
 
 int server::compare(const boost::string_ref & lhs, const boost::string_ref &rhs) const
 {
-	auto& collate = std::use_facet<std::collate<char>>(locale_);
-	return collate.compare(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend());
+	return casemapping_.compare(lhs, rhs);
+}
+
+std::string server::casefold(const boost::string_ref & name) const
+{
+	return casemapping_.key(name);
 }
 
-const std::locale & server::current_locale() const
+const casemap & server::casemapping() const
 {
-	return locale_;
+	return casemapping_;
 }
 
 void
@@ -1889,6 +1972,9 @@ server::server()
 	iotag(),
 	recondelay_tag(),				/* reconnect delay timeout */
 	joindelay_tag(),				/* waiting before we send JOIN */
+	lag_timer(),
+	lag_meter_timer(),
+	send_timer(),
 	hostname(),				/* real ip number */
 	servername(),			/* what the server says is its name */
 	password(),
@@ -1898,6 +1984,9 @@ server::server()
 	nickcount(),
 	loginmethod(),
 	modes_per_line(),			/* 6 on undernet, 4 on efnet etc... */
+	watch_limit(),				/* from MONITOR= or WATCH=, 0 if none given */
+	join_targets(),				/* channels per JOIN from TARGMAX or MAXTARGETS, 0 if no limit */
+	join_targets_targmax(),		/* TARGMAX gave it, MAXTARGETS can't override it */
 	network(),						/* points to entry in servlist.c or NULL! */
 	next_send(),						/* cptr->since in ircu */
 	prev_now(),					/* previous now-time */
@@ -2006,6 +2095,9 @@ server::reset_to_defaults()
 	this->is_away = false;
 	this->supports_watch = false;
 	this->supports_monitor = false;
+	this->watch_limit = 0;
+	this->join_targets = 0;
+	this->join_targets_targmax = false;
 	this->bad_prefix = false;
 	this->use_who = true;
 	this->have_namesx = false;
@@ -2104,6 +2196,7 @@ server_free (server *serv)
 		g_slist_free_full (serv->favlist, (GDestroyNotify) servlist_favchan_free);
 
 	fe_server_callback (serv);
+	reconnect_planner.forget (serv);
 
 	delete serv;
 
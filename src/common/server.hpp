@@ -25,11 +25,13 @@ extern GSList *serv_list;
 #include <utility>
 #include <unordered_map>
 #include <chrono>
-#include <locale>
 #include <boost/chrono.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/string_ref_fwd.hpp>
 #include <tcpfwd.hpp>
+#include "casemap.hpp"
+#include "timers.hpp"
+#include "user_directory.hpp"
 
 struct server
 {
@@ -37,7 +39,7 @@ private:
 	void reset_to_defaults();
 	int death_timer;
 	std::unordered_map<std::string, std::pair<bool, std::string> > away_map;
-	std::locale locale_;
+	casemap casemapping_;
 	friend server *server_new(void);
 public:
 	enum class cleanup_result{
@@ -51,7 +53,8 @@ public:
 	// explict due to use of unique_ptr
 	~server();
 public:
-	void imbue(const std::locale&);
+	/* from CASEMAPPING=, sets p_cmp to match */
+	void set_casemapping(casemap::mapping kind);
 public:
 	/*  server control operations (in server*.c) */
 	void connect(char *hostname, int port, bool no_login);
@@ -59,6 +62,7 @@ public:
 	cleanup_result cleanup();
 	void flush_queue();
 	void auto_reconnect(bool send_quit, int err);
+	void reconnect_done();	/* end of MOTD, lets the next one connect */
 	/* irc protocol functions (in proto*.c) */
 	void p_inline(const boost::string_ref & text);
 	void p_invite(const std::string& channel, const std::string &nick);
@@ -77,7 +81,7 @@ public:
 	void p_join_info(const std::string & channel);
 	void p_mode(const std::string & target, const std::string &mode);
 	void p_user_list(const std::string & channel);
-	void p_away_status(const std::string & channel){ p_user_list(channel); }
+	void p_away_status(const std::string & channel);
 	void p_whois(const std::string& nicks);
 	void p_get_ip(const std::string &nick){ p_user_list(nick); }
 	void p_get_ip_uh(const std::string &nick);
@@ -95,7 +99,9 @@ public:
 	bool p_raw(const boost::string_ref & raw);
 	int(*p_cmp)(const char *s1, const char *s2);
 	int compare(const boost::string_ref & lhs, const boost::string_ref & rhs) const;
-	const std::locale & current_locale() const;
+	/* name as this server's casemapping sees it */
+	std::string casefold(const boost::string_ref & name) const;
+	const casemap & casemapping() const;
 
 	void set_name(const std::string& name);
 	void set_encoding(const char* new_encoding);
@@ -129,6 +135,9 @@ public:
 	int iotag;
 	int recondelay_tag;				/* reconnect delay timeout */
 	int joindelay_tag;				/* waiting before we send JOIN */
+	timers::handle lag_timer;		/* the next lag check */
+	timers::handle lag_meter_timer;	/* redraws the lag meter while a ping is out */
+	timers::handle send_timer;		/* the throttle lets the next line out */
 	char hostname[128];				/* real ip number */
 	char servername[128];			/* what the server says is its name */
 	char password[86];
@@ -145,6 +154,9 @@ public:
 	std::string nick_modes;             /* e.g. "aohv" */
 	std::string bad_nick_prefixes;		/* for ircd that doesn't give the modes */
 	int modes_per_line;				/* 6 on undernet, 4 on efnet etc... */
+	int watch_limit;				/* from MONITOR= or WATCH=, 0 if none given */
+	int join_targets;				/* channels per JOIN from TARGMAX or MAXTARGETS, 0 if no limit */
+	bool join_targets_targmax;		/* TARGMAX gave it, MAXTARGETS can't override it */
 
 	ircnet *network;						/* points to entry in servlist.c or NULL! */
 
@@ -156,6 +168,7 @@ public:
 
 	struct session *front_session;	/* front-most window/tab */
 	struct session *server_session;	/* server window/tab */
+	user_directory users;			/* whoever is in our channels, by nick */
 
 	struct server_gui *gui;		  /* initialized by fe_new_server */
 
@@ -1136,53 +1136,59 @@ static bool servlist_load (void)
 		bfs::rename(oldfile, newfile, ec);
 	}
 
-	bfs::ifstream infile(io::fs::make_config_path("servlist.conf"), std::ios::in);
-	if (!infile)
+	gchar *cfg_ptr;
+	gsize cfg_len;
+	if (!g_file_get_contents(newfile.string().c_str(), &cfg_ptr, &cfg_len, nullptr))
 		return false;
+	glib_string cfg(cfg_ptr);
 
 	ircnet *net = nullptr;
 
-	for(std::string buf; std::getline(infile, buf);)
+	/* every line is a letter, '=' and the value */
+	for (const auto & ln : config::parse_lines(boost::string_ref(cfg_ptr, cfg_len)))
 	{
+		if (ln.text.size() < 2)
+			continue;
+		const auto value = ln.text.substr(2).to_string();
 		if (net)
 		{
-			switch (buf[0])
+			switch (ln.text[0])
 			{
 			case 'I':
-				net->nick = buf.substr(2);
+				net->nick = value;
 				break;
 			case 'i':
-				net->nick2 = buf.substr(2);
+				net->nick2 = value;
 				break;
 			case 'U':
-				net->user = strdup (buf.c_str() + 2);
+				net->user = strdup (value.c_str());
 				break;
 			case 'R':
-				net->real = strdup (buf.c_str() + 2);
+				net->real = strdup (value.c_str());
 				break;
 			case 'P':
-				net->pass = strdup (buf.c_str() + 2);
+				net->pass = strdup (value.c_str());
 				break;
 			case 'L':
-				net->logintype = std::atoi (buf.c_str() + 2);
+				net->logintype = std::atoi (value.c_str());
 				break;
 			case 'E':
-				net->encoding = strdup (buf.c_str() + 2);
+				net->encoding = strdup (value.c_str());
 				break;
 			case 'F':
-				net->flags = std::atoi (buf.c_str() + 2);
+				net->flags = std::atoi (value.c_str());
 				break;
 			case 'S':	/* new server/hostname for this network */
-				servlist_server_add (net, buf.c_str() + 2);
+				servlist_server_add (net, value.c_str());
 				break;
 			case 'C':
-				servlist_command_add (net, buf.c_str() + 2);
+				servlist_command_add (net, value.c_str());
 				break;
 			case 'J':
-				servlist_favchan_add (net, buf.c_str() + 2);
+				servlist_favchan_add (net, value.c_str());
 				break;
 			case 'D':
-				net->selected = std::atoi (buf.c_str() + 2);
+				net->selected = std::atoi (value.c_str());
 				break;
 			/* FIXME Migration code. In 2.9.5 the order was:
 			 *
@@ -1197,7 +1203,7 @@ static bool servlist_load (void)
 			case 'A':
 				if (!net->pass)
 				{
-					net->pass = strdup (buf.c_str() + 2);
+					net->pass = strdup (value.c_str());
 					if (!net->logintype)
 					{
 						net->logintype = LOGIN_SASL;
@@ -1206,7 +1212,7 @@ static bool servlist_load (void)
 			case 'B':
 				if (!net->pass)
 				{
-					net->pass = strdup (buf.c_str() + 2);
+					net->pass = strdup (value.c_str());
 					if (!net->logintype)
 					{
 						net->logintype = LOGIN_NICKSERV;
@@ -1214,8 +1220,8 @@ static bool servlist_load (void)
 				}
 			}
 		}
-		if (!buf.empty() && buf[0] == 'N')
-			net = servlist_net_add (buf.c_str() + 2, /* comment */ nullptr, false);
+		if (ln.text[0] == 'N')
+			net = servlist_net_add (value.c_str(), /* comment */ nullptr, false);
 	}
 
 	return true;
@@ -24,7 +24,6 @@
 #include "session.hpp"
 
 #include "chanopt.hpp"
-#include "dcc.hpp"
 #include "fe.hpp"
 #include "hexchat.hpp"
 #include "hexchatc.hpp"
@@ -33,8 +32,11 @@
 #include "outbound.hpp"
 #include "plugin.hpp"
 #include "session_logging.hpp"
+#include "session_registry.hpp"
 #include "server.hpp"
+#include "startup.hpp"
 #include "text.hpp"
+#include "timers.hpp"
 #include "userlist.hpp"
 #include "util.hpp"
 
@@ -111,6 +113,8 @@ session::session(struct server *serv, const char *from, ::session::session_type
 	end_of_names(),
 	doing_who(),
 	done_away_check(),
+	who_replies(),
+	bans(),
 	lastlog_flags(),
 	scrollback_replay_marklast(nullptr)
 {
@@ -192,72 +196,24 @@ doover:
 	return 1;
 }
 
-static void
-lagcheck_update(void)
-{
-	if (!prefs.hex_gui_lagometer)
-		return;
-
-	for (auto & serv : glib_helper::glist_iterable<server>(serv_list))
-	{
-		if (serv.lag_sent)
-			fe_set_lag(serv, -1);
-	}
-}
-
-static int
-hexchat_misc_checks(void)		/* this gets called every 1/2 second */
-{
-	namespace dcc = hexchat::dcc;
-	static int count = 0;
-
-	count++;
-
-	lagcheck_update();			/* every 500ms */
-
-	if (count % 2)
-		dcc::dcc_check_timeouts();	/* every 1 second */
-
-	if (count >= 60)				/* every 30 seconds */
-	{
-		if (prefs.hex_gui_lagometer)
-			lag_check();
-		count = 0;
-	}
-
-	return 1;
-}
-
-/* executed when the first irc window opens */
+/* loads the plugins and runs what the command line asked for. Plugins
+   may hook the commands given there, so this all happens together. */
 
 static void
-irc_init(session *sess)
+irc_init_late(session *sess)
 {
-	static bool done_init = false;
-
-	if (done_init)
-		return;
-
-	done_init = true;
-
-	plugin_add(sess, nullptr, nullptr, timer_plugin_init, timer_plugin_deinit, nullptr, false);
-
 #ifdef USE_PLUGIN
 	if (!arg_skip_plugins)
+	{
+		startup::span trace("plugin_auto_load");
 		plugin_auto_load(sess);	/* autoload ~/.xchat *.so */
+	}
 #endif
 
 #ifdef USE_DBUS
 	plugin_add(sess, nullptr, nullptr, dbus_plugin_init, nullptr, nullptr, false);
 #endif
 
-	if (prefs.hex_notify_timeout)
-		notify_tag = fe_timeout_add(prefs.hex_notify_timeout * 1000,
-		(GSourceFunc)notify_checklist, 0);
-
-	fe_timeout_add(prefs.hex_away_timeout * 1000, (GSourceFunc)away_check, nullptr);
-	fe_timeout_add(500, (GSourceFunc)hexchat_misc_checks, nullptr);
-
 	if (arg_url != nullptr)
 	{
 		glib_string arg_url_ptr{ arg_url }; /* from GOption */
@@ -287,6 +243,47 @@ irc_init(session *sess)
 	load_perform_file(sess, "startup.txt");
 }
 
+static gboolean
+irc_init_late_cb(session *sess)
+{
+	/* the window it was meant for may be gone already */
+	if (!is_session(sess))
+	{
+		if (!sess_list)
+			return FALSE;
+		sess = static_cast<session *>(sess_list->data);
+	}
+	irc_init_late(sess);
+	return FALSE;
+}
+
+/* executed when the first irc window opens */
+
+static void
+irc_init(session *sess)
+{
+	static bool done_init = false;
+
+	if (done_init)
+		return;
+
+	done_init = true;
+
+	plugin_add(sess, nullptr, nullptr, timer_plugin_init, timer_plugin_deinit, nullptr, false);
+
+	if (prefs.hex_notify_timeout)
+		notify_tag = timers::add(prefs.hex_notify_timeout * 1000, []{ return notify_checklist() != 0; });
+
+	timers::add(prefs.hex_away_timeout * 1000, []{ return away_check() != 0; });
+
+	/* with gui_defer_plugins, the first window gets drawn before any
+	   plugin is loaded */
+	if (prefs.hex_gui_defer_plugins)
+		fe_idle_add((GSourceFunc)irc_init_late_cb, sess);
+	else
+		irc_init_late(sess);
+}
+
 
 static session *
 session_new(server *serv, const char *from, int type, bool focus)
@@ -294,6 +291,7 @@ session_new(server *serv, const char *from, int type, bool focus)
 	session *sess = new session(serv, from, type);
 
 	sess_list = g_slist_prepend(sess_list, sess);
+	session_registry::add(*sess);
 
 	fe_new_window(sess, focus);
 
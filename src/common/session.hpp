@@ -24,11 +24,23 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "banlist-store.hpp"
 #include "sessfwd.hpp"
 #include "serverfwd.hpp"
 #include "history.hpp"
 #include "session_logging.hpp"
 
+/* a reply to our own WHO, held back until the 315 that ends it */
+struct who_reply
+{
+	std::string nick;
+	std::string hostname;	/* user@host, empty if not asked for */
+	std::string realname;
+	std::string servername;
+	std::string account;
+	unsigned int away;		/* 0xff if unknown */
+};
+
 struct session
 {
 	typedef int session_type;
@@ -105,6 +117,8 @@ struct session
 	bool end_of_names;
 	bool doing_who;		/* /who sent on this channel */
 	bool done_away_check;	/* done checking for away status changes */
+	std::vector<who_reply> who_replies;	/* while doing_who, applied all at once at 315 */
+	banlist::store bans;	/* +b/+e/+I/+q lists as far as we know them */
 	gtk_xtext_search_flags lastlog_flags;
 	void(*scrollback_replay_marklast) (struct session *sess);
 };
@@ -0,0 +1,166 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hexchat.hpp"
+#include "server.hpp"
+#include "session.hpp"
+#include "session_registry.hpp"
+
+namespace session_registry
+{
+	namespace
+	{
+		struct name_key
+		{
+			const server *serv;
+			int type;
+			std::string name;	/* folded */
+
+			bool operator==(const name_key & other) const
+			{
+				return serv == other.serv && type == other.type && name == other.name;
+			}
+		};
+
+		struct name_key_hash
+		{
+			std::size_t operator()(const name_key & key) const
+			{
+				auto h = std::hash<std::string>()(key.name);
+				h ^= std::hash<const void*>()(key.serv) + 0x9e3779b9 + (h << 6) + (h >> 2);
+				return h ^ static_cast<std::size_t>(key.type);
+			}
+		};
+
+		struct entry
+		{
+			session *sess;
+			std::uint64_t id;
+			bool indexed;
+			name_key key;
+		};
+
+		std::unordered_map<const session*, entry> live;
+		/* the same name can be open twice, e.g. a dialog and a DCC chat */
+		std::unordered_map<name_key, std::vector<session*>, name_key_hash> by_name;
+		std::uint64_t next_id = 1;
+
+		void unindex(const session *sess, entry & e)
+		{
+			if (!e.indexed)
+				return;
+			auto found = by_name.find(e.key);
+			if (found != by_name.end())
+			{
+				auto & sessions = found->second;
+				sessions.erase(std::remove(sessions.begin(), sessions.end(), sess), sessions.end());
+				if (sessions.empty())
+					by_name.erase(found);
+			}
+			e.indexed = false;
+		}
+
+		void index(session & sess, entry & e)
+		{
+			if (sess.type != session::SESS_CHANNEL && sess.type != session::SESS_DIALOG)
+				return;
+			e.key = name_key{ sess.server, sess.type, sess.server->casefold(sess.channel) };
+			by_name[e.key].push_back(&sess);
+			e.indexed = true;
+		}
+	}
+
+	void add(session &sess)
+	{
+		auto & e = live[&sess];
+		e.sess = &sess;
+		e.id = next_id++;
+		e.indexed = false;
+		index(sess, e);
+	}
+
+	void remove(session &sess)
+	{
+		auto found = live.find(&sess);
+		if (found == live.end())
+			return;
+		unindex(&sess, found->second);
+		live.erase(found);
+	}
+
+	bool contains(const session *sess)
+	{
+		return live.find(sess) != live.end();
+	}
+
+	std::uint64_t id(const session *sess)
+	{
+		auto found = live.find(sess);
+		return found == live.end() ? 0 : found->second.id;
+	}
+
+	void renamed(session &sess)
+	{
+		auto found = live.find(&sess);
+		if (found == live.end())
+			return;
+		unindex(&sess, found->second);
+		index(sess, found->second);
+	}
+
+	session *find(const server &serv, int type, const boost::string_ref &name)
+	{
+		auto found = by_name.find(name_key{ &serv, type, serv.casefold(name) });
+		if (found == by_name.end())
+			return nullptr;
+
+		/* sess_list has the newest first, so that's the one a scan found */
+		session *newest = nullptr;
+		std::uint64_t newest_id = 0;
+		for (auto sess : found->second)
+		{
+			const auto sess_id = live[sess].id;
+			if (sess_id > newest_id)
+			{
+				newest = sess;
+				newest_id = sess_id;
+			}
+		}
+		return newest;
+	}
+
+	void rehash(const server &serv)
+	{
+		for (auto & item : live)
+		{
+			auto & e = item.second;
+			if (e.sess->server != &serv)
+				continue;
+			unindex(e.sess, e);
+			index(*e.sess, e);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_SESSION_REGISTRY_HPP
+#define HEXCHAT_SESSION_REGISTRY_HPP
+
+#include <cstdint>
+#include <boost/utility/string_ref.hpp>
+#include "serverfwd.hpp"
+#include "sessfwd.hpp"
+
+/* Every live session, hashed, so is_session() doesn't have to walk
+ * sess_list and find_channel()/find_dialog() don't have to compare every
+ * name. Channels and dialogs are also indexed by server, type and the
+ * name as the server's casemapping folds it, which means whoever changes
+ * sess->channel of one of those has to call renamed() afterwards. */
+namespace session_registry
+{
+	/* sess was just put on sess_list / is about to be taken off it */
+	void add(session &sess);
+	void remove(session &sess);
+
+	bool contains(const session *sess);
+
+	/* a number that stays with sess and is never given to another one,
+	 * 0 if sess isn't live */
+	std::uint64_t id(const session *sess);
+
+	/* sess->channel changed */
+	void renamed(session &sess);
+
+	/* the newest live session of this type with this name, or nullptr */
+	session *find(const server &serv, int type, const boost::string_ref &name);
+
+	/* serv's casemapping changed, fold its names again */
+	void rehash(const server &serv);
+}
+
+#endif
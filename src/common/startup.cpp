@@ -0,0 +1,208 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <glib.h>
+
+#include "cfgfiles.hpp"
+#include "filesystem.hpp"
+#include "startup.hpp"
+
+namespace startup
+{
+	namespace
+	{
+		struct event
+		{
+			std::string name;
+			int tid;
+			std::int64_t start;	/* microseconds since trace_enable() */
+			std::int64_t dur;
+		};
+
+		std::atomic_bool enabled(false);
+		std::int64_t origin;
+		std::mutex events_mutex;
+		std::vector<event> events;
+		std::map<std::thread::id, int> thread_ids;	/* small numbers for the trace */
+
+		std::int64_t now()
+		{
+			return g_get_monotonic_time() - origin;
+		}
+
+		void record(std::string name, std::int64_t start, std::int64_t end)
+		{
+			std::lock_guard<std::mutex> lock(events_mutex);
+			auto tid = thread_ids.emplace(std::this_thread::get_id(), static_cast<int>(thread_ids.size()) + 1).first->second;
+			event ev;
+			ev.name = std::move(name);
+			ev.tid = tid;
+			ev.start = start;
+			ev.dur = end - start;
+			events.emplace_back(std::move(ev));
+		}
+
+		void append_json_string(std::string & out, const std::string & text)
+		{
+			out.push_back('"');
+			for (auto c : text)
+			{
+				switch (c)
+				{
+				case '"':
+					out += "\\\"";
+					break;
+				case '\\':
+					out += "\\\\";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char esc[8];
+						g_snprintf(esc, sizeof(esc), "\\u%04x", c);
+						out += esc;
+					}
+					else
+						out.push_back(c);
+				}
+			}
+			out.push_back('"');
+		}
+	}
+
+	void trace_enable()
+	{
+		origin = g_get_monotonic_time();
+		{
+			std::lock_guard<std::mutex> lock(events_mutex);
+			thread_ids.emplace(std::this_thread::get_id(), 1);
+		}
+		enabled = true;
+	}
+
+	bool tracing()
+	{
+		return enabled;
+	}
+
+	span::span(std::string name)
+		:name_(std::move(name)), start_(enabled ? now() : 0)
+	{}
+
+	span::~span()
+	{
+		if (enabled)
+			record(std::move(name_), start_, now());
+	}
+
+	std::string trace_json()
+	{
+		std::lock_guard<std::mutex> lock(events_mutex);
+		std::string out = "{\"traceEvents\":[";
+		for (std::size_t i = 0; i < events.size(); ++i)
+		{
+			const auto & ev = events[i];
+			if (i)
+				out += ",";
+			out += "\n{\"name\":";
+			append_json_string(out, ev.name);
+			out += ",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(ev.tid)
+				+ ",\"ts\":" + std::to_string(ev.start) + ",\"dur\":" + std::to_string(ev.dur) + "}";
+		}
+		out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return out;
+	}
+
+	void trace_finish()
+	{
+		if (!enabled.exchange(false))
+			return;
+
+		const auto total = now();
+		{
+			std::lock_guard<std::mutex> lock(events_mutex);
+			/* spans are recorded as they end, list them as they started */
+			auto sorted = events;
+			std::stable_sort(sorted.begin(), sorted.end(), [](const event & a, const event & b){
+				return a.start < b.start;
+			});
+			std::printf("Startup trace, %.1f ms in all:\n", total / 1000.0);
+			std::printf("%10s %10s %7s  %s\n", "start ms", "took ms", "thread", "phase");
+			for (const auto & ev : sorted)
+			{
+				std::printf("%10.1f %10.1f %7d  %s\n", ev.start / 1000.0, ev.dur / 1000.0,
+					ev.tid, ev.name.c_str());
+			}
+		}
+
+		const auto path = io::fs::make_config_path("startup-trace.json").string();
+		config::writer out;
+		out.put_raw(trace_json());
+		if (out.commit(path))
+			std::printf("Saved as %s\n", path.c_str());
+		std::fflush(stdout);
+	}
+
+	void run_parallel(std::vector<phase> phases)
+	{
+		if (phases.empty())
+			return;
+
+		std::vector<std::exception_ptr> errors(phases.size());
+		auto run_one = [&phases, &errors](std::size_t i)
+		{
+			try
+			{
+				span trace(phases[i].name);
+				phases[i].run();
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (std::size_t i = 0; i + 1 < phases.size(); ++i)
+			workers.emplace_back(run_one, i);
+		run_one(phases.size() - 1);
+		for (auto & worker : workers)
+			worker.join();
+
+		for (const auto & error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_STARTUP_HPP
+#define HEXCHAT_STARTUP_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/* Startup phases: --trace-startup records a span for each one, which is
+ * printed once startup is over and saved as Chrome trace JSON (load it in
+ * chrome://tracing). Phases that only read their own config file can be
+ * run side by side on worker threads. */
+namespace startup
+{
+	/* from now on, spans are recorded */
+	void trace_enable();
+	bool tracing();
+
+	/* the time between construction and destruction as one span */
+	class span
+	{
+	public:
+		explicit span(std::string name);
+		~span();
+
+	private:
+		span(const span &) = delete;
+		span & operator=(const span &) = delete;
+
+		std::string name_;
+		std::int64_t start_;
+	};
+
+	/* every span so far in Chrome's trace event format */
+	std::string trace_json();
+
+	/* prints the spans, saves them to startup-trace.json in the config
+	 * dir and stops recording */
+	void trace_finish();
+
+	struct phase
+	{
+		const char *name;
+		std::function<void()> run;
+	};
+
+	/* runs the phases on worker threads (the last one on this thread),
+	 * each as its own span, and returns once they've all finished */
+	void run_parallel(std::vector<phase> phases);
+}
+
+#endif
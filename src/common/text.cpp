@@ -27,12 +27,14 @@
 #include <cstring>
 #include <cctype>
 #include <ctime>
+#include <iterator>
 #include <cwchar>
 #include <memory>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -1359,11 +1361,17 @@ static void pevent_check_all_loaded ()
 	}
 }
 
-void load_text_events ()
+/* only reads pevents.conf, so it's safe to run off the main thread */
+void read_text_events ()
 {
 	if (pevent_load (nullptr))
 		pevent_load_defaults ();
 	pevent_check_all_loaded ();
+}
+
+void load_text_events ()
+{
+	read_text_events ();
 	pevent_make_pntevts ();
 }
 
@@ -1763,6 +1771,21 @@ void pevent_save(const char file_name[])
 std::array<std::string, NUM_XP> sound_files;
 //char *sound_files[NUM_XP];
 
+#define SOUND_MIN_INTERVAL 1000	/* ms before one event's sound plays again */
+
+/* what sound_files[i] resolved to, worked out once and not on every event */
+struct event_sound
+{
+	boost::filesystem::path::string_type path;
+	bool readable;
+	bool reported;		/* told the user it can't be read */
+	gint64 last_played;
+#ifdef WIN32
+	std::vector<char> data;	/* the whole file, for SND_MEMORY */
+#endif
+};
+static std::array<event_sound, NUM_XP> event_sounds;
+
 void sound_beep (session *sess)
 {
 	if (!prefs.hex_gui_focus_omitalerts || !fe_gui_info (sess, 0) == 1)
@@ -1776,16 +1799,10 @@ void sound_beep (session *sess)
 	}
 }
 
-void sound_play(const boost::string_ref & file, bool quiet)
+static boost::filesystem::path
+sound_resolve (const boost::string_ref & file)
 {
 	namespace bfs = boost::filesystem;
-
-	/* the pevents GUI editor triggers this after removing a soundfile */
-	if (file.empty())
-	{
-		return;
-	}
-	bfs::path wavfile;
 #ifdef WIN32
 	/* check for fullpath */
 	if (file[0] == '\\' || (((file[0] >= 'A' && file[0] <= 'Z') || (file[0] >= 'a' && file[0] <= 'z')) && file[1] == ':'))
@@ -1793,55 +1810,142 @@ void sound_play(const boost::string_ref & file, bool quiet)
 	if (file[0] == '/')
 #endif
 	{
-		wavfile = file.to_string();
+		return bfs::path(file.to_string());
 	}
-	else
+	return bfs::path(config::config_dir()) / HEXCHAT_SOUND_DIR / file.to_string();
+}
+
+#ifdef USE_LIBCANBERRA
+/* one context for the whole session, so the sound server connection and
+   its sample cache stay around */
+static ca_context *
+sound_context ()
+{
+	if (ca_con == NULL)
 	{
-		wavfile = bfs::path(config::config_dir()) / HEXCHAT_SOUND_DIR / file.to_string();
+		ca_context_create (&ca_con);
+		ca_context_change_props (ca_con,
+										CA_PROP_APPLICATION_ID, "hexchat",
+										CA_PROP_APPLICATION_NAME, "HexChat",
+										CA_PROP_APPLICATION_ICON_NAME, "hexchat", NULL);
 	}
+	return ca_con;
+}
+#endif
 
-	if (g_access (wavfile.string().c_str(), R_OK) == 0)
-	{
+/* event is the text event index if it's an event's sound, else -1 */
+static void
+sound_play_file (const boost::filesystem::path & wavfile, int event)
+{
 #ifdef WIN32
+	if (event >= 0 && !event_sounds[event].data.empty ())
+		PlaySoundW (reinterpret_cast<LPCWSTR>(event_sounds[event].data.data ()), nullptr, SND_NODEFAULT|SND_MEMORY|SND_ASYNC);
+	else
 		PlaySoundW (wavfile.c_str(), nullptr, SND_NODEFAULT|SND_FILENAME|SND_ASYNC);
 #else
 #ifdef USE_LIBCANBERRA
-		if (ca_con == NULL)
-		{
-			ca_context_create (&ca_con);
-			ca_context_change_props (ca_con,
-											CA_PROP_APPLICATION_ID, "hexchat",
-											CA_PROP_APPLICATION_NAME, "HexChat",
-											CA_PROP_APPLICATION_ICON_NAME, "hexchat", NULL);
-		}
-
-		if (ca_context_play (ca_con, 0, CA_PROP_MEDIA_FILENAME, wavfile.c_str(), NULL) != 0)
+	int played;
+	if (event >= 0)
+		played = ca_context_play (sound_context (), 0, CA_PROP_EVENT_ID, te[event].name,
+										  CA_PROP_MEDIA_FILENAME, wavfile.c_str(), NULL);
+	else
+		played = ca_context_play (sound_context (), 0, CA_PROP_MEDIA_FILENAME, wavfile.c_str(), NULL);
+	if (played != 0)
 #endif
+	{
+		glib_string cmd (g_find_program_in_path ("play"));
+
+		if (cmd)
 		{
-			glib_string cmd (g_find_program_in_path ("play"));
-	
-			if (cmd)
-			{
-				glib_string buf(g_strdup_printf ("%s \"%s\"", cmd.get(), wavfile.c_str()));
-				hexchat_exec (buf.get());
-			}
+			glib_string buf(g_strdup_printf ("%s \"%s\"", cmd.get(), wavfile.c_str()));
+			hexchat_exec (buf.get());
 		}
+	}
 #endif
+}
+
+static void
+sound_report_unreadable (const boost::filesystem::path & wavfile)
+{
+	std::ostringstream buf;
+	buf << boost::format(_("Cannot read sound file:\n%s")) % wavfile;
+	fe_message (buf.str(), FE_MSG_ERROR);
+}
+
+void sound_play(const boost::string_ref & file, bool quiet)
+{
+	/* the pevents GUI editor triggers this after removing a soundfile */
+	if (file.empty())
+	{
+		return;
 	}
-	else
+	auto wavfile = sound_resolve (file);
+
+	if (g_access (wavfile.string().c_str(), R_OK) == 0)
+		sound_play_file (wavfile, -1);
+	else if (!quiet)
+		sound_report_unreadable (wavfile);
+}
+
+/* resolves and preloads event i's sound, after sound_files[i] changed */
+static void
+sound_cache_event (int i)
+{
+	auto & snd = event_sounds[i];
+#ifdef WIN32
+	/* SND_ASYNC keeps reading the buffer after PlaySoundW returns, so stop
+	   it before the buffer goes away */
+	if (!snd.data.empty ())
+		PlaySoundW (nullptr, nullptr, 0);
+#endif
+	snd = event_sound{};
+	if (sound_files[i].empty())
+		return;
+
+	const auto wavfile = sound_resolve (sound_files[i]);
+	snd.path = wavfile.native();
+	snd.readable = g_access (wavfile.string().c_str(), R_OK) == 0;
+	if (!snd.readable)
+		return;
+#ifdef WIN32
+	boost::filesystem::ifstream in(wavfile, std::ios::in | std::ios::binary);
+	snd.data.assign (std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+#elif defined(USE_LIBCANBERRA)
+	/* uploads it to the sound server's cache under the event's name */
+	ca_context_cache (sound_context (), CA_PROP_EVENT_ID, te[i].name,
+							CA_PROP_MEDIA_FILENAME, wavfile.c_str(), NULL);
+#endif
+}
+
+/* a flood of one event plays its sound at most once every SOUND_MIN_INTERVAL */
+void sound_play_event (int i)
+{
+	auto & snd = event_sounds[i];
+	if (snd.path.empty())
+		return;
+
+	const boost::filesystem::path wavfile (snd.path);
+	if (!snd.readable)
 	{
-		if (!quiet)
+		if (!snd.reported)
 		{
-			std::ostringstream buf;
-			buf << boost::format(_("Cannot read sound file:\n%s")) % wavfile;
-			fe_message (buf.str(), FE_MSG_ERROR);
+			snd.reported = true;
+			sound_report_unreadable (wavfile);
 		}
+		return;
 	}
+
+	const auto now = g_get_monotonic_time ();
+	if (snd.last_played && now - snd.last_played < SOUND_MIN_INTERVAL * 1000)
+		return;
+	snd.last_played = now;
+	sound_play_file (wavfile, i);
 }
 
-void sound_play_event (int i)
+void sound_set_event (int i, const std::string & file)
 {
-	sound_play(sound_files[i], false);
+	sound_files[i] = file;
+	sound_cache_event (i);
 }
 
 // file is intended to be an R-Value
@@ -1850,9 +1954,7 @@ static void sound_load_event (const std::string & evt, std::string file)
 	int i = 0;
 
 	if (!file.empty() && pevent_find (evt.c_str(), i) != -1)
-	{
 		sound_files[i] = std::move(file);
-	}
 }
 
 void sound_load ()
@@ -1877,6 +1979,14 @@ void sound_load ()
 	}
 }
 
+/* libcanberra's context isn't shared between threads, so this runs on the
+   main thread once sound_load has filled in sound_files */
+void sound_preload ()
+{
+	for (int i = 0; i < NUM_XP; i++)
+		sound_cache_event (i);
+}
+
 void sound_save ()
 {
 	int fd = hexchat_open_file ("sound.conf", O_CREAT | O_TRUNC | O_WRONLY, 0x180,
@@ -49,6 +49,7 @@ void PrintTextTimeStamp(session *sess, const boost::string_ref & text, time_t ti
 void PrintTextf(session * sess, const boost::format & fmt);
 void PrintTextf (session *sess, const char *format, ...) G_GNUC_PRINTF (2, 3);
 void PrintTextTimeStampf (session *sess, time_t timestamp, const char *format, ...) G_GNUC_PRINTF (3, 4);
+void read_text_events (void);
 void load_text_events (void);
 void pevent_save (const char file_name[]);
 int pevt_build_string(const std::string& input, std::string & output, int &max_arg);
@@ -66,8 +67,13 @@ const char *text_find_format_string (const char name[]);
  
 void sound_play (const boost::string_ref & file, bool quiet);
 void sound_play_event (int i);
+/* changes event i's sound and loads it */
+void sound_set_event (int i, const std::string &file);
 void sound_beep (session *);
+/* reads sound.conf, safe on a worker thread */
 void sound_load ();
+/* resolves and preloads every event's sound; main thread only */
+void sound_preload ();
 void sound_save ();
 
 
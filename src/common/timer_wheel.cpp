@@ -0,0 +1,203 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "timer_wheel.hpp"
+
+namespace
+{
+	/* ticks covered by one slot / a full turn of the wheel at level */
+	std::int64_t slot_span(int level)
+	{
+		return std::int64_t(1) << (timer_wheel::SLOT_BITS * level);
+	}
+}
+
+timer_wheel::timer_wheel(std::int64_t now)
+	:current_(now), next_id_(1), counts_()
+{
+}
+
+timer_wheel::id timer_wheel::add(std::int64_t due, std::int64_t interval, callback cb)
+{
+	id timer;
+	do
+		timer = next_id_++;
+	while (!timer || entries_.count(timer));
+
+	auto & e = entries_[timer];
+	e.due = due;
+	e.interval = interval;
+	e.cb = std::move(cb);
+	place(timer, e);
+	return timer;
+}
+
+bool timer_wheel::cancel(id timer)
+{
+	return entries_.erase(timer) != 0;
+}
+
+bool timer_wheel::pending(id timer) const
+{
+	return entries_.count(timer) != 0;
+}
+
+std::size_t timer_wheel::size() const
+{
+	return entries_.size();
+}
+
+/* on the lowest wheel a slot is exactly one tick. Higher up a slot covers
+ * a whole turn of the wheel below, but the slots still come in order of
+ * time, so the first one that holds anything has that wheel's earliest. */
+std::int64_t timer_wheel::next_due() const
+{
+	std::int64_t best = -1;
+	for (int level = 0; level < LEVELS; ++level)
+	{
+		if (!counts_[level])
+			continue;
+		const auto base = current_ >> (SLOT_BITS * level);
+		for (int i = 1; i <= SLOTS; ++i)
+		{
+			bool found = false;
+			for (auto timer : wheels_[level][(base + i) & (SLOTS - 1)])
+			{
+				auto e = entries_.find(timer);
+				if (e == entries_.end())
+					continue;
+				found = true;
+				if (best < 0 || e->second.due < best)
+					best = e->second.due;
+			}
+			if (found)
+				break;
+		}
+	}
+	return best;
+}
+
+std::size_t timer_wheel::advance(std::int64_t now)
+{
+	std::size_t ran = 0;
+	while (current_ < now)
+	{
+		/* with the lower wheels empty nothing happens until the next turn
+		 * of the lowest one that isn't */
+		int empty = 0;
+		while (empty < LEVELS && !counts_[empty])
+			++empty;
+		if (empty == LEVELS)
+		{
+			current_ = now;
+			break;
+		}
+		if (empty)
+		{
+			const auto next = (current_ | (slot_span(empty) - 1)) + 1;
+			if (next > now)
+			{
+				current_ = now;
+				break;
+			}
+			current_ = next - 1;
+		}
+
+		++current_;
+		for (int level = 1; level < LEVELS && !(current_ & (slot_span(level) - 1)); ++level)
+			cascade(level);
+		ran += run_slot();
+	}
+	return ran;
+}
+
+/* the lowest wheel whose slots are big enough to reach due from now;
+ * anything further off than the top wheel reaches waits in its last slot
+ * and is placed again when that comes round */
+void timer_wheel::place(id timer, entry &e)
+{
+	auto when = std::max(e.due, current_ + 1);
+	if (when - current_ >= slot_span(LEVELS))
+		when = current_ + slot_span(LEVELS) - 1;
+
+	int level = 0;
+	while (when - current_ >= slot_span(level + 1))
+		++level;
+	wheels_[level][(when >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(timer);
+	counts_[level]++;
+}
+
+/* the lower wheel just turned over into this slot's span: spread it out */
+void timer_wheel::cascade(int level)
+{
+	slot timers;
+	timers.swap(wheels_[level][(current_ >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+	counts_[level] -= timers.size();
+	for (auto timer : timers)
+	{
+		auto e = entries_.find(timer);
+		if (e != entries_.end())
+			place(timer, e->second);
+	}
+}
+
+std::size_t timer_wheel::run_slot()
+{
+	slot timers;
+	timers.swap(wheels_[0][current_ & (SLOTS - 1)]);
+	counts_[0] -= timers.size();
+
+	std::size_t ran = 0;
+	for (auto timer : timers)
+	{
+		auto e = entries_.find(timer);
+		if (e == entries_.end())
+			continue;
+		/* parked in the top wheel's last slot */
+		if (e->second.due > current_)
+		{
+			place(timer, e->second);
+			continue;
+		}
+
+		/* the callback may add or cancel timers, itself included */
+		auto cb = std::move(e->second.cb);
+		const bool again = cb();
+		++ran;
+
+		e = entries_.find(timer);
+		if (e == entries_.end())
+			continue;
+		if (again && e->second.interval > 0)
+		{
+			e->second.due = current_ + e->second.interval;
+			e->second.cb = std::move(cb);
+			place(timer, e->second);
+		}
+		else
+		{
+			entries_.erase(e);
+		}
+	}
+	return ran;
+}
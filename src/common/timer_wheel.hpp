@@ -0,0 +1,84 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_TIMER_WHEEL_HPP
+#define HEXCHAT_TIMER_WHEEL_HPP
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/* A hierarchical timer wheel: LEVELS wheels of SLOTS slots, one tick per
+ * millisecond on the lowest, each wheel above spanning a full turn of the
+ * one below. Adding and cancelling don't depend on how many timers there
+ * are, and advancing skips over stretches where nothing can be due, so a
+ * wheel left alone for hours costs nothing to catch up. Times are in
+ * milliseconds on whatever clock the caller uses, as long as it doesn't
+ * go backwards. */
+class timer_wheel
+{
+public:
+	typedef unsigned int id;	/* never 0 */
+	/* return true to run again interval ms later */
+	typedef std::function<bool()> callback;
+
+	enum { SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS, LEVELS = 4 };
+
+	explicit timer_wheel(std::int64_t now);
+
+	/* runs cb at due (or on the next advance if that's past); if
+	 * interval > 0 and cb returns true, again every interval ms */
+	id add(std::int64_t due, std::int64_t interval, callback cb);
+	/* false if it's not pending (anymore); safe from inside a callback */
+	bool cancel(id timer);
+	bool pending(id timer) const;
+	std::size_t size() const;
+
+	/* the earliest due time, -1 if nothing's pending */
+	std::int64_t next_due() const;
+
+	/* runs everything that's due by now, returns how many ran */
+	std::size_t advance(std::int64_t now);
+
+private:
+	struct entry
+	{
+		std::int64_t due;
+		std::int64_t interval;
+		callback cb;
+	};
+
+	/* cancelling doesn't look for the slot, so a slot can still hold ids
+	 * that are gone */
+	typedef std::vector<id> slot;
+
+	void place(id timer, entry &e);
+	void cascade(int level);
+	std::size_t run_slot();
+
+	std::int64_t current_;	/* the last tick that ran */
+	id next_id_;
+	std::unordered_map<id, entry> entries_;
+	std::array<std::array<slot, SLOTS>, LEVELS> wheels_;
+	std::array<std::size_t, LEVELS> counts_;	/* refs in each wheel */
+};
+
+#endif
@@ -0,0 +1,110 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "hexchat.hpp"
+#include "fe.hpp"
+#include "timers.hpp"
+
+namespace timers
+{
+	namespace
+	{
+		/* longest single wait handed to the main loop */
+		const std::int64_t MAX_SLEEP_MS = 24 * 60 * 60 * 1000;
+
+		std::int64_t now()
+		{
+			return g_get_monotonic_time () / 1000;
+		}
+
+		timer_wheel & wheel()
+		{
+			static timer_wheel wheel (now ());
+			return wheel;
+		}
+
+		int wake_tag = 0;
+		std::int64_t wake_at = -1;
+
+		void arm();
+
+		gboolean wake(gpointer)
+		{
+			wake_tag = 0;
+			wake_at = -1;
+			wheel ().advance (now ());
+			arm ();
+			return FALSE;
+		}
+
+		/* the main loop timeout follows the earliest timer */
+		void arm()
+		{
+			const auto due = wheel ().next_due ();
+			if (wake_tag && due == wake_at)
+				return;
+			if (wake_tag)
+			{
+				fe_timeout_remove (wake_tag);
+				wake_tag = 0;
+				wake_at = -1;
+			}
+			if (due < 0)
+				return;
+
+			const auto delay = std::min (std::max<std::int64_t> (due - now (), 0), MAX_SLEEP_MS);
+			wake_at = due;
+			wake_tag = fe_timeout_add (static_cast<int>(delay), (GSourceFunc)wake, nullptr);
+		}
+	}
+
+	handle add(int ms, std::function<bool()> cb)
+	{
+		/* 0 would make it a one-shot */
+		ms = std::max (ms, 1);
+		const auto timer = wheel ().add (now () + ms, ms, std::move (cb));
+		arm ();
+		return timer;
+	}
+
+	handle once(int ms, std::function<void()> cb)
+	{
+		const auto timer = wheel ().add (now () + ms, 0, [cb]{
+			cb ();
+			return false;
+		});
+		arm ();
+		return timer;
+	}
+
+	void remove(handle timer)
+	{
+		if (timer && wheel ().cancel (timer))
+			arm ();
+	}
+
+	bool pending(handle timer)
+	{
+		return timer && wheel ().pending (timer);
+	}
+}
@@ -0,0 +1,42 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_TIMERS_HPP
+#define HEXCHAT_TIMERS_HPP
+
+#include <functional>
+#include "timer_wheel.hpp"
+
+/* The core's housekeeping timers. They all live on one timer_wheel, and
+ * the main loop only has a single timeout, for whichever is due first, so
+ * an idle client isn't woken up by timers that have nothing to do. */
+namespace timers
+{
+	typedef timer_wheel::id handle;	/* 0 for none */
+
+	/* calls cb every ms milliseconds for as long as it returns true */
+	handle add(int ms, std::function<bool()> cb);
+	/* calls cb once, ms milliseconds from now */
+	handle once(int ms, std::function<void()> cb);
+	/* does nothing for 0 or a timer that's done already */
+	void remove(handle timer);
+	bool pending(handle timer);
+}
+
+#endif
@@ -0,0 +1,166 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#include <utility>
+#include <vector>
+
+#include "user_directory.hpp"
+
+user_info::user_info()
+	:hostname(),
+	servername(),
+	away(),
+	owner_(),
+	refs_()
+{}
+
+void intrusive_ptr_add_ref(user_info *info)
+{
+	++info->refs_;
+}
+
+void intrusive_ptr_release(user_info *info)
+{
+	if (--info->refs_ != 0)
+		return;
+	if (info->owner_)
+		info->owner_->release(info);
+	else
+		delete info;
+}
+
+user_directory::user_directory() = default;
+
+user_directory::~user_directory()
+{
+	/* the server goes after its sessions, so this is normally empty */
+	for (auto & item : by_key_)
+	{
+		item.second->owner_ = nullptr;
+		item.second->hostname = nullptr;
+		item.second->servername = nullptr;
+	}
+}
+
+user_directory::pointer user_directory::acquire(const std::string & key, const boost::string_ref & nick)
+{
+	auto & slot = by_key_[key];
+	if (!slot)
+	{
+		slot = new user_info;
+		slot->nick = nick.to_string();
+		slot->owner_ = this;
+		slot->key_ = key;
+	}
+	return pointer(slot);
+}
+
+user_info *user_directory::find(const std::string & key) const
+{
+	auto found = by_key_.find(key);
+	return found == by_key_.end() ? nullptr : found->second;
+}
+
+user_info *user_directory::rename(const std::string & old_key, const std::string & new_key,
+	const boost::string_ref & nick)
+{
+	auto found = by_key_.find(old_key);
+	if (found == by_key_.end())
+		return nullptr;
+
+	auto info = found->second;
+	info->nick = nick.to_string();
+	if (old_key != new_key)
+	{
+		by_key_.erase(found);
+		by_key_[new_key] = info;
+		info->key_ = new_key;
+	}
+	return info;
+}
+
+void user_directory::set_hostname(user_info & info, const boost::string_ref & hostname)
+{
+	if (info.hostname && *info.hostname == hostname)
+		return;
+	auto interned = intern(hostname);
+	unintern(info.hostname);
+	info.hostname = interned;
+}
+
+void user_directory::set_servername(user_info & info, const boost::string_ref & servername)
+{
+	if (info.servername && *info.servername == servername)
+		return;
+	auto interned = intern(servername);
+	unintern(info.servername);
+	info.servername = interned;
+}
+
+void user_directory::rehash(const std::function<std::string(const std::string &)> & fold)
+{
+	std::vector<user_info *> infos;
+	infos.reserve(by_key_.size());
+	for (auto & item : by_key_)
+		infos.push_back(item.second);
+
+	by_key_.clear();
+	for (auto info : infos)
+	{
+		info->key_ = fold(info->nick);
+		by_key_.emplace(info->key_, info);
+	}
+}
+
+std::size_t user_directory::size() const
+{
+	return by_key_.size();
+}
+
+std::size_t user_directory::strings() const
+{
+	return strings_.size();
+}
+
+void user_directory::release(user_info *info)
+{
+	auto found = by_key_.find(info->key_);
+	if (found != by_key_.end() && found->second == info)
+		by_key_.erase(found);
+	unintern(info->hostname);
+	unintern(info->servername);
+	delete info;
+}
+
+const std::string *user_directory::intern(const boost::string_ref & str)
+{
+	auto item = strings_.emplace(str.to_string(), 0).first;
+	++item->second;
+	return &item->first;
+}
+
+void user_directory::unintern(const std::string *str)
+{
+	if (!str)
+		return;
+	auto found = strings_.find(*str);
+	if (found != strings_.end() && --found->second == 0)
+		strings_.erase(found);
+}
@@ -0,0 +1,112 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#ifndef HEXCHAT_USER_DIRECTORY_HPP
+#define HEXCHAT_USER_DIRECTORY_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <boost/optional.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+#include <boost/utility/string_ref.hpp>
+
+class user_directory;
+
+/* Who a nick is. There is one of these per server and nick, shared by
+ * every channel the nick is in, so a user on 20 of our channels doesn't
+ * cost 20 copies of their host and realname. */
+struct user_info
+{
+	std::string nick;
+	const std::string *hostname;	/* user@host, interned, nullptr until known */
+	const std::string *servername;	/* interned, nullptr until known */
+	boost::optional<std::string> realname;
+	boost::optional<std::string> account;
+	bool away;
+
+	/* nick as the server's casemapping folds it */
+	const std::string & key() const
+	{
+		return key_;
+	}
+
+private:
+	friend class user_directory;
+	friend void intrusive_ptr_add_ref(user_info *info);
+	friend void intrusive_ptr_release(user_info *info);
+
+	user_info();
+	user_directory *owner_;
+	std::string key_;
+	std::size_t refs_;
+};
+
+void intrusive_ptr_add_ref(user_info *info);
+void intrusive_ptr_release(user_info *info);
+
+/* A server's user_infos by folded nick. An entry lives as long as some
+ * channel still holds a pointer to it. Hosts and servernames go through a
+ * refcounted string pool: a network has a few dozen servernames shared by
+ * thousands of users, and cloaked hosts repeat too. */
+class user_directory
+{
+public:
+	typedef boost::intrusive_ptr<user_info> pointer;
+
+	user_directory();
+	~user_directory();
+	user_directory(const user_directory &) = delete;
+	user_directory & operator=(const user_directory &) = delete;
+
+	/* the entry for key (nick as the server folds it), made if needed */
+	pointer acquire(const std::string & key, const boost::string_ref & nick);
+	user_info *find(const std::string & key) const;
+
+	/* the nick at old_key is now nick, nullptr if nobody had old_key */
+	user_info *rename(const std::string & old_key, const std::string & new_key,
+		const boost::string_ref & nick);
+
+	void set_hostname(user_info & info, const boost::string_ref & hostname);
+	void set_servername(user_info & info, const boost::string_ref & servername);
+
+	/* the casemapping changed, fold every nick again */
+	void rehash(const std::function<std::string(const std::string &)> & fold);
+
+	std::size_t size() const;
+	/* distinct hosts and servernames held */
+	std::size_t strings() const;
+
+private:
+	friend void intrusive_ptr_release(user_info *info);
+
+	void release(user_info *info);
+	const std::string *intern(const boost::string_ref & str);
+	void unintern(const std::string *str);
+
+	/* an entry whose folded nick collides with another one's (a rename
+	   onto a nick we still have, a casemapping change) isn't in here, it
+	   just lives until its last pointer goes */
+	std::unordered_map<std::string, user_info *> by_key_;
+	std::unordered_map<std::string, std::size_t> strings_;
+};
+
+#endif
@@ -24,6 +24,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <boost/utility/string_ref.hpp>
 
 #include "hexchat.hpp"
@@ -44,14 +45,13 @@ User::User()
 	hop(),
 	voice(),
 	me(),
-	away(),
 	selected()
 {}
 
 namespace{
 
 	static int
-		nick_cmp_az_ops(const std::locale &locale, const User & user1, const User & user2)
+		nick_cmp_az_ops(const User & user1, const User & user2)
 	{
 		unsigned int access1 = user1.access;
 		unsigned int access2 = user2.access;
@@ -68,30 +68,29 @@ namespace{
 					return 1;
 			}
 		}
-		auto& collate = std::use_facet<std::collate<char>>(locale);
-		return collate.compare(user1.nick.c_str(), user1.nick.c_str() + user1.nick.size(), user2.nick.c_str(), user2.nick.c_str() + user2.nick.size());
+		return user1.info->key().compare(user2.info->key());
 	}
 
 	static int
 		nick_cmp_alpha(struct User *user1, struct User *user2, server *serv)
 	{
-		return serv->compare(user1->nick, user2->nick);
+		return serv->compare(user1->info->nick, user2->info->nick);
 	}
 
 	static int
-		nick_cmp(const User &user1, const User &user2, const std::locale &locale)
+		nick_cmp(const User &user1, const User &user2)
 	{
-		auto& collate = std::use_facet<std::collate<char>>(locale);
+		/* the folded keys sort the way server::compare() does */
 		switch (prefs.hex_gui_ulist_sort)
 		{
 		case 0:
-			return nick_cmp_az_ops(locale, user1, user2);
+			return nick_cmp_az_ops(user1, user2);
 		case 1:
-			return collate.compare(user1.nick.c_str(), user1.nick.c_str() + user1.nick.size(), user2.nick.c_str(), user2.nick.c_str() + user2.nick.size());
+			return user1.info->key().compare(user2.info->key());
 		case 2:
-			return -1 * nick_cmp_az_ops(locale, user1, user2);
+			return -1 * nick_cmp_az_ops(user1, user2);
 		case 3:
-			return -1 * collate.compare(user1.nick.c_str(), user1.nick.c_str() + user1.nick.size(), user2.nick.c_str(), user2.nick.c_str() + user2.nick.size());
+			return -1 * user1.info->key().compare(user2.info->key());
 		default:
 			return -1;
 		}
@@ -103,27 +102,109 @@ namespace{
 		std::sort(
 			sess.usertree.begin(),
 			sess.usertree.end(),
-			[&sess](const std::unique_ptr<User> &a, const std::unique_ptr<User> &b)
+			[](const std::unique_ptr<User> &a, const std::unique_ptr<User> &b)
 		{
-			return nick_cmp(*a, *b, sess.server->current_locale()) < 0;
+			return nick_cmp(*a, *b) < 0;
 		});
 
 		std::sort(
 			sess.usertree_alpha.begin(),
 			sess.usertree_alpha.end(),
-			[&sess](const User* a, const User* b){
-			return sess.server->current_locale()(a->nick, b->nick);
+			[](const User* a, const User* b){
+			return a->info->key() < b->info->key();
 		});
 
+		const auto key = sess.server->casefold(nick);
 		auto result = std::find_if(
 			sess.usertree.cbegin(),
 			sess.usertree.cend(),
-			[nick, &sess](const std::unique_ptr<User> & ptr){
-			return sess.server->compare(nick, ptr->nick) == 0;
+			[&key](const std::unique_ptr<User> & ptr){
+			return ptr->info->key() == key;
 		});
 		return std::distance(sess.usertree.cbegin(), result);
 	}
 
+	/* strict weak ordering of usertree, as used by userlist_resort */
+	struct usertree_order
+	{
+		bool operator()(const std::unique_ptr<User> & a, const User * b) const
+		{
+			return nick_cmp(*a, *b) < 0;
+		}
+		bool operator()(const User * a, const std::unique_ptr<User> & b) const
+		{
+			return nick_cmp(*a, *b) < 0;
+		}
+	};
+
+	/* where is user in usertree? binary search first, then a plain scan */
+	static std::vector<std::unique_ptr<User>>::iterator
+		usertree_locate(session & sess, const User * user)
+	{
+		auto & tree = sess.usertree;
+		auto is_user = [user](const std::unique_ptr<User> & ptr){ return ptr.get() == user; };
+
+		const usertree_order order{};
+		auto range = std::equal_range(tree.begin(), tree.end(), user, order);
+		auto current = std::find_if(range.first, range.second, is_user);
+		if (current != range.second)
+			return current;
+
+		/* tree isn't in sort order any more (e.g. the sort pref changed) */
+		return std::find_if(tree.begin(), tree.end(), is_user);
+	}
+
+	/*
+	 * move a user whose access bits just changed from old_access to its new
+	 * place in usertree, without resorting everything. old_rows, if given,
+	 * is rotated the same way so it keeps mapping new rows to old ones.
+	 */
+	static void userlist_reposition(session & sess, User * user, unsigned int old_access,
+		std::vector<int> * old_rows)
+	{
+		auto & tree = sess.usertree;
+		const usertree_order order{};
+
+		/* look it up under the key it was sorted with */
+		const auto new_access = user->access;
+		user->access = old_access;
+		auto current = usertree_locate(sess, user);
+		user->access = new_access;
+		if (current == tree.end())
+			return;
+
+		if (old_rows && old_rows->size() != tree.size())
+		{
+			old_rows->resize(tree.size());
+			for (std::size_t i = 0; i < old_rows->size(); ++i)
+				(*old_rows)[i] = static_cast<int>(i);
+		}
+
+		/* rotate it into place among its new neighbours */
+		auto first = current;
+		auto middle = current + 1;
+		auto last = current + 1;
+		auto dest = std::upper_bound(tree.begin(), current, user, order);
+		if (dest != current)
+		{
+			first = dest;
+			middle = current;
+		}
+		else
+		{
+			first = current;
+			last = std::lower_bound(current + 1, tree.end(), user, order);
+		}
+		if (old_rows)
+		{
+			auto rows = old_rows->begin();
+			std::rotate(rows + std::distance(tree.begin(), first),
+				rows + std::distance(tree.begin(), middle),
+				rows + std::distance(tree.begin(), last));
+		}
+		std::rotate(first, middle, last);
+	}
+
 	/*
 	insert name in appropriate place in linked list. Returns row number or:
 	-1: duplicate
@@ -134,30 +215,52 @@ namespace{
 		auto result = std::find_if(
 			sess->usertree.cbegin(),
 			sess->usertree.cend(),
-			[sess, &newuser](const std::unique_ptr<User>& a){
-			return sess->server->compare(a->nick, newuser->nick) == 0;
+			[&newuser](const std::unique_ptr<User>& a){
+			return a->info == newuser->info;
 		});
 		if (result != sess->usertree.cend())
 		{
 			return -1;
 		}
 
-		const std::string& nick = newuser->nick;
+		const std::string& nick = newuser->info->nick;
 		sess->usertree.emplace_back(std::move(newuser));
 		sess->usertree_alpha.emplace_back(sess->usertree.back().get());
 		return userlist_resort(*sess, nick);
 	}
 } // end anonymous namespace
 
+/* info changed: redraw its row in every channel of serv but skip */
+static void
+userlist_rehash_info (const server &serv, const user_info &info, const session *skip)
+{
+	for (auto list = sess_list; list; list = g_slist_next (list))
+	{
+		auto sess = static_cast<session*>(list->data);
+		if (sess == skip || sess->server != &serv || sess->type != session::SESS_CHANNEL)
+			continue;
+		auto user = userlist_find (sess, info.nick);
+		if (user)
+			fe_userlist_rehash (sess, user);
+	}
+}
+
 void
-userlist_set_away (struct session *sess, const char nick[], bool away)
+userlist_set_away (const server &serv, const char nick[], bool away)
 {
-	auto user = userlist_find (sess, nick);
-	if (user)
+	auto info = serv.users.find (serv.casefold (nick));
+	if (!info || info->away == away)
+		return;
+
+	info->away = away;
+	for (auto list = sess_list; list; list = g_slist_next (list))
 	{
-		if (user->away != away)
+		auto sess = static_cast<session*>(list->data);
+		if (sess->server != &serv)
+			continue;
+		auto user = userlist_find (sess, nick);
+		if (user)
 		{
-			user->away = away;
 			/* rehash GUI */
 			fe_userlist_rehash (sess, user);
 			if (away)
@@ -167,19 +270,47 @@ userlist_set_away (struct session *sess, const char nick[], bool away)
 }
 
 void
-userlist_set_account (struct session *sess, const char nick[], const char account[])
+userlist_set_account (const server &serv, const char nick[], const char account[])
 {
-	auto user = userlist_find (sess, nick);
-	if (user)
+	auto info = serv.users.find (serv.casefold (nick));
+	if (!info)
+		return;
+
+	if (strcmp (account, "*") == 0)
+		info->account = boost::none;
+	else
+		info->account = std::string(account);
+
+	/* gui doesnt currently reflect login status, maybe later
+	fe_userlist_rehash (sess, user); */
+}
+
+/* fills in what we didn't know yet, true if the row looks different now */
+static bool
+userlist_fill_info (server &serv, user_info &info, const char hostname[], const char realname[],
+						  const char servername[], const char account[], unsigned int away)
+{
+	bool do_rehash = false;
+	if (!info.hostname && hostname)
 	{
-		if (strcmp (account, "*") == 0)
-			user->account = boost::none;
-		else
-			user->account = std::string(account);
-			
-		/* gui doesnt currently reflect login status, maybe later
-		fe_userlist_rehash (sess, user); */
+		if (prefs.hex_gui_ulist_show_hosts)
+			do_rehash = true;
+		serv.users.set_hostname (info, hostname);
+	}
+	if (!info.realname && realname && *realname)
+		info.realname = std::string(realname);
+	if (!info.servername && servername)
+		serv.users.set_servername (info, servername);
+	if (!info.account && account && strcmp (account, "0") != 0)
+		info.account = std::string(account);
+	if (away != 0xff)
+	{
+		bool actually_away = !!away;
+		if (info.away != actually_away)
+			do_rehash = true;
+		info.away = actually_away;
 	}
+	return do_rehash;
 }
 
 bool
@@ -189,36 +320,50 @@ userlist_add_hostname (struct session *sess, const char nick[], const char hostn
 	auto user = userlist_find (sess, nick);
 	if (user)
 	{
-		bool do_rehash = false;
-		if (!user->hostname && hostname)
-		{
-			if (prefs.hex_gui_ulist_show_hosts)
-				do_rehash = true;
-			user->hostname = hostname;
-		}
-		if (!user->realname && realname && *realname)
-			user->realname = std::string(realname);
-		if (!user->servername && servername)
-			user->servername = std::string(servername);
-		if (!user->account && account && strcmp (account, "0") != 0)
-			user->account = std::string(account);
-		if (away != 0xff)
-		{
-			bool actually_away = !!away;
-			if (user->away != actually_away)
-				do_rehash = true;
-			user->away = actually_away;
-		}
+		bool do_rehash = userlist_fill_info (*sess->server, *user->info, hostname, realname, servername, account, away);
 
 		fe_userlist_update (sess, user);
 		if (do_rehash)
+		{
 			fe_userlist_rehash (sess, user);
+			userlist_rehash_info (*sess->server, *user->info, sess);
+		}
 
 		return true;
 	}
 	return false;
 }
 
+void
+userlist_apply_who (session *sess)
+{
+	userlist_moves moves;
+	for (const auto & reply : sess->who_replies)
+	{
+		auto user = userlist_find (sess, reply.nick);
+		if (!user)
+			continue;	/* left or changed nick since */
+
+		auto str_or_null = [](const std::string & s){ return s.empty () ? nullptr : s.c_str (); };
+		if (userlist_fill_info (*sess->server, *user->info, str_or_null (reply.hostname), str_or_null (reply.realname),
+									  str_or_null (reply.servername), str_or_null (reply.account), reply.away))
+		{
+			moves.changed.push_back (user);
+			fe_userlist_update (sess, user);
+		}
+	}
+	/* the same people in our other channels look different too */
+	for (auto user : moves.changed)
+		userlist_rehash_info (*sess->server, *user->info, sess);
+
+	/* a 5000 user channel shouldn't keep this much around */
+	decltype(sess->who_replies) ().swap (sess->who_replies);
+
+	/* nobody moved, the frontend just redraws the rows that changed */
+	if (!moves.changed.empty ())
+		fe_userlist_reorder (sess, moves);
+}
+
 void
 userlist_free (session &sess)
 {
@@ -243,13 +388,17 @@ userlist_clear (session *sess)
 
 struct User * userlist_find(struct session *sess, const boost::string_ref & name)
 {
-	auto result = std::find_if(
+	/* usertree_alpha is kept sorted by folded nick, so fold this one once
+	   and the rest is byte compares */
+	const auto key = sess->server->casefold(name);
+	auto result = std::lower_bound(
 		sess->usertree_alpha.cbegin(),
 		sess->usertree_alpha.cend(),
-		[sess, name](const User* u){
-			return sess->server->compare(name, u->nick) == 0;
+		key,
+		[](const User* u, const std::string & key){
+			return u->info->key() < key;
 		});
-	if (result != sess->usertree_alpha.cend())
+	if (result != sess->usertree_alpha.cend() && (*result)->info->key() == key)
 		return *result;
 
 	return nullptr;
@@ -294,23 +443,26 @@ update_counts (session *sess, struct User *user, char prefix,
 	}
 }
 
-void
-userlist_update_mode (session *sess, const char name[], char mode, char sign)
+int
+userlist_row (session *sess, const struct User *user)
 {
-	auto result = std::find_if(
-		sess->usertree.begin(),
-		sess->usertree.end(),
-		[sess, name](const std::unique_ptr<User> &u){
-		return sess->server->compare(name, u->nick) == 0;
-	});
-	if (result == sess->usertree.end())
-		return;
+	auto found = usertree_locate (*sess, user);
+	if (found == sess->usertree.end())
+		return -1;
+	return static_cast<int>(std::distance (sess->usertree.begin(), found));
+}
 
-	User * user = result->get();
+struct User *
+userlist_apply_mode (session *sess, const char name[], char mode, char sign, userlist_moves & moves)
+{
+	auto user = userlist_find (sess, name);
+	if (!user)
+		return nullptr;
 
 	/* which bit number is affected? */
 	char prefix;
 	auto access = mode_access (sess->server, mode, &prefix);
+	const auto old_access = user->access;
 	bool level = false;
 	int offset = 0;
 	if (sign == '+')
@@ -336,30 +488,60 @@ userlist_update_mode (session *sess, const char name[], char mode, char sign)
 
 	/* update the various counts using the CHANGED prefix only */
 	update_counts (sess, user, prefix, level, offset);
-	
-	int pos = userlist_resort(*sess, user->nick);
 
-	/* let GTK move it too */
-	fe_userlist_move (sess, user, pos);
+	if (user->access != old_access)
+		userlist_reposition (*sess, user, old_access, &moves.old_rows);
+	moves.changed.push_back (user);
+
+	return user;
+}
+
+void
+userlist_modes_applied (session *sess, const userlist_moves & moves)
+{
+	if (moves.changed.empty())
+		return;
+
+	/* let GTK move them too, all in one go */
+	fe_userlist_reorder (sess, moves);
 	fe_userlist_numbers (*sess);
 }
 
+void
+userlist_update_mode (session *sess, const char name[], char mode, char sign)
+{
+	userlist_moves moves;
+	if (userlist_apply_mode (sess, name, mode, sign, moves))
+		userlist_modes_applied (sess, moves);
+}
+
 bool
 userlist_change(struct session *sess, const std::string & oldname, const std::string & newname)
 {
+	/* the first channel renames it for all of them, so the caller has to
+	   change every channel of the server before anything looks them up */
+	auto & serv = *sess->server;
+	const auto new_key = serv.casefold(newname);
+	auto info = serv.users.rename(serv.casefold(oldname), new_key, newname);
+	if (!info)
+		info = serv.users.find(new_key);
+	if (!info)
+		return false;
+
+	/* by pointer, the name usertree_alpha is sorted by just changed */
 	auto user = std::find_if(
 		sess->usertree.begin(),
 		sess->usertree.end(),
-		[sess, oldname](const std::unique_ptr<User> &u){
-			return sess->server->compare(oldname, u->nick) == 0;
+		[info](const std::unique_ptr<User> &u){
+			return u->info.get() == info;
 		});
 	if (user == sess->usertree.end())
 		return false;
 
-	user->get()->nick = newname;
+	const int old_pos = static_cast<int>(std::distance(sess->usertree.begin(), user));
 	User* user_ref = user->get();
-	int pos = userlist_resort(*sess, user_ref->nick);
-	fe_userlist_move(sess, user_ref, pos);
+	int pos = userlist_resort(*sess, user_ref->info->nick);
+	fe_userlist_move(sess, user_ref, old_pos, pos);
 	fe_userlist_numbers(*sess);
 
 	return true;
@@ -387,23 +569,26 @@ userlist_remove_user (struct session *sess, struct User *user)
 		sess->hops--;
 	sess->total--;
 	fe_userlist_numbers (*sess);
-	fe_userlist_remove (sess, user);
 
 	if (user == sess->me)
 		sess->me = nullptr;
 
+	/* the GUI reads straight out of usertree, so take the user out
+	   before telling it, but keep it alive until it has been told */
+	auto found = usertree_locate (*sess, user);
+	if (found == sess->usertree.end())
+		return;
+	const int row = static_cast<int>(std::distance (sess->usertree.begin(), found));
+	std::unique_ptr<User> removed (std::move (*found));
+	sess->usertree.erase (found);
 	sess->usertree_alpha.erase(
 		std::remove(
 			sess->usertree_alpha.begin(),
 			sess->usertree_alpha.end(),
-			user));
-	sess->usertree.erase(
-		std::remove_if(
-			sess->usertree.begin(),
-			sess->usertree.end(),
-			[user](const std::unique_ptr<User>& ptr){
-				return user == ptr.get();
-			}));
+			user),
+		sess->usertree_alpha.end());
+
+	fe_userlist_remove (sess, user, row);
 }
 
 void
@@ -423,20 +608,22 @@ userlist_add (struct session *sess, const char name[], const char hostname[],
 	if (prefix_chars)
 		user->prefix[0] = name[0];
 
-	/* add it to our linked list */
+	/* the same user in another channel already has an entry */
+	auto & serv = *sess->server;
+	const char *nick = name + prefix_chars;
+	user->info = serv.users.acquire (serv.casefold (nick), nick);
 	if (hostname)
-		user->hostname = std::string(hostname);
-	user->nick = (name + prefix_chars);
+		serv.users.set_hostname (*user->info, hostname);
 	/* is it me? */
-	if (!sess->server->compare (user->nick, sess->server->nick))
+	if (!serv.compare (user->info->nick, serv.nick))
 		user->me = true;
 	/* extended join info */
-	if (sess->server->have_extjoin)
+	if (serv.have_extjoin)
 	{
 		if (account && *account)
-			user->account = std::string (account);
+			user->info->account = std::string (account);
 		if (realname && *realname)
-			user->realname = std::string (realname);
+			user->info->realname = std::string (realname);
 	}
 
 	User * user_ref = user.get();
@@ -473,6 +660,34 @@ userlist_rehash (session *sess)
 		fe_userlist_rehash(sess, user);
 }
 
+void
+userlist_refold (session &sess)
+{
+	auto & tree = sess.usertree;
+	/* old_rows[new row] = old row, as fe_userlist_reorder wants it */
+	std::vector<int> order (tree.size ());
+	std::iota (order.begin (), order.end (), 0);
+	std::stable_sort (order.begin (), order.end (), [&tree](int a, int b){
+		return nick_cmp (*tree[a], *tree[b]) < 0;
+	});
+
+	std::vector<std::unique_ptr<User>> sorted;
+	sorted.reserve (tree.size ());
+	for (auto row : order)
+		sorted.emplace_back (std::move (tree[row]));
+	tree.swap (sorted);
+
+	std::sort (sess.usertree_alpha.begin (), sess.usertree_alpha.end (),
+		[](const User* a, const User* b){ return a->info->key() < b->info->key(); });
+
+	if (!tree.empty ())
+	{
+		userlist_moves moves;
+		moves.old_rows = std::move (order);
+		fe_userlist_reorder (&sess, moves);
+	}
+}
+
 GSList *
 userlist_flat_list (session *sess)
 {
@@ -537,14 +752,14 @@ public:
 			this->users_.end(),
 			[this](const std::unique_ptr<User> &a, const std::unique_ptr<User> &b)
 		{
-			return nick_cmp(*a, *b, this->locale_) < 0;
+			return nick_cmp(*a, *b) < 0;
 		});
 
 		std::sort(
 			this->users_alpha_.begin(),
 			this->users_alpha_.end(),
 			[this](const User* a, const User* b){
-			return locale_(a->nick, b->nick);
+			return locale_(a->info->nick, b->info->nick);
 			}
 		);
 	}
@@ -555,14 +770,14 @@ public:
 			this->users_.cbegin(),
 			this->users_.cend(),
 			[&user, this](const std::unique_ptr<User>& a){
-				return locale_(a->nick, user->nick);
+				return locale_(a->info->nick, user->info->nick);
 			});
 		if (result != this->users_.cend())
 		{
 			return std::make_pair(false, 0);
 		}
 
-		const std::string & nick = user->nick;
+		const std::string & nick = user->info->nick;
 		this->users_.emplace_back(std::move(user));
 		this->users_alpha_.emplace_back(this->users_.back().get());
 		this->sort();
@@ -576,7 +791,7 @@ public:
 			users_alpha_.cbegin(),
 			users_alpha_.cend(),
 			[&nick, this](const User* u){
-			return this->locale_(nick, u->nick);
+			return this->locale_(nick, u->info->nick);
 		});
 		if (result != users_alpha_.cend())
 			return boost::optional<const User&>(*(*result));
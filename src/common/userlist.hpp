@@ -25,28 +25,27 @@
 #include <locale>
 #include <memory>
 #include <string>
+#include <vector>
 #include <boost/optional.hpp>
 #include "proto-irc.hpp"
 #include "sessfwd.hpp"
 #include "serverfwd.hpp"
+#include "user_directory.hpp"
 
+/* one channel's member; who they are is in info, shared with the
+   server's other channels */
 struct User
 {
 	User();
-	std::string nick;
-	boost::optional<std::string> hostname;
-	boost::optional<std::string> realname;
-	boost::optional<std::string> servername;
-	boost::optional<std::string> account;
+	user_directory::pointer info;
 	time_t lasttalk;
 	unsigned int access;	/* axs bit field */
 	char prefix[2]; /* @ + % */
-	bool op;
-	bool hop;
-	bool voice;
-	bool me;
-	bool away;
-	bool selected;
+	bool op : 1;
+	bool hop : 1;
+	bool voice : 1;
+	bool me : 1;
+	bool selected : 1;
 };
 
 class userlist
@@ -72,8 +71,11 @@ enum{ USERACCESS_SIZE = 12 };
 bool userlist_add_hostname (session *sess, const char nick[],
 									const char hostname[], const char realname[],
 									const char servername[], const char account[], unsigned int away);
-void userlist_set_away (session *sess, const char nick[], bool away);
-void userlist_set_account (session *sess, const char nick[], const char account[]);
+/* the WHO is over, apply session::who_replies and tell the frontend once */
+void userlist_apply_who (session *sess);
+/* for the nick in every channel, they're the same user everywhere */
+void userlist_set_away (const server &serv, const char nick[], bool away);
+void userlist_set_account (const server &serv, const char nick[], const char account[]);
 struct User *userlist_find(session *sess, const boost::string_ref & name);
 struct User *userlist_find_global (server *serv, const std::string & name);
 void userlist_clear (session *sess);
@@ -84,8 +86,21 @@ bool userlist_remove (session *sess, const char name[]);
 void userlist_remove_user (session *sess, struct User *user);
 bool userlist_change (session *sess, const std::string & oldname, const std::string & newname);
 void userlist_update_mode (session *sess, const char name[], char mode, char sign);
+/* rows touched by a batch of mode changes, old_rows[new row] = old row */
+struct userlist_moves
+{
+	std::vector<int> old_rows;	/* empty while nobody has moved */
+	std::vector<struct User*> changed;
+};
+/* for a whole MODE line: apply each change, then tell the frontend once */
+struct User *userlist_apply_mode (session *sess, const char name[], char mode, char sign, userlist_moves & moves);
+void userlist_modes_applied (session *sess, const userlist_moves & moves);
+/* position of user in session::usertree, -1 if it isn't there */
+int userlist_row (session *sess, const struct User *user);
 GSList *userlist_flat_list (session *sess);
 GList *userlist_double_list (session *sess);
 void userlist_rehash (session *sess);
+/* the server's casemapping changed and the keys with it, sort again */
+void userlist_refold (session &sess);
 
 #endif
@@ -28,12 +28,13 @@
 #include <numeric>
 #include <string>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <ctime>
-#include <iomanip>
 #include <boost/utility/string_ref.hpp>
 
 #ifndef WIN32
@@ -49,7 +50,9 @@
 #include "../common/hexchatc.hpp"
 #include "../common/server.hpp"
 #include "../common/userlist.hpp"
+#include "../common/user_directory.hpp"
 #include "../common/session.hpp"
+#include "../common/util.hpp"
 #include "gtkutil.hpp"
 #include "gtk_helpers.hpp"
 #include "maingui.hpp"
@@ -119,6 +122,8 @@ enum
 	MASK_COLUMN,
 	FROM_COLUMN,
 	DATE_COLUMN,
+	USERS_COLUMN,	/* how many in the channel it matches */
+	STAMP_COLUMN,	/* not shown, DATE_COLUMN sorts by it */
 	N_COLUMNS
 };
 
@@ -213,17 +218,84 @@ yes:
 }
 }
 
+static void
+banlist_add_row (session *sess, const mode_info &mode, const char *mask, const char *who,
+					  const char *when, time_t stamp)
+{
+	GtkListStore *store = get_store (sess);
+	GtkTreeIter iter;
+
+	gtk_list_store_append (store, &iter);
+	gtk_list_store_set (store, &iter, TYPE_COLUMN, _(mode.type.c_str()), MASK_COLUMN, mask,
+					FROM_COLUMN, who, DATE_COLUMN, when, STAMP_COLUMN, static_cast<gint64>(stamp), -1);
+	sess->res->banlist->line_ct++;
+}
+
+/* fills in USERS_COLUMN from the core's copy of the lists, matching every
+   user against a list at once instead of every mask against every user */
+static void
+banlist_count_users (banlist_info *banl)
+{
+	session *sess = banl->sess;
+	std::array<std::unordered_map<std::string, int>, MODE_CT> hits;
+	std::vector<std::size_t> matched;
+
+	for (int i = 0; i < MODE_CT; i++)
+	{
+		const auto & entries = sess->bans.entries (static_cast<banlist::list_type>(i));
+		if (entries.empty ())
+			continue;
+
+		banlist::matcher matcher (entries, sess->server->casemapping ());
+		std::vector<int> counts (entries.size ());
+		for (const auto & user : sess->usertree)
+		{
+			/* no user@host until the WHO is in */
+			if (!user->info->hostname)
+				continue;
+			const boost::string_ref userhost = *user->info->hostname;
+			const auto at = userhost.find ('@');
+			if (at == boost::string_ref::npos)
+				continue;
+			matcher.match (user->info->nick, userhost.substr (0, at), userhost.substr (at + 1), matched);
+			for (auto entry : matched)
+				counts[entry]++;
+		}
+		for (std::size_t entry = 0; entry < entries.size (); entry++)
+			hits[i][entries[entry].mask] = counts[entry];
+	}
+
+	auto model = GTK_TREE_MODEL (get_store (sess));
+	GtkTreeIter iter;
+	if (!gtk_tree_model_get_iter_first (model, &iter))
+		return;
+	do
+	{
+		gchar *type_str, *mask_str;
+		gtk_tree_model_get (model, &iter, TYPE_COLUMN, &type_str, MASK_COLUMN, &mask_str, -1);
+		glib_string type (type_str), mask (mask_str);
+		for (int i = 0; i < MODE_CT; i++)
+		{
+			if (std::strcmp (type.get (), _(modes[i].type.c_str ())))
+				continue;
+			auto found = hits[i].find (mask.get ());
+			gtk_list_store_set (GTK_LIST_STORE (model), &iter, USERS_COLUMN,
+				found != hits[i].end () ? found->second : 0, -1);
+			break;
+		}
+	}
+	while (gtk_tree_model_iter_next (model, &iter));
+}
+
 /* fe_add_ban_list() and fe_ban_list_end() return true if consumed, false otherwise */
 gboolean
-fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, int rplcode)
+fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, time_t stamp, int rplcode)
 {
 	banlist_info *banl = sess->res->banlist;
 
 	if (!banl)
 		return false;
 	int i;
-	GtkListStore *store;
-	GtkTreeIter iter;
 
 	for (i = 0; i < MODE_CT; i++)
 		if (modes[i].code == rplcode)
@@ -235,13 +307,7 @@ fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, int rp
 	}
 	if (banl->pending & 1<<i)
 	{
-		store = get_store (sess);
-		gtk_list_store_append (store, &iter);
-
-		gtk_list_store_set (store, &iter, TYPE_COLUMN, _(modes[i].type.c_str()), MASK_COLUMN, mask,
-						FROM_COLUMN, who, DATE_COLUMN, when, -1);
-
-		banl->line_ct++;
+		banlist_add_row (sess, modes[i], mask, who, when, stamp);
 		return true;
 	}
 	else return false;
@@ -329,6 +395,7 @@ fe_ban_list_end (struct session *sess, int rplcode)
 	if (banl->pending & modes[i].bit)
 	{
 		banl->pending &= ~modes[i].bit;
+		banlist_count_users (banl);
 		if (!banl->pending)
 		{
 			gtk_widget_set_sensitive (banl->but_refresh, true);
@@ -423,11 +490,39 @@ banlist_select_changed (GtkWidget *item, banlist_info *banl)
 	banlist_sensitize (banl);
 }
 
+/* lists the core already has in full are shown from there, the others
+   are asked for */
+static void
+banlist_show_cached (banlist_info *banl)
+{
+	session *sess = banl->sess;
+
+	for (int i = 0; i < MODE_CT; i++)
+	{
+		const auto type = static_cast<banlist::list_type>(i);
+		if (!(banl->pending & 1<<i) || !sess->bans.complete (type))
+			continue;
+		for (const auto & ban : sess->bans.entries (type))
+		{
+			char when[64] = "";
+			if (ban.set_at > 0)
+			{
+				safe_strcpy (when, std::ctime (&ban.set_at), sizeof (when));
+				auto nl = std::strchr (when, '\n');
+				if (nl)
+					*nl = 0;
+			}
+			banlist_add_row (sess, modes[i], ban.mask.c_str (), ban.setter.c_str (), when, ban.set_at);
+		}
+		banl->pending &= ~(1<<i);
+	}
+}
+
 /**
  *  * Performs the actual refresh operations.
  *  */
 static void
-banlist_do_refresh (banlist_info *banl)
+banlist_do_refresh (banlist_info *banl, bool use_cache)
 {
 	session *sess = banl->sess;
 	
@@ -445,6 +540,13 @@ banlist_do_refresh (banlist_info *banl)
 		gtk_list_store_clear (store);
 		banl->line_ct = 0;
 		banl->pending = banl->checked;
+		if (use_cache)
+		{
+			banlist_show_cached (banl);
+			banlist_count_users (banl);
+			if (!banl->pending)
+				banlist_sensitize (banl);
+		}
 		if (banl->pending)
 		{
 			for (int i = 0; i < MODE_CT; i++)
@@ -471,7 +573,7 @@ banlist_refresh (GtkWidget *, banlist_info *banl)
 	   *          * or apply for the first time if the list has not yet been
 	   *          * received.
 	   *          */
-	banlist_do_refresh (banl);
+	banlist_do_refresh (banl, false);
 }
 
 static int
@@ -532,7 +634,7 @@ banlist_unban (GtkWidget * wid, banlist_info *banl)
 		return;
 	}
 
-	banlist_do_refresh (banl);
+	banlist_do_refresh (banl, false);
 }
 
 static void
@@ -627,82 +729,18 @@ banlist_toggle (GtkWidget *item, gpointer data)
 	{
 		banl->checked &= ~bit;
 		banl->checked |= (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (item)))? bit: 0;
-		banlist_do_refresh (banl);
+		banlist_do_refresh (banl, true);
 	}
 }
 
-/* NOTICE:  The official strptime() is not available on all platforms so
- * I've implemented a special version here.  The official version is
- * vastly more general than this:  it uses locales for weekday and month
- * names and its second arg is a format character-string.  This special
- * version depends on the format returned by ctime(3) whose manpage
- * says it returns:
- *     "a null-terminated string of the form "Wed Jun 30 21:49:08 1993\n"
- *
- * If the real strpftime() comes available, use this format string:
- *		#define DATE_FORMAT "%a %b %d %T %Y"
- */
-//static void
-//banlist_strptime (char *ti, struct tm *tm)
-//{
-//	/* Expect something like "Sat Mar 16 21:24:27 2013" */
-//	static char *mon[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
-//								  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec", nullptr };
-//	int M = -1, d = -1, h = -1, m = -1, s = -1, y = -1;
-//
-//	if (*ti == 0)
-//	{
-//		memset (tm, 0, sizeof *tm);
-//		return;
-//	}
-//	/* No need to supply tm->tm_wday; mktime() doesn't read it */
-//	ti += 4;
-//	while ((mon[++M]))
-//		if (strncmp (ti, mon[M], 3) == 0)
-//			break;
-//	ti += 4;
-//
-//	d = strtol (ti, &ti, 10);
-//	h = strtol (++ti, &ti, 10);
-//	m = strtol (++ti, &ti, 10);
-//	s = strtol (++ti, &ti, 10);
-//	y = strtol (++ti, nullptr, 10) - 1900;
-//
-//	tm->tm_sec = s;
-//	tm->tm_min = m;
-//	tm->tm_hour = h;
-//	tm->tm_mday = d;
-//	tm->tm_mon = M;
-//	tm->tm_year = y;
-//}
-
-namespace banlist{
-static time_t
-get_time(const std::string& timestr)
-{
-	const char DATE_FORMAT[] = "%a %b %d %T %Y";
-	std::tm t{};
-#if defined(__GNUC__) && (__GNUC__ <= 4 && __GNUC_MINOR__ < 10)
-	strptime(timestr.c_str(), DATE_FORMAT, &t);
-#else
-	std::istringstream buffer(timestr);
-	buffer >> std::get_time(&t, DATE_FORMAT);
-#endif
-	return std::mktime(&t);
-}
-}
+/* newest first, by the time the core read off the reply */
 gint
 banlist_date_sort (GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b, gpointer)
 {
-	/*struct tm tm1, tm2;*/
-	char *time1, *time2;
+	gint64 t1, t2;
 
-	gtk_tree_model_get(model, a, DATE_COLUMN, &time1, -1);
-	gtk_tree_model_get(model, b, DATE_COLUMN, &time2, -1);
-	/*banlist_strptime (time1, &tm1);
-	banlist_strptime (time2, &tm2);*/
-	auto t1 = banlist::get_time(time1);
-	auto t2 = banlist::get_time(time2);
+	gtk_tree_model_get(model, a, STAMP_COLUMN, &t1, -1);
+	gtk_tree_model_get(model, b, STAMP_COLUMN, &t2, -1);
 
 	if (t1 < t2) return 1;
 	if (t1 == t2) return 0;
@@ -719,7 +757,7 @@ banlist_treeview_new (GtkWidget *box, banlist_info *banl)
 	GtkTreeSortable *sortable;
 
 	store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
-										 G_TYPE_STRING, G_TYPE_STRING);
+										 G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT, G_TYPE_INT64);
 	g_return_val_if_fail (store != nullptr, nullptr);
 
 	sortable = GTK_TREE_SORTABLE (store);
@@ -729,7 +767,8 @@ banlist_treeview_new (GtkWidget *box, banlist_info *banl)
 										  TYPE_COLUMN, _("Type"),
 										  MASK_COLUMN, _("Mask"),
 										  FROM_COLUMN, _("From"),
-										  DATE_COLUMN, _("Date"), -1);
+										  DATE_COLUMN, _("Date"),
+										  USERS_COLUMN, _("Users"), -1);
 	g_signal_connect (G_OBJECT (view), "button-press-event", G_CALLBACK (banlist_button_pressed), nullptr);
 
 	col = gtk_tree_view_get_column (GTK_TREE_VIEW (view), MASK_COLUMN);
@@ -755,6 +794,10 @@ banlist_treeview_new (GtkWidget *box, banlist_info *banl)
 	gtk_tree_view_column_set_sizing (col, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
 	gtk_tree_view_column_set_resizable (col, true);
 
+	col = gtk_tree_view_get_column (GTK_TREE_VIEW (view), USERS_COLUMN);
+	gtk_tree_view_column_set_alignment (col, 0.5);
+	gtk_tree_view_column_set_sort_column_id (col, USERS_COLUMN);
+
 	select = gtk_tree_view_get_selection (GTK_TREE_VIEW (view));
 	g_signal_connect (G_OBJECT (select), "changed", G_CALLBACK (banlist_select_changed), banl);
 	gtk_tree_selection_set_mode (select, GTK_SELECTION_MULTIPLE);
@@ -855,7 +898,7 @@ banlist_opengui (struct session *sess)
 
 	banl->but_refresh = gtkutil_button(bbox, GTK_STOCK_REFRESH, 0, G_CALLBACK(banlist_refresh), banl, _("Refresh"));
 
-	banlist_do_refresh (banl);
+	banlist_do_refresh (banl, true);
 
 	gtk_widget_show_all (banl->window);
 }
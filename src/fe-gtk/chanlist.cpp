@@ -19,12 +19,16 @@
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #endif
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <ctime>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 #include <boost/utility/string_ref.hpp>
 
 #ifdef WIN32
@@ -44,6 +48,7 @@
 #include "../common/util.hpp"
 #include "../common/fe.hpp"
 #include "../common/server.hpp"
+#include "../common/chanlist-store.hpp"
 #include "gtkutil.hpp"
 #include "maingui.hpp"
 #include "menu.hpp"
@@ -69,23 +74,6 @@ get_model(server_gui & gui)
 	return gtk_tree_view_get_model(GTK_TREE_VIEW(gui.chanlist_list));
 }
 
-static bool
-chanlist_match (const server_gui &gui, const std::string& str)
-{
-	switch (gui.chanlist_search_type)
-	{
-	case 1:
-		return match (gtk_entry_get_text (GTK_ENTRY (gui.chanlist_wild)), str.c_str());
-	case 2:
-		if (!gui.have_regex)
-			return false;
-
-		return g_regex_match (gui.chanlist_match_regex, str.c_str(), static_cast<GRegexMatchFlags>(0), NULL) ? true : false;
-	default:	/* case 0: */
-		return nocasestrstr (str.c_str(), gtk_entry_get_text (GTK_ENTRY (gui.chanlist_wild))) ? true : false;
-	}
-}
-
 /**
  * Updates the caption to reflect the number of users and channels
  */
@@ -132,55 +120,67 @@ chanlist_reset_counters (server_gui &gui)
 	chanlist_update_buttons (gui);
 }
 
-/* free up our entire linked list and all the nodes */
+/* swap in a new set of visible rows. The view is detached while we do it,
+   which is far cheaper than a row-deleted/row-inserted signal per row */
 
 static void
-chanlist_data_free (server_gui &gui)
+chanlist_publish (server_gui &gui, chanlist::snapshot snap, std::vector<chanlist::row_id> rows)
 {
-	if (gui.chanlist_data_stored_rows)
-	{
-		for (GSList * rows = gui.chanlist_data_stored_rows; rows != NULL;
-			  rows = rows->next)
-		{
-			chanlistrow * data = static_cast<chanlistrow*>(rows->data);
-			delete data;
-		}
+	auto view = GTK_TREE_VIEW (gui.chanlist_list);
+	auto model = get_model (gui);
 
-		g_slist_free (gui.chanlist_data_stored_rows);
-		gui.chanlist_data_stored_rows = NULL;
-	}
+	g_object_ref (model);
+	gtk_tree_view_set_model (view, NULL);
+	custom_list_set_rows (CUSTOM_LIST (model), std::move (snap), std::move (rows));
+	gtk_tree_view_set_model (view, model);
+	g_object_unref (model);
+}
+
+/* what the search widgets currently ask for */
 
-	g_slist_free (gui.chanlist_pending_rows);
-	gui.chanlist_pending_rows = NULL;
+static chanlist::filter
+chanlist_current_filter (server_gui &gui)
+{
+	chanlist::filter flt;
+	flt.min_users = std::max (gui.chanlist_minusers, 0);
+	flt.max_users = std::max (gui.chanlist_maxusers, 0);
+	flt.type = static_cast<chanlist::filter::search_type>(gui.chanlist_search_type);
+	flt.pattern = gtk_entry_get_text (GTK_ENTRY (gui.chanlist_wild));
+	if (gui.have_regex)
+		flt.regex.reset (g_regex_ref (gui.chanlist_match_regex), g_regex_unref);
+	flt.match_channel = !!gui.chanlist_match_wants_channel;
+	flt.match_topic = !!gui.chanlist_match_wants_topic;
+
+	auto model = CUSTOM_LIST (get_model (gui));
+	flt.sort = static_cast<chanlist::filter::sort_column>(model->sort_id);
+	flt.descending = model->sort_order == GTK_SORT_DESCENDING;
+	return flt;
 }
 
-/* add any rows we received from the server in the last 0.25s to the GUI */
+/* filter (and sort) every row we have, replacing what's shown */
 
 static void
-chanlist_flush_pending (server_gui &gui)
+chanlist_filter_all (server_gui &gui)
 {
-	GSList *list = gui.chanlist_pending_rows;
-	GtkTreeModel *model;
-	chanlistrow *row;
+	gui.chanlist_worker->submit (gui.chanlist_store->snap (), chanlist_current_filter (gui), 0, true);
+	gui.chanlist_filter_busy = true;
+}
 
-	if (!list)
+/* send rows we received from the server since the last time to the filter */
+
+static void
+chanlist_flush_pending (server_gui &gui)
+{
+	if (gui.chanlist_filter_busy || gui.chanlist_rows_filtered >= gui.chanlist_store->size ())
 	{
 		if (gui.chanlist_caption_is_stale)
 			chanlist_update_caption (gui);
 		return;
 	}
-	model = get_model (gui);
-
-	while (list)
-	{
-		row = static_cast<chanlistrow*>(list->data);
-		custom_list_append (CUSTOM_LIST (model), row);
-		list = list->next;
-	}
 
-	g_slist_free (gui.chanlist_pending_rows);
-	gui.chanlist_pending_rows = NULL;
-	chanlist_update_caption (gui);
+	gui.chanlist_worker->submit (gui.chanlist_store->snap (), chanlist_current_filter (gui),
+										  gui.chanlist_rows_filtered, false);
+	gui.chanlist_filter_busy = true;
 }
 
 static gboolean
@@ -190,85 +190,44 @@ chanlist_timeout (server *serv)
 	return TRUE;
 }
 
-/**
- * Places a data row into the gui GtkTreeView, if and only if the row matches
- * the user and regex/search requirements.
- */
+/* the worker thread is done, show what it found */
+
 static void
-chanlist_place_row_in_gui (server_gui &gui, chanlistrow *next_row, gboolean force)
+chanlist_filter_done (server_gui &gui, chanlist::result && res)
 {
-	GtkTreeModel *model;
-
-	/* First, update the 'found' counter values */
-	gui.chanlist_users_found_count += next_row->users;
-	gui.chanlist_channels_found_count++;
-
-	if (gui.chanlist_channels_shown_count == 1)
-		/* join & save buttons become live */
-		chanlist_update_buttons (gui);
-
-	if (next_row->users < gui.chanlist_minusers)
-	{
-		gui.chanlist_caption_is_stale = true;
+	/* something newer is on its way */
+	if (res.generation != gui.chanlist_worker->generation ())
 		return;
-	}
+	gui.chanlist_filter_busy = false;
 
-	if (next_row->users > gui.chanlist_maxusers
-		 && gui.chanlist_maxusers > 0)
+	const auto shown = static_cast<guint>(res.rows.size ());
+	const auto users_shown = static_cast<guint>(res.users_shown);
+	gui.chanlist_rows_filtered = res.end;
+	if (res.sorted)
 	{
-		gui.chanlist_caption_is_stale = true;
-		return;
+		chanlist_publish (gui, std::move (res.snap), std::move (res.rows));
+		gui.chanlist_channels_shown_count = shown;
+		gui.chanlist_users_shown_count = users_shown;
 	}
-
-	if (gtk_entry_get_text (GTK_ENTRY (gui.chanlist_wild))[0])
+	else
 	{
-		/* Check what the user wants to match. If both buttons or _neither_
-		 * button is checked, look for match in both by default. 
-		 */
-		if (gui.chanlist_match_wants_channel ==
-			 gui.chanlist_match_wants_topic)
-		{
-			if (!chanlist_match (gui, next_row->chan)
-				&& !chanlist_match(gui, next_row->topic))
-			{
-				gui.chanlist_caption_is_stale = true;
-				return;
-			}
-		}
-
-		else if (gui.chanlist_match_wants_channel)
-		{
-			if (!chanlist_match(gui, next_row->chan))
-			{
-				gui.chanlist_caption_is_stale = true;
-				return;
-			}
-		}
-
-		else if (gui.chanlist_match_wants_topic)
-		{
-			if (!chanlist_match(gui, next_row->topic))
-			{
-				gui.chanlist_caption_is_stale = true;
-				return;
-			}
-		}
+		custom_list_append (CUSTOM_LIST (get_model (gui)), res.snap, res.rows);
+		gui.chanlist_channels_shown_count += shown;
+		gui.chanlist_users_shown_count += users_shown;
 	}
 
-	if (force || gui.chanlist_channels_shown_count < 20)
-	{
-		model = get_model(gui);
-		/* makes it appear fast :) */
-		custom_list_append (CUSTOM_LIST (model), next_row);
-		chanlist_update_caption (gui);
-	}
-	else
-		/* add it to GUI at the next update interval */
-		gui.chanlist_pending_rows = g_slist_prepend (gui.chanlist_pending_rows, next_row);
+	chanlist_update_caption (gui);
+	chanlist_update_buttons (gui);
+
+	/* more came in while we were busy */
+	chanlist_flush_pending (gui);
+}
 
-	/* Update the 'shown' counter values */
-	gui.chanlist_users_shown_count += next_row->users;
-	gui.chanlist_channels_shown_count++;
+static void
+chanlist_sort_changed (GtkTreeSortable *, server *serv)
+{
+	if (serv->gui->chanlist_store->size ())
+		chanlist_filter_all (*serv->gui);
 }
 
 /* Performs the LIST download from the IRC server. */
@@ -288,10 +247,13 @@ chanlist_do_refresh (server *serv)
 		return;
 	}
 
-	custom_list_clear ((CustomList *)GET_MODEL (serv));
 	gtk_widget_set_sensitive (serv->gui->chanlist_refresh, FALSE);
 
-	chanlist_data_free (*serv->gui);
+	serv->gui->chanlist_worker->cancel ();
+	serv->gui->chanlist_filter_busy = false;
+	serv->gui->chanlist_rows_filtered = 0;
+	serv->gui->chanlist_store->clear ();
+	chanlist_publish (*serv->gui, chanlist::snapshot (), std::vector<chanlist::row_id> ());
 	chanlist_reset_counters (*serv->gui);
 
 	/* can we request a list with minusers arg? */
@@ -320,71 +282,51 @@ chanlist_refresh (GtkWidget *, server *serv)
 }
 
 /**
- * Fills the gui GtkTreeView with stored items from the GSList.
+ * Fills the gui GtkTreeView with the stored rows that match the search.
  */
 static void
 chanlist_build_gui_list (server *serv)
 {
-	GSList *rows;
-
 	/* first check if the list is present */
-	if (serv->gui->chanlist_data_stored_rows == NULL)
+	if (serv->gui->chanlist_store->size () == 0)
 	{
 		/* start a download */
 		chanlist_do_refresh (serv);
 		return;
 	}
 
-	custom_list_clear ((CustomList *)GET_MODEL (serv));
-
-	/* discard pending rows FIXME: free the structs? */
-	g_slist_free (serv->gui->chanlist_pending_rows);
-	serv->gui->chanlist_pending_rows = NULL;
-
-	/* Reset the counters */
-	chanlist_reset_counters (*serv->gui);
-
-	/* Refill the list */
-	for (rows = serv->gui->chanlist_data_stored_rows; rows != NULL;
-		  rows = rows->next)
-	{
-		chanlist_place_row_in_gui(*serv->gui, static_cast<chanlistrow*>(rows->data), TRUE);
-	}
-
-	custom_list_resort ((CustomList *)GET_MODEL (serv));
+	chanlist_filter_all (*serv->gui);
 }
 }// end anonymous namespace
 
 /**
- * Accepts incoming channel data from inbound.c, allocates new space for a
- * chanlistrow, adds it to our linked list and calls chanlist_place_row_in_gui.
+ * Accepts incoming channel data from inbound.c and adds it to the store;
+ * the filter worker picks it up from there.
  */
 void
 fe_add_chan_list (server *serv, char *chan, char *users, char *topic)
 {
-	auto len = strlen (chan) + 1;
+	auto & gui = *serv->gui;
+	const auto user_count = static_cast<std::uint32_t>(std::max (atoi (users), 0));
 
-	chanlistrow * next_row = new chanlistrow;
-	next_row->topic = strip_color(topic, STRIP_ALL);
-	glib_string collation_key(g_utf8_collate_key(chan, len - 1));
-	next_row->collation_key = collation_key ? collation_key.get() : chan;
-	next_row->users = atoi (users);
+	gui.chanlist_store->append (chan, user_count, strip_color (topic, STRIP_ALL));
 
-	/* add this row to the data */
-	serv->gui->chanlist_data_stored_rows =
-		g_slist_prepend (serv->gui->chanlist_data_stored_rows, next_row);
+	/* First, update the 'found' counter values */
+	gui.chanlist_users_found_count += user_count;
+	gui.chanlist_channels_found_count++;
+	gui.chanlist_caption_is_stale = true;
 
-	/* _possibly_ add the row to the gui */
-	chanlist_place_row_in_gui (*serv->gui, next_row, FALSE);
+	/* makes it appear fast :) */
+	if (gui.chanlist_channels_found_count <= 20)
+		chanlist_flush_pending (gui);
 }
 
 void
 fe_chan_list_end (server *serv)
 {
-	/* download complete */
-	chanlist_flush_pending (*serv->gui);
+	/* download complete, one last pass to get it all sorted */
 	gtk_widget_set_sensitive (serv->gui->chanlist_refresh, TRUE);
-	custom_list_resort ((CustomList *)GET_MODEL (serv));
+	chanlist_filter_all (*serv->gui);
 }
 
 namespace
@@ -630,8 +572,13 @@ chanlist_destroy_widget (GtkWidget *, server_gui *gui)
 {
 	if (!gui)
 		throw std::invalid_argument("invalid server_gui reference");
+
+	/* stop the worker first, nothing it still has for us gets delivered */
+	delete gui->chanlist_worker;
+	gui->chanlist_worker = nullptr;
 	custom_list_clear ((CustomList *)get_model(*gui));
-	chanlist_data_free (*gui);
+	delete gui->chanlist_store;
+	gui->chanlist_store = nullptr;
 
 	if (gui->chanlist_flash_tag)
 	{
@@ -712,10 +659,16 @@ chanlist_opengui (server *serv, bool do_refresh)
 	snprintf (tbuf, sizeof tbuf, _(DISPLAY_NAME": Channel List (%s)"),
 				 serv->get_network (true).data());
 
-	serv->gui->chanlist_pending_rows = NULL;
 	serv->gui->chanlist_tag = 0;
 	serv->gui->chanlist_flash_tag = 0;
-	serv->gui->chanlist_data_stored_rows = NULL;
+	serv->gui->chanlist_store = new chanlist::store;
+	serv->gui->chanlist_rows_filtered = 0;
+	serv->gui->chanlist_filter_busy = false;
+	{
+		auto gui = serv->gui;
+		serv->gui->chanlist_worker = new chanlist::filter_worker (
+			[gui](chanlist::result && res){ chanlist_filter_done (*gui, std::move (res)); });
+	}
 
 	if (!serv->gui->chanlist_minusers)
 	{
@@ -761,6 +714,8 @@ chanlist_opengui (server *serv, bool do_refresh)
 													 GTK_SHADOW_IN);
 	serv->gui->chanlist_list = view;
 
+	g_signal_connect (G_OBJECT (store), "sort-column-changed",
+							G_CALLBACK (chanlist_sort_changed), serv);
 	g_signal_connect (G_OBJECT (view), "row_activated",
 							G_CALLBACK (chanlist_dclick_cb), serv);
 	g_signal_connect (G_OBJECT (view), "button-press-event",
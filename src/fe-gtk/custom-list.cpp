@@ -252,8 +252,8 @@ custom_list_init (CustomList * custom_list)
 	custom_list->column_types[2] = G_TYPE_STRING;	/* CUSTOM_LIST_COL_TOPIC     */
 
 	custom_list->num_rows = 0;
-	custom_list->num_alloc = 0;
-	custom_list->rows = NULL;
+	custom_list->snap = new chanlist::snapshot;
+	custom_list->rows = new std::vector<chanlist::row_id>;
 
 	custom_list->sort_id = SORT_ID_CHANNEL;
 	custom_list->sort_order = GTK_SORT_ASCENDING;
@@ -270,7 +270,11 @@ custom_list_init (CustomList * custom_list)
 static void
 custom_list_finalize (GObject * object)
 {
-	custom_list_clear (CUSTOM_LIST (object));
+	CustomList *custom_list = CUSTOM_LIST (object);
+
+	custom_list_clear (custom_list);
+	delete custom_list->snap;
+	delete custom_list->rows;
 
 	/* must chain up - finalize parent */
 	(*parent_class->finalize) (object);
@@ -327,8 +331,7 @@ custom_list_get_column_type (GtkTreeModel * tree_model, gint index)
  *  custom_list_get_iter: converts a tree path (physical position) into a
  *                        tree iter structure (the content of the iter
  *                        fields will only be used internally by our model).
- *                        We simply store a pointer to our chanlistrow
- *                        structure that represents that row in the tree iter.
+ *                        We simply store the row's position in the tree iter.
  *
  *****************************************************************************/
 
@@ -337,17 +340,14 @@ custom_list_get_iter (GtkTreeModel * tree_model,
 							 GtkTreeIter * iter, GtkTreePath * path)
 {
 	CustomList *custom_list = CUSTOM_LIST (tree_model);
-	chanlistrow *record;
 	gint n;
 
 	n = gtk_tree_path_get_indices (path)[0];
-	if (n >= custom_list->num_rows || n < 0)
+	if (n >= (gint) custom_list->num_rows || n < 0)
 		return FALSE;
 
-	record = custom_list->rows[n];
-
-	/* We simply store a pointer to our custom record in the iter */
-	iter->user_data = record;
+	/* We simply store the position in the iter */
+	iter->user_data = GUINT_TO_POINTER (n);
 
 	return TRUE;
 }
@@ -364,12 +364,9 @@ static GtkTreePath *
 custom_list_get_path (GtkTreeModel * tree_model, GtkTreeIter * iter)
 {
 	GtkTreePath *path;
-	chanlistrow *record;
-
-	record = (chanlistrow *) iter->user_data;
 
 	path = gtk_tree_path_new ();
-	gtk_tree_path_append_index (path, record->pos);
+	gtk_tree_path_append_index (path, GPOINTER_TO_UINT (iter->user_data));
 
 	return path;
 }
@@ -386,7 +383,6 @@ static void
 custom_list_get_value (GtkTreeModel * tree_model,
 							  GtkTreeIter * iter, gint column, GValue * value)
 {
-	chanlistrow *record;
 	CustomList *custom_list = CUSTOM_LIST (tree_model);
 
 	if (custom_list->num_rows == 0)
@@ -394,20 +390,20 @@ custom_list_get_value (GtkTreeModel * tree_model,
 
 	g_value_init (value, custom_list->column_types[column]);
 
-	record = (chanlistrow *) iter->user_data;
+	const auto row = (*custom_list->rows)[GPOINTER_TO_UINT (iter->user_data)];
 
 	switch (column)
 	{
 	case CUSTOM_LIST_COL_NAME:
-		g_value_set_static_string (value, record->chan.c_str());
+		g_value_set_static_string (value, custom_list->snap->channel (row));
 		break;
 
 	case CUSTOM_LIST_COL_USERS:
-		g_value_set_uint (value, record->users);
+		g_value_set_uint (value, custom_list->snap->users (row));
 		break;
 
 	case CUSTOM_LIST_COL_TOPIC:
-		g_value_set_static_string (value, record->topic.c_str());
+		g_value_set_static_string (value, custom_list->snap->topic (row));
 		break;
 	}
 }
@@ -423,21 +419,14 @@ custom_list_get_value (GtkTreeModel * tree_model,
 static gboolean
 custom_list_iter_next (GtkTreeModel * tree_model, GtkTreeIter * iter)
 {
-	chanlistrow *record, *nextrecord;
 	CustomList *custom_list = CUSTOM_LIST (tree_model);
-
-	record = (chanlistrow *) iter->user_data;
+	guint pos = GPOINTER_TO_UINT (iter->user_data);
 
 	/* Is this the last record in the list? */
-	if ((record->pos + 1) >= custom_list->num_rows)
+	if ((pos + 1) >= custom_list->num_rows)
 		return FALSE;
 
-	nextrecord = custom_list->rows[(record->pos + 1)];
-
-	g_assert (nextrecord != NULL);
-	g_assert (nextrecord->pos == (record->pos + 1));
-
-	iter->user_data = nextrecord;
+	iter->user_data = GUINT_TO_POINTER (pos + 1);
 
 	return TRUE;
 }
@@ -470,7 +459,7 @@ custom_list_iter_children (GtkTreeModel * tree_model,
 		return FALSE;
 
 	/* Set iter to first item in list */
-	iter->user_data = custom_list->rows[0];
+	iter->user_data = GUINT_TO_POINTER (0);
 
 	return TRUE;
 }
@@ -538,10 +527,10 @@ custom_list_iter_nth_child (GtkTreeModel * tree_model,
 		return FALSE;
 
 	/* special case: if parent == NULL, set iter to n-th top-level row */
-	if (n >= custom_list->num_rows)
+	if (n < 0 || n >= (gint) custom_list->num_rows)
 		return FALSE;
 
-	iter->user_data = custom_list->rows[n];
+	iter->user_data = GUINT_TO_POINTER (n);
 	return TRUE;
 }
 
@@ -591,12 +580,12 @@ custom_list_sortable_set_sort_column_id (GtkTreeSortable * sortable,
 	custom_list->sort_id = sort_col_id;
 	custom_list->sort_order = order;
 
-	custom_list_resort (custom_list);
-
 	/* emit "sort-column-changed" signal to tell any tree views
 	 *  that the sort column has changed (so the little arrow
 	 *  in the column header of the sort column is drawn
-	 *  in the right column)                                     */
+	 *  in the right column). The rows themselves are sorted
+	 *  off the GTK thread by whoever owns the list, which
+	 *  listens for this too.                                    */
 
 	gtk_tree_sortable_sort_column_changed (sortable);
 }
@@ -624,30 +613,6 @@ custom_list_sortable_has_default_sort_func (GtkTreeSortable * sortable)
 	return FALSE;
 }
 
-static gint
-custom_list_qsort_compare_func (const chanlistrow ** a, const chanlistrow ** b,
-										  CustomList * custom_list)
-{
-	if (custom_list->sort_order == GTK_SORT_DESCENDING)
-	{
-		const chanlistrow **tmp = a;
-		a = b;
-		b = tmp;
-	}
-
-	if (custom_list->sort_id == SORT_ID_USERS)
-	{
-		return (*a)->users - (*b)->users;
-	}
-
-	if (custom_list->sort_id == SORT_ID_TOPIC)
-	{
-		return (*a)->topic.compare((*b)->topic);
-	}
-
-	return (*a)->collation_key.compare((*b)->collation_key);
-}
-
 /*****************************************************************************
  *
  *  custom_list_new:  This is what you use in your own code to create a
@@ -662,86 +627,51 @@ custom_list_new (void)
 }
 
 void
-custom_list_append (CustomList * custom_list, chanlistrow * newrecord)
+custom_list_append (CustomList * custom_list, const chanlist::snapshot & snap,
+						  const std::vector<chanlist::row_id> & rows)
 {
 	GtkTreeIter iter;
-	gulong newsize;
-	guint pos;
-
-	if (custom_list->num_rows >= custom_list->num_alloc)
-	{
-		custom_list->num_alloc += 64;
-		newsize = custom_list->num_alloc * sizeof (chanlistrow *);
-		custom_list->rows = static_cast<chanlistrow **>(g_realloc(custom_list->rows, newsize));
-	}
 
-	/* TODO: Binary search insert? */
+	/* a newer snapshot of the same store, the rows we have stay valid */
+	*custom_list->snap = snap;
+	custom_list->rows->insert (custom_list->rows->end (), rows.cbegin (), rows.cend ());
 
-	pos = custom_list->num_rows;
-	custom_list->rows[pos] = newrecord;
-	custom_list->num_rows++;
-	newrecord->pos = pos;
+	while (custom_list->num_rows < custom_list->rows->size ())
+	{
+		guint pos = custom_list->num_rows++;
 
-	/* inform the tree view and other interested objects
-	 *  (e.g. tree row references) that we have inserted
-	 *  a new row, and where it was inserted */
+		/* inform the tree view and other interested objects
+		 *  (e.g. tree row references) that we have inserted
+		 *  a new row, and where it was inserted */
 
-	GtkTreePathPtr path(gtk_tree_path_new());
-	gtk_tree_path_append_index (path.get(), newrecord->pos);
-/*  custom_list_get_iter(GTK_TREE_MODEL(custom_list), &iter, path);*/
-	iter.user_data = newrecord;
-	gtk_tree_model_row_inserted (GTK_TREE_MODEL (custom_list), path.get(), &iter);
+		GtkTreePathPtr path(gtk_tree_path_new());
+		gtk_tree_path_append_index (path.get(), pos);
+		iter.user_data = GUINT_TO_POINTER (pos);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (custom_list), path.get(), &iter);
+	}
 }
 
 void
-custom_list_resort (CustomList * custom_list)
+custom_list_set_rows (CustomList * custom_list, chanlist::snapshot snap,
+							 std::vector<chanlist::row_id> rows)
 {
-	if (custom_list->num_rows < 2)
-		return;
-
-	/* resort */
-	std::sort(
-		custom_list->rows,
-		custom_list->rows + custom_list->num_rows,
-		[custom_list](const chanlistrow * a, const chanlistrow * b){
-		return custom_list_qsort_compare_func(&a, &b, custom_list) < 0;
-		}
-	);
-
-	/* let other objects know about the new order */
-	std::vector<gint> neworder(custom_list->num_rows);
-
-	for (int i = custom_list->num_rows - 1; i >= 0; i--)
-	{
-		/* Note that the API reference might be wrong about
-		 * this, see bug number 124790 on bugs.gnome.org.
-		 * Both will work, but one will give you 'jumpy'
-		 * selections after row reordering. */
-		/* neworder[(custom_list->rows[i])->pos] = i; */
-		neworder[i] = (custom_list->rows[i])->pos;
-		(custom_list->rows[i])->pos = i;
-	}
-
-	GtkTreePathPtr path(gtk_tree_path_new());
-	gtk_tree_model_rows_reordered (GTK_TREE_MODEL (custom_list), path.get(), NULL,
-											 &neworder[0]);
+	*custom_list->snap = std::move (snap);
+	*custom_list->rows = std::move (rows);
+	custom_list->num_rows = custom_list->rows->size ();
 }
 
 void
 custom_list_clear (CustomList * custom_list)
 {
-	int max = custom_list->num_rows - 1;
-
-	for (int i = max; i >= 0; i--)
+	for (int i = custom_list->num_rows - 1; i >= 0; i--)
 	{
 		GtkTreePathPtr path(gtk_tree_path_new ());
-		gtk_tree_path_append_index (path.get(), custom_list->rows[i]->pos);
+		gtk_tree_path_append_index (path.get(), i);
+		custom_list->num_rows = i;
 		gtk_tree_model_row_deleted (GTK_TREE_MODEL (custom_list), path.get());
 	}
 
 	custom_list->num_rows = 0;
-	custom_list->num_alloc = 0;
-
-	g_free (custom_list->rows);
-	custom_list->rows = NULL;
+	custom_list->rows->clear ();
+	*custom_list->snap = chanlist::snapshot ();
 }
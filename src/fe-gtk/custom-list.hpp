@@ -21,7 +21,9 @@
 #define HEXCHAT_CUSTOM_LIST_HPP
 
 #include <string>
+#include <vector>
 #include <gtk/gtk.h>
+#include "../common/chanlist-store.hpp"
 GType custom_list_get_type (void);
 
 /* Some boilerplate GObject defines. 'klass' is used
@@ -51,16 +53,6 @@ enum
 	SORT_ID_TOPIC
 };
 
-struct chanlistrow
-{
-	std::string topic;
-	std::string collation_key;
-	guint32 pos;						  /* pos within the array */
-	guint32 users;
-	/* channel string lives beyond "users" */
-	std::string chan;
-};
-
 /* CustomList: this structure contains everything we need for our
  *             model implementation. You can add extra fields to
  *             this structure, e.g. hashtables to quickly lookup
@@ -72,9 +64,8 @@ struct CustomList
 	GObject parent;
 
 	guint num_rows;				  /* number of rows that we have used */
-	guint num_alloc;					/* number of rows allocated */
-	chanlistrow **rows;			  /* a dynamically allocated array of pointers to the
-										   *  CustomRecord structure for each row */
+	chanlist::snapshot *snap;	  /* the /LIST rows are read from here */
+	std::vector<chanlist::row_id> *rows;	/* which of them are shown, in order */
 
 	gint n_columns;
 	GType column_types[CUSTOM_LIST_N_COLUMNS];
@@ -93,8 +84,10 @@ struct CustomListClass
 
 
 CustomList *custom_list_new (void);
-void custom_list_append (CustomList *, chanlistrow *);
-void custom_list_resort (CustomList *);
+void custom_list_append (CustomList *, const chanlist::snapshot &, const std::vector<chanlist::row_id> &);
+/* swaps in a whole new set of rows without telling the views row by row,
+ * so detach the list from any view before calling this */
+void custom_list_set_rows (CustomList *, chanlist::snapshot, std::vector<chanlist::row_id>);
 void custom_list_clear (CustomList *);
 
 #endif /* HEXCHAT_CUSTOM_LIST_H */
@@ -106,6 +106,7 @@ static const GOptionEntry gopt_entries[] =
  {"existing",	'e', 0, G_OPTION_ARG_NONE,	&arg_existing, N_("Open URL or execute command in an existing HexChat"), nullptr},
 #endif
  {"minimize",	 0,  0, G_OPTION_ARG_INT,	&arg_minimize, N_("Begin minimized. Level 0=Normal 1=Iconified 2=Tray"), N_("level")},
+ {"trace-startup",	 0,  0, G_OPTION_ARG_NONE,	&arg_trace_startup, N_("Show where startup time goes and save it as startup-trace.json"), nullptr},
  {"version",	'v', 0, G_OPTION_ARG_NONE,	&arg_show_version, N_("Show version information"), nullptr},
  {G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &arg_urls, N_("Open an irc://server:port/channel?key URL"), "URL"},
  {nullptr}
@@ -841,6 +842,18 @@ fe_ctrl_gui (session *sess, fe_gui_action action, int arg)
 		break;
 	case FE_GUI_APPLY:
 		setup_apply_real (true, true, true);
+		break;
+	case FE_GUI_FRAMES:
+	{
+		/* report what the text widgets' render queue has done since the last call */
+		const auto & stats = gtk_xtext_get_frame_stats ();
+		PrintTextf (sess, "Frames: %" G_GUINT64_FORMAT ", widgets redrawn: %" G_GUINT64_FORMAT
+			", deferred: %" G_GUINT64_FORMAT ", avg: %" G_GINT64_FORMAT " us, max: %" G_GINT64_FORMAT " us\n",
+			stats.frames, stats.renders, stats.deferred,
+			stats.frames ? stats.total_us / static_cast<gint64>(stats.frames) : 0, stats.max_us);
+		gtk_xtext_reset_frame_stats ();
+		break;
+	}
 	}
 }
 
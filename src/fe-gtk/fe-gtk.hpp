@@ -39,6 +39,12 @@
 
 #include "banlist.hpp"
 
+namespace chanlist
+{
+	class store;
+	class filter_worker;
+}
+
 #define flag_c flag_wid[0]
 #define flag_n flag_wid[1]
 #define flag_r flag_wid[2]
@@ -77,8 +83,10 @@ struct server_gui
 	GtkWidget *chanlist_savelist;
 	GtkWidget *chanlist_search;
 
-	GSList *chanlist_data_stored_rows;	/* stored list so it can be resorted  */
-	GSList *chanlist_pending_rows;
+	chanlist::store *chanlist_store;	/* every row of the last /LIST */
+	chanlist::filter_worker *chanlist_worker;	/* filters chanlist_store off the GTK thread */
+	guint32 chanlist_rows_filtered;	/* rows of chanlist_store the view has caught up with */
+	bool chanlist_filter_busy;
 	gint chanlist_tag;
 	gint chanlist_flash_tag;
 
@@ -1314,7 +1314,7 @@ static char *
 gcomp_nick_func (char *data)
 {
 	if (data)
-		return &(reinterpret_cast<User *>(data)->nick)[0];
+		return &(reinterpret_cast<User *>(data)->info->nick)[0];
 	return "";
 }
 
@@ -1464,7 +1464,7 @@ struct session *sess)
 				std::sort(tmp_vec.begin(), tmp_vec.end(), talked_recent_cmp);
 			for (auto usr : tmp_vec)
 			{
-				tmp_list = g_list_prepend(tmp_list, const_cast<char*>(usr->nick.c_str()));
+				tmp_list = g_list_prepend(tmp_list, const_cast<char*>(usr->info->nick.c_str()));
 			}
 		}
 		else
@@ -995,7 +995,7 @@ mg_topdestroy_cb (GtkWidget *win, session *sess)
 	/* kill the text buffer */
 	gtk_xtext_buffer_free(static_cast<xtext_buffer*>(sess->res->buffer));
 	/* kill the user list */
-	g_object_unref (G_OBJECT (sess->res->user_model));
+	userlist_destroy_model (sess->res->user_model);
 
 	session_free (sess);	/* tell hexchat.c about it */
 }
@@ -1010,7 +1010,7 @@ mg_ircdestroy (session *sess)
 	/* kill the text buffer */
 	gtk_xtext_buffer_free(static_cast<xtext_buffer*>(sess->res->buffer));
 	/* kill the user list */
-	g_object_unref (G_OBJECT (sess->res->user_model));
+	userlist_destroy_model (sess->res->user_model);
 
 	session_free (sess);	/* tell hexchat.c about it */
 
@@ -1481,7 +1481,6 @@ mg_set_guint8 (GtkCheckMenuItem *item, guint8 *setting)
 		log_open_or_close (sess);*/
 
 	chanopt_save (sess);
-	chanopt_save_all ();
 }
 
 static void
@@ -1675,7 +1674,7 @@ mg_add_chan (session *sess)
 	{
 		sess->res->buffer = gtk_xtext_buffer_new (GTK_XTEXT (sess->gui->xtext));
 		static_cast<xtext_buffer*>(sess->res->buffer)->time_stamp = !!prefs.hex_stamp_text;
-		sess->res->user_model = userlist_create_model ();
+		sess->res->user_model = userlist_create_model (sess);
 	}
 }
 
@@ -3097,7 +3096,7 @@ mg_create_topwindow (session *sess)
 		sess->res->buffer = gtk_xtext_buffer_new (GTK_XTEXT (sess->gui->xtext));
 		gtk_xtext_buffer_show(GTK_XTEXT(sess->gui->xtext), static_cast<xtext_buffer*>(sess->res->buffer), true);
 		static_cast<xtext_buffer*>(sess->res->buffer)->time_stamp = !!prefs.hex_stamp_text;
-		sess->res->user_model = userlist_create_model ();
+		sess->res->user_model = userlist_create_model (sess);
 	}
 
 	userlist_show (sess);
@@ -3455,8 +3454,8 @@ mg_changui_new (session *sess, restore_gui *res, bool tab, bool focus)
 		sess->gui = gui;
 		mg_create_topwindow (sess);
 		fe_set_title (*sess);
-		if (user && user->hostname)
-			set_topic (sess, *user->hostname, *user->hostname);
+		if (user && user->info->hostname)
+			set_topic (sess, *user->info->hostname, *user->info->hostname);
 		return;
 	}
 
@@ -3476,8 +3475,8 @@ mg_changui_new (session *sess, restore_gui *res, bool tab, bool focus)
 		gui->is_tab = true;
 	}
 
-	if (user && user->hostname)
-		set_topic (sess, *user->hostname, *user->hostname);
+	if (user && user->info->hostname)
+		set_topic (sess, *user->info->hostname, *user->info->hostname);
 
 	mg_add_chan (sess);
 
@@ -145,15 +145,15 @@ nick_command_parse(session *sess, const boost::string_ref & cmd, const boost::st
 		user = userlist_find (sess, nick);
 		if (user)
 		{
-			if (user->hostname)
+			if (user->info->hostname)
 			{
-				auto at_idx = user->hostname->find_first_of('@');
+				auto at_idx = user->info->hostname->find_first_of('@');
 				if (at_idx == std::string::npos)
 					throw std::runtime_error("invalid user hostname");
-				host = user->hostname->substr(at_idx + 1);
+				host = user->info->hostname->substr(at_idx + 1);
 			}
-			if (user->account)
-				account = user->account ? user->account->c_str() : nullptr;
+			if (user->info->account)
+				account = user->info->account ? user->info->account->c_str() : nullptr;
 		}
 	}
 
@@ -600,9 +600,9 @@ menu_create_nickinfo_menu (struct User *user, GtkWidget *submenu)
 	const char* fmt = _("<tt><b>%-11s</b></tt> %s");
 	snprintf (unknown, sizeof (unknown), "<i>%s</i>", _("Unknown"));
 
-	if (user->realname)
+	if (user->info->realname)
 	{
-		auto real = strip_color (user->realname.get(), static_cast<strip_flags>(STRIP_ALL|STRIP_ESCMARKUP));
+		auto real = strip_color (user->info->realname.get(), static_cast<strip_flags>(STRIP_ALL|STRIP_ESCMARKUP));
 		snprintf (buf, sizeof (buf), fmt, _("Real Name:"), real.c_str());
 	} else
 	{
@@ -611,23 +611,23 @@ menu_create_nickinfo_menu (struct User *user, GtkWidget *submenu)
 	item = menu_quick_item (nullptr, buf, submenu, XCMENU_MARKUP, nullptr, nullptr);
 	g_signal_connect (G_OBJECT (item), "activate",
 							G_CALLBACK (copy_to_clipboard_cb), 
-							user->realname ? &(*user->realname)[0] : unknown);
+							user->info->realname ? &(*user->info->realname)[0] : unknown);
 
 	snprintf (buf, sizeof (buf), fmt, _("User:"),
-				 user->hostname ? user->hostname->c_str() : unknown);
+				 user->info->hostname ? user->info->hostname->c_str() : unknown);
 	item = menu_quick_item (nullptr, buf, submenu, XCMENU_MARKUP, nullptr, nullptr);
 	g_signal_connect (G_OBJECT (item), "activate",
 							G_CALLBACK (copy_to_clipboard_cb), 
-							(gpointer)(user->hostname ? user->hostname->c_str() : unknown));
+							(gpointer)(user->info->hostname ? user->info->hostname->c_str() : unknown));
 	
 	snprintf (buf, sizeof (buf), fmt, _("Account:"),
-				 user->account ? user->account->c_str() : unknown);
+				 user->info->account ? user->info->account->c_str() : unknown);
 	item = menu_quick_item (nullptr, buf, submenu, XCMENU_MARKUP, nullptr, nullptr);
 	g_signal_connect (G_OBJECT (item), "activate",
 							G_CALLBACK (copy_to_clipboard_cb), 
-							user->account ? &(*user->account)[0] : unknown);
+							user->info->account ? &(*user->info->account)[0] : unknown);
 
-	static std::string users_country = user->hostname ? country(user->hostname.get()) : nullptr;
+	static std::string users_country = user->info->hostname ? country(*user->info->hostname) : nullptr;
 	if (!users_country.empty())
 	{
 		snprintf (buf, sizeof (buf), fmt, _ ("Country:"), users_country.c_str());
@@ -637,11 +637,11 @@ menu_create_nickinfo_menu (struct User *user, GtkWidget *submenu)
 	}
 
 	snprintf (buf, sizeof (buf), fmt, _("Server:"),
-				 user->servername ? user->servername->c_str() : unknown);
+				 user->info->servername ? user->info->servername->c_str() : unknown);
 	item = menu_quick_item (nullptr, buf, submenu, XCMENU_MARKUP, nullptr, nullptr);
 	g_signal_connect (G_OBJECT (item), "activate",
 							G_CALLBACK (copy_to_clipboard_cb), 
-							user->servername ? &(*user->servername)[0] : unknown);
+							user->info->servername ? (gpointer)user->info->servername->c_str() : unknown);
 
 	if (user->lasttalk)
 	{
@@ -656,9 +656,9 @@ menu_create_nickinfo_menu (struct User *user, GtkWidget *submenu)
 	}
 	menu_quick_item (nullptr, buf, submenu, XCMENU_MARKUP, nullptr, nullptr);
 
-	if (user->away)
+	if (user->info->away)
 	{
-		auto away = current_sess->server->get_away_message(user->nick);// server_away_find_message(current_sess->server, user->nick);
+		auto away = current_sess->server->get_away_message(user->info->nick);// server_away_find_message(current_sess->server, user->info->nick);
 		if (away)
 		{
 			auto msg = strip_color (away->first ? away->second : std::string(unknown), static_cast<strip_flags>(STRIP_ALL|STRIP_ESCMARKUP));
@@ -684,7 +684,7 @@ fe_userlist_update (session *sess, struct User *user)
 		return;
 
 	/* not the same nick as the menu? */
-	if (sess->server->p_cmp (user->nick.c_str(), str_copy.get()))
+	if (sess->server->p_cmp (user->info->nick.c_str(), str_copy.get()))
 		return;
 
 	/* get rid of the "show" signal */
@@ -730,7 +730,7 @@ menu_nickmenu (session *sess, GdkEventButton *event, const std::string &nick, in
 			nick_submenu = submenu = menu_quick_sub (nick.c_str(), menu, nullptr, XCMENU_DOLIST, -1);
 
 			if (menu_create_nickinfo_menu (user, submenu) ||
-				 !user->hostname || !user->realname || !user->servername)
+				 !user->info->hostname || !user->info->realname || !user->info->servername)
 			{
 				g_signal_connect (G_OBJECT (submenu), "show", G_CALLBACK (menu_nickinfo_cb), sess);
 			}
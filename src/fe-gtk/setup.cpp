@@ -1502,6 +1502,7 @@ setup_create_color_page (void)
 
 static GtkWidget *sndfile_entry;
 static bool ignore_changed = false;
+static int snd_edited = -1;	/* event whose sound file was typed but isn't loaded yet */
 
 extern const text_event te[]; /* text.c */
 extern std::array<std::string, NUM_XP> sound_files;
@@ -1544,11 +1545,24 @@ setup_snd_get_selected (GtkTreeSelection *sel, GtkTreeIter *iter)
 	return n;
 }
 
+/* loading a sound hits the disk and the sound server, so it's done once
+   the user is done typing, not on every key */
+static void
+setup_snd_commit (void)
+{
+	if (snd_edited == -1)
+		return;
+	sound_set_event (snd_edited, sound_files[snd_edited]);
+	snd_edited = -1;
+}
+
 static void
 setup_snd_row_cb (GtkTreeSelection *sel, gpointer)
 {
 	GtkTreeIter iter;
 
+	setup_snd_commit ();
+
 	int n = setup_snd_get_selected (sel, &iter);
 	if (n == -1)
 		return;
@@ -1600,6 +1614,7 @@ setup_snd_filereq_cb (GtkWidget *entry, char *file)
 			{
 				gtk_entry_set_text (GTK_ENTRY (entry), file);
 			}
+			setup_snd_commit ();
 		}
 	}
 }
@@ -1643,8 +1658,9 @@ setup_snd_changed_cb (GtkEntry *ent, GtkTreeView *tree)
 	if (n == -1)
 		return;
 
-	/* get the new sound file */
+	/* get the new sound file, it's loaded by setup_snd_commit */
 	sound_files[n] = gtk_entry_get_text (GTK_ENTRY (ent));
+	snd_edited = n;
 
 	/* update the TreeView list */
 	store = (GtkListStore *)gtk_tree_view_get_model (tree);
@@ -1653,6 +1669,19 @@ setup_snd_changed_cb (GtkEntry *ent, GtkTreeView *tree)
 	gtk_widget_set_sensitive (cancel_button, false);
 }
 
+static void
+setup_snd_activate_cb (GtkEntry *, gpointer)
+{
+	setup_snd_commit ();
+}
+
+static gboolean
+setup_snd_focus_out_cb (GtkWidget *, GdkEventFocus *, gpointer)
+{
+	setup_snd_commit ();
+	return false;
+}
+
 static GtkWidget *
 setup_create_sound_page (void)
 {
@@ -1709,6 +1738,10 @@ setup_create_sound_page (void)
 	sndfile_entry = gtk_entry_new ();
 	g_signal_connect (G_OBJECT (sndfile_entry), "changed",
 							G_CALLBACK (setup_snd_changed_cb), sound_tree);
+	g_signal_connect (G_OBJECT (sndfile_entry), "activate",
+							G_CALLBACK (setup_snd_activate_cb), nullptr);
+	g_signal_connect (G_OBJECT (sndfile_entry), "focus-out-event",
+							G_CALLBACK (setup_snd_focus_out_cb), nullptr);
 	gtk_widget_show (sndfile_entry);
 	gtk_table_attach (GTK_TABLE (table1), sndfile_entry, 0, 1, 1, 2,
 							(GtkAttachOptions) (GTK_EXPAND | GTK_FILL),
@@ -2189,6 +2222,7 @@ static void
 setup_close_cb (GtkWidget * /*win*/, GtkWidget **swin)
 {
 	*swin = nullptr;
+	setup_snd_commit ();
 
 	if (font_dialog)
 	{
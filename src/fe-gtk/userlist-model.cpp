@@ -0,0 +1,352 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#endif
+#include <string>
+#include <vector>
+
+#include "fe-gtk.hpp"
+#include "../common/hexchat.hpp"
+#include "../common/hexchatc.hpp"
+#include "../common/session.hpp"
+#include "../common/text.hpp"
+#include "../common/userlist.hpp"
+#include "palette.hpp"
+#include "userlistgui.hpp"
+#include "userlist-model.hpp"
+#include "gtk_helpers.hpp"
+
+/* the iter carries the User * and its row, so both directions are O(1) */
+#define ITER_USER(iter) (static_cast<User *>((iter)->user_data))
+#define ITER_ROW(iter) (GPOINTER_TO_INT ((iter)->user_data2))
+
+static void userlist_model_init (UserListModel *model);
+static void userlist_model_class_init (UserListModelClass *klass);
+static void userlist_model_tree_model_init (GtkTreeModelIface *iface);
+
+static GObjectClass *parent_class = nullptr;
+
+GType
+userlist_model_get_type (void)
+{
+	static GType userlist_model_type = 0;
+
+	if (userlist_model_type)
+		return userlist_model_type;
+
+	{
+		static const GTypeInfo userlist_model_info = {
+			sizeof (UserListModelClass),
+			nullptr,	/* base_init */
+			nullptr,	/* base_finalize */
+			(GClassInitFunc) userlist_model_class_init,
+			nullptr,	/* class finalize */
+			nullptr,	/* class_data */
+			sizeof (UserListModel),
+			0,	/* n_preallocs */
+			(GInstanceInitFunc) userlist_model_init
+		};
+
+		userlist_model_type =
+			g_type_register_static (G_TYPE_OBJECT, "UserListModel",
+											&userlist_model_info, (GTypeFlags) 0);
+	}
+
+	{
+		static const GInterfaceInfo tree_model_info = {
+			(GInterfaceInitFunc) userlist_model_tree_model_init,
+			nullptr,
+			nullptr
+		};
+
+		g_type_add_interface_static (userlist_model_type, GTK_TYPE_TREE_MODEL,
+											  &tree_model_info);
+	}
+
+	return userlist_model_type;
+}
+
+static void
+userlist_model_class_init (UserListModelClass *klass)
+{
+	parent_class = (GObjectClass *) g_type_class_peek_parent (klass);
+}
+
+static void
+userlist_model_init (UserListModel *model)
+{
+	model->sess = nullptr;
+	model->num_rows = 0;
+	model->stamp = g_random_int ();
+}
+
+/* the row as long as both the view and the core have it */
+static User *
+userlist_model_user_at (UserListModel *model, gint n)
+{
+	if (!model->sess || n < 0 || n >= model->num_rows ||
+		 static_cast<std::size_t>(n) >= model->sess->usertree.size())
+		return nullptr;
+	return model->sess->usertree[n].get ();
+}
+
+static gboolean
+userlist_model_set_iter (UserListModel *model, GtkTreeIter *iter, gint n)
+{
+	auto user = userlist_model_user_at (model, n);
+	if (!user)
+		return FALSE;
+
+	iter->stamp = model->stamp;
+	iter->user_data = user;
+	iter->user_data2 = GINT_TO_POINTER (n);
+	return TRUE;
+}
+
+static GtkTreeModelFlags
+userlist_model_get_flags (GtkTreeModel *)
+{
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint
+userlist_model_get_n_columns (GtkTreeModel *)
+{
+	return USERLIST_N_COLUMNS;
+}
+
+static GType
+userlist_model_get_column_type (GtkTreeModel *, gint index)
+{
+	switch (index)
+	{
+	case COL_PIX:
+		return GDK_TYPE_PIXBUF;
+	case COL_NICK:
+	case COL_HOST:
+		return G_TYPE_STRING;
+	case COL_USER:
+		return G_TYPE_POINTER;
+	case COL_GDKCOLOR:
+		return GDK_TYPE_COLOR;
+	}
+	return G_TYPE_INVALID;
+}
+
+static gboolean
+userlist_model_get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	return userlist_model_set_iter (USERLIST_MODEL (tree_model), iter,
+											  gtk_tree_path_get_indices (path)[0]);
+}
+
+static GtkTreePath *
+userlist_model_get_path (GtkTreeModel *, GtkTreeIter *iter)
+{
+	auto path = gtk_tree_path_new ();
+	gtk_tree_path_append_index (path, ITER_ROW (iter));
+	return path;
+}
+
+static void
+userlist_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	auto model = USERLIST_MODEL (tree_model);
+	auto user = ITER_USER (iter);
+
+	g_value_init (value, userlist_model_get_column_type (nullptr, column));
+
+	switch (column)
+	{
+	case COL_PIX:
+		if (prefs.hex_gui_ulist_icons && model->sess)
+			g_value_set_object (value, get_user_icon (model->sess->server, user));
+		break;
+	case COL_NICK:
+	{
+		std::string nick (user->info->nick);
+		if (!prefs.hex_gui_ulist_icons && user->prefix[0])
+			nick.insert (nick.begin (), user->prefix[0]);
+		g_value_set_string (value, nick.c_str ());
+		break;
+	}
+	case COL_HOST:
+		g_value_set_static_string (value, user->info->hostname ? user->info->hostname->c_str () : nullptr);
+		break;
+	case COL_USER:
+		g_value_set_pointer (value, user);
+		break;
+	case COL_GDKCOLOR:
+	{
+		int nick_color = 0;
+		if (prefs.hex_away_track && user->info->away)
+			nick_color = COL_AWAY;
+		else if (prefs.hex_gui_ulist_color)
+			nick_color = text_color_of (user->info->nick);
+		g_value_set_static_boxed (value, nick_color ? &colors[nick_color] : nullptr);
+		break;
+	}
+	}
+}
+
+static gboolean
+userlist_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	return userlist_model_set_iter (USERLIST_MODEL (tree_model), iter, ITER_ROW (iter) + 1);
+}
+
+static gboolean
+userlist_model_iter_children (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	/* this is a list, nodes have no children */
+	if (parent)
+		return FALSE;
+	return userlist_model_set_iter (USERLIST_MODEL (tree_model), iter, 0);
+}
+
+static gboolean
+userlist_model_iter_has_child (GtkTreeModel *, GtkTreeIter *)
+{
+	return FALSE;
+}
+
+static gint
+userlist_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	/* special case: if iter == NULL, return number of top-level rows */
+	if (!iter)
+		return USERLIST_MODEL (tree_model)->num_rows;
+	return 0;
+}
+
+static gboolean
+userlist_model_iter_nth_child (GtkTreeModel *tree_model, GtkTreeIter *iter,
+										 GtkTreeIter *parent, gint n)
+{
+	if (parent)
+		return FALSE;
+	return userlist_model_set_iter (USERLIST_MODEL (tree_model), iter, n);
+}
+
+static gboolean
+userlist_model_iter_parent (GtkTreeModel *, GtkTreeIter *, GtkTreeIter *)
+{
+	return FALSE;
+}
+
+static void
+userlist_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = userlist_model_get_flags;
+	iface->get_n_columns = userlist_model_get_n_columns;
+	iface->get_column_type = userlist_model_get_column_type;
+	iface->get_iter = userlist_model_get_iter;
+	iface->get_path = userlist_model_get_path;
+	iface->get_value = userlist_model_get_value;
+	iface->iter_next = userlist_model_iter_next;
+	iface->iter_children = userlist_model_iter_children;
+	iface->iter_has_child = userlist_model_iter_has_child;
+	iface->iter_n_children = userlist_model_iter_n_children;
+	iface->iter_nth_child = userlist_model_iter_nth_child;
+	iface->iter_parent = userlist_model_iter_parent;
+}
+
+UserListModel *
+userlist_model_new (session *sess)
+{
+	auto model = static_cast<UserListModel *>(g_object_new (USERLIST_TYPE_MODEL, nullptr));
+	model->sess = sess;
+	return model;
+}
+
+/* the session is going away, from now on we're an empty list */
+void
+userlist_model_detach (UserListModel *model)
+{
+	userlist_model_clear (model);
+	model->sess = nullptr;
+}
+
+bool
+userlist_model_iter_at (UserListModel *model, int row, GtkTreeIter *iter)
+{
+	return userlist_model_set_iter (model, iter, row) != FALSE;
+}
+
+/* the core has already put a user at 'row' */
+void
+userlist_model_row_inserted (UserListModel *model, int row)
+{
+	model->stamp++;
+	model->num_rows++;
+
+	GtkTreeIter iter;
+	if (!userlist_model_set_iter (model, &iter, row))
+		return;
+	GtkTreePathPtr path (gtk_tree_path_new ());
+	gtk_tree_path_append_index (path.get (), row);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path.get (), &iter);
+}
+
+/* the core has already taken the user at 'row' out */
+void
+userlist_model_row_deleted (UserListModel *model, int row)
+{
+	if (row < 0 || row >= model->num_rows)
+		return;
+
+	model->stamp++;
+	model->num_rows--;
+
+	GtkTreePathPtr path (gtk_tree_path_new ());
+	gtk_tree_path_append_index (path.get (), row);
+	gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path.get ());
+}
+
+void
+userlist_model_row_changed (UserListModel *model, int row)
+{
+	GtkTreeIter iter;
+	if (!userlist_model_set_iter (model, &iter, row))
+		return;
+	GtkTreePathPtr path (gtk_tree_path_new ());
+	gtk_tree_path_append_index (path.get (), row);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path.get (), &iter);
+}
+
+/* new_order[new row] = old row */
+void
+userlist_model_rows_reordered (UserListModel *model, std::vector<gint> &new_order)
+{
+	if (static_cast<gint>(new_order.size ()) != model->num_rows || new_order.empty ())
+		return;
+
+	model->stamp++;
+	GtkTreePathPtr path (gtk_tree_path_new ());
+	gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path.get (), nullptr, new_order.data ());
+}
+
+void
+userlist_model_clear (UserListModel *model)
+{
+	while (model->num_rows > 0)
+		userlist_model_row_deleted (model, model->num_rows - 1);
+}
@@ -0,0 +1,74 @@
+/* HexChat
+ * Copyright (C) 1998-2010 Peter Zelezny.
+ * Copyright (C) 2009-2013 Berke Viktor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef HEXCHAT_USERLIST_MODEL_HPP
+#define HEXCHAT_USERLIST_MODEL_HPP
+
+#include <vector>
+#include <gtk/gtk.h>
+#include "../common/sessfwd.hpp"
+
+GType userlist_model_get_type (void);
+
+#define USERLIST_TYPE_MODEL            (userlist_model_get_type ())
+#define USERLIST_MODEL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), USERLIST_TYPE_MODEL, UserListModel))
+#define USERLIST_MODEL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  USERLIST_TYPE_MODEL, UserListModelClass))
+#define USERLIST_IS_MODEL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), USERLIST_TYPE_MODEL))
+
+/* The data columns that we export via the tree model interface */
+
+enum
+{
+	COL_PIX=0,		// GdkPixbuf *
+	COL_NICK=1,		// char *
+	COL_HOST=2,		// char *
+	COL_USER=3,		// struct User *
+	COL_GDKCOLOR=4,	// GdkColor *
+	USERLIST_N_COLUMNS
+};
+
+/* UserListModel: a GtkTreeModel that reads straight out of
+ *                session::usertree, so no copy of the users is kept.
+ *                Rows are published to the view one change at a time
+ *                through the functions below; num_rows is the number
+ *                of rows the view has been told about.              */
+struct UserListModel
+{
+	GObject parent;
+
+	session *sess;
+	gint num_rows;
+	gint stamp;		/* iters are only valid until the next change */
+};
+
+struct UserListModelClass
+{
+	GObjectClass parent_class;
+};
+
+UserListModel *userlist_model_new (session *sess);
+void userlist_model_detach (UserListModel *model);
+void userlist_model_row_inserted (UserListModel *model, int row);
+void userlist_model_row_deleted (UserListModel *model, int row);
+void userlist_model_row_changed (UserListModel *model, int row);
+void userlist_model_rows_reordered (UserListModel *model, std::vector<gint> &new_order);
+void userlist_model_clear (UserListModel *model);
+bool userlist_model_iter_at (UserListModel *model, int row, GtkTreeIter *iter);
+
+#endif /* HEXCHAT_USERLIST_MODEL_HPP */
@@ -24,7 +24,8 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
-#include <utility>
+#include <algorithm>
+#include <vector>
 #include <boost/utility/string_ref.hpp>
 
 #include "fe-gtk.hpp"
@@ -47,19 +48,10 @@
 #include "menu.hpp"
 #include "pixmaps.hpp"
 #include "userlistgui.hpp"
+#include "userlist-model.hpp"
 #include "fkeys.hpp"
 #include "gtk_helpers.hpp"
 
-enum
-{
-	COL_PIX=0,		// GdkPixbuf *
-	COL_NICK=1,		// char *
-	COL_HOST=2,		// char *
-	COL_USER=3,		// struct User *
-	COL_GDKCOLOR=4	// GdkColor *
-};
-
-
 GdkPixbuf *
 get_user_icon (server *serv, struct User *user)
 {
@@ -151,7 +143,7 @@ userlist_select (session *sess, const char name[])
 		{
 			struct User *row_user;
 			gtk_tree_model_get (model, &iter, COL_USER, &row_user, -1);
-			if (sess->server->compare (row_user->nick, name) == 0)
+			if (sess->server->compare (row_user->info->nick, name) == 0)
 			{
 				if (gtk_tree_selection_iter_is_selected (selection, &iter))
 					gtk_tree_selection_unselect_iter (selection, &iter);
@@ -198,7 +190,7 @@ userlist_selection_list (GtkWidget *widget)
 		{
 			struct User *user;
 			gtk_tree_model_get (model, &iter, COL_USER, &user, -1);
-			nicks.emplace_back(user->nick);
+			nicks.emplace_back(user->info->nick);
 		}
 	}
 	while (gtk_tree_model_iter_next (model, &iter));
@@ -209,57 +201,28 @@ userlist_selection_list (GtkWidget *widget)
 void
 fe_userlist_set_selected (struct session *sess)
 {
-	GtkListStore *store = static_cast<GtkListStore *>( sess->res->user_model);
+	auto model = static_cast<GtkTreeModel *>(sess->res->user_model);
 	GtkTreeSelection *selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (sess->gui->user_tree));
 	GtkTreeIter iter;
 
 	/* if it's not front-most tab it doesn't own the GtkTreeView! */
-	if (store != (GtkListStore*) gtk_tree_view_get_model (GTK_TREE_VIEW (sess->gui->user_tree)))
+	if (model != gtk_tree_view_get_model (GTK_TREE_VIEW (sess->gui->user_tree)))
 		return;
 
-	if (gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter))
+	if (gtk_tree_model_get_iter_first (model, &iter))
 	{
 		do
 		{
 			struct User *user;
-			gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COL_USER, &user, -1);
+			gtk_tree_model_get (model, &iter, COL_USER, &user, -1);
 
 			if (gtk_tree_selection_iter_is_selected (selection, &iter))
 				user->selected = true;
 			else
 				user->selected = false;
 				
-		} while (gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter));
-	}
-}
-
-static std::pair<GtkTreeIterPtr, bool> find_row (GtkTreeView *treeview, GtkTreeModel *model, const struct User *user)
-{
-	GtkTreeIter iter;
-
-	bool selected = false;
-	if (gtk_tree_model_get_iter_first (model, &iter))
-	{
-		do
-		{
-			User *row_user;
-			gtk_tree_model_get (model, &iter, COL_USER, &row_user, -1);
-			if (row_user == user)
-			{
-				if (gtk_tree_view_get_model (treeview) == model)
-				{
-					if (gtk_tree_selection_iter_is_selected(gtk_tree_view_get_selection(treeview), &iter))
-					{
-						selected = true;
-					}
-				}
-				return std::make_pair(GtkTreeIterPtr(gtk_tree_iter_copy(&iter)), selected);
-			}
-		}
-		while (gtk_tree_model_iter_next (model, &iter));
+		} while (gtk_tree_model_iter_next (model, &iter));
 	}
-
-	return std::pair<GtkTreeIterPtr, bool>(nullptr, selected);
 }
 
 void
@@ -275,111 +238,106 @@ userlist_get_value (GtkWidget *treeview)
 	return gtk_adjustment_get_value (gtk_tree_view_get_vadjustment (GTK_TREE_VIEW (treeview)));
 }
 
-bool
-fe_userlist_remove(session *sess, struct User const *user)
+static bool
+userlist_is_front (session *sess)
 {
-/*	GtkAdjustment *adj;
-	gfloat val, end;*/
-
-	auto result = find_row (GTK_TREE_VIEW (sess->gui->user_tree),
-						  static_cast<GtkTreeModel*>(sess->res->user_model), user);
-	if (!result.first)
-		return false;
-
-/*	adj = gtk_tree_view_get_vadjustment (GTK_TREE_VIEW (sess->gui->user_tree));
-	val = adj->value;*/
-
-	gtk_list_store_remove (static_cast<GtkListStore*>(sess->res->user_model), result.first.get());
+	return gtk_tree_view_get_model (GTK_TREE_VIEW (sess->gui->user_tree))
+		== static_cast<GtkTreeModel*>(sess->res->user_model);
+}
 
-	/* is it the front-most tab? */
-/*	if (gtk_tree_view_get_model (GTK_TREE_VIEW (sess->gui->user_tree))
-		 == sess->res->user_model)
+/* our own entry in the list changed, update the access icon next to the nick box */
+static void
+userlist_update_me (session *sess, struct User *user)
+{
+	if (!user->me || !sess->gui->nick_box)
+		return;
+	if (!sess->gui->is_tab || sess == current_tab)
 	{
-		end = adj->upper - adj->lower - adj->page_size;
-		if (val > end)
-			val = end;
-		gtk_adjustment_set_value (adj, val);
-	}*/
+		GdkPixbuf *pix = prefs.hex_gui_ulist_icons ? get_user_icon (sess->server, user) : nullptr;
+		mg_set_access_icon (sess->gui, pix, sess->server->is_away);
+	}
+}
 
-	return result.second;
+void
+fe_userlist_remove (session *sess, struct User const *, int row)
+{
+	userlist_model_row_deleted (USERLIST_MODEL (sess->res->user_model), row);
 }
 
 void
 fe_userlist_rehash (session *sess, struct User const *user)
 {
-	auto result = find_row (GTK_TREE_VIEW (sess->gui->user_tree),
-			static_cast<GtkTreeModel*>(sess->res->user_model), user);
-	if (!result.first)
+	auto row = userlist_row (sess, user);
+	if (row < 0)
 		return;
 
-	int nick_color = 0;
-	if (prefs.hex_away_track && user->away)
-		nick_color = COL_AWAY;
-	else if (prefs.hex_gui_ulist_color)
-		nick_color = text_color_of(user->nick);
-
-	gtk_list_store_set (GTK_LIST_STORE (sess->res->user_model), result.first.get(),
-							  COL_HOST, user->hostname ? user->hostname->c_str() : nullptr,
-							  COL_GDKCOLOR, nick_color ? &colors[nick_color] : nullptr,
-							  -1);
+	userlist_model_row_changed (USERLIST_MODEL (sess->res->user_model), row);
 }
 
 void
 fe_userlist_insert (session *sess, struct User *newuser, int row, bool sel)
 {
-	GtkTreeModel *model = static_cast<GtkTreeModel*>(sess->res->user_model);
-	GdkPixbuf *pix = get_user_icon (sess->server, newuser);
-	GtkTreeIter iter;
-	int nick_color = 0;
-
-	if (prefs.hex_away_track && newuser->away)
-		nick_color = COL_AWAY;
-	else if (prefs.hex_gui_ulist_color)
-		nick_color = text_color_of(newuser->nick);
-
-	std::string nick(newuser->nick);
-	if (!prefs.hex_gui_ulist_icons)
-	{		
-		if (newuser->prefix[0] || newuser->prefix[0] != ' ')
-			nick.insert(nick.begin(), newuser->prefix[0]);
-		pix = nullptr;
-	}
-
-	gtk_list_store_insert_with_values (GTK_LIST_STORE (model), &iter, row,
-									COL_PIX, pix,
-									COL_NICK, nick.c_str(),
-									COL_HOST, newuser->hostname ? newuser->hostname->c_str() : nullptr,
-									COL_USER, newuser,
-									COL_GDKCOLOR, nick_color ? &colors[nick_color] : nullptr,
-								  -1);
+	auto model = USERLIST_MODEL (sess->res->user_model);
+	userlist_model_row_inserted (model, row);
 
 	/* is it me? */
-	if (newuser->me && sess->gui->nick_box)
+	userlist_update_me (sess, newuser);
+
+	/* is it the front-most tab? */
+	GtkTreeIter iter;
+	if (sel && userlist_is_front (sess) && userlist_model_iter_at (model, row, &iter))
 	{
-		if (!sess->gui->is_tab || sess == current_tab)
-			mg_set_access_icon (sess->gui, pix, sess->server->is_away);
+		gtk_tree_selection_select_iter (gtk_tree_view_get_selection
+									(GTK_TREE_VIEW (sess->gui->user_tree)), &iter);
 	}
+}
 
-	/* is it the front-most tab? */
-	if (gtk_tree_view_get_model (GTK_TREE_VIEW (sess->gui->user_tree))
-		 == model)
+void
+fe_userlist_move (session *sess, struct User *user, int old_row, int new_row)
+{
+	auto model = USERLIST_MODEL (sess->res->user_model);
+
+	if (old_row != new_row && old_row >= 0 && new_row >= 0)
 	{
-		if (sel)
-			gtk_tree_selection_select_iter (gtk_tree_view_get_selection
-										(GTK_TREE_VIEW (sess->gui->user_tree)), &iter);
+		/* everyone in between shifts by one, this keeps the selection */
+		std::vector<gint> new_order (model->num_rows);
+		for (gint i = 0; i < model->num_rows; ++i)
+			new_order[i] = i;
+		if (old_row < new_row)
+			std::rotate (new_order.begin () + old_row, new_order.begin () + old_row + 1,
+							 new_order.begin () + new_row + 1);
+		else
+			std::rotate (new_order.begin () + new_row, new_order.begin () + old_row,
+							 new_order.begin () + old_row + 1);
+		userlist_model_rows_reordered (model, new_order);
 	}
+	userlist_model_row_changed (model, new_row);
 }
 
 void
-fe_userlist_move (session *sess, struct User *user, int new_row)
+fe_userlist_reorder (session *sess, const userlist_moves & moves)
 {
-	fe_userlist_insert (sess, user, new_row, fe_userlist_remove (sess, user));
+	auto model = USERLIST_MODEL (sess->res->user_model);
+
+	/* one reorder to match the core's order */
+	if (!moves.old_rows.empty ())
+	{
+		std::vector<gint> new_order (moves.old_rows.cbegin (), moves.old_rows.cend ());
+		userlist_model_rows_reordered (model, new_order);
+	}
+
+	/* then refresh the prefix/icon of whoever changed */
+	for (auto user : moves.changed)
+	{
+		userlist_model_row_changed (model, userlist_row (sess, user));
+		userlist_update_me (sess, user);
+	}
 }
 
 void
 fe_userlist_clear (session &sess)
 {
-	gtk_list_store_clear (static_cast<GtkListStore*>(sess.res->user_model));
+	userlist_model_clear (USERLIST_MODEL (sess.res->user_model));
 }
 
 static void
@@ -402,7 +360,7 @@ userlist_dnd_drop (GtkTreeView *widget, GdkDragContext *context,
 	auto data = gtk_selection_data_get_data (selection_data);
 
 	if (data)
-		mg_dnd_drop_file (current_sess, user->nick.c_str(), reinterpret_cast<const char*>(data));
+		mg_dnd_drop_file (current_sess, user->info->nick.c_str(), reinterpret_cast<const char*>(data));
 }
 
 static gboolean
@@ -432,10 +390,16 @@ userlist_dnd_leave (GtkTreeView *widget, GdkDragContext *context, guint ttime)
 }
 
 void *
-userlist_create_model (void)
+userlist_create_model (session *sess)
+{
+	return userlist_model_new (sess);
+}
+
+void
+userlist_destroy_model (void *model)
 {
-	return gtk_list_store_new (5, GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_STRING,
-										G_TYPE_POINTER, GDK_TYPE_COLOR);
+	userlist_model_detach (USERLIST_MODEL (model));
+	g_object_unref (G_OBJECT (model));
 }
 
 static void
@@ -637,7 +601,7 @@ fe_uselect (session *sess, char *word[], int do_clear, int scroll_to)
 				thisname = 0;
 				while ( *(name = word[thisname++]) )
 				{
-					if (sess->server->compare (row_user->nick, name) == 0)
+					if (sess->server->compare (row_user->info->nick, name) == 0)
 					{
 						gtk_tree_selection_select_iter (selection, &iter);
 						if (scroll_to)
@@ -26,7 +26,8 @@
 void userlist_set_value (GtkWidget *treeview, gfloat val);
 gfloat userlist_get_value (GtkWidget *treeview);
 GtkWidget *userlist_create (GtkWidget *box);
-void *userlist_create_model (void);
+void *userlist_create_model (session *sess);
+void userlist_destroy_model (void *model);
 void userlist_show (session *sess);
 void userlist_select (session *sess, const char name[]);
 std::vector<std::string> userlist_selection_list (GtkWidget *widget);
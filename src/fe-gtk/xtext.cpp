@@ -44,6 +44,7 @@ enum{ MARGIN = 2 };					/* dont touch. */
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/utility/string_ref.hpp>
@@ -87,8 +88,122 @@ struct offlen_t {
 	guint16 width;
 };
 
+/* view of an entry's bytes, which live in the owning buffer's text_arena */
+class entry_text
+{
+	const unsigned char *data_;
+	std::size_t size_;
+public:
+	entry_text() NOEXCEPT
+		:data_(reinterpret_cast<const unsigned char*>("")), size_() {}
+	entry_text(const unsigned char *data, std::size_t size) NOEXCEPT
+		:data_(data), size_(size) {}
+
+	const unsigned char *c_str() const NOEXCEPT { return data_; }
+	const unsigned char *data() const NOEXCEPT { return data_; }
+	std::size_t size() const NOEXCEPT { return size_; }
+	bool empty() const NOEXCEPT { return size_ == 0; }
+	const unsigned char *begin() const NOEXCEPT { return data_; }
+	const unsigned char *end() const NOEXCEPT { return data_ + size_; }
+	const unsigned char *cbegin() const NOEXCEPT { return data_; }
+	const unsigned char *cend() const NOEXCEPT { return data_ + size_; }
+	operator ustring_ref() const NOEXCEPT { return ustring_ref(data_, size_); }
+};
+
+/*
+* Text bytes for every entry of a buffer, packed into large chunks instead of
+* one heap allocation per line. Entries only ever leave from either end, so a
+* chunk can be dropped as a whole once the last entry using it is gone.
+*/
+class text_arena
+{
+	enum { CHUNK_SIZE = 64 * 1024 };
+	struct chunk
+	{
+		std::unique_ptr<unsigned char[]> bytes;
+		std::size_t capacity;
+		std::size_t used;
+		std::size_t live;	/* entries still pointing into this chunk */
+	};
+	std::deque<chunk> chunks;
+
+public:
+	/* copies text in, NUL terminated, and returns the writable copy */
+	unsigned char *store(const ustring_ref & text)
+	{
+		const auto needed = text.size() + 1;
+		if (chunks.empty() || chunks.back().capacity - chunks.back().used < needed)
+		{
+			chunk c;
+			c.capacity = std::max<std::size_t>(CHUNK_SIZE, needed);
+			c.bytes.reset(new unsigned char[c.capacity]);
+			c.used = 0;
+			c.live = 0;
+			chunks.emplace_back(std::move(c));
+		}
+		auto & c = chunks.back();
+		auto dest = c.bytes.get() + c.used;
+		std::copy(text.cbegin(), text.cend(), dest);
+		dest[text.size()] = '\0';
+		c.used += needed;
+		++c.live;
+		return dest;
+	}
+
+	/* the oldest entry went away */
+	void release_front()
+	{
+		if (chunks.empty())
+			return;
+		auto & c = chunks.front();
+		if (--c.live == 0)
+		{
+			if (chunks.size() > 1)
+				chunks.pop_front();
+			else
+				c.used = 0;
+		}
+	}
+
+	/* the newest entry went away, its bytes are at the end of the last chunk */
+	void release_back(const entry_text & text)
+	{
+		if (chunks.empty())
+			return;
+		auto & c = chunks.back();
+		c.used = text.c_str() - c.bytes.get();
+		if (--c.live == 0 && chunks.size() > 1)
+			chunks.pop_back();
+	}
+
+	void clear()
+	{
+		chunks.clear();
+	}
+};
+
 struct textentry
 {
+	/* everything the wrap points of an entry depend on */
+	struct wrap_key
+	{
+		int win_width;
+		int buf_indent;
+		gint16 indent;
+		gint16 str_width;
+		unsigned int font_generation;
+		bool wordwrap;
+		bool ignore_hidden;	/* hidden text takes up room when it's shown */
+
+		bool operator==(const wrap_key & other) const
+		{
+			return win_width == other.win_width && buf_indent == other.buf_indent &&
+				indent == other.indent && str_width == other.str_width &&
+				font_generation == other.font_generation && wordwrap == other.wordwrap &&
+				ignore_hidden == other.ignore_hidden;
+		}
+	};
+
 	textentry()
 		:tag(),
 		str_width(),
@@ -99,7 +214,9 @@ struct textentry
 		stamp(),
 		next(),
 		prev(),
-		marks(){}
+		marks(),
+		wrap(),
+		prev_wrap(){}
 	textentry(const textentry & other) = default;
 	textentry& operator=(const textentry& other) = default;
 	textentry& operator=(textentry&& other) NOEXCEPT
@@ -118,6 +235,9 @@ struct textentry
 			std::swap(this->marks, other.marks);
 			std::swap(this->slp, other.slp);
 			std::swap(this->sublines, other.sublines);
+			std::swap(this->wrap, other.wrap);
+			std::swap(this->prev_sublines, other.prev_sublines);
+			std::swap(this->prev_wrap, other.prev_wrap);
 			std::swap(this->str, other.str);
 		}
 		return *this;
@@ -139,7 +259,10 @@ struct textentry
 	GList *marks;	/* List of found strings */
 	std::vector<offlen_t> slp;
 	std::vector<int> sublines;
-	ustring str;
+	wrap_key wrap;			/* what sublines was computed for */
+	std::vector<int> prev_sublines;	/* the layout before the last re-wrap */
+	wrap_key prev_wrap;
+	entry_text str;
 };
 
 struct xtext_impl
@@ -155,6 +278,7 @@ struct xtext_impl
 	textentry *marker_pos;
 	
 	std::deque<textentry> entries;
+	text_arena text;
 
 	xtext_impl()
 		:marker_state(),
@@ -233,6 +357,8 @@ namespace
 		int strip_hidden);
 	static bool gtk_xtext_check_ent_visibility(GtkXText * xtext, textentry *find_ent, int add);
 	static int gtk_xtext_render_page_timeout(GtkXText * xtext);
+	static void gtk_xtext_queue_render(GtkXText * xtext);
+	static void gtk_xtext_unqueue_render(GtkXText * xtext);
 	static int gtk_xtext_search_offset(xtext_buffer *buf, textentry *ent, unsigned int off);
 	static GList * gtk_xtext_search_textentry(xtext_buffer *, const textentry &);
 	static void gtk_xtext_search_textentry_add(xtext_buffer *, textentry *, GList *, bool);
@@ -277,6 +403,27 @@ namespace
 	static PangoAttrList *attr_lists[4];
 	static int fontwidths[4][128];
 
+	/* advance widths for everything that isn't ASCII, filled in lazily.
+	 * The BMP gets a flat table, anything above it and multi-codepoint
+	 * grapheme clusters (combining marks, ZWJ emoji sequences) go in maps. */
+	struct glyph_width_cache
+	{
+		enum { UNKNOWN = 0xFFFF, BMP_SIZE = 0x10000 };
+		std::unique_ptr<guint16[]> bmp;
+		std::unordered_map<gunichar, int> astral;
+		std::unordered_map<std::string, int> clusters;
+
+		void clear()
+		{
+			bmp.reset();
+			astral.clear();
+			clusters.clear();
+		}
+	};
+	static glyph_width_cache glyph_widths[4];
+	/* bumped on every font change so cached wrap points can be discarded */
+	static unsigned int font_generation;
+
 	static PangoAttribute *
 		xtext_pango_attr(PangoAttribute *attr)
 	{
@@ -290,6 +437,10 @@ namespace
 	{
 		char buf[2] = "\000";
 
+		++font_generation;
+		for (auto & cache : glyph_widths)
+			cache.clear();
+
 		if (attr_lists[0])
 		{
 			for (int i = 0; i < (EMPH_ITAL | EMPH_BOLD); i++)
@@ -398,6 +549,87 @@ namespace
 		xtext->font->descent = pango_font_metrics_get_descent(metrics.get()) / PANGO_SCALE;
 	}
 
+	static bool is_cluster_extender(gunichar c)
+	{
+		return g_unichar_ismark(c) ||
+			(c >= 0xFE00 && c <= 0xFE0F) ||	/* variation selectors */
+			(c >= 0x1F3FB && c <= 0x1F3FF) ||	/* emoji skin tone modifiers */
+			(c >= 0xE0020 && c <= 0xE007F);	/* tag sequences */
+	}
+
+	/* length in bytes of the grapheme cluster starting at str */
+	static int cluster_len(const unsigned char *str, const unsigned char *end)
+	{
+		auto p = str + charlen(str);
+		while (p < end)
+		{
+			auto c = g_utf8_get_char_validated(reinterpret_cast<const gchar*>(p), end - p);
+			if (c == static_cast<gunichar>(-1) || c == static_cast<gunichar>(-2))
+				break;
+			if (c == 0x200D) /* ZWJ glues the next codepoint on as well */
+			{
+				p += charlen(p);
+				if (p < end)
+					p += charlen(p);
+				continue;
+			}
+			if (!is_cluster_extender(c))
+				break;
+			p += charlen(p);
+		}
+		return static_cast<int>(std::min(p, end) - str);
+	}
+
+	static int backend_measure_text(GtkXText *xtext, const unsigned char *str, int len, int emphasis)
+	{
+		int width;
+		pango_layout_set_attributes(xtext->layout, attr_lists[emphasis]);
+		pango_layout_set_text(xtext->layout, reinterpret_cast<const char*>(str), len);
+		pango_layout_get_pixel_size(xtext->layout, &width, nullptr);
+		return width;
+	}
+
+	/* width of one non-ASCII cluster, shaped by pango only the first time it's seen */
+	static int backend_get_glyph_width(GtkXText *xtext, const unsigned char *str, int len, int emphasis)
+	{
+		auto & cache = glyph_widths[emphasis];
+		if (len != charlen(str))
+		{
+			std::string key(reinterpret_cast<const char*>(str), len);
+			auto found = cache.clusters.find(key);
+			if (found != cache.clusters.end())
+				return found->second;
+			int width = backend_measure_text(xtext, str, len, emphasis);
+			cache.clusters.emplace(std::move(key), width);
+			return width;
+		}
+
+		auto c = g_utf8_get_char_validated(reinterpret_cast<const gchar*>(str), len);
+		if (c < glyph_width_cache::BMP_SIZE)
+		{
+			if (!cache.bmp)
+			{
+				cache.bmp.reset(new guint16[glyph_width_cache::BMP_SIZE]);
+				std::fill_n(cache.bmp.get(), glyph_width_cache::BMP_SIZE, glyph_width_cache::UNKNOWN);
+			}
+			auto & width = cache.bmp[c];
+			if (width == glyph_width_cache::UNKNOWN)
+				width = static_cast<guint16>(backend_measure_text(xtext, str, len, emphasis));
+			return width;
+		}
+		if (c <= 0x10FFFF)
+		{
+			auto found = cache.astral.find(c);
+			if (found != cache.astral.end())
+				return found->second;
+			int width = backend_measure_text(xtext, str, len, emphasis);
+			cache.astral.emplace(c, width);
+			return width;
+		}
+		/* invalid UTF-8, not worth remembering */
+		return backend_measure_text(xtext, str, len, emphasis);
+	}
+
 	static int backend_get_text_width_emph(GtkXText *xtext, const ustring_ref & str, int emphasis)
 	{
 		if (str.empty())
@@ -408,19 +640,19 @@ namespace
 		emphasis &= (EMPH_ITAL | EMPH_BOLD);
 
 		int width = 0;
-		pango_layout_set_attributes(xtext->layout, attr_lists[emphasis]);
 		for (auto itr = str.cbegin(), end = str.cend(); itr != end;)
 		{
-			int mbl = charlen(itr);
-			int deltaw;
+			int mbl;
 			if (*itr < 128)
-				deltaw = fontwidths[emphasis][*itr];
+			{
+				mbl = 1;
+				width += fontwidths[emphasis][*itr];
+			}
 			else
 			{
-				pango_layout_set_text(xtext->layout, reinterpret_cast<const char*>(itr), mbl);
-				pango_layout_get_pixel_size(xtext->layout, &deltaw, nullptr);
+				mbl = cluster_len(itr, end);
+				width += backend_get_glyph_width(xtext, itr, mbl, emphasis);
 			}
-			width += deltaw;
 			if (mbl < std::distance(itr, end))
 				itr += mbl;
 			else
@@ -507,7 +739,7 @@ namespace
 	{
 		xtext->pixmap = nullptr;
 		xtext->io_tag = 0;
-		xtext->add_io_tag = 0;
+		xtext->render_queued = false;
 		xtext->scroll_tag = 0;
 		xtext->max_lines = 0;
 		xtext->col_back = XTEXT_BG;
@@ -649,11 +881,7 @@ namespace {
 	{
 		GtkXText *xtext = GTK_XTEXT(object);
 
-		if (xtext->add_io_tag)
-		{
-			g_source_remove(xtext->add_io_tag);
-			xtext->add_io_tag = 0;
-		}
+		gtk_xtext_unqueue_render(xtext);
 
 		if (xtext->scroll_tag)
 		{
@@ -2869,7 +3097,7 @@ namespace{
 		if (!xtext->skip_border_fills && !xtext->dont_render)
 		{
 			/* draw background to the left of the text */
-			if (str == ent->str && indent > MARGIN && xtext->buffer->time_stamp)
+			if (str == ent->str.c_str() && indent > MARGIN && xtext->buffer->time_stamp)
 			{
 				/* don't overwrite the timestamp */
 				if (indent > xtext->stamp_width)
@@ -3310,7 +3538,8 @@ namespace{
 				default:
 				def :
 				{
-					int mbl = static_cast<int>(charlen(str));
+					/* never wrap in the middle of a grapheme cluster */
+					int mbl = *str < 128 ? 1 : cluster_len(str, ent.str.c_str() + ent.str.size());
 					int char_width = backend_get_text_width_emph(xtext, ustring_ref(str, mbl), emphasis);
 					if (!hidden) str_width += char_width;
 					if (str_width > win_width)
@@ -3382,9 +3611,15 @@ namespace{
 	void gtk_xtext_render_stamp(GtkXText * xtext, textentry * ent,
 		const boost::string_ref & text, int line, int win_width)
 	{
+		/* render_str looks one byte past a color code's digits, so it gets a
+		 * NUL terminated copy of the stamp, in an entry of its own that
+		 * only carries what render_str reads from it */
+		const std::string stamp(text.begin(), text.end());
+		textentry tmp_ent;
+		tmp_ent.str = entry_text{ reinterpret_cast<const unsigned char*>(stamp.c_str()), stamp.size() };
+		tmp_ent.mark_start = -1;
+		tmp_ent.mark_end = -1;
 
-		/* trashing ent here, so make a backup first */
-		textentry tmp_ent(*ent);
 		auto jo = xtext->jump_out_offset;	/* back these up */
 		auto ji = xtext->jump_in_offset;
 		auto hs = xtext->hilight_start;
@@ -3392,29 +3627,19 @@ namespace{
 		xtext->jump_in_offset = 0;
 		xtext->hilight_start = 0xffff;	/* temp disable */
 
-		if (xtext->mark_stamp)
+		/* if this line is marked, mark this stamp too */
+		if (xtext->mark_stamp && ent->mark_start == 0)
 		{
-			/* if this line is marked, mark this stamp too */
-			if (tmp_ent.mark_start == 0)
-			{
-				tmp_ent.mark_start = 0;
-				tmp_ent.mark_end = text.size();
-			}
-			else
-			{
-				tmp_ent.mark_start = -1;
-				tmp_ent.mark_end = -1;
-			}
-			tmp_ent.str = ustring{ text.cbegin(), text.cend() };
+			tmp_ent.mark_start = 0;
+			tmp_ent.mark_end = stamp.size();
 		}
 
 		int xsize, emphasis = 0;
 		auto y = (xtext->fontsize * line) + xtext->font->ascent - xtext->pixel_offset;
-		gtk_xtext_render_str(xtext, y, &tmp_ent, (const unsigned char*)text.data(), text.size(),
+		gtk_xtext_render_str(xtext, y, &tmp_ent, tmp_ent.str.c_str(), stamp.size(),
 			win_width, 2, line, true, &xsize, &emphasis);
 
 		/* restore everything back to how it was */
-		//(*ent) = std::move(tmp_ent);
 		xtext->jump_out_offset = jo;
 		xtext->jump_in_offset = ji;
 		xtext->hilight_start = hs;
@@ -3657,8 +3882,27 @@ namespace{
 
 	int gtk_xtext_lines_taken(xtext_buffer *buf, textentry & ent)
 	{
-		ent.sublines.clear();
 		int win_width = buf->window_width - MARGIN;
+		const textentry::wrap_key key = { win_width, buf->indent, ent.indent, ent.str_width,
+			font_generation, buf->xtext->wordwrap, buf->xtext->ignore_hidden };
+
+		/* resizing back and forth between two widths (e.g. maximize) costs nothing */
+		if (!ent.sublines.empty() && ent.wrap == key)
+			return ent.sublines.size();
+		if (!ent.prev_sublines.empty() && ent.prev_wrap == key)
+		{
+			std::swap(ent.sublines, ent.prev_sublines);
+			std::swap(ent.wrap, ent.prev_wrap);
+			return ent.sublines.size();
+		}
+
+		if (!ent.sublines.empty())
+		{
+			std::swap(ent.sublines, ent.prev_sublines);
+			ent.prev_wrap = ent.wrap;
+		}
+		ent.sublines.clear();
+		ent.wrap = key;
 
 		if (win_width >= ent.indent + ent.str_width)
 		{
@@ -4010,7 +4254,7 @@ namespace{
 
 		if (gtk_xtext_kill_ent(buffer, ent))
 		{
-			if (!buffer->xtext->add_io_tag)
+			if (!buffer->xtext->render_queued)
 			{
 				/* remove scrolling events */
 				if (buffer->xtext->io_tag)
@@ -4019,13 +4263,11 @@ namespace{
 					buffer->xtext->io_tag = 0;
 				}
 				buffer->xtext->force_render = true;
-				buffer->xtext->add_io_tag = g_timeout_add(REFRESH_TIMEOUT * 2,
-					(GSourceFunc)
-					gtk_xtext_render_page_timeout,
-					buffer->xtext);
+				gtk_xtext_queue_render(buffer->xtext);
 			}
 		}
 		buffer->impl->entries.pop_front();
+		buffer->impl->text.release_front();
 	}
 
 	static void
@@ -4049,7 +4291,7 @@ namespace{
 
 		if (gtk_xtext_kill_ent(buffer, ent))
 		{
-			if (!buffer->xtext->add_io_tag)
+			if (!buffer->xtext->render_queued)
 			{
 				/* remove scrolling events */
 				if (buffer->xtext->io_tag)
@@ -4058,12 +4300,10 @@ namespace{
 					buffer->xtext->io_tag = 0;
 				}
 				buffer->xtext->force_render = true;
-				buffer->xtext->add_io_tag = g_timeout_add(REFRESH_TIMEOUT * 2,
-					(GSourceFunc)
-					gtk_xtext_render_page_timeout,
-					buffer->xtext);
+				gtk_xtext_queue_render(buffer->xtext);
 			}
 		}
+		buffer->impl->text.release_back(ent->str);
 		buffer->impl->entries.pop_back();
 	}
 
@@ -4117,6 +4357,7 @@ gtk_xtext_clear(xtext_buffer *buf, int lines)
 			marker_reset = true;
 		dontscroll(buf);
 		buf->impl->entries.clear();
+		buf->impl->text.clear();
 		buf->impl->text_first = nullptr;
 		/*while (buf->text_first)
 		{
@@ -4565,8 +4806,6 @@ namespace {
 	{
 		GtkAdjustment *adj = xtext->adj;
 
-		xtext->add_io_tag = 0;
-
 		/* less than a complete page? */
 		if (xtext->buffer->num_lines <= adj->page_size)
 		{
@@ -4596,13 +4835,78 @@ namespace {
 		return 0;
 	}
 
+	/*
+	* Appends don't redraw right away. Every widget with new text joins one
+	* queue which is drained once per frame, at the same priority as the
+	* server sockets so a flood of input can't starve it (GDK's redraw
+	* priority is lower than theirs), and only for as long as the frame
+	* budget allows; the rest waits for the next frame. render_page blits
+	* what is already on screen when scrolled to the bottom, so only the new
+	* lines get painted. /GUI FRAMES reports the frame stats.
+	*/
+	enum { FRAME_INTERVAL = 16, FRAME_BUDGET = 8000 /* microseconds */ };
+	static std::vector<GtkXText*> render_queue;
+	static guint render_tag;
+	static xtext_frame_stats frame_stats;
+
+	static gboolean gtk_xtext_render_frame(gpointer)
+	{
+		const auto start = g_get_monotonic_time();
+		std::size_t rendered = 0;
+		while (rendered < render_queue.size())
+		{
+			auto xtext = render_queue[rendered++];
+			xtext->render_queued = false;
+			gtk_xtext_render_page_timeout(xtext);
+			if (g_get_monotonic_time() - start >= FRAME_BUDGET)
+				break;
+		}
+		render_queue.erase(render_queue.begin(), render_queue.begin() + rendered);
+
+		const auto elapsed = g_get_monotonic_time() - start;
+		/* everything queued may have been unqueued since */
+		if (rendered)
+			frame_stats.frames++;
+		frame_stats.renders += rendered;
+		frame_stats.deferred += render_queue.size();
+		frame_stats.total_us += elapsed;
+		frame_stats.max_us = std::max(frame_stats.max_us, elapsed);
+
+		if (!render_queue.empty())
+			return TRUE;
+		render_tag = 0;
+		return FALSE;
+	}
+
+	static void gtk_xtext_queue_render(GtkXText * xtext)
+	{
+		if (xtext->render_queued)
+			return;
+		xtext->render_queued = true;
+		render_queue.push_back(xtext);
+		if (!render_tag)
+			render_tag = g_timeout_add_full(G_PRIORITY_DEFAULT, FRAME_INTERVAL,
+				gtk_xtext_render_frame, nullptr, nullptr);
+	}
+
+	static void gtk_xtext_unqueue_render(GtkXText * xtext)
+	{
+		if (!xtext->render_queued)
+			return;
+		xtext->render_queued = false;
+		render_queue.erase(std::remove(render_queue.begin(), render_queue.end(), xtext),
+			render_queue.end());
+	}
+
 	/* append a textentry to our linked list */
-	static void gtk_xtext_append_entry(xtext_buffer *buf, const textentry && ent, time_t stamp) = delete;
+	static void gtk_xtext_append_entry(xtext_buffer *buf, const textentry && ent, const ustring_ref & text, time_t stamp) = delete;
 
-	static void gtk_xtext_append_entry(xtext_buffer *buf, textentry && ent, time_t stamp)
+	static void gtk_xtext_append_entry(xtext_buffer *buf, textentry && ent, const ustring_ref & text, time_t stamp)
 	{
+		auto stored = buf->impl->text.store(text);
 		/* we don't like tabs */
-		std::replace(ent.str.begin(), ent.str.end(), '\t', ' ');
+		std::replace(stored, stored + text.size(), '\t', ' ');
+		ent.str = entry_text{ stored, text.size() };
 
 		ent.stamp = stamp;
 		if (stamp == 0)
@@ -4648,7 +4952,7 @@ namespace {
 			if ((buf->num_lines - 1) <= buf->xtext->adj->page_size)
 				dontscroll(buf);
 
-			if (!buf->xtext->add_io_tag)
+			if (!buf->xtext->render_queued)
 			{
 				/* remove scrolling events */
 				if (buf->xtext->io_tag)
@@ -4656,10 +4960,7 @@ namespace {
 					g_source_remove(buf->xtext->io_tag);
 					buf->xtext->io_tag = 0;
 				}
-				buf->xtext->add_io_tag = g_timeout_add(REFRESH_TIMEOUT * 2,
-					(GSourceFunc)
-					gtk_xtext_render_page_timeout,
-					buf->xtext);
+				gtk_xtext_queue_render(buf->xtext);
 			}
 		}
 		if (buf->scrollbar_down)
@@ -4677,6 +4978,16 @@ namespace {
 
 } // end anonymous namespace
 
+const xtext_frame_stats & gtk_xtext_get_frame_stats()
+{
+	return frame_stats;
+}
+
+void gtk_xtext_reset_frame_stats()
+{
+	frame_stats = xtext_frame_stats();
+}
+
 /* the main two public functions */
 
 void gtk_xtext_append_indent(xtext_buffer *buf, const unsigned char left_text[],
@@ -4696,8 +5007,8 @@ void gtk_xtext_append_indent(xtext_buffer *buf, const unsigned char left_text[],
 		right_len--;
 
 	textentry ent;
-	ent.str.resize(left_len + right_len + 1, '\0');
-	auto str = ent.str.begin();
+	ustring text(left_len + right_len + 1, '\0');
+	auto str = text.begin();
 	if (left_text)
 		std::copy_n(left_text, left_len, str);
 	str[left_len] = ' ';
@@ -4731,7 +5042,7 @@ void gtk_xtext_append_indent(xtext_buffer *buf, const unsigned char left_text[],
 		buf->xtext->force_render = true;
 	}
 
-	gtk_xtext_append_entry(buf, std::move(ent), stamp);
+	gtk_xtext_append_entry(buf, std::move(ent), text, stamp);
 }
 
 void gtk_xtext_append(xtext_buffer *buf, boost::string_ref text, time_t stamp)
@@ -4743,14 +5054,11 @@ void gtk_xtext_append(xtext_buffer *buf, boost::string_ref text, time_t stamp)
 		text.remove_suffix(sizeof(buf->xtext->scratch_buffer) - 1);
 
 	textentry ent;
-	if (!text.empty())
-	{
-		ent.str = ustring{text.cbegin(), text.cend()};
-	}
 	ent.indent = 0;
 	ent.left_len = -1;
 
-	gtk_xtext_append_entry(buf, std::move(ent), stamp);
+	gtk_xtext_append_entry(buf, std::move(ent),
+		ustring_ref(reinterpret_cast<const unsigned char*>(text.data()), text.size()), stamp);
 }
 
 bool gtk_xtext_is_empty(const xtext_buffer &buf)
@@ -4921,11 +5229,7 @@ gtk_xtext_buffer_show(GtkXText *xtext, xtext_buffer *buf, bool render)
 
 	/*printf("text_buffer_show: xtext=%p buffer=%p\n", xtext, buf);*/
 
-	if (xtext->add_io_tag)
-	{
-		g_source_remove(xtext->add_io_tag);
-		xtext->add_io_tag = 0;
-	}
+	gtk_xtext_unqueue_render(xtext);
 
 	if (xtext->io_tag)
 	{
@@ -157,7 +157,6 @@ struct GtkXText
 	GdkColor palette[XTEXT_COLS];
 
 	gint io_tag;					  /* for delayed refresh events */
-	gint add_io_tag;				  /* "" when adding new text */
 	gint scroll_tag;				  /* marking-scroll timeout */
 	gulong vc_signal_tag;        /* signal handler for "value_changed" adj */
 
@@ -240,6 +239,7 @@ struct GtkXText
 	bool un_hilight;
 	bool force_render;
 	bool color_paste; /* CTRL was pressed when selection finished */
+	bool render_queued; /* new text waiting for the next frame */
 
 	/* settings/prefs */
 	bool auto_indent;
@@ -257,6 +257,16 @@ struct GtkXTextClass
 	void(*set_scroll_adjustments) (GtkXText *xtext, GtkAdjustment *hadj, GtkAdjustment *vadj);
 };
 
+/* accumulated since startup (or the last reset), for benchmarking */
+struct xtext_frame_stats
+{
+	guint64 frames;		/* frames that redrew anything */
+	guint64 renders;		/* widgets redrawn, summed over all frames */
+	guint64 deferred;		/* widgets pushed to a later frame by the budget */
+	gint64 total_us;		/* time spent rendering */
+	gint64 max_us;		/* slowest single frame */
+};
+
 GtkWidget *gtk_xtext_new(GdkColor palette[], bool separator);
 void gtk_xtext_append(xtext_buffer *buf, boost::string_ref text, time_t stamp);
 void gtk_xtext_append_indent(xtext_buffer *buf,
@@ -296,6 +306,8 @@ void gtk_xtext_buffer_free(xtext_buffer *buf);
 void gtk_xtext_buffer_show(GtkXText *xtext, xtext_buffer *buf, bool render);
 void gtk_xtext_copy_selection(GtkXText *xtext);
 GType gtk_xtext_get_type(void);
+const xtext_frame_stats & gtk_xtext_get_frame_stats();
+void gtk_xtext_reset_frame_stats();
 
 
 #endif
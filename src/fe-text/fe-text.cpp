@@ -481,6 +481,7 @@ static const GOptionEntry gopt_entries[] =
  {"plugindir",	'p', 0, G_OPTION_ARG_NONE,	&arg_show_autoload, N_("Show plugin/script auto-load directory"), NULL},
  {"configdir",	'u', 0, G_OPTION_ARG_NONE,	&arg_show_config, N_("Show user config directory"), NULL},
  {"url",	 0,  G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING,	&arg_url, N_("Open an irc://server:port/channel URL"), "URL"},
+ {"trace-startup",	 0,  0, G_OPTION_ARG_NONE,	&arg_trace_startup, N_("Show where startup time goes and save it as startup-trace.json"), NULL},
  {"version",	'v', 0, G_OPTION_ARG_NONE,	&arg_show_version, N_("Show version information"), NULL},
  {G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &arg_urls, N_("Open an irc://server:port/channel?key URL"), "URL"},
  {NULL}
@@ -662,7 +663,7 @@ fe_chan_list_end (struct server *serv)
 {
 }
 gboolean
-fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, int rplcode)
+fe_add_ban_list (struct session *sess, char *mask, char *who, char *when, time_t stamp, int rplcode)
 {
 	return 0;
 }
@@ -701,17 +702,20 @@ void
 fe_userlist_insert (struct session *, struct User *, int, bool)
 {
 }
-bool
-fe_userlist_remove (struct session *, struct User const *)
+void
+fe_userlist_remove (struct session *, struct User const *, int)
 {
-	return false;
 }
 void
 fe_userlist_rehash (struct session *, struct User const *)
 {
 }
 void
-fe_userlist_move (struct session *, struct User *, int )
+fe_userlist_move (struct session *, struct User *, int, int)
+{
+}
+void
+fe_userlist_reorder (struct session *, const struct userlist_moves &)
 {
 }
 void
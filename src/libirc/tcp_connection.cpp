@@ -20,9 +20,11 @@
 #include <algorithm>
 #include <istream>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
@@ -41,19 +43,122 @@ namespace{
 		boost::asio::io_service io_service;
 	};
 
-	struct ssl_context : public context{
-		ssl_context(boost::asio::ssl::context::verify_mode mode)
-			:ssl_ctx(io_service, boost::asio::ssl::context::tlsv1)
+	/* The client TLS context, one per verify mode for the whole process.
+	 * It remembers the last session of each host:port, so reconnecting
+	 * resumes it with an abbreviated handshake. */
+	class tls_client
+	{
+	public:
+		static tls_client & get(boost::asio::ssl::context::verify_mode mode)
+		{
+			static tls_client verify_none(boost::asio::ssl::verify_none);
+			static tls_client verify_peer(boost::asio::ssl::verify_peer);
+			return mode == boost::asio::ssl::verify_none ? verify_none : verify_peer;
+		}
+
+		boost::asio::ssl::context & context()
+		{
+			return ssl_ctx_;
+		}
+
+		/* before the handshake: SNI, and the session to resume if we have one */
+		void prepare(SSL * ssl, const std::string & host, const std::string & service)
+		{
+			boost::system::error_code ec;
+			boost::asio::ip::address::from_string(host, ec);
+			if (ec)	/* a name, not an address */
+				SSL_set_tlsext_host_name(ssl, host.c_str());
+
+			auto peer = new std::string(host + ":" + service);
+			SSL_set_ex_data(ssl, peer_index(), peer);
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto found = sessions_.find(*peer);
+			if (found != sessions_.end())
+				SSL_set_session(ssl, found->second.get());
+		}
+
+	private:
+		typedef std::unique_ptr<SSL_SESSION, decltype(&SSL_SESSION_free)> session_ptr;
+
+		explicit tls_client(boost::asio::ssl::context::verify_mode mode)
+			:ssl_ctx_(boost::asio::ssl::context::sslv23)
 		{
-			ssl_ctx.set_options(
+			ssl_ctx_.set_options(
 				boost::asio::ssl::context::no_sslv2 |
 				boost::asio::ssl::context::no_sslv3 |
-				boost::asio::ssl::context::no_compression | 
+				boost::asio::ssl::context::no_compression |
 				boost::asio::ssl::context::single_dh_use |
 				SSL_OP_CIPHER_SERVER_PREFERENCE);
-			ssl_ctx.set_verify_mode(mode);
+			ssl_ctx_.set_verify_mode(mode);
+
+			/* OpenSSL's own cache is keyed by session id, which only a
+			 * server can use; we keep ours by peer instead */
+			/* the app data is boost's, for its verify callback */
+			auto ctx = ssl_ctx_.native_handle();
+			SSL_CTX_set_ex_data(ctx, client_index(), this);
+			SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+			SSL_CTX_sess_set_new_cb(ctx, &tls_client::new_session);
+		}
+
+		static int client_index()
+		{
+			static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+			return index;
+		}
+
+		/* the host:port a connection's SSL is for, freed along with it */
+		static int peer_index()
+		{
+			static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr,
+				[](void *, void * ptr, CRYPTO_EX_DATA *, int, long, void *)
+				{
+					delete static_cast<std::string *>(ptr);
+				});
+			return index;
+		}
+
+		/* OpenSSL has a session (or a TLS 1.3 ticket) we can resume later */
+		static int new_session(SSL * ssl, SSL_SESSION * session)
+		{
+			auto peer = static_cast<std::string *>(SSL_get_ex_data(ssl, peer_index()));
+			if (!peer)
+				return 0;
+
+			/* a connection that drops without a TLS shutdown, as they do
+			 * when the network goes away, gets its session marked as not
+			 * resumable; a copy of it doesn't */
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+			session_ptr copy(SSL_SESSION_dup(session), &SSL_SESSION_free);
+			const int taken = 0;
+#else
+			session_ptr copy(session, &SSL_SESSION_free);
+			const int taken = 1;
+#endif
+			if (!copy)
+				return 0;
+
+			auto self = static_cast<tls_client *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), client_index()));
+			std::lock_guard<std::mutex> lock(self->mutex_);
+			auto found = self->sessions_.find(*peer);
+			if (found != self->sessions_.end())
+				found->second = std::move(copy);
+			else
+				self->sessions_.emplace(*peer, std::move(copy));
+			return taken;
 		}
-		boost::asio::ssl::context ssl_ctx;
+
+		boost::asio::ssl::context ssl_ctx_;
+		std::mutex mutex_;
+		std::unordered_map<std::string, session_ptr> sessions_;	/* by host:port */
+	};
+
+	struct ssl_context : public context{
+		explicit ssl_context(tls_client & client)
+			:client(client)
+		{
+		}
+		tls_client & client;
 	};
 
 	template<class SocketType_>
@@ -140,7 +245,7 @@ namespace{
 	struct ssl_connection : public basic_connection < boost::asio::ssl::stream<boost::asio::ip::tcp::socket> >
 	{
 		ssl_connection(ssl_context * ctx)
-			:basic_connection(ctx, ctx->ssl_ctx)
+			:basic_connection(ctx, ctx->client.context()), client_(ctx->client)
 		{
 		}
 
@@ -149,6 +254,7 @@ namespace{
 		{
 			if (!error)
 			{
+				client_.prepare(socket_.native_handle(), endpoint_iterator->host_name(), endpoint_iterator->service_name());
 				socket_.async_handshake(boost::asio::ssl::stream_base::client,
 					boost::bind(&ssl_connection::handle_handshake, this,
 					boost::asio::placeholders::error));
@@ -171,7 +277,7 @@ namespace{
 					boost::asio::placeholders::bytes_transferred));
 
 				// callback to allow for printing of cipher info
-				this->on_ssl_handshakecomplete(socket_.impl()->ssl);
+				this->on_ssl_handshakecomplete(socket_.native_handle());
 				this->on_connect(error);
 			}
 			else
@@ -179,6 +285,8 @@ namespace{
 				this->handle_error(error);
 			}
 		}
+
+		tls_client & client_;
 	};
 
 	struct tcp_connection : public basic_connection < boost::asio::ip::tcp::socket >
@@ -322,7 +430,7 @@ namespace io{
 #ifdef WIN32
 				w32::crypto::seed_openssl_random();
 #endif
-				return std::make_unique<ssl_connection>(new ssl_context(security == connection_security::enforced ? boost::asio::ssl::verify_peer : boost::asio::ssl::verify_none));
+				return std::make_unique<ssl_connection>(new ssl_context(tls_client::get(security == connection_security::enforced ? boost::asio::ssl::verify_peer : boost::asio::ssl::verify_none)));
 			}
 			return std::make_unique<tcp_connection>(new context());
 		}
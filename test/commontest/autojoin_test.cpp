@@ -0,0 +1,88 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <autojoin.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+	std::vector<favchannel> make_channels(int count, const char *prefix = "#channel")
+	{
+		std::vector<favchannel> channels;
+		for (int i = 0; i < count; ++i)
+			channels.push_back(favchannel{ prefix + std::to_string(i), boost::none });
+		return channels;
+	}
+
+	std::size_t count_targets(const std::string & line)
+	{
+		const auto names = line.substr(5, line.find(' ', 5) - 5);
+		return std::count(names.begin(), names.end(), ',') + 1;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(autojoin_test)
+
+BOOST_AUTO_TEST_CASE(pack_fills_lines_to_the_limit)
+{
+	const auto channels = make_channels(400);
+	const auto lines = autojoin::pack(channels, 0);
+
+	std::size_t targets = 0;
+	for (const auto & line : lines)
+	{
+		BOOST_REQUIRE_LE(line.size() + 2, static_cast<std::size_t>(autojoin::MAX_LINE));
+		BOOST_REQUIRE_EQUAL(line.compare(0, 5, "JOIN "), 0);
+		targets += count_targets(line);
+	}
+	BOOST_REQUIRE_EQUAL(targets, channels.size());
+	/* every line but the last is full: one more channel wouldn't fit */
+	for (std::size_t i = 0; i + 1 < lines.size(); ++i)
+		BOOST_REQUIRE_GT(lines[i].size() + 2 + 1 + std::string("#channel399").size(), static_cast<std::size_t>(autojoin::MAX_LINE));
+}
+
+BOOST_AUTO_TEST_CASE(pack_respects_targmax)
+{
+	const auto lines = autojoin::pack(make_channels(10, "#c"), 4);
+	BOOST_REQUIRE_EQUAL(lines.size(), 3u);
+	BOOST_REQUIRE_EQUAL(lines[0], "JOIN #c0,#c1,#c2,#c3");
+	BOOST_REQUIRE_EQUAL(lines[2], "JOIN #c8,#c9");
+}
+
+BOOST_AUTO_TEST_CASE(pack_puts_keyed_channels_first)
+{
+	std::vector<favchannel> channels{
+		{ "#open", boost::none },
+		{ "#locked", std::string("secret") },
+		{ "#other", boost::none },
+		{ "#vault", std::string("hunter2") },
+	};
+	const auto lines = autojoin::pack(channels, 0);
+	BOOST_REQUIRE_EQUAL(lines.size(), 1u);
+	BOOST_REQUIRE_EQUAL(lines[0], "JOIN #locked,#vault,#open,#other secret,hunter2");
+
+	BOOST_REQUIRE(autojoin::pack({}, 0).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,241 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <banlist-store.hpp>
+#include <casemap.hpp>
+#include <util.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "bench.hpp"
+
+namespace
+{
+	struct user
+	{
+		std::string nick;
+		std::string ident;
+		std::string host;
+	};
+
+	std::vector<user> make_users(int count)
+	{
+		std::vector<user> users;
+		for (int i = 0; i < count; ++i)
+		{
+			const auto n = std::to_string(i);
+			users.push_back(user{ "Nick" + n, "id" + std::to_string(i % 50),
+				i % 3 ? "host" + n + ".isp" + std::to_string(i % 20) + ".example.net"
+					: "10.0." + std::to_string(i % 7) + "." + std::to_string(i % 250) });
+		}
+		return users;
+	}
+
+	/* the kinds of masks real channels pile up */
+	std::vector<banlist::entry> make_bans(int count)
+	{
+		std::vector<banlist::entry> bans;
+		for (int i = 0; i < count; ++i)
+		{
+			const auto n = std::to_string(i);
+			std::string mask;
+			switch (i % 8)
+			{
+			case 0: mask = "*!*@host" + n + ".isp" + std::to_string(i % 20) + ".example.net"; break;
+			case 1: mask = "Nick" + n + "!*@*"; break;
+			case 2: mask = "*!id" + std::to_string(i % 97) + "@*"; break;
+			case 3: mask = "*!*@*.isp" + std::to_string(100 + i % 40) + ".example.net"; break;
+			case 4: mask = "*!*@10." + std::to_string(1 + i % 9) + ".*"; break;
+			case 5: mask = "*badword" + n + "*!*@*"; break;
+			case 6: mask = "$a:account" + n; break;
+			default: mask = "Nick" + n + "!id" + std::to_string(i % 50) + "@*.example.net"; break;
+			}
+			bans.push_back(banlist::entry{ mask, "op!op@staff", 1400000000 + i * 37 % 100000 });
+		}
+		return bans;
+	}
+
+	void match_all(const std::vector<banlist::entry> & bans, const user & u, std::vector<std::size_t> & out)
+	{
+		out.clear();
+		const auto full = u.nick + "!" + u.ident + "@" + u.host;
+		for (std::size_t i = 0; i < bans.size(); ++i)
+			if (bans[i].mask.find('!') != std::string::npos && match(bans[i].mask.c_str(), full.c_str()))
+				out.push_back(i);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(banlist_store_test)
+
+BOOST_AUTO_TEST_CASE(store_follows_replies_and_modes)
+{
+	const casemap rfc;
+	banlist::store store;
+	BOOST_REQUIRE_EQUAL(banlist::from_reply(367), banlist::BANS);
+	BOOST_REQUIRE_EQUAL(banlist::from_end(729), banlist::QUIETS);
+	BOOST_REQUIRE_EQUAL(banlist::from_mode('I'), banlist::INVITES);
+	BOOST_REQUIRE_EQUAL(banlist::from_mode('o'), banlist::LIST_COUNT);
+
+	/* changes seen before the list was fetched */
+	store.add(banlist::BANS, "*!*@early", "op", 5, rfc);
+	BOOST_REQUIRE(!store.complete(banlist::BANS));
+
+	store.reply(banlist::BANS, "*!*@a", "op", 10);
+	store.reply(banlist::BANS, "*!*@b", "op", 20);
+	store.end(banlist::BANS);
+	BOOST_REQUIRE(store.complete(banlist::BANS));
+	BOOST_REQUIRE_EQUAL(store.entries(banlist::BANS).size(), 2u);
+	BOOST_REQUIRE_EQUAL(store.entries(banlist::BANS)[1].set_at, 20);
+
+	store.add(banlist::BANS, "*!*@C", "op2", 30, rfc);
+	store.add(banlist::BANS, "*!*@c", "op2", 31, rfc);	/* same mask */
+	BOOST_REQUIRE(store.remove(banlist::BANS, "*!*@A", rfc));
+	BOOST_REQUIRE(!store.remove(banlist::BANS, "*!*@nope", rfc));
+	const auto & bans = store.entries(banlist::BANS);
+	BOOST_REQUIRE_EQUAL(bans.size(), 2u);
+	BOOST_REQUIRE_EQUAL(bans[0].mask, "*!*@b");
+	BOOST_REQUIRE_EQUAL(bans[1].mask, "*!*@C");
+	BOOST_REQUIRE(store.entries(banlist::EXEMPTS).empty());
+
+	/* fetching it again starts over */
+	store.reply(banlist::BANS, "*!*@d", "op", 40);
+	BOOST_REQUIRE(!store.complete(banlist::BANS));
+	BOOST_REQUIRE_EQUAL(store.entries(banlist::BANS).size(), 1u);
+
+	store.clear();
+	BOOST_REQUIRE(store.entries(banlist::BANS).empty());
+}
+
+BOOST_AUTO_TEST_CASE(matcher_agrees_with_matching_every_mask)
+{
+	const auto bans = make_bans(2000);
+	auto users = make_users(600);
+	users.push_back(user{ "x", "y", "HOST8.ISP8.EXAMPLE.NET" });
+	users.push_back(user{ "NICK1", "z", "elsewhere" });
+	users.push_back(user{ "spambadword5here", "z", "elsewhere" });
+
+	banlist::matcher matcher(bans, casemap(casemap::RFC1459));
+	std::vector<std::size_t> expected, got;
+	std::size_t matched = 0;
+	for (const auto & u : users)
+	{
+		match_all(bans, u, expected);
+		matcher.match(u.nick, u.ident, u.host, got);
+		BOOST_REQUIRE(got == expected);
+		matched += got.size();
+	}
+	BOOST_REQUIRE_GT(matched, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(masks_fold_by_casemapping)
+{
+	/* [ and { are the same letter in rfc1459, not in ascii */
+	const std::vector<banlist::entry> bans = {
+		banlist::entry{ "*!*@Host[1].example", "op", 0 },
+		banlist::entry{ "Nick\\*!*@*", "op", 0 },
+	};
+	std::vector<std::size_t> got;
+
+	banlist::matcher rfc(bans, casemap(casemap::RFC1459));
+	rfc.match("x", "y", "host{1}.EXAMPLE", got);
+	BOOST_REQUIRE_EQUAL(got.size(), 1u);
+	/* the escaped star stays one, though rfc1459 folds a backslash to | */
+	rfc.match("NICK*", "y", "elsewhere", got);
+	BOOST_REQUIRE_EQUAL(got.size(), 1u);
+	rfc.match("nickx", "y", "elsewhere", got);
+	BOOST_REQUIRE(got.empty());
+
+	banlist::matcher ascii(bans, casemap(casemap::ASCII));
+	ascii.match("x", "y", "host{1}.EXAMPLE", got);
+	BOOST_REQUIRE(got.empty());
+	ascii.match("x", "y", "HOST[1].example", got);
+	BOOST_REQUIRE_EQUAL(got.size(), 1u);
+
+	banlist::store store;
+	store.add(banlist::BANS, "*!*@[a]", "op", 1, casemap(casemap::ASCII));
+	store.add(banlist::BANS, "*!*@{a}", "op", 2, casemap(casemap::ASCII));
+	BOOST_REQUIRE_EQUAL(store.entries(banlist::BANS).size(), 2u);
+	BOOST_REQUIRE(store.remove(banlist::BANS, "*!*@{A}", casemap(casemap::RFC1459)));
+	BOOST_REQUIRE_EQUAL(store.entries(banlist::BANS).size(), 1u);
+}
+
+/* not a correctness test: sorts and matches a 10k entry list */
+BOOST_AUTO_TEST_CASE(benchmark_10k_bans, *boost::unit_test::disabled())
+{
+	auto bans = make_bans(10000);
+	const auto users = make_users(2000);
+
+	/* what the ban list window did: parse the date text in every comparison */
+	std::vector<std::string> dates;
+	for (const auto & b : bans)
+	{
+		char buf[64];
+		std::strftime(buf, sizeof buf, "%a %b %d %H:%M:%S %Y", std::localtime(&b.set_at));
+		dates.emplace_back(buf);
+	}
+	auto parse = [](const std::string & text){
+		std::tm t{};
+		std::istringstream buffer(text);
+		buffer >> std::get_time(&t, "%a %b %d %H:%M:%S %Y");
+		return std::mktime(&t);
+	};
+	const auto parsed = bench::time_ms([&]{
+		std::sort(dates.begin(), dates.end(), [&](const std::string & a, const std::string & b){
+			return parse(a) > parse(b);
+		});
+	});
+	const auto stamped = bench::time_ms([&]{
+		std::sort(bans.begin(), bans.end(), [](const banlist::entry & a, const banlist::entry & b){
+			return a.set_at > b.set_at;
+		});
+	});
+
+	std::vector<std::size_t> out;
+	std::size_t slow_hits = 0, fast_hits = 0;
+	const auto every_mask = bench::time_ms([&]{
+		for (const auto & u : users)
+		{
+			match_all(bans, u, out);
+			slow_hits += out.size();
+		}
+	});
+	const auto compiled = bench::time_ms([&]{
+		banlist::matcher matcher(bans, casemap());
+		for (const auto & u : users)
+		{
+			matcher.match(u.nick, u.ident, u.host, out);
+			fast_hits += out.size();
+		}
+	});
+	BOOST_REQUIRE_EQUAL(slow_hits, fast_hits);
+
+	BOOST_TEST_MESSAGE("banlist 10k entries: sort by parsed date " << parsed << "ms, by timestamp "
+		<< stamped << "ms; 2000 users against every mask " << every_mask << "ms, compiled "
+		<< compiled << "ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
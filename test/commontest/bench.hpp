@@ -0,0 +1,37 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef HEXCHAT_TEST_BENCH_HPP
+#define HEXCHAT_TEST_BENCH_HPP
+
+#include <chrono>
+
+/* Helpers for the benchmark cases. Those are registered disabled so a
+ * plain run skips them; run one by name with --run_test=<suite>/<case>. */
+namespace bench
+{
+	template <typename F>
+	double time_ms(F f)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+#endif
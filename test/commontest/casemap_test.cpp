@@ -0,0 +1,194 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <algorithm>
+#include <locale>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <casemap.hpp>
+#include <util.hpp>
+#include <boost/test/unit_test.hpp>
+#include "bench.hpp"
+
+namespace
+{
+	std::vector<std::string> make_nicks(std::size_t count)
+	{
+		const std::string chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ[]\\^{}|~_-0123456789";
+		std::mt19937 rng(7);
+		std::uniform_int_distribution<std::size_t> pick(0, chars.size() - 1);
+		std::uniform_int_distribution<std::size_t> length(4, 24);
+		std::vector<std::string> nicks;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::string nick(length(rng), ' ');
+			for (auto & c : nick)
+				c = chars[pick(rng)];
+			nicks.push_back(nick);
+		}
+		return nicks;
+	}
+
+	int sign(int x)
+	{
+		return (x > 0) - (x < 0);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(casemap_test)
+
+BOOST_AUTO_TEST_CASE(mappings_fold_what_they_should)
+{
+	const casemap ascii(casemap::ASCII);
+	const casemap rfc(casemap::RFC1459);
+	const casemap strict(casemap::STRICT_RFC1459);
+
+	BOOST_REQUIRE_EQUAL(ascii.key("Nick[A]^"), "nick[a]^");
+	BOOST_REQUIRE_EQUAL(rfc.key("Nick[A]^\\"), "nick{a}~|");
+	BOOST_REQUIRE_EQUAL(strict.key("Nick[A]^\\"), "nick{a}^|");
+
+	BOOST_REQUIRE_EQUAL(casemap::parse("ascii"), casemap::ASCII);
+	BOOST_REQUIRE_EQUAL(casemap::parse("strict-rfc1459"), casemap::STRICT_RFC1459);
+	BOOST_REQUIRE_EQUAL(casemap::parse("rfc1459"), casemap::RFC1459);
+	BOOST_REQUIRE_EQUAL(casemap::parse("rfc7613"), casemap::RFC1459);
+
+	/* the rfc1459 table is the one util has always used */
+	for (int c = 0; c < 256; ++c)
+		BOOST_REQUIRE_EQUAL(rfc.fold(static_cast<unsigned char>(c)), rfc_tolowertab[c]);
+}
+
+BOOST_AUTO_TEST_CASE(long_strings_fold_like_the_table)
+{
+	/* every byte at every offset of the eight byte steps */
+	for (auto kind : { casemap::ASCII, casemap::RFC1459, casemap::STRICT_RFC1459 })
+	{
+		const casemap map(kind);
+		for (int c = 0; c < 256; ++c)
+		{
+			for (std::size_t at = 0; at < 19; ++at)
+			{
+				std::string name(19, 'Q');
+				name[at] = static_cast<char>(c);
+				const auto key = map.key(name);
+				for (std::size_t i = 0; i < name.size(); ++i)
+					BOOST_REQUIRE_EQUAL(static_cast<unsigned char>(key[i]), map.fold(static_cast<unsigned char>(name[i])));
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(keys_agree_with_compare)
+{
+	const casemap rfc(casemap::RFC1459);
+	const auto nicks = make_nicks(2000);
+	const auto c_cmp = rfc.c_function();
+	for (std::size_t i = 0; i + 1 < nicks.size(); ++i)
+	{
+		const auto & a = nicks[i];
+		const auto & b = i % 3 ? nicks[i + 1] : rfc.key(a);
+		const int expected = sign(rfc_casecmp(a.c_str(), b.c_str()));
+		BOOST_REQUIRE_EQUAL(sign(rfc.compare(a, b)), expected);
+		BOOST_REQUIRE_EQUAL(sign(c_cmp(a.c_str(), b.c_str())), expected);
+		BOOST_REQUIRE_EQUAL(sign(rfc.key(a).compare(rfc.key(b))), expected);
+		BOOST_REQUIRE_EQUAL(rfc.equal(a, b), expected == 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_against_rfc_casecmp_and_locale, *boost::unit_test::disabled())
+{
+	const casemap rfc(casemap::RFC1459);
+	const auto nicks = make_nicks(5000);
+	std::vector<std::string> lookups;
+	for (const auto & nick : nicks)
+		lookups.push_back(rfc.key(nick) == nick ? nick : std::string(nick.rbegin(), nick.rend()));
+	const std::size_t rounds = 20;
+
+	/* each of them against every nick, the way the lists used to be searched */
+	std::size_t found[4] = {};
+	const auto c_time = bench::time_ms([&]{
+		for (std::size_t r = 0; r < rounds; ++r)
+			for (std::size_t i = 0; i < 500; ++i)
+				for (const auto & nick : nicks)
+					found[0] += rfc_casecmp(lookups[i].c_str(), nick.c_str()) == 0;
+	});
+	const auto locale = rfc_locale(std::locale());
+	const auto & collate = std::use_facet<std::collate<char>>(locale);
+	const auto locale_time = bench::time_ms([&]{
+		for (std::size_t r = 0; r < rounds; ++r)
+			for (std::size_t i = 0; i < 500; ++i)
+				for (const auto & nick : nicks)
+					found[1] += collate.compare(lookups[i].data(), lookups[i].data() + lookups[i].size(),
+						nick.data(), nick.data() + nick.size()) == 0;
+	});
+	const auto table_time = bench::time_ms([&]{
+		for (std::size_t r = 0; r < rounds; ++r)
+			for (std::size_t i = 0; i < 500; ++i)
+				for (const auto & nick : nicks)
+					found[2] += rfc.equal(lookups[i], nick);
+	});
+	/* with the keys made once, it's plain string equality */
+	std::vector<std::string> keys;
+	for (const auto & nick : nicks)
+		keys.push_back(rfc.key(nick));
+	const auto key_time = bench::time_ms([&]{
+		for (std::size_t r = 0; r < rounds; ++r)
+			for (std::size_t i = 0; i < 500; ++i)
+			{
+				const auto key = rfc.key(lookups[i]);
+				for (const auto & other : keys)
+					found[3] += key == other;
+			}
+	});
+	BOOST_REQUIRE_EQUAL(found[0], found[1]);
+	BOOST_REQUIRE_EQUAL(found[0], found[2]);
+	BOOST_REQUIRE_EQUAL(found[0], found[3]);
+
+	/* folding long strings, byte by byte against eight at a time */
+	std::string text(1 << 20, 'x');
+	std::mt19937 rng(3);
+	for (auto & c : text)
+		c = static_cast<char>(rng() % 95 + 32);
+	std::string copy;
+	const auto bytewise_time = bench::time_ms([&]{
+		for (int r = 0; r < 20; ++r)
+		{
+			copy = text;
+			for (auto & c : copy)
+				c = static_cast<char>(rfc_tolower(c));
+		}
+	});
+	const auto wide_time = bench::time_ms([&]{
+		for (int r = 0; r < 20; ++r)
+		{
+			copy = text;
+			rfc.fold(&copy[0], &copy[0] + copy.size());
+		}
+	});
+	BOOST_REQUIRE_EQUAL(copy, rfc.key(text));
+
+	BOOST_TEST_MESSAGE("500 nicks against 5000, 20 times: rfc_casecmp " << c_time << "ms, locale collate "
+		<< locale_time << "ms, casemap::equal " << table_time << "ms, folded keys " << key_time
+		<< "ms; folding 20 MiB: per byte " << bytewise_time << "ms, 8 at a time " << wide_time << "ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
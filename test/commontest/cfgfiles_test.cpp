@@ -0,0 +1,154 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cfgfiles.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "bench.hpp"
+
+namespace
+{
+	/* about as many variables as the real hexchat.conf has */
+	enum { CONFIG_VARS = 350 };
+
+	std::string var_name(int i)
+	{
+		return "hex_setting_number_" + std::to_string(i);
+	}
+
+	std::string make_config()
+	{
+		config::writer out;
+		out.put_str("version", "2.12.0");
+		for (int i = 0; i < CONFIG_VARS; ++i)
+		{
+			if (i % 3)
+				out.put_int(var_name(i).c_str(), i);
+			else
+				out.put_str(var_name(i).c_str(), "some string value for setting " + std::to_string(i));
+		}
+		return out.data();
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(cfgfiles_test)
+
+BOOST_AUTO_TEST_CASE(parse_lines_splits_once)
+{
+	const auto lines = config::parse_lines("# comment\r\nname = value \r\n\nbare\nnick net1,net2\n");
+	BOOST_REQUIRE_EQUAL(lines.size(), 3u);
+	BOOST_REQUIRE_EQUAL(lines[0].key, "name");
+	BOOST_REQUIRE_EQUAL(lines[0].value, "value ");
+	BOOST_REQUIRE_EQUAL(lines[1].key, "bare");
+	BOOST_REQUIRE(lines[1].value.empty());
+
+	const auto words = config::parse_lines("nick net1,net2\nloner", ' ');
+	BOOST_REQUIRE_EQUAL(words.size(), 2u);
+	BOOST_REQUIRE_EQUAL(words[0].key, "nick");
+	BOOST_REQUIRE_EQUAL(words[0].value, "net1,net2");
+	BOOST_REQUIRE_EQUAL(words[1].key, "loner");
+}
+
+BOOST_AUTO_TEST_CASE(settings_match_cfg_get_str)
+{
+	std::string text = "Foo = first\nfoo = second\nfoobar = 12\nempty =\n";
+	const config::settings cfg(text);
+
+	char buf[64];
+	BOOST_REQUIRE(cfg.get_str("foo", buf, sizeof(buf)));
+	BOOST_REQUIRE_EQUAL(std::string(buf), "first");
+	BOOST_REQUIRE(cfg_get_str(&text[0], "foo", buf, sizeof(buf)));
+	BOOST_REQUIRE_EQUAL(std::string(buf), "first");
+
+	int value = 0;
+	BOOST_REQUIRE(cfg.get_int("FOOBAR", value));
+	BOOST_REQUIRE_EQUAL(value, 12);
+	BOOST_REQUIRE(cfg.get_str("empty", buf, sizeof(buf)));
+	BOOST_REQUIRE_EQUAL(std::string(buf), "");
+	BOOST_REQUIRE(!cfg.get_int("fo", value));
+}
+
+BOOST_AUTO_TEST_CASE(writer_replaces_file)
+{
+	const auto dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	boost::filesystem::create_directory(dir);
+	const auto path = (dir / "test.conf").string();
+
+	config::writer first;
+	first.put_str("name", "old");
+	BOOST_REQUIRE(first.commit(path));
+
+	config::writer second;
+	second.put_str("name", "new");
+	second.put_int("number", -1);
+	BOOST_REQUIRE(second.commit(path));
+
+	boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+	std::string contents{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+	BOOST_REQUIRE_EQUAL(contents, "name = new\nnumber = 1\n");
+	BOOST_REQUIRE(!boost::filesystem::exists(path + ".new"));
+
+	stream.close();
+	boost::system::error_code ec;
+	boost::filesystem::remove_all(dir, ec);
+}
+
+/* not a correctness test: reading every variable of a hexchat.conf sized
+ * file, the way load_config did and the way it does now */
+BOOST_AUTO_TEST_CASE(benchmark_load_config, *boost::unit_test::disabled())
+{
+	auto text = make_config();
+	std::vector<std::string> names;
+	for (int i = 0; i < CONFIG_VARS; ++i)
+		names.push_back(var_name(i));
+
+	const int rounds = 20;
+	char buf[512];
+	int found_scan = 0;
+	const auto scan = bench::time_ms([&]{
+		for (int r = 0; r < rounds; ++r)
+			for (const auto & name : names)
+				found_scan += cfg_get_str(&text[0], name.c_str(), buf, sizeof(buf)) != nullptr;
+	});
+
+	int found_map = 0;
+	const auto parsed = bench::time_ms([&]{
+		for (int r = 0; r < rounds; ++r)
+		{
+			const config::settings cfg(text);
+			for (const auto & name : names)
+				found_map += cfg.get_str(name.c_str(), buf, sizeof(buf));
+		}
+	});
+
+	BOOST_REQUIRE_EQUAL(found_scan, CONFIG_VARS * rounds);
+	BOOST_REQUIRE_EQUAL(found_map, CONFIG_VARS * rounds);
+	BOOST_TEST_MESSAGE("load_config, " << CONFIG_VARS << " vars: rescanning per var "
+		<< scan / rounds << "ms, parsed once " << parsed / rounds << "ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,169 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <cstring>
+#include <string>
+#include <chanlist-store.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "bench.hpp"
+
+namespace
+{
+	void fill(chanlist::store & store, chanlist::row_id rows)
+	{
+		static const char *const words[] = { "linux", "chat", "music", "games", "help", "dev" };
+		for (chanlist::row_id i = 0; i < rows; ++i)
+		{
+			const auto word = words[i % 6];
+			const auto chan = "#" + std::string(word) + std::to_string(i);
+			const auto topic = "Welcome to " + chan + ", talk about " + words[(i / 6) % 6];
+			store.append(chan, i % 500 + 1, topic);
+		}
+	}
+
+	bool no_cancel() { return false; }
+}
+
+BOOST_AUTO_TEST_SUITE(chanlist_store_test)
+
+BOOST_AUTO_TEST_CASE(store_rows_across_segments)
+{
+	chanlist::store store;
+	fill(store, chanlist::SEGMENT_ROWS + 10);
+	auto snap = store.snap();
+
+	BOOST_REQUIRE_EQUAL(snap.size(), chanlist::SEGMENT_ROWS + 10);
+	BOOST_REQUIRE_EQUAL(std::string(snap.channel(0)), "#linux0");
+	BOOST_REQUIRE_EQUAL(snap.users(0), 1u);
+	const chanlist::row_id last = chanlist::SEGMENT_ROWS + 9;
+	BOOST_REQUIRE_EQUAL(std::string(snap.channel(last)), "#chat" + std::to_string(last));
+
+	/* appending doesn't disturb a snapshot already handed out */
+	store.append("#late", 3, "late topic");
+	BOOST_REQUIRE_EQUAL(snap.size(), chanlist::SEGMENT_ROWS + 10);
+	BOOST_REQUIRE_EQUAL(std::string(snap.channel(last)), "#chat" + std::to_string(last));
+	BOOST_REQUIRE_EQUAL(std::string(store.snap().topic(last + 1)), "late topic");
+}
+
+BOOST_AUTO_TEST_CASE(filter_users_and_text)
+{
+	chanlist::store store;
+	store.append("#small", 2, "nothing here");
+	store.append("#Linux", 50, "kernel talk");
+	store.append("#big", 900, "all about LINUX");
+	auto snap = store.snap();
+
+	chanlist::filter flt;
+	flt.min_users = 5;
+	flt.max_users = 100;
+	chanlist::result res;
+	BOOST_REQUIRE(chanlist::run_filter(snap, flt, 0, false, res, no_cancel));
+	BOOST_REQUIRE_EQUAL(res.rows.size(), 1u);
+	BOOST_REQUIRE_EQUAL(res.rows[0], 1u);
+
+	flt.max_users = 0;
+	flt.pattern = "linux";
+	flt.match_topic = false;
+	BOOST_REQUIRE(chanlist::run_filter(snap, flt, 0, false, res, no_cancel));
+	BOOST_REQUIRE_EQUAL(res.rows.size(), 1u);
+
+	flt.match_topic = true;
+	BOOST_REQUIRE(chanlist::run_filter(snap, flt, 0, false, res, no_cancel));
+	BOOST_REQUIRE_EQUAL(res.rows.size(), 2u);
+	BOOST_REQUIRE_EQUAL(res.users_shown, 950u);
+
+	flt.type = chanlist::filter::WILDCARD;
+	flt.pattern = "#b*";
+	BOOST_REQUIRE(chanlist::run_filter(snap, flt, 0, false, res, no_cancel));
+	BOOST_REQUIRE_EQUAL(res.rows.size(), 1u);
+	BOOST_REQUIRE_EQUAL(res.rows[0], 2u);
+}
+
+BOOST_AUTO_TEST_CASE(filter_sorts_and_cancels)
+{
+	chanlist::store store;
+	store.append("#b", 10, "");
+	store.append("#c", 30, "");
+	store.append("#a", 20, "");
+	auto snap = store.snap();
+
+	chanlist::filter flt;
+	flt.sort = chanlist::filter::BY_USERS;
+	flt.descending = true;
+	chanlist::result res;
+	BOOST_REQUIRE(chanlist::run_filter(snap, flt, 0, true, res, no_cancel));
+	BOOST_REQUIRE_EQUAL(res.rows.size(), 3u);
+	BOOST_REQUIRE_EQUAL(res.rows[0], 1u);
+	BOOST_REQUIRE_EQUAL(res.rows[2], 0u);
+
+	/* only the rows after 'first' are looked at */
+	BOOST_REQUIRE(chanlist::run_filter(snap, flt, 2, false, res, no_cancel));
+	BOOST_REQUIRE_EQUAL(res.rows.size(), 1u);
+	BOOST_REQUIRE_EQUAL(res.rows[0], 2u);
+
+	BOOST_REQUIRE(!chanlist::run_filter(snap, flt, 0, true, res, []{ return true; }));
+
+	/* a long sort gives up part way too, not only the loop over rows */
+	chanlist::store big;
+	fill(big, 50000);
+	flt.sort = chanlist::filter::BY_TOPIC;
+	const int row_checks = (50000 + 1023) / 1024;
+	int checks = 0;
+	BOOST_REQUIRE(!chanlist::run_filter(big.snap(), flt, 0, true, res, [&checks]{ return ++checks > row_checks; }));
+	BOOST_REQUIRE_GT(checks, row_checks);
+}
+
+/* not a correctness test: loads and filters a LIST the size of a big network */
+BOOST_AUTO_TEST_CASE(benchmark_200k_rows, *boost::unit_test::disabled())
+{
+	const chanlist::row_id rows = 200000;
+	chanlist::store store;
+	const auto load = bench::time_ms([&]{ fill(store, rows); });
+	auto snap = store.snap();
+	BOOST_REQUIRE_EQUAL(snap.size(), rows);
+
+	chanlist::filter flt;
+	chanlist::result res;
+	const auto all = bench::time_ms([&]{ chanlist::run_filter(snap, flt, 0, false, res, no_cancel); });
+	BOOST_REQUIRE_EQUAL(res.rows.size(), rows);
+
+	flt.pattern = "music";
+	const auto simple = bench::time_ms([&]{ chanlist::run_filter(snap, flt, 0, false, res, no_cancel); });
+	BOOST_REQUIRE(!res.rows.empty());
+
+	flt.type = chanlist::filter::WILDCARD;
+	flt.pattern = "#games*9";
+	const auto wildcard = bench::time_ms([&]{ chanlist::run_filter(snap, flt, 0, false, res, no_cancel); });
+	BOOST_REQUIRE(!res.rows.empty());
+
+	flt.type = chanlist::filter::SIMPLE;
+	flt.pattern.clear();
+	flt.min_users = 100;
+	const auto sorted = bench::time_ms([&]{ chanlist::run_filter(snap, flt, 0, true, res, no_cancel); });
+	BOOST_REQUIRE(!res.rows.empty());
+
+	BOOST_TEST_MESSAGE("chanlist 200k rows: load " << load << "ms, no filter " << all
+		<< "ms, simple " << simple << "ms, wildcard " << wildcard
+		<< "ms, min users + sort by name " << sorted << "ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,410 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+/* the loopback plumbing below is POSIX only */
+#ifndef WIN32
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <dcc-xfer.hpp>
+
+namespace xfer = hexchat::dcc::xfer;
+
+namespace
+{
+	struct temp_file
+	{
+		std::string path;
+		int fd;
+
+		explicit temp_file(std::uint64_t size)
+			:path("/tmp/hexchat-dcc-XXXXXX")
+		{
+			fd = mkstemp(&path[0]);
+			BOOST_REQUIRE(fd != -1);
+			std::vector<char> block(1024 * 1024);
+			for (std::size_t i = 0; i < block.size(); ++i)
+				block[i] = static_cast<char>(i * 31 + 7);
+			for (std::uint64_t done = 0; done < size;)
+			{
+				const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), size - done));
+				BOOST_REQUIRE_EQUAL(write(fd, block.data(), n), static_cast<ssize_t>(n));
+				done += n;
+			}
+		}
+		~temp_file()
+		{
+			close(fd);
+			unlink(path.c_str());
+		}
+	};
+
+	/* a connected loopback TCP pair, like a DCC send would have */
+	struct tcp_pair
+	{
+		int sender;
+		int receiver;
+
+		tcp_pair()
+		{
+			const int listener = socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in addr = {};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t len = sizeof(addr);
+			BOOST_REQUIRE(bind(listener, reinterpret_cast<sockaddr*>(&addr), len) == 0);
+			BOOST_REQUIRE(listen(listener, 1) == 0);
+			BOOST_REQUIRE(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+			sender = socket(AF_INET, SOCK_STREAM, 0);
+			BOOST_REQUIRE(connect(sender, reinterpret_cast<sockaddr*>(&addr), len) == 0);
+			receiver = accept(listener, nullptr, nullptr);
+			BOOST_REQUIRE(receiver != -1);
+			close(listener);
+		}
+		~tcp_pair()
+		{
+			close(sender);
+			close(receiver);
+		}
+	};
+
+	/* reads everything the sender writes until it hangs up */
+	std::uint64_t drain(int sok, std::vector<char> *keep)
+	{
+		std::vector<char> buf(256 * 1024);
+		std::uint64_t total = 0;
+		for (;;)
+		{
+			const auto n = recv(sok, buf.data(), buf.size(), 0);
+			if (n <= 0)
+				return total;
+			if (keep)
+				keep->insert(keep->end(), buf.data(), buf.data() + n);
+			total += n;
+		}
+	}
+
+	/* what dcc_send_data did before: a fresh block, lseek, read, send */
+	long long send_old(int sok, int fd, std::uint64_t offset, std::size_t len)
+	{
+		std::vector<char> buf(len);
+		lseek(fd, offset, SEEK_SET);
+		const auto got = read(fd, &buf[0], len);
+		if (got < 1)
+			return 0;
+		return send(sok, &buf[0], got, 0);
+	}
+
+	struct transfer_stats
+	{
+		double ms;
+		std::uint64_t wakeups;
+	};
+
+	/* drives the sender the way the main loop does for a fast send: a
+	 * non-blocking socket, and one block handed over per writable wakeup */
+	template <typename Send>
+	transfer_stats transfer(const temp_file & file, std::uint64_t size, Send send_block)
+	{
+		tcp_pair pair;
+		fcntl(pair.sender, F_SETFL, O_NONBLOCK);
+		std::uint64_t received = 0;
+		std::thread reader([&]{ received = drain(pair.receiver, nullptr); });
+
+		transfer_stats stats = {};
+		const auto start = std::chrono::steady_clock::now();
+		for (std::uint64_t pos = 0; pos < size;)
+		{
+			pollfd pfd = { pair.sender, POLLOUT, 0 };
+			BOOST_REQUIRE_EQUAL(poll(&pfd, 1, -1), 1);
+			++stats.wakeups;
+			const auto sent = send_block(pair.sender, file.fd, pos);
+			BOOST_REQUIRE(sent > 0 || (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)));
+			if (sent > 0)
+				pos += sent;
+		}
+		shutdown(pair.sender, SHUT_WR);
+		reader.join();
+		stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		BOOST_REQUIRE_EQUAL(received, size);
+		return stats;
+	}
+
+	double mib_per_s(std::uint64_t size, double ms)
+	{
+		return size / (1024.0 * 1024.0) / (ms / 1000.0);
+	}
+
+	struct receive_stats
+	{
+		double ms;
+		double busy_ms;	/* main thread time spent outside poll() */
+		double worst_ms;	/* the longest single wakeup */
+		std::uint64_t wakeups;
+	};
+
+	/* pushes size bytes at a non-blocking receiving socket and drives
+	 * on_readable the way the main loop would. on_readable returns false
+	 * while it wants to be called again without waiting for data */
+	template <typename Readable>
+	receive_stats receive(std::uint64_t size, Readable on_readable)
+	{
+		typedef std::chrono::steady_clock clock;
+		tcp_pair pair;
+		fcntl(pair.receiver, F_SETFL, O_NONBLOCK);
+		std::thread writer([&]{
+			std::vector<char> block(256 * 1024);
+			for (std::size_t i = 0; i < block.size(); ++i)
+				block[i] = static_cast<char>(i * 31 + 7);
+			for (std::uint64_t done = 0; done < size;)
+			{
+				const auto n = send(pair.sender, block.data(),
+					static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), size - done)), 0);
+				if (n <= 0)
+					return;
+				done += n;
+			}
+		});
+
+		receive_stats stats = {};
+		std::uint64_t got = 0;
+		const auto start = clock::now();
+		bool wait = true;
+		while (got < size)
+		{
+			if (wait)
+			{
+				pollfd pfd = { pair.receiver, POLLIN, 0 };
+				BOOST_REQUIRE_EQUAL(poll(&pfd, 1, -1), 1);
+			}
+			++stats.wakeups;
+			const auto woke = clock::now();
+			wait = on_readable(pair.receiver, got);
+			const auto ms = std::chrono::duration<double, std::milli>(clock::now() - woke).count();
+			stats.busy_ms += ms;
+			stats.worst_ms = std::max(stats.worst_ms, ms);
+		}
+		writer.join();
+		stats.ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		return stats;
+	}
+
+	/* one main loop wakeup of the receiving side, as dcc_read now does it */
+	bool read_into(xfer::file_receiver & rx, int sok, std::uint64_t & got)
+	{
+		for (;;)
+		{
+			BOOST_REQUIRE_EQUAL(rx.error(), 0);
+			if (rx.full())
+			{
+				/* dcc_read waits for when_ready(), there's no main loop here */
+				std::this_thread::yield();
+				return false;
+			}
+			const auto n = rx.recv(sok);
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				rx.flush_if_idle();
+				return true;
+			}
+			BOOST_REQUIRE(n > 0);
+			got += n;
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(dcc_xfer_test)
+
+BOOST_AUTO_TEST_CASE(send_window_stays_in_bounds)
+{
+	tcp_pair pair;
+	const auto room = xfer::send_window(pair.sender, 1024, xfer::MAX_SEND_CHUNK);
+	BOOST_REQUIRE_GE(room, 1024u);
+	BOOST_REQUIRE_LE(room, static_cast<std::size_t>(xfer::MAX_SEND_CHUNK));
+
+	/* not a socket: falls back to the floor */
+	BOOST_REQUIRE_EQUAL(xfer::send_window(-1, 4096, xfer::MAX_SEND_CHUNK), 4096u);
+}
+
+BOOST_AUTO_TEST_CASE(sha256_known_answer)
+{
+	xfer::sha256 sum;
+	sum.update("a", 1);
+	sum.update("bc", 2);
+	BOOST_REQUIRE_EQUAL(sum.hex(), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+BOOST_AUTO_TEST_CASE(file_sender_sends_from_offset)
+{
+	const std::uint64_t size = 3 * 1024 * 1024 + 123;
+	temp_file file(size);
+
+	for (const bool zero_copy : { true, false })
+	{
+		tcp_pair pair;
+		std::vector<char> got;
+		std::thread reader([&]{ drain(pair.receiver, &got); });
+
+		xfer::file_sender sender;
+		sender.zero_copy = sender.zero_copy && zero_copy;
+		sender.hash.reset(new xfer::sha256);
+		const std::uint64_t start = 1000;
+		for (std::uint64_t pos = start; pos < size;)
+		{
+			const auto sent = sender.send(pair.sender, file.fd, pos, 65536);
+			BOOST_REQUIRE(sent > 0);
+			pos += sent;
+		}
+		/* at the end of the file there's nothing left to send */
+		BOOST_REQUIRE_EQUAL(sender.send(pair.sender, file.fd, size, 65536), 0);
+		shutdown(pair.sender, SHUT_WR);
+		reader.join();
+
+		BOOST_REQUIRE_EQUAL(got.size(), size - start);
+		std::vector<char> want(got.size());
+		BOOST_REQUIRE_EQUAL(pread(file.fd, want.data(), want.size(), start), static_cast<ssize_t>(want.size()));
+		BOOST_REQUIRE(got == want);
+
+		/* the hash only sees what it's shown */
+		if (!sender.zero_copy)
+		{
+			xfer::sha256 sum;
+			sum.update(want.data(), want.size());
+			BOOST_REQUIRE_EQUAL(sender.hash->hex(), sum.hex());
+		}
+	}
+}
+
+/* not a correctness test: pushes a file over loopback the old way and the
+ * new way. HEXCHAT_DCC_BENCH_MB sets the file size, e.g. 4096 for 4GB */
+BOOST_AUTO_TEST_CASE(benchmark_loopback_send, *boost::unit_test::disabled())
+{
+	std::uint64_t mb = 256;
+	if (const char *env = std::getenv("HEXCHAT_DCC_BENCH_MB"))
+		mb = std::strtoull(env, nullptr, 10);
+	const std::uint64_t size = mb * 1024 * 1024;
+	temp_file file(size);
+	const std::size_t blocksize = 102400;	/* the largest hex_dcc_blocksize */
+
+	const auto old_loop = transfer(file, size, [&](int sok, int fd, std::uint64_t pos){
+		return send_old(sok, fd, pos, blocksize);
+	});
+
+	xfer::file_sender copying;
+	copying.zero_copy = false;
+	const auto copied = transfer(file, size, [&](int sok, int fd, std::uint64_t pos){
+		return copying.send(sok, fd, pos, xfer::send_window(sok, blocksize, xfer::MAX_SEND_CHUNK));
+	});
+
+	xfer::file_sender zero_copy;
+	const auto zero = transfer(file, size, [&](int sok, int fd, std::uint64_t pos){
+		return zero_copy.send(sok, fd, pos, xfer::send_window(sok, blocksize, xfer::MAX_SEND_CHUNK));
+	});
+
+	BOOST_TEST_MESSAGE("dcc send " << mb << "MB over loopback: old loop " << mib_per_s(size, old_loop.ms)
+		<< "MB/s in " << old_loop.wakeups << " wakeups, reused buffer + adaptive chunk "
+		<< mib_per_s(size, copied.ms) << "MB/s in " << copied.wakeups << " wakeups, "
+		<< (zero_copy.zero_copy ? "sendfile" : "no sendfile, copied") << " + adaptive chunk "
+		<< mib_per_s(size, zero.ms) << "MB/s in " << zero.wakeups << " wakeups");
+}
+
+BOOST_AUTO_TEST_CASE(file_receiver_writes_in_order)
+{
+	const std::uint64_t size = 9 * 1024 * 1024 + 77;
+	temp_file file(0);
+	std::string digest;
+	{
+		xfer::file_receiver rx(file.fd, true);
+		receive(size, [&](int sok, std::uint64_t & got){ return read_into(rx, sok, got); });
+		rx.flush();
+		/* the destructor waits for the writes too, but so can callers */
+		while (!rx.drained())
+			std::this_thread::yield();
+		digest = rx.digest();
+	}
+
+	std::vector<char> got(size);
+	BOOST_REQUIRE_EQUAL(pread(file.fd, got.data(), got.size(), 0), static_cast<ssize_t>(size));
+	for (std::size_t i = 0; i < got.size(); ++i)
+	{
+		if (got[i] != static_cast<char>((i % (256 * 1024)) * 31 + 7))
+			BOOST_FAIL("byte " << i << " is wrong");
+	}
+
+	xfer::sha256 sum;
+	sum.update(got.data(), got.size());
+	BOOST_REQUIRE_EQUAL(digest, sum.hex());
+}
+
+/* not a correctness test: receives over loopback into a file the old way
+ * (4 KiB recv + write per chunk on the main thread) and through the
+ * file_receiver. HEXCHAT_DCC_BENCH_MB sets the size */
+BOOST_AUTO_TEST_CASE(benchmark_loopback_receive, *boost::unit_test::disabled())
+{
+	std::uint64_t mb = 256;
+	if (const char *env = std::getenv("HEXCHAT_DCC_BENCH_MB"))
+		mb = std::strtoull(env, nullptr, 10);
+	const std::uint64_t size = mb * 1024 * 1024;
+
+	temp_file old_file(0);
+	const auto old_loop = receive(size, [&](int sok, std::uint64_t & got){
+		char buf[4096];
+		for (;;)
+		{
+			const auto n = recv(sok, buf, sizeof(buf), 0);
+			if (n < 0)
+				return true;
+			BOOST_REQUIRE(n > 0);
+			BOOST_REQUIRE_EQUAL(write(old_file.fd, buf, n), n);
+			got += n;
+		}
+	});
+
+	temp_file new_file(0);
+	xfer::preallocate(new_file.fd, 0, size);
+	receive_stats ring;
+	{
+		xfer::file_receiver rx(new_file.fd, false);
+		ring = receive(size, [&](int sok, std::uint64_t & got){ return read_into(rx, sok, got); });
+	}
+
+	BOOST_TEST_MESSAGE("dcc receive " << mb << "MB over loopback: old loop " << mib_per_s(size, old_loop.ms)
+		<< "MB/s, main thread busy " << old_loop.busy_ms << "ms, worst wakeup " << old_loop.worst_ms
+		<< "ms; ring + I/O thread " << mib_per_s(size, ring.ms)
+		<< "MB/s, main thread busy " << ring.busy_ms << "ms, worst wakeup " << ring.worst_ms << "ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
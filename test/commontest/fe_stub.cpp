@@ -105,7 +105,7 @@ void fe_add_chan_list(struct server *, char *, char *, char *)
 }
 void fe_chan_list_end(struct server *) {}
 gboolean fe_add_ban_list(struct session *, char *, char *,
-			 char *, int)
+			 char *, time_t, int)
 {
 	return 0;
 }
@@ -125,9 +125,10 @@ void fe_text_clear(struct session *, int ) {}
 void fe_progressbar_start(struct session *) {}
 void fe_progressbar_end(struct server *) {}
 void fe_userlist_insert(struct session *, struct User *, int, bool) {}
-bool fe_userlist_remove(struct session *, struct User const *) { return false; }
+void fe_userlist_remove(struct session *, struct User const *, int) {}
 void fe_userlist_rehash(struct session *, struct User const *) {}
-void fe_userlist_move(struct session *, struct User *, int) {}
+void fe_userlist_move(struct session *, struct User *, int, int) {}
+void fe_userlist_reorder(struct session *, const struct userlist_moves &) {}
 void fe_userlist_numbers(session &) {}
 void fe_userlist_clear(session &) {}
 void fe_userlist_set_selected(struct session *) {}
@@ -21,12 +21,17 @@
 #define BOOST_TEST_MODULE common_tests
 #include <algorithm>
 #include <cstring>
+#include <iterator>
 #include <memory>
+#include <string>
 #include <plugin.hpp>
+#include <plugin-prefs.hpp>
 #include <hexchat-plugin.h>
 #include <boost/test/unit_test.hpp>
 #include <boost/utility/string_ref.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <boost/system/error_code.hpp>
 
 extern char * xdir;
@@ -114,4 +119,49 @@ BOOST_FIXTURE_TEST_CASE(plugin_get_preflist_multi, MyConfig)
 	hexchat_pluginpref_delete(ph.get(), test_val2_name);
 }
 
+BOOST_AUTO_TEST_CASE(pluginpref_file_keeps_format)
+{
+	pluginpref::file prefs;
+	prefs.parse("# not a setting\nfoo = one\nBar = two\\nlines\nfoobar = three\n");
+
+	std::string value;
+	BOOST_REQUIRE(prefs.get("bar", value));
+	BOOST_REQUIRE_EQUAL(value, "two\nlines");
+	BOOST_REQUIRE(!prefs.get("fo", value));
+
+	prefs.set("foo", "new \"value\"");
+	prefs.set("added", "four");
+	BOOST_REQUIRE(prefs.remove("foobar"));
+	BOOST_REQUIRE(!prefs.remove("foobar"));
+	BOOST_REQUIRE_EQUAL(prefs.serialize(),
+		"# not a setting\nfoo = new \\\"value\\\"\nBar = two\\nlines\nadded = four\n");
+	BOOST_REQUIRE_EQUAL(boost::join(prefs.names(), ","), "foo,Bar,added");
+	BOOST_REQUIRE(prefs.get("FOO", value));
+	BOOST_REQUIRE_EQUAL(value, "new \"value\"");
+}
+
+BOOST_FIXTURE_TEST_CASE(plugin_pref_written_on_flush, MyConfig)
+{
+	std::unique_ptr<hexchat_plugin_internal> ph{ std::make_unique<hexchat_plugin_internal>() };
+	ph->name = "flush test";
+	auto path = boost::filesystem::path(testdir) / "addon_flush_test.conf";
+
+	BOOST_REQUIRE(hexchat_pluginpref_set_str(ph.get(), "first", "1"));
+	BOOST_REQUIRE(hexchat_pluginpref_set_int(ph.get(), "second", 2));
+	BOOST_REQUIRE_EQUAL(hexchat_pluginpref_get_int(ph.get(), "second"), 2);
+
+	pluginpref::flush();
+	{
+		boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+		std::string contents{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+		BOOST_REQUIRE_EQUAL(contents, "first = 1\nsecond = 2\n");
+	}
+
+	hexchat_pluginpref_delete(ph.get(), "first");
+	hexchat_pluginpref_delete(ph.get(), "second");
+	pluginpref::flush();
+	boost::system::error_code ec;
+	boost::filesystem::remove(path, ec);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
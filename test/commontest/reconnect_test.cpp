@@ -0,0 +1,167 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <cstdint>
+#include <vector>
+#include <reconnect.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+	const std::int64_t SEC = 1000 * 1000;
+
+	/* somewhere to point at, one per fake server */
+	struct fake_server { int unused; };
+}
+
+BOOST_AUTO_TEST_SUITE(reconnect_test)
+
+BOOST_AUTO_TEST_CASE(backoff_doubles_up_to_the_cap)
+{
+	reconnect::planner plan;
+	fake_server serv;
+	BOOST_REQUIRE_EQUAL(plan.schedule(&serv, 10000, 0.0, 0.5, 0), 10000);
+	BOOST_REQUIRE_EQUAL(plan.schedule(&serv, 10000, 0.0, 0.5, 0), 20000);
+	BOOST_REQUIRE_EQUAL(plan.schedule(&serv, 10000, 0.0, 0.5, 0), 40000);
+	for (int i = 0; i < 20; ++i)
+		plan.schedule(&serv, 10000, 0.0, 0.5, 0);
+	BOOST_REQUIRE_EQUAL(plan.schedule(&serv, 10000, 0.0, 0.5, 0), reconnect::MAX_BACKOFF_MS);
+
+	plan.reset_attempts(&serv);
+	BOOST_REQUIRE_EQUAL(plan.schedule(&serv, 0, 0.0, 0.5, 0), reconnect::MIN_DELAY_MS);
+}
+
+BOOST_AUTO_TEST_CASE(jitter_spreads_the_delay)
+{
+	reconnect::planner plan;
+	fake_server a, b, c;
+	BOOST_REQUIRE_EQUAL(plan.schedule(&a, 10000, 0.2, 0.0, 0), 8000);
+	BOOST_REQUIRE_EQUAL(plan.schedule(&b, 10000, 0.2, 0.5, 0), 10000);
+	BOOST_REQUIRE_EQUAL(plan.schedule(&c, 10000, 0.2, 0.999, 0), 11996);
+}
+
+BOOST_AUTO_TEST_CASE(handshakes_and_bursts_are_capped)
+{
+	reconnect::planner plan;
+	std::vector<fake_server> servers(10);
+	for (auto & serv : servers)
+	{
+		plan.schedule(&serv, 1000, 0.0, 0.5, 0);
+		plan.due(&serv, reconnect::PRIORITY_OTHER, SEC);
+	}
+
+	int started = 0;
+	for (auto & serv : servers)
+		started += plan.try_start(&serv, SEC);
+	BOOST_REQUIRE_EQUAL(started, reconnect::MAX_HANDSHAKES);
+	BOOST_REQUIRE_EQUAL(plan.handshakes(SEC), reconnect::MAX_HANDSHAKES);
+
+	/* logging in frees a handshake slot but holds a burst slot */
+	reconnect::timing took;
+	BOOST_REQUIRE(plan.logged_in(&servers[0], 3 * SEC, took));
+	BOOST_REQUIRE_EQUAL(took.attempt, 1);
+	BOOST_REQUIRE_EQUAL(took.backoff, SEC);
+	BOOST_REQUIRE_EQUAL(took.queued, 0);
+	BOOST_REQUIRE_EQUAL(took.login, 2 * SEC);
+	BOOST_REQUIRE_EQUAL(plan.attempts(&servers[0]), 0);
+	BOOST_REQUIRE(plan.try_start(&servers[3], 3 * SEC));
+
+	BOOST_REQUIRE(plan.logged_in(&servers[1], 3 * SEC, took));
+	BOOST_REQUIRE(plan.logged_in(&servers[2], 3 * SEC, took));
+	/* a login can't be put off, so the bursts may go over the cap... */
+	BOOST_REQUIRE_EQUAL(plan.bursts(3 * SEC), 3);
+	/* ...but then nothing new starts, though two handshake slots are free */
+	BOOST_REQUIRE(!plan.try_start(&servers[4], 3 * SEC));
+	/* until they've had their time */
+	BOOST_REQUIRE(plan.try_start(&servers[4], 3 * SEC + reconnect::BURST_US));
+
+	/* a failed handshake gives its slot back */
+	plan.release(&servers[3]);
+	BOOST_REQUIRE(plan.try_start(&servers[5], 3 * SEC + reconnect::BURST_US));
+	BOOST_REQUIRE(plan.try_start(&servers[6], 3 * SEC + reconnect::BURST_US));
+	BOOST_REQUIRE(!plan.try_start(&servers[7], 3 * SEC + reconnect::BURST_US));
+}
+
+BOOST_AUTO_TEST_CASE(favorites_go_first)
+{
+	reconnect::planner plan;
+	std::vector<fake_server> servers(reconnect::MAX_HANDSHAKES + 2);
+	auto & other = servers[reconnect::MAX_HANDSHAKES];
+	auto & favorite = servers[reconnect::MAX_HANDSHAKES + 1];
+
+	for (int i = 0; i < reconnect::MAX_HANDSHAKES; ++i)
+	{
+		plan.schedule(&servers[i], 1000, 0.0, 0.5, 0);
+		plan.due(&servers[i], reconnect::PRIORITY_OTHER, 0);
+		BOOST_REQUIRE(plan.try_start(&servers[i], 0));
+	}
+	plan.schedule(&other, 1000, 0.0, 0.5, 0);
+	plan.due(&other, reconnect::PRIORITY_OTHER, SEC);
+	plan.schedule(&favorite, 1000, 0.0, 0.5, 0);
+	plan.due(&favorite, reconnect::PRIORITY_FAVORITE, 2 * SEC);
+
+	plan.release(&servers[0]);
+	/* other has been due for longer, but the favorite gets the slot */
+	BOOST_REQUIRE(!plan.try_start(&other, 3 * SEC));
+	BOOST_REQUIRE(plan.try_start(&favorite, 3 * SEC));
+
+	/* a stuck handshake doesn't block the queue forever */
+	BOOST_REQUIRE(!plan.try_start(&other, 3 * SEC));
+	BOOST_REQUIRE(plan.try_start(&other, reconnect::HANDSHAKE_TIMEOUT_US));
+
+	reconnect::timing took;
+	BOOST_REQUIRE(plan.logged_in(&other, reconnect::HANDSHAKE_TIMEOUT_US + SEC, took));
+	BOOST_REQUIRE_EQUAL(took.queued, reconnect::HANDSHAKE_TIMEOUT_US - SEC);
+	plan.forget(&other);
+	BOOST_REQUIRE(!plan.logged_in(&other, reconnect::HANDSHAKE_TIMEOUT_US + SEC, took));
+}
+
+BOOST_AUTO_TEST_CASE(manual_connect_frees_the_queue)
+{
+	reconnect::planner plan;
+	std::vector<fake_server> servers(reconnect::MAX_HANDSHAKES + 2);
+	auto & manual = servers[reconnect::MAX_HANDSHAKES];
+	auto & behind = servers[reconnect::MAX_HANDSHAKES + 1];
+
+	for (int i = 0; i < reconnect::MAX_HANDSHAKES; ++i)
+	{
+		plan.schedule(&servers[i], 1000, 0.0, 0.5, 0);
+		plan.due(&servers[i], reconnect::PRIORITY_OTHER, 0);
+		BOOST_REQUIRE(plan.try_start(&servers[i], 0));
+	}
+	plan.schedule(&manual, 1000, 0.0, 0.5, 0);
+	plan.due(&manual, reconnect::PRIORITY_FAVORITE, SEC);
+	plan.schedule(&behind, 1000, 0.0, 0.5, 0);
+	plan.due(&behind, reconnect::PRIORITY_OTHER, 2 * SEC);
+
+	/* manual is waiting for a slot when the user connects it by hand, so
+	 * its retry finds it already connecting and gives up its place */
+	BOOST_REQUIRE(!plan.try_start(&manual, 2 * SEC));
+	plan.release(&manual);
+	BOOST_REQUIRE(!plan.try_start(&manual, 2 * SEC));
+
+	/* the free slot goes to the next one in line instead of being held for it */
+	plan.release(&servers[0]);
+	BOOST_REQUIRE(plan.try_start(&behind, 3 * SEC));
+	BOOST_REQUIRE_EQUAL(plan.handshakes(3 * SEC), reconnect::MAX_HANDSHAKES);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <startup.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(startup_test)
+
+BOOST_AUTO_TEST_CASE(run_parallel_runs_every_phase)
+{
+	std::atomic_int ran(0);
+	startup::run_parallel({
+		{ "one", [&ran]{ ran += 1; } },
+		{ "two", [&ran]{ ran += 10; } },
+		{ "three", [&ran]{ ran += 100; } },
+	});
+	BOOST_REQUIRE_EQUAL(ran.load(), 111);
+}
+
+BOOST_AUTO_TEST_CASE(run_parallel_passes_on_errors)
+{
+	std::atomic_int ran(0);
+	BOOST_REQUIRE_THROW(startup::run_parallel({
+		{ "fails", []{ throw std::runtime_error("broken"); } },
+		{ "works", [&ran]{ ran += 1; } },
+	}), std::runtime_error);
+	/* the others still got to finish */
+	BOOST_REQUIRE_EQUAL(ran.load(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(spans_end_up_in_trace)
+{
+	{
+		startup::span ignored("before \"enable\"");
+	}
+	startup::trace_enable();
+	BOOST_REQUIRE(startup::tracing());
+	{
+		startup::span outer("outer \"quoted\"");
+		startup::run_parallel({
+			{ "worker", []{} },
+			{ "inline", []{} },
+		});
+	}
+
+	const auto json = startup::trace_json();
+	BOOST_REQUIRE_EQUAL(json.find("before"), std::string::npos);
+	BOOST_REQUIRE_NE(json.find("\"name\":\"outer \\\"quoted\\\"\""), std::string::npos);
+	BOOST_REQUIRE_NE(json.find("\"name\":\"worker\""), std::string::npos);
+	BOOST_REQUIRE_NE(json.find("\"name\":\"inline\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"), std::string::npos);
+	BOOST_REQUIRE_NE(json.find("\"tid\":2,"), std::string::npos);
+	BOOST_REQUIRE_EQUAL(json.compare(0, 15, "{\"traceEvents\":"), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
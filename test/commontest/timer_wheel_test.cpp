@@ -0,0 +1,107 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+#include <timer_wheel.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(timer_wheel_test)
+
+BOOST_AUTO_TEST_CASE(runs_each_level_on_time)
+{
+	timer_wheel wheel(1000);
+	std::vector<std::int64_t> ran;
+	std::int64_t now = 1000;
+	/* one on each wheel, and one further than the top wheel reaches */
+	const std::vector<std::int64_t> dues{ 1010, 1000 + 3000, 1000 + 200000, 1000 + 5000000, 1000 + 30000000 };
+	for (auto due : dues)
+		wheel.add(due, 0, [&]{ ran.push_back(now); return false; });
+
+	for (auto due : dues)
+	{
+		BOOST_REQUIRE_EQUAL(wheel.next_due(), due);
+		now = due - 1;
+		BOOST_REQUIRE_EQUAL(wheel.advance(now), 0u);
+		now = due;
+		BOOST_REQUIRE_EQUAL(wheel.advance(now), 1u);
+	}
+	BOOST_REQUIRE(ran == dues);
+	BOOST_REQUIRE_EQUAL(wheel.next_due(), -1);
+	BOOST_REQUIRE_EQUAL(wheel.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(repeats_and_cancels)
+{
+	timer_wheel wheel(0);
+	int ticks = 0;
+	timer_wheel::id other = 0;
+	const auto repeating = wheel.add(500, 500, [&]{ return ++ticks < 3; });
+	other = wheel.add(1200, 0, [&]{ BOOST_FAIL("cancelled timer ran"); return false; });
+	/* cancels the other one from inside a callback */
+	wheel.add(1000, 0, [&]{ BOOST_REQUIRE(wheel.cancel(other)); return false; });
+
+	BOOST_REQUIRE_EQUAL(wheel.advance(1499), 3u);
+	BOOST_REQUIRE_EQUAL(ticks, 2);
+	BOOST_REQUIRE(wheel.pending(repeating));
+	BOOST_REQUIRE(!wheel.pending(other));
+	BOOST_REQUIRE_EQUAL(wheel.next_due(), 1500);
+	BOOST_REQUIRE_EQUAL(wheel.advance(100000), 1u);
+	BOOST_REQUIRE_EQUAL(ticks, 3);
+	BOOST_REQUIRE(!wheel.pending(repeating));
+	BOOST_REQUIRE(!wheel.cancel(repeating));
+}
+
+BOOST_AUTO_TEST_CASE(matches_a_sorted_list)
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<std::int64_t> delay(0, 20000000);
+	std::uniform_int_distribution<std::int64_t> step(0, 300000);
+	timer_wheel wheel(0);
+	std::multimap<std::int64_t, int> expected;
+	std::int64_t now = 0;
+	int fired = 0;
+	for (int i = 0; i < 2000; ++i)
+	{
+		const auto due = now + delay(rng) / (i % 3 + 1);
+		expected.emplace(due, i);
+		wheel.add(due, 0, [&, due]{
+			BOOST_REQUIRE_LE(due, now);
+			++fired;
+			return false;
+		});
+		if (i % 4 == 0)
+		{
+			BOOST_REQUIRE_EQUAL(wheel.next_due(), expected.begin()->first);
+			now += step(rng);
+			const auto due_now = std::distance(expected.begin(), expected.upper_bound(now));
+			BOOST_REQUIRE_EQUAL(wheel.advance(now), static_cast<std::size_t>(due_now));
+			expected.erase(expected.begin(), expected.upper_bound(now));
+		}
+	}
+	now += 30000000;
+	wheel.advance(now);
+	BOOST_REQUIRE_EQUAL(fired, 2000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,249 @@
+/* HexChat
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#include <cctype>
+#include <ctime>
+#include <set>
+#include <string>
+#include <vector>
+#include <user_directory.hpp>
+#include <userlist.hpp>
+#include <boost/optional.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+	std::string fold(const std::string & nick)
+	{
+		std::string folded(nick);
+		for (auto & c : folded)
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return folded;
+	}
+
+	/* what a string costs beyond its sizeof */
+	std::size_t heap(const std::string & s)
+	{
+		const auto data = reinterpret_cast<const char *>(s.data());
+		const auto self = reinterpret_cast<const char *>(&s);
+		return data >= self && data < self + sizeof(s) ? 0 : s.capacity() + 1;
+	}
+
+	std::size_t heap(const boost::optional<std::string> & s)
+	{
+		return s ? heap(*s) : 0;
+	}
+
+	/* a hash node: the value and the next pointer, the cached hash */
+	template<typename T>
+	std::size_t node(const T &)
+	{
+		return sizeof(T) + 2 * sizeof(void *);
+	}
+
+	/* struct User as it was, every channel had its own copy */
+	struct legacy_user
+	{
+		std::string nick;
+		boost::optional<std::string> hostname;
+		boost::optional<std::string> realname;
+		boost::optional<std::string> servername;
+		boost::optional<std::string> account;
+		time_t lasttalk;
+		unsigned int access;
+		char prefix[2];
+		bool op;
+		bool hop;
+		bool voice;
+		bool me;
+		bool away;
+		bool selected;
+	};
+
+	struct person
+	{
+		std::string nick;
+		std::string hostname;
+		std::string realname;
+		std::string servername;
+		std::string account;
+	};
+
+	std::vector<person> make_people(std::size_t count)
+	{
+		std::vector<person> people;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto n = std::to_string(i);
+			person p;
+			p.nick = "nick" + n;
+			/* every fifth one is behind one of ten bouncers */
+			p.hostname = i % 5 == 0 ? "~znc@bouncer" + std::to_string(i % 10) + ".example.net"
+				: "~user" + n + "@host-" + n + ".dsl.example.com";
+			p.realname = "Some Real Name " + n;
+			p.servername = "leaf" + std::to_string(i % 30) + ".irc.example.org";
+			if (i % 2)
+				p.account = "acct" + n;
+			people.push_back(p);
+		}
+		return people;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(user_directory_test)
+
+BOOST_AUTO_TEST_CASE(channels_share_one_entry)
+{
+	user_directory users;
+	{
+		auto first = users.acquire(fold("Alice"), "Alice");
+		auto second = users.acquire(fold("ALICE"), "ALICE");
+		BOOST_REQUIRE_EQUAL(first.get(), second.get());
+		BOOST_REQUIRE_EQUAL(first->nick, "Alice");
+		BOOST_REQUIRE_EQUAL(users.size(), 1u);
+
+		users.set_hostname(*first, "~a@example.com");
+		users.set_servername(*first, "irc.example.org");
+		auto bob = users.acquire(fold("bob"), "bob");
+		users.set_servername(*bob, "irc.example.org");
+		BOOST_REQUIRE_EQUAL(first->servername, bob->servername);
+		BOOST_REQUIRE_EQUAL(users.strings(), 2u);
+
+		first.reset();
+		BOOST_REQUIRE(users.find(fold("alice")));
+	}
+	/* the last channel let go of both */
+	BOOST_REQUIRE_EQUAL(users.size(), 0u);
+	BOOST_REQUIRE_EQUAL(users.strings(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(rename_and_rehash_keep_the_entry)
+{
+	user_directory users;
+	auto alice = users.acquire(fold("alice"), "alice");
+	BOOST_REQUIRE_EQUAL(users.rename(fold("alice"), fold("Alicia"), "Alicia"), alice.get());
+	BOOST_REQUIRE_EQUAL(alice->nick, "Alicia");
+	BOOST_REQUIRE(!users.find(fold("alice")));
+	BOOST_REQUIRE_EQUAL(users.find(fold("ALICIA")), alice.get());
+	/* the other channels come asking under the old nick */
+	BOOST_REQUIRE(!users.rename(fold("alice"), fold("Alicia"), "Alicia"));
+
+	users.rehash([](const std::string & nick){ return nick; });
+	BOOST_REQUIRE(!users.find("alicia"));
+	BOOST_REQUIRE_EQUAL(users.find("Alicia"), alice.get());
+	alice.reset();
+	BOOST_REQUIRE_EQUAL(users.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_for_100k_memberships)
+{
+	/* 25000 people in 4 of 20 channels each */
+	const std::size_t channels = 20;
+	const std::size_t per_person = 4;
+	const auto people = make_people(25000);
+
+	std::size_t before = 0;
+	{
+		std::vector<std::vector<legacy_user>> lists(channels);
+		for (std::size_t i = 0; i < people.size(); ++i)
+		{
+			const auto & p = people[i];
+			for (std::size_t c = 0; c < per_person; ++c)
+			{
+				legacy_user u{};
+				u.nick = p.nick;
+				u.hostname = p.hostname;
+				u.realname = p.realname;
+				u.servername = p.servername;
+				if (!p.account.empty())
+					u.account = p.account;
+				lists[(i + c * 5) % channels].push_back(u);
+			}
+		}
+		for (const auto & list : lists)
+		{
+			for (const auto & u : list)
+			{
+				before += sizeof(u) + heap(u.nick) + heap(u.hostname) + heap(u.realname)
+					+ heap(u.servername) + heap(u.account);
+			}
+		}
+	}
+
+	std::size_t after = 0;
+	std::size_t memberships = 0;
+	{
+		user_directory users;
+		std::vector<std::vector<User>> lists(channels);
+		for (std::size_t i = 0; i < people.size(); ++i)
+		{
+			const auto & p = people[i];
+			for (std::size_t c = 0; c < per_person; ++c)
+			{
+				User m;
+				m.info = users.acquire(fold(p.nick), p.nick);
+				users.set_hostname(*m.info, p.hostname);
+				m.info->realname = p.realname;
+				users.set_servername(*m.info, p.servername);
+				if (!p.account.empty())
+					m.info->account = p.account;
+				lists[(i + c * 5) % channels].push_back(m);
+			}
+		}
+		BOOST_REQUIRE_EQUAL(users.size(), people.size());
+
+		for (const auto & list : lists)
+			memberships += list.size();
+		after += memberships * sizeof(User);
+
+		/* each entry, and its node in the directory under the folded nick;
+		   the nick is in there three times, as is and folded twice */
+		std::pair<const std::string, user_info *> by_key;
+		for (const auto & p : people)
+		{
+			auto info = users.find(fold(p.nick));
+			BOOST_REQUIRE(info);
+			after += sizeof(user_info) + 3 * heap(info->nick) + heap(info->realname) + heap(info->account)
+				+ node(by_key);
+		}
+		/* the pool, one of each host and servername */
+		std::set<std::string> distinct;
+		for (const auto & p : people)
+		{
+			distinct.insert(p.hostname);
+			distinct.insert(p.servername);
+		}
+		BOOST_REQUIRE_EQUAL(users.strings(), distinct.size());
+		std::pair<const std::string, std::size_t> pooled;
+		std::size_t pooled_heap = 0;
+		for (const auto & str : distinct)
+			pooled_heap += heap(str);
+		after += users.strings() * node(pooled) + pooled_heap;
+	}
+
+	BOOST_REQUIRE_EQUAL(memberships, 100000u);
+	BOOST_REQUIRE_LT(after, before);
+	BOOST_TEST_MESSAGE("20 channels, 100k memberships: " << before / 1024 << " KiB before, "
+		<< after / 1024 << " KiB after (" << sizeof(legacy_user) << " vs " << sizeof(User)
+		<< " bytes a membership)");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,183 @@
+/* libirc
+* Copyright (C) 2015 Leetsoftwerx.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+// do not uncomment this should only be defined once
+//#define BOOST_TEST_MODULE irc_proto_tests
+#ifndef _MSC_VER
+#define BOOST_TEST_DYN_LINK
+#endif
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/test/unit_test.hpp>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <tcp_connection.hpp>
+
+namespace
+{
+	namespace asio = boost::asio;
+
+	/* a throwaway self-signed certificate for the loopback server */
+	void use_self_signed(asio::ssl::context & ctx)
+	{
+		std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> keygen(EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr), &EVP_PKEY_CTX_free);
+		EVP_PKEY *raw_key = nullptr;
+		BOOST_REQUIRE(EVP_PKEY_keygen_init(keygen.get()) == 1);
+		BOOST_REQUIRE(EVP_PKEY_CTX_set_rsa_keygen_bits(keygen.get(), 2048) == 1);
+		BOOST_REQUIRE(EVP_PKEY_keygen(keygen.get(), &raw_key) == 1);
+		std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(raw_key, &EVP_PKEY_free);
+
+		std::unique_ptr<X509, decltype(&X509_free)> cert(X509_new(), &X509_free);
+		X509_set_version(cert.get(), 2);
+		ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+		X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+		X509_gmtime_adj(X509_getm_notAfter(cert.get()), 60 * 60);
+		X509_set_pubkey(cert.get(), key.get());
+		auto name = X509_get_subject_name(cert.get());
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+		X509_set_issuer_name(cert.get(), name);
+		BOOST_REQUIRE(X509_sign(cert.get(), key.get(), EVP_sha256()) > 0);
+
+		BOOST_REQUIRE(SSL_CTX_use_certificate(ctx.native_handle(), cert.get()) == 1);
+		BOOST_REQUIRE(SSL_CTX_use_PrivateKey(ctx.native_handle(), key.get()) == 1);
+	}
+
+	/* accepts connections on 127.0.0.1, greets each one and counts the
+	 * handshakes that resumed an earlier session */
+	class loopback_server
+	{
+	public:
+		explicit loopback_server(int connections)
+			:handshakes(0), resumed(0), stopping_(false),
+			ctx_(asio::ssl::context::sslv23),
+			acceptor_(io_service_, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0))
+		{
+			use_self_signed(ctx_);
+			const unsigned char id[] = "libirctest";
+			SSL_CTX_set_session_id_context(ctx_.native_handle(), id, sizeof(id) - 1);
+			thread_ = std::thread([this, connections]{ serve(connections); });
+		}
+
+		/* a failed BOOST_REQUIRE can leave serve() waiting in accept(),
+		 * and closing the acceptor doesn't wake that up everywhere, so
+		 * it's woken with one last connection */
+		~loopback_server()
+		{
+			stopping_ = true;
+			asio::io_service io_service;
+			asio::ip::tcp::socket wake(io_service);
+			boost::system::error_code ec;
+			wake.connect(acceptor_.local_endpoint(), ec);
+			thread_.join();
+		}
+
+		unsigned short port() const
+		{
+			return acceptor_.local_endpoint().port();
+		}
+
+		std::atomic_int handshakes;
+		std::atomic_int resumed;
+
+	private:
+		void serve(int connections)
+		{
+			for (int i = 0; i < connections; ++i)
+			{
+				asio::ssl::stream<asio::ip::tcp::socket> stream(io_service_, ctx_);
+				boost::system::error_code ec;
+				acceptor_.accept(stream.lowest_layer(), ec);
+				if (ec || stopping_)
+					return;
+				stream.lowest_layer().set_option(asio::ip::tcp::no_delay(true), ec);
+				stream.handshake(asio::ssl::stream_base::server, ec);
+				if (ec)
+					continue;
+				handshakes++;
+				if (SSL_session_reused(stream.native_handle()))
+					resumed++;
+
+				asio::write(stream, asio::buffer(std::string("PING :loopback\r\n")), ec);
+				/* wait for the client to hang up */
+				char buf[64];
+				while (!ec)
+					stream.read_some(asio::buffer(buf), ec);
+			}
+		}
+
+		std::atomic_bool stopping_;
+		asio::io_service io_service_;
+		asio::ssl::context ctx_;
+		asio::ip::tcp::acceptor acceptor_;
+		std::thread thread_;
+	};
+
+	/* connects, waits for the greeting and hangs up; false on failure */
+	bool connect_once(unsigned short port)
+	{
+		asio::io_service io_service;
+		auto resolved = io::tcp::resolve_endpoints(io_service, "127.0.0.1", port);
+		if (resolved.first)
+			return false;
+
+		auto conn = io::tcp::connection::create_connection(io::tcp::connection_security::no_verify, io_service);
+		bool greeted = false;
+		bool failed = false;
+		conn->on_message.connect([&greeted](const std::string &, size_t){ greeted = true; });
+		conn->on_error.connect([&failed](const boost::system::error_code &){ failed = true; });
+		conn->connect(resolved.second);
+
+		const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!greeted && !failed && std::chrono::steady_clock::now() < give_up)
+		{
+			conn->poll();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return greeted;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(tls_resume)
+
+BOOST_AUTO_TEST_CASE(reconnects_resume_the_session)
+{
+	const int reconnects = 10;
+	loopback_server server(reconnects + 1);
+
+	const auto start = std::chrono::steady_clock::now();
+	BOOST_REQUIRE(connect_once(server.port()));
+	const auto first_done = std::chrono::steady_clock::now();
+	for (int i = 0; i < reconnects; ++i)
+		BOOST_REQUIRE(connect_once(server.port()));
+	const auto end = std::chrono::steady_clock::now();
+
+	BOOST_REQUIRE_EQUAL(server.handshakes.load(), reconnects + 1);
+	BOOST_REQUIRE_EQUAL(server.resumed.load(), reconnects);
+
+	typedef std::chrono::duration<double, std::milli> ms;
+	BOOST_TEST_MESSAGE("first connect " << ms(first_done - start).count() << "ms, resumed reconnects "
+		<< ms(end - first_done).count() / reconnects << "ms each");
+}
+
+BOOST_AUTO_TEST_SUITE_END()